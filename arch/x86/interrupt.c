@@ -6,66 +6,414 @@
  */
 
 #include <arch/interrupt.h>
+#include <arch/pic.h>
+#include <arch/percpu.h>
 #include <kernel/string.h>
+#include <kernel/spinlock.h>
+#include <kernel/rcu.h>
 
-/* 中断处理函数表 */
-static interrupt_handler_t interrupt_handlers[256];
+/* 处理链节点 */
+typedef struct interrupt_action {
+    interrupt_handler_t handler;
+    void *data;
+    const char *name;
+    struct interrupt_action *next;
+    struct interrupt_action *removed_next;  /* 同一次摘除的节点，next要留给读者 */
+    int used;
+} interrupt_action_t;
+
+/* 每个向量的处理链（分发路径按RCU无锁遍历） */
+static interrupt_action_t *interrupt_actions[INTERRUPT_VECTORS];
+
+/* 处理链节点池，中断路径不分配内存 */
+static interrupt_action_t interrupt_action_pool[INTERRUPT_MAX_ACTIONS];
+
+/* 保护处理链的修改 */
+static DEFINE_SPINLOCK(interrupt_lock);
+
+/* 没有处理函数时的回调 */
+static interrupt_unhandled_t interrupt_unhandled_hook;
+
+/* 当前中断控制器 */
+static const interrupt_controller_t *interrupt_controller = &pic_controller;
+
+/* 每CPU中断嵌套深度和各向量统计 */
+static DEFINE_PER_CPU(uint32_t, irq_nesting);
+static DEFINE_PER_CPU(uint32_t [INTERRUPT_VECTORS], irq_count);
+static DEFINE_PER_CPU(uint64_t [INTERRUPT_VECTORS], irq_cycles);
+
+/* 没有处理函数的中断次数 */
+static volatile uint32_t interrupt_unhandled_count;
 
 /**
  * @brief 初始化中断系统
  */
 int interrupt_init(void) {
-    /* 清零中断处理函数表 */
-    memset(interrupt_handlers, 0, sizeof(interrupt_handlers));
+    /* 清空处理链 */
+    memset(interrupt_actions, 0, sizeof(interrupt_actions));
+    memset(interrupt_action_pool, 0, sizeof(interrupt_action_pool));
 
-    /* 这里应该设置IDT和其他中断硬件 */
-    /* 简化实现 */
+    /* 默认使用8259A，平台支持时再切换到IOAPIC */
+    pic_init();
+    interrupt_controller = &pic_controller;
 
     return 0;
 }
 
 /**
- * @brief 设置中断处理函数
+ * @brief 在处理链末尾登记处理函数
  */
-int interrupt_set_handler(uint8_t vector, interrupt_handler_t handler) {
-    if (vector >= 256) {
+int interrupt_register(uint8_t vector, interrupt_handler_t handler, void *data,
+                       const char *name) {
+    interrupt_action_t *action = NULL;
+
+    if (!handler) {
         return -1;
     }
 
-    interrupt_handlers[vector] = handler;
-    return 0;
+    uint32_t flags = spinlock_lock_irqsave(&interrupt_lock);
+
+    for (int i = 0; i < INTERRUPT_MAX_ACTIONS; i++) {
+        if (!interrupt_action_pool[i].used) {
+            action = &interrupt_action_pool[i];
+            break;
+        }
+    }
+
+    if (action) {
+        action->handler = handler;
+        action->data = data;
+        action->name = name ? name : "-";
+        action->next = NULL;
+        action->used = 1;
+
+        /* 节点初始化完成后再发布 */
+        interrupt_action_t **link = &interrupt_actions[vector];
+        while (*link) {
+            link = &(*link)->next;
+        }
+        rcu_assign_pointer(*link, action);
+    }
+
+    spinlock_unlock_irqrestore(&interrupt_lock, flags);
+    return action ? 0 : -1;
+}
+
+/**
+ * @brief 从处理链中摘下匹配的节点（handler为NULL时匹配全部）
+ * @return 摘下的节点链表
+ */
+static interrupt_action_t *interrupt_unlink(uint8_t vector, interrupt_handler_t handler,
+                                            void *data) {
+    interrupt_action_t *removed = NULL;
+    interrupt_action_t **removed_tail = &removed;
+    interrupt_action_t **link = &interrupt_actions[vector];
+
+    while (*link) {
+        interrupt_action_t *action = *link;
+        if (!handler || (action->handler == handler && action->data == data)) {
+            /* 正在遍历的CPU仍能沿action->next继续 */
+            rcu_assign_pointer(*link, action->next);
+            action->used = -1;  /* 宽限期结束前不能复用 */
+            action->removed_next = NULL;
+            *removed_tail = action;
+            removed_tail = &action->removed_next;
+        } else {
+            link = &action->next;
+        }
+    }
+
+    return removed;
+}
+
+/**
+ * @brief 等待宽限期后回收本次摘下的节点
+ *
+ * 只回收removed链表上的节点：其他CPU同时摘下的节点属于另一个宽限期，
+ * 由它们自己的调用者回收。
+ */
+static void interrupt_reclaim(interrupt_action_t *removed) {
+    if (!removed) {
+        return;
+    }
+
+    synchronize_rcu();
+
+    uint32_t flags = spinlock_lock_irqsave(&interrupt_lock);
+    while (removed) {
+        interrupt_action_t *next = removed->removed_next;
+        removed->removed_next = NULL;
+        removed->used = 0;
+        removed = next;
+    }
+    spinlock_unlock_irqrestore(&interrupt_lock, flags);
 }
 
 /**
- * @brief 移除中断处理函数
+ * @brief 移除处理函数
+ */
+void interrupt_unregister(uint8_t vector, interrupt_handler_t handler, void *data) {
+    uint32_t flags = spinlock_lock_irqsave(&interrupt_lock);
+    interrupt_action_t *removed = interrupt_unlink(vector, handler, data);
+    spinlock_unlock_irqrestore(&interrupt_lock, flags);
+
+    interrupt_reclaim(removed);
+}
+
+/**
+ * @brief 设置中断处理函数（替换整条处理链）
+ */
+int interrupt_set_handler(uint8_t vector, interrupt_handler_t handler) {
+    interrupt_remove_handler(vector);
+    return interrupt_register(vector, handler, NULL, NULL);
+}
+
+/**
+ * @brief 移除向量上的所有处理函数
  */
 void interrupt_remove_handler(uint8_t vector) {
-    if (vector < 256) {
-        interrupt_handlers[vector] = NULL;
+    interrupt_unregister(vector, NULL, NULL);
+}
+
+/**
+ * @brief 设置没有处理函数时的回调
+ */
+void interrupt_set_unhandled_hook(interrupt_unhandled_t hook) {
+    interrupt_unhandled_hook = hook;
+}
+
+/**
+ * @brief 中断分发
+ */
+void interrupt_dispatch(interrupt_frame_t *frame) {
+    uint8_t vector = (uint8_t)frame->vector;
+    uint64_t start = rdtsc();
+
+    /* 只有外部中断和IPI算中断上下文：异常（如用户地址的页故障）属于
+     * 被打断的线程，处理时可以睡眠 */
+    int external = vector >= INTERRUPT_EXCEPTIONS;
+
+    if (external) {
+        this_cpu_inc(irq_nesting);
+    }
+
+    /* 可能刚从停机空闲中醒来，遍历处理链之前恢复RCU检测 */
+    rcu_irq_enter();
+
+    interrupt_action_t *action = rcu_dereference(interrupt_actions[vector]);
+    if (action) {
+        /* 共享中断：每个处理函数自己判断设备是否有事件 */
+        for (; action; action = rcu_dereference(action->next)) {
+            action->handler(frame, action->data);
+        }
+    } else {
+        __sync_fetch_and_add(&interrupt_unhandled_count, 1);
+        if (interrupt_unhandled_hook) {
+            interrupt_unhandled_hook(frame);
+        }
+    }
+
+    interrupt_eoi(vector);
+
+    if (external) {
+        this_cpu_dec(irq_nesting);
+    }
+
+    /* 中断已关闭，直接修改本CPU的统计 */
+    this_cpu_inc(irq_count[vector]);
+    *this_cpu_ptr(&irq_cycles[vector]) += rdtsc() - start;
+}
+
+/**
+ * @brief 读取向量在某个CPU上的统计
+ */
+uint32_t interrupt_get_count(uint8_t vector, uint32_t cpu, uint64_t *cycles) {
+    if (cpu >= NR_CPUS) {
+        return 0;
+    }
+    if (cycles) {
+        *cycles = per_cpu(irq_cycles, cpu)[vector];
+    }
+    return per_cpu(irq_count, cpu)[vector];
+}
+
+/* 统计表输出位置 */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} interrupt_out_t;
+
+/**
+ * @brief 追加字符串
+ */
+static void interrupt_put(interrupt_out_t *out, const char *s) {
+    while (*s && out->len + 1 < out->size) {
+        out->buf[out->len++] = *s++;
     }
 }
 
+/**
+ * @brief 追加64位无符号整数，右对齐到width列
+ *
+ * 按16位分段做除法，避免依赖libgcc的64位除法。
+ */
+static void interrupt_put_u64(interrupt_out_t *out, uint64_t value, size_t width) {
+    char field[24];
+    int pos = sizeof(field) - 1;
+
+    field[pos] = '\0';
+    do {
+        uint32_t limbs[4] = {
+            (uint32_t)(value >> 48) & 0xFFFF, (uint32_t)(value >> 32) & 0xFFFF,
+            (uint32_t)(value >> 16) & 0xFFFF, (uint32_t)value & 0xFFFF
+        };
+        uint32_t rem = 0;
+
+        for (int i = 0; i < 4; i++) {
+            uint32_t cur = (rem << 16) | limbs[i];
+            limbs[i] = cur / 10;
+            rem = cur % 10;
+        }
+
+        field[--pos] = (char)('0' + rem);
+        value = ((uint64_t)limbs[0] << 48) | ((uint64_t)limbs[1] << 32) |
+                ((uint64_t)limbs[2] << 16) | limbs[3];
+    } while (value);
+
+    while ((size_t)(sizeof(field) - 1 - pos) < width && pos > 0) {
+        field[--pos] = ' ';
+    }
+
+    interrupt_put(out, &field[pos]);
+}
+
+/**
+ * @brief 生成类似/proc/interrupts的统计表
+ *
+ * 每行：向量、各CPU次数、累计处理周期、控制器、处理函数名。
+ */
+int interrupt_show(char *buf, size_t size, uint32_t ncpus) {
+    interrupt_out_t out = { buf, size, 0 };
+
+    if (!buf || size == 0) {
+        return 0;
+    }
+    if (ncpus == 0 || ncpus > NR_CPUS) {
+        ncpus = NR_CPUS;
+    }
+
+    interrupt_put(&out, "    ");
+    for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+        interrupt_put(&out, "       CPU");
+        interrupt_put_u64(&out, cpu, 1);
+    }
+    interrupt_put(&out, "          cycles\n");
+
+    rcu_read_lock();
+    for (uint32_t vector = 0; vector < INTERRUPT_VECTORS; vector++) {
+        interrupt_action_t *action = rcu_dereference(interrupt_actions[vector]);
+        uint64_t cycles = 0;
+        uint32_t total = 0;
+
+        for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+            uint64_t c;
+            total += interrupt_get_count((uint8_t)vector, cpu, &c);
+            cycles += c;
+        }
+        if (!action && !total) {
+            continue;
+        }
+
+        interrupt_put_u64(&out, vector, 3);
+        interrupt_put(&out, ":");
+        for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+            interrupt_put_u64(&out, interrupt_get_count((uint8_t)vector, cpu, NULL), 11);
+        }
+        interrupt_put_u64(&out, cycles, 16);
+
+        interrupt_put(&out, "  ");
+        if (vector < INTERRUPT_EXCEPTIONS) {
+            interrupt_put(&out, "exception");
+        } else if (IRQ_VECTOR_VALID(vector)) {
+            interrupt_put(&out, interrupt_controller->name);
+        } else {
+            interrupt_put(&out, "vector");
+        }
+
+        for (int first = 1; action; action = rcu_dereference(action->next), first = 0) {
+            interrupt_put(&out, first ? "  " : ", ");
+            interrupt_put(&out, action->name);
+        }
+        interrupt_put(&out, "\n");
+    }
+    rcu_read_unlock();
+
+    interrupt_put(&out, "ERR:");
+    interrupt_put_u64(&out, interrupt_unhandled_count, 11);
+    interrupt_put(&out, "\n");
+
+    out.buf[out.len] = '\0';
+    return (int)out.len;
+}
+
+/**
+ * @brief 切换中断控制器
+ */
+void interrupt_set_controller(const interrupt_controller_t *controller) {
+    if (controller) {
+        interrupt_controller = controller;
+    }
+}
+
+/**
+ * @brief 获取当前中断控制器
+ */
+const interrupt_controller_t *interrupt_get_controller(void) {
+    return interrupt_controller;
+}
+
 /**
  * @brief 启用中断
  */
 void interrupt_enable(uint8_t vector) {
-    /* 这里应该操作PIC来启用特定中断 */
-    /* 简化实现 */
+    if (IRQ_VECTOR_VALID(vector)) {
+        interrupt_controller->enable(vector - IRQ_BASE);
+    }
 }
 
 /**
  * @brief 禁用中断
  */
 void interrupt_disable(uint8_t vector) {
-    /* 这里应该操作PIC来禁用特定中断 */
-    /* 简化实现 */
+    if (IRQ_VECTOR_VALID(vector)) {
+        interrupt_controller->disable(vector - IRQ_BASE);
+    }
+}
+
+/**
+ * @brief 通知中断控制器中断处理结束
+ */
+void interrupt_eoi(uint8_t vector) {
+    if (IRQ_VECTOR_VALID(vector)) {
+        interrupt_controller->eoi(vector - IRQ_BASE);
+    }
+}
+
+/**
+ * @brief 设置外部中断投递的CPU
+ */
+int interrupt_set_affinity(uint8_t vector, uint32_t cpu) {
+    if (!IRQ_VECTOR_VALID(vector) || !interrupt_controller->set_affinity) {
+        return -1;
+    }
+
+    return interrupt_controller->set_affinity(vector - IRQ_BASE, cpu);
 }
 
 /**
  * @brief 检查是否在中断上下文中
  */
 int interrupt_in_context(void) {
-    /* 这里应该检查当前是否在中断处理中 */
-    /* 简化实现 */
-    return 0;
-}
\ No newline at end of file
+    return this_cpu_read(irq_nesting) != 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file pic.c
+ * @brief 8259A可编程中断控制器
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#include <stddef.h>
+#include <arch/pic.h>
+#include <arch/io.h>
+
+/* 初始化命令字 */
+#define ICW1_INIT       0x10
+#define ICW1_ICW4       0x01
+#define ICW4_8086       0x01
+
+/* 从片级联在主片IRQ2 */
+#define PIC_CASCADE_IRQ 2
+
+/* 屏蔽字缓存，避免读端口 */
+static uint16_t pic_mask = 0xFFFF;
+
+/**
+ * @brief 把屏蔽字写入硬件
+ */
+static void pic_write_mask(void) {
+    outb(PIC1_DATA, (uint8_t)(pic_mask & 0xFF));
+    outb(PIC2_DATA, (uint8_t)(pic_mask >> 8));
+}
+
+/**
+ * @brief 取消屏蔽IRQ
+ */
+static void pic_enable(uint8_t irq) {
+    uint32_t flags = interrupt_save_and_disable();
+
+    pic_mask &= ~(1u << irq);
+    if (irq >= 8) {
+        pic_mask &= ~(1u << PIC_CASCADE_IRQ);  /* 从片需要级联线 */
+    }
+    pic_write_mask();
+
+    interrupt_restore(flags);
+}
+
+/**
+ * @brief 屏蔽IRQ
+ */
+static void pic_disable_irq(uint8_t irq) {
+    uint32_t flags = interrupt_save_and_disable();
+
+    pic_mask |= (1u << irq);
+    pic_write_mask();
+
+    interrupt_restore(flags);
+}
+
+/**
+ * @brief 中断结束（从片的IRQ需要同时通知两片）
+ */
+static void pic_eoi(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_COMMAND, PIC_EOI);
+    }
+    outb(PIC1_COMMAND, PIC_EOI);
+}
+
+const interrupt_controller_t pic_controller = {
+    .name = "8259A",
+    .enable = pic_enable,
+    .disable = pic_disable_irq,
+    .eoi = pic_eoi,
+    .set_affinity = NULL,   /* 只能投递到BSP */
+};
+
+/**
+ * @brief 重新映射向量并屏蔽所有IRQ
+ */
+void pic_init(void) {
+    outb(PIC1_COMMAND, ICW1_INIT | ICW1_ICW4);
+    outb(PIC2_COMMAND, ICW1_INIT | ICW1_ICW4);
+    outb(PIC1_DATA, IRQ_BASE);              /* 主片向量偏移 */
+    outb(PIC2_DATA, IRQ_BASE + 8);          /* 从片向量偏移 */
+    outb(PIC1_DATA, 1 << PIC_CASCADE_IRQ);  /* 从片在IRQ2 */
+    outb(PIC2_DATA, PIC_CASCADE_IRQ);       /* 从片级联标识 */
+    outb(PIC1_DATA, ICW4_8086);
+    outb(PIC2_DATA, ICW4_8086);
+
+    pic_mask = 0xFFFF;
+    pic_write_mask();
+}
+
+/**
+ * @brief 屏蔽所有IRQ
+ */
+void pic_disable(void) {
+    pic_mask = 0xFFFF;
+    pic_write_mask();
+}
+
+/**
+ * @brief 获取屏蔽字
+ */
+uint16_t pic_get_mask(void) {
+    return pic_mask;
+}
@@ -8,6 +8,10 @@
 #include <drivers/keyboard.h>
 #include <arch/io.h>
 #include <arch/interrupt.h>
+#include <kernel/softirq.h>
+#include <kernel/spinlock.h>
+#include <kernel/timer_wheel.h>
+#include <kernel/wait.h>
 #include <string.h>
 
 /* 当前扫描码集合 */
@@ -18,8 +22,33 @@ static modifier_keys_t keyboard_modifiers = {0};
 static uint8_t keyboard_leds = 0;
 static keyboard_handler_t user_handler = NULL;
 
-/* 键盘缓冲区 */
+/* 键盘缓冲区（下半部写入，读者在线程上下文取出） */
 static keyboard_buffer_t keyboard_buffer;
+static DEFINE_SPINLOCK(keyboard_buffer_lock);
+
+/* 在keyboard_wait_for_key中睡眠的线程，新事件入队后唤醒 */
+static DECLARE_WAIT_QUEUE_HEAD(keyboard_wait);
+
+/* 等待控制器就绪：先短暂轮询，仍未就绪则每个节拍检查一次直到超时 */
+#define KEYBOARD_READY_SPINS        1000
+#define KEYBOARD_READY_TIMEOUT_MS   100
+
+/* 不能睡眠时（下半部中设置LED、调度器未启动）的轮询次数上限 */
+#define KEYBOARD_READY_POLL_LIMIT   100000
+
+/*
+ * 上半部到下半部的扫描码队列：中断处理函数是唯一写者，
+ * tasklet是唯一读者（同一时刻只在一个CPU上运行），无需加锁
+ */
+#define KEYBOARD_SCANCODE_QUEUE_SIZE 64
+
+static uint8_t scancode_queue[KEYBOARD_SCANCODE_QUEUE_SIZE];
+static volatile uint32_t scancode_head;
+static volatile uint32_t scancode_tail;
+static volatile uint32_t scancode_dropped;
+
+static void keyboard_tasklet_func(void *data);
+static DECLARE_TASKLET(keyboard_tasklet, keyboard_tasklet_func, NULL);
 
 /* 扫描码映射表 - 美国键盘布局 */
 static const char scancode_to_ascii_table_set1[128] = {
@@ -92,23 +121,62 @@ int keyboard_init(void) {
     /* 设置LED状态 */
     keyboard_set_leds(keyboard_leds);
 
+    /* 登记中断处理函数并打开IRQ1 */
+    scancode_head = 0;
+    scancode_tail = 0;
+    interrupt_register(IRQ_KEYBOARD, keyboard_interrupt_handler, NULL, "keyboard");
+    interrupt_enable(IRQ_KEYBOARD);
+
     return 0;
 }
 
 /**
- * @brief 键盘中断处理函数
+ * @brief 键盘中断处理函数（上半部）
+ *
+ * 只读出扫描码放入队列并调度tasklet，扫描码解析、用户处理器、
+ * 行规程和回显都在下半部开中断执行。
  */
-void keyboard_interrupt_handler(void) {
+void keyboard_interrupt_handler(interrupt_frame_t *frame, void *data) {
+    (void)frame;
+    (void)data;
+
     /* 检查输出缓冲区是否有数据 */
     if (!keyboard_is_output_buffer_full()) {
         return;
     }
 
-    /* 读取扫描码 */
+    /* 读取扫描码，应答控制器 */
     uint8_t scancode = keyboard_read_data();
 
-    /* 处理扫描码 */
-    process_scancode(scancode);
+    uint32_t tail = scancode_tail;
+    if (tail - scancode_head >= KEYBOARD_SCANCODE_QUEUE_SIZE) {
+        /* 下半部来不及处理，丢弃 */
+        scancode_dropped++;
+        return;
+    }
+
+    scancode_queue[tail % KEYBOARD_SCANCODE_QUEUE_SIZE] = scancode;
+    barrier();
+    scancode_tail = tail + 1;
+
+    tasklet_schedule(&keyboard_tasklet);
+}
+
+/**
+ * @brief 键盘下半部：处理队列中的扫描码
+ */
+static void keyboard_tasklet_func(void *data) {
+    (void)data;
+
+    uint32_t head = scancode_head;
+
+    while (head != scancode_tail) {
+        uint8_t scancode = scancode_queue[head % KEYBOARD_SCANCODE_QUEUE_SIZE];
+        barrier();
+        scancode_head = ++head;
+
+        process_scancode(scancode);
+    }
 }
 
 /**
@@ -262,9 +330,11 @@ int keyboard_has_event(void) {
  * @brief 清空键盘缓冲区
  */
 void keyboard_flush(void) {
+    uint32_t flags = spinlock_lock_irqsave(&keyboard_buffer_lock);
     keyboard_buffer.head = 0;
     keyboard_buffer.tail = 0;
     keyboard_buffer.count = 0;
+    spinlock_unlock_irqrestore(&keyboard_buffer_lock, flags);
 }
 
 /**
@@ -396,6 +466,9 @@ void keyboard_remove_handler(void) {
  * @brief 缓冲区推送事件
  */
 static void buffer_push_event(const keyboard_event_t *event) {
+    /* 关中断：读者持锁时本CPU不会进入下半部 */
+    uint32_t flags = spinlock_lock_irqsave(&keyboard_buffer_lock);
+
     if (keyboard_buffer.count >= KEYBOARD_BUFFER_SIZE) {
         /* 缓冲区满，丢弃最旧的事件 */
         keyboard_buffer.head = (keyboard_buffer.head + 1) % KEYBOARD_BUFFER_SIZE;
@@ -405,13 +478,20 @@ static void buffer_push_event(const keyboard_event_t *event) {
     keyboard_buffer.buffer[keyboard_buffer.tail] = *event;
     keyboard_buffer.tail = (keyboard_buffer.tail + 1) % KEYBOARD_BUFFER_SIZE;
     keyboard_buffer.count++;
+
+    spinlock_unlock_irqrestore(&keyboard_buffer_lock, flags);
+
+    wake_up(&keyboard_wait);
 }
 
 /**
  * @brief 缓冲区弹出事件
  */
 static int buffer_pop_event(keyboard_event_t *event) {
+    uint32_t flags = spinlock_lock_irqsave(&keyboard_buffer_lock);
+
     if (keyboard_buffer.count == 0) {
+        spinlock_unlock_irqrestore(&keyboard_buffer_lock, flags);
         return -1;  /* 缓冲区空 */
     }
 
@@ -419,6 +499,8 @@ static int buffer_pop_event(keyboard_event_t *event) {
     keyboard_buffer.head = (keyboard_buffer.head + 1) % KEYBOARD_BUFFER_SIZE;
     keyboard_buffer.count--;
 
+    spinlock_unlock_irqrestore(&keyboard_buffer_lock, flags);
+
     return 0;
 }
 
@@ -426,33 +508,55 @@ static int buffer_pop_event(keyboard_event_t *event) {
  * @brief 等待键盘就绪
  */
 static int wait_for_keyboard_ready(void) {
-    for (int i = 0; i < 100000; i++) {
+    /* 控制器通常几微秒内就绪 */
+    for (int i = 0; i < KEYBOARD_READY_SPINS; i++) {
         if (!keyboard_is_input_buffer_full()) {
             return 0;
         }
+        cpu_relax();
     }
-    return -1;  /* 超时 */
+
+    if (!sleep_current()) {
+        for (int i = KEYBOARD_READY_SPINS; i < KEYBOARD_READY_POLL_LIMIT; i++) {
+            if (!keyboard_is_input_buffer_full()) {
+                return 0;
+            }
+            cpu_relax();
+        }
+        return -1;  /* 超时 */
+    }
+
+    uint64_t deadline = timer_get_jiffies() + msecs_to_jiffies(KEYBOARD_READY_TIMEOUT_MS);
+
+    while (keyboard_is_input_buffer_full()) {
+        if (timer_get_jiffies() >= deadline) {
+            return -1;  /* 超时 */
+        }
+        schedule_timeout(1);
+    }
+
+    return 0;
 }
 
 /**
  * @brief 等待按键
  */
 int keyboard_wait_for_key(uint32_t timeout) {
-    uint32_t start_time = 0;  /* 这里需要系统时间支持 */
+    uint32_t ticks = timeout > 0 ? msecs_to_jiffies(timeout) : TIMER_MAX_TIMEOUT;
 
-    while (1) {
-        if (keyboard_has_event()) {
-            return 0;
-        }
+    if (sleep_current()) {
+        return wait_event_timeout(&keyboard_wait, keyboard_has_event(), ticks) ? 0 : -1;
+    }
 
-        /* 检查超时 */
-        if (timeout > 0) {
-            uint32_t current_time = 0;  /* 这里需要系统时间支持 */
-            if ((current_time - start_time) >= timeout) {
-                return -1;  /* 超时 */
-            }
+    /* 不能睡眠（调度器未启动）：轮询 */
+    uint64_t deadline = timer_get_jiffies() + ticks;
+
+    while (!keyboard_has_event()) {
+        if (timeout > 0 && timer_get_jiffies() >= deadline) {
+            return -1;  /* 超时 */
         }
+        cpu_relax();
     }
 
     return 0;
-}
\ No newline at end of file
+}
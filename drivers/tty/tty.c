@@ -10,6 +10,7 @@
 #include <drivers/keyboard.h>
 #include <kernel/string.h>
 #include <kernel/memory.h>
+#include <kernel/timer_wheel.h>
 #include <stdarg.h>
 
 /* TTY管理器全局实例 */
@@ -22,7 +23,9 @@ static const tty_config_t default_tty_config = {
     .signal_en = 1,
     .crlf = 1,
     .tab_expand = 1,
-    .flow_control = 0
+    .flow_control = 0,
+    .vmin = 1,
+    .vtime = 0
 };
 
 /* 内部函数声明 */
@@ -31,6 +34,10 @@ static int tty_process_output_char(tty_device_t *tty, char ch);
 static int tty_line_discipline_input(tty_device_t *tty, char ch);
 static int tty_line_discipline_output(tty_device_t *tty, char ch);
 static void tty_update_display(tty_device_t *tty);
+static int tty_wait_input(tty_device_t *tty, uint32_t ticks);
+static size_t tty_take_input(tty_device_t *tty, char *buffer, size_t size, int line);
+static int tty_read_canonical(tty_device_t *tty, char *buffer, size_t size);
+static int tty_read_raw(tty_device_t *tty, char *buffer, size_t size);
 static void tty_save_cursor_state(tty_device_t *tty);
 static void tty_restore_cursor_state(tty_device_t *tty);
 static int tty_buffer_putchar(char *buffer, uint16_t *head, uint16_t *tail,
@@ -107,7 +114,9 @@ tty_device_t *tty_register(const char *name, int minor) {
     tty->cursor_visible = 1;
 
     /* 设置输入超时 */
-    tty->input_timeout = 0;  /* 无限等待 */
+    tty->input_timeout = 0;  /* 熟模式一直等待，生模式按vmin/vtime */
+    init_waitqueue_head(&tty->read_wait);
+    spinlock_init(&tty->input_lock, "tty_input");
 
     /* 初始化统计信息 */
     tty->bytes_read = 0;
@@ -203,30 +212,85 @@ int tty_read(int minor, char *buffer, size_t size) {
         return -1;
     }
 
+    if (tty->mode == TTY_MODE_COOKED) {
+        return tty_read_canonical(tty, buffer, size);
+    }
+    return tty_read_raw(tty, buffer, size);
+}
+
+/**
+ * @brief 熟模式读取：等待完整的一行
+ */
+static int tty_read_canonical(tty_device_t *tty, char *buffer, size_t size) {
+    /* 行规程只在回车时把整行移入输入缓冲区，有数据即有完整的行 */
+    uint32_t ticks = tty->input_timeout ? msecs_to_jiffies(tty->input_timeout)
+                                        : TIMER_MAX_TIMEOUT;
+
+    if (tty_wait_input(tty, ticks) != 0) {
+        return 0;
+    }
+
+    return (int)tty_take_input(tty, buffer, size, 1);
+}
+
+/**
+ * @brief 生模式读取：按vmin/vtime等待
+ */
+static int tty_read_raw(tty_device_t *tty, char *buffer, size_t size) {
+    uint32_t vmin = tty->config.vmin;
+    uint32_t vtime = msecs_to_jiffies((uint32_t)tty->config.vtime * 100);
+
+    if (vmin == 0) {
+        /* 纯超时读：有数据立即返回，vtime也为0时退回到input_timeout */
+        uint32_t ticks = vtime ? vtime : msecs_to_jiffies(tty->input_timeout);
+        if (ticks) {
+            tty_wait_input(tty, ticks);
+        }
+        return (int)tty_take_input(tty, buffer, size, 0);
+    }
+
+    size_t want = vmin < size ? vmin : size;
     size_t bytes_read = 0;
 
-    while (bytes_read < size) {
-        /* 检查输入缓冲区 */
-        if (tty->line.input_count > 0) {
-            /* 从输入缓冲区读取数据 */
-            char ch = tty->line.input_buffer[tty->line.input_head];
-            tty->line.input_head = (tty->line.input_head + 1) % TTY_BUFFER_SIZE;
-            tty->line.input_count--;
+    while (1) {
+        bytes_read += tty_take_input(tty, buffer + bytes_read, size - bytes_read, 0);
+        if (bytes_read >= want) {
+            break;
+        }
 
-            buffer[bytes_read++] = ch;
-            tty->bytes_read++;
-        } else {
-            /* 没有数据可读 */
-            if (tty->mode == TTY_MODE_COOKED) {
-                /* 熟模式：等待完整的行 */
-                break;
-            } else {
-                /* 生模式：没有数据就直接返回 */
-                break;
-            }
+        /* 第一个字符之前一直等待，之后vtime是字符间超时 */
+        uint32_t ticks = (bytes_read > 0 && vtime) ? vtime : TIMER_MAX_TIMEOUT;
+        if (tty_wait_input(tty, ticks) != 0) {
+            break;
         }
     }
 
+    return (int)bytes_read;
+}
+
+/**
+ * @brief 从输入缓冲区取出数据
+ * @param line 非0时取到换行符为止
+ * @return 取出的字节数
+ */
+static size_t tty_take_input(tty_device_t *tty, char *buffer, size_t size, int line) {
+    size_t bytes_read = 0;
+    uint32_t flags = spinlock_lock_irqsave(&tty->input_lock);
+
+    while (bytes_read < size && tty->line.input_count > 0) {
+        char ch = tty->line.input_buffer[tty->line.input_head];
+        tty->line.input_head = (tty->line.input_head + 1) % TTY_BUFFER_SIZE;
+        tty->line.input_count--;
+
+        buffer[bytes_read++] = ch;
+        tty->bytes_read++;
+
+        if (line && ch == '\n') {
+            break;
+        }
+    }
+
+    spinlock_unlock_irqrestore(&tty->input_lock, flags);
     return bytes_read;
 }
 
@@ -373,14 +437,21 @@ void tty_keyboard_handler(const keyboard_event_t *event) {
 static int tty_process_input_char(tty_device_t *tty, char ch) {
     if (tty->mode == TTY_MODE_COOKED) {
         return tty_line_discipline_input(tty, ch);
-    } else {
-        /* 生模式：直接将字符放入输入缓冲区 */
-        return tty_buffer_putchar(tty->line.input_buffer,
+    }
+
+    /* 生模式：直接将字符放入输入缓冲区 */
+    uint32_t flags = spinlock_lock_irqsave(&tty->input_lock);
+    int ret = tty_buffer_putchar(tty->line.input_buffer,
                                  &tty->line.input_head,
                                  &tty->line.input_tail,
                                  &tty->line.input_count,
                                  TTY_BUFFER_SIZE, ch);
+    spinlock_unlock_irqrestore(&tty->input_lock, flags);
+
+    if (ret == 0) {
+        wake_up(&tty->read_wait);
     }
+    return ret;
 }
 
 /**
@@ -413,7 +484,8 @@ static int tty_line_discipline_input(tty_device_t *tty, char ch) {
                 tty_putchar(tty->minor, '\n');
             }
 
-            /* 将行缓冲区内容复制到输入缓冲区 */
+            /* 将行缓冲区内容复制到输入缓冲区，整行到达后才唤醒读者 */
+            uint32_t flags = spinlock_lock_irqsave(&tty->input_lock);
             for (int i = 0; i < tty->line.line_count; i++) {
                 tty_buffer_putchar(tty->line.input_buffer,
                                  &tty->line.input_head,
@@ -429,6 +501,8 @@ static int tty_line_discipline_input(tty_device_t *tty, char ch) {
                              &tty->line.input_tail,
                              &tty->line.input_count,
                              TTY_BUFFER_SIZE, '\n');
+            spinlock_unlock_irqrestore(&tty->input_lock, flags);
+            wake_up(&tty->read_wait);
 
             tty->line.line_count = 0;
             tty->line.line_pos = 0;
@@ -523,6 +597,57 @@ int tty_set_color(int minor, vga_color_t foreground, vga_color_t background) {
     return 0;
 }
 
+/**
+ * @brief 设置TTY模式
+ */
+int tty_set_mode(int minor, tty_mode_t mode) {
+    tty_device_t *tty = tty_get_device(minor);
+    if (!tty) {
+        return -1;
+    }
+
+    tty->mode = mode;
+    return 0;
+}
+
+/**
+ * @brief 获取TTY模式
+ */
+tty_mode_t tty_get_mode(int minor) {
+    tty_device_t *tty = tty_get_device(minor);
+    if (!tty) {
+        return TTY_MODE_COOKED;
+    }
+
+    return tty->mode;
+}
+
+/**
+ * @brief 设置TTY配置
+ */
+int tty_set_config(int minor, const tty_config_t *config) {
+    tty_device_t *tty = tty_get_device(minor);
+    if (!tty || !config) {
+        return -1;
+    }
+
+    tty->config = *config;
+    return 0;
+}
+
+/**
+ * @brief 获取TTY配置
+ */
+int tty_get_config(int minor, tty_config_t *config) {
+    tty_device_t *tty = tty_get_device(minor);
+    if (!tty || !config) {
+        return -1;
+    }
+
+    *config = tty->config;
+    return 0;
+}
+
 /**
  * @brief 清除TTY屏幕
  */
@@ -585,11 +710,13 @@ int tty_flush_input(int minor) {
         return -1;
     }
 
+    uint32_t flags = spinlock_lock_irqsave(&tty->input_lock);
     tty->line.input_head = 0;
     tty->line.input_tail = 0;
     tty->line.input_count = 0;
     tty->line.line_pos = 0;
     tty->line.line_count = 0;
+    spinlock_unlock_irqrestore(&tty->input_lock, flags);
 
     return 0;
 }
@@ -610,6 +737,28 @@ int tty_flush_output(int minor) {
     return 0;
 }
 
+/**
+ * @brief 设置输入超时
+ */
+int tty_set_input_timeout(int minor, uint32_t timeout) {
+    tty_device_t *tty = tty_get_device(minor);
+    if (!tty) {
+        return -1;
+    }
+
+    tty->input_timeout = timeout;
+    return 0;
+}
+
+/**
+ * @brief 等待输入（睡眠到有数据或超时）
+ * @param ticks 超时节拍数，TIMER_MAX_TIMEOUT表示一直等待
+ * @return 0有数据，-1超时或不能睡眠
+ */
+static int tty_wait_input(tty_device_t *tty, uint32_t ticks) {
+    return wait_event_timeout(&tty->read_wait, tty->line.input_count > 0, ticks) ? 0 : -1;
+}
+
 /**
  * @brief 检查TTY是否有数据可读
  */
@@ -7,6 +7,7 @@
 
 #include <drivers/vga.h>
 #include <arch/io.h>
+#include <kernel/spinlock.h>
 #include <stdarg.h>
 #include <string.h>
 
@@ -23,14 +24,27 @@
 /* 全局VGA状态 */
 static vga_state_t vga_state;
 
+/* 光标位置顺序锁（读多写少） */
+static DEFINE_SEQLOCK(vga_cursor_seq);
+
+/**
+ * @brief 更新光标位置（不写硬件寄存器）
+ */
+static void vga_update_cursor(uint8_t x, uint8_t y) {
+    /* 回显tasklet也会移动光标 */
+    uint32_t flags = seqlock_write_lock_irqsave(&vga_cursor_seq);
+    vga_state.cursor.x = x;
+    vga_state.cursor.y = y;
+    seqlock_write_unlock_irqrestore(&vga_cursor_seq, flags);
+}
+
 /**
  * @brief 初始化VGA显示系统
  */
 int vga_init(void) {
     /* 初始化VGA状态 */
     vga_state.buffer = (vga_cell_t*)VGA_MEMORY;
-    vga_state.cursor.x = 0;
-    vga_state.cursor.y = 0;
+    vga_update_cursor(0, 0);
     vga_state.foreground_color = VGA_COLOR_LIGHT_GREY;
     vga_state.background_color = VGA_COLOR_BLACK;
     vga_state.current_color = vga_make_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
@@ -92,8 +106,7 @@ void vga_set_cursor(uint8_t x, uint8_t y) {
         y = VGA_HEIGHT - 1;
     }
 
-    vga_state.cursor.x = x;
-    vga_state.cursor.y = y;
+    vga_update_cursor(x, y);
 
     /* 更新硬件光标位置 */
     uint16_t pos = y * VGA_WIDTH + x;
@@ -111,7 +124,15 @@ void vga_set_cursor(uint8_t x, uint8_t y) {
  * @brief 获取光标位置
  */
 vga_cursor_t vga_get_cursor(void) {
-    return vga_state.cursor;
+    vga_cursor_t cursor;
+    uint32_t seq;
+
+    do {
+        seq = seqlock_read_begin(&vga_cursor_seq);
+        cursor = vga_state.cursor;
+    } while (seqlock_read_retry(&vga_cursor_seq, seq));
+
+    return cursor;
 }
 
 /**
@@ -182,7 +203,7 @@ void vga_put_char(char ch) {
                                ch, vga_state.current_color);
 
                 /* 移动光标 */
-                vga_state.cursor.x++;
+                vga_update_cursor(vga_state.cursor.x + 1, vga_state.cursor.y);
                 if (vga_state.cursor.x >= VGA_WIDTH) {
                     vga_new_line();
                 }
@@ -264,18 +285,17 @@ void vga_scroll_lines(uint8_t lines) {
  * @brief 插入新行
  */
 void vga_new_line(void) {
-    vga_state.cursor.x = 0;
-    vga_state.cursor.y++;
+    uint8_t y = vga_state.cursor.y + 1;
 
     /* 检查是否需要滚动 */
-    if (vga_state.cursor.y >= VGA_HEIGHT) {
+    if (y >= VGA_HEIGHT) {
         if (vga_state.auto_scroll) {
             vga_scroll_line();
-            vga_state.cursor.y = VGA_HEIGHT - 1;
-        } else {
-            vga_state.cursor.y = VGA_HEIGHT - 1;
         }
+        y = VGA_HEIGHT - 1;
     }
+
+    vga_update_cursor(0, y);
 }
 
 /**
@@ -294,12 +314,11 @@ void vga_tab(void) {
  */
 void vga_backspace(void) {
     if (vga_state.cursor.x > 0) {
-        vga_state.cursor.x--;
+        vga_update_cursor(vga_state.cursor.x - 1, vga_state.cursor.y);
         vga_put_char_at(vga_state.cursor.x, vga_state.cursor.y, ' ', vga_state.current_color);
     } else if (vga_state.cursor.y > 0) {
         /* 移动到上一行末尾 */
-        vga_state.cursor.y--;
-        vga_state.cursor.x = VGA_WIDTH - 1;
+        vga_update_cursor(VGA_WIDTH - 1, vga_state.cursor.y - 1);
         vga_put_char_at(vga_state.cursor.x, vga_state.cursor.y, ' ', vga_state.current_color);
     }
 }
@@ -0,0 +1,46 @@
+/**
+ * @file cpu.h
+ * @brief CPU相关内联函数
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#ifndef _ARCH_CPU_H
+#define _ARCH_CPU_H
+
+#include <stdint.h>
+
+/* 支持的最大CPU数量 */
+#define NR_CPUS         8
+
+/* 缓存行大小 */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @brief 自旋等待提示
+ */
+static inline void cpu_relax(void) {
+    __asm__ volatile("pause" ::: "memory");
+}
+
+/**
+ * @brief 编译器屏障
+ */
+static inline void barrier(void) {
+    __asm__ volatile("" ::: "memory");
+}
+
+/**
+ * @brief 读取时间戳计数器
+ * @return TSC值
+ */
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+/* arch_cpu_id()从每CPU数据区读取 */
+#include <arch/percpu.h>
+
+#endif /* _ARCH_CPU_H */
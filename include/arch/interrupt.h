@@ -9,6 +9,7 @@
 #define _ARCH_INTERRUPT_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 /* 中断向量 */
 #define IRQ_BASE        0x20
@@ -26,8 +27,46 @@
 #define IRQ_ATA_PRIMARY (IRQ_BASE + 14)
 #define IRQ_ATA_SECONDARY (IRQ_BASE + 15)
 
-/* 中断处理函数类型 */
-typedef void (*interrupt_handler_t)(void);
+/* 外部IRQ数量（ISA IRQ0-15） */
+#define IRQ_COUNT       16
+
+/* 向量是否对应外部IRQ */
+#define IRQ_VECTOR_VALID(vector) \
+    ((vector) >= IRQ_BASE && (vector) < IRQ_BASE + IRQ_COUNT)
+
+/* 中断向量数量 */
+#define INTERRUPT_VECTORS       256
+
+/* 所有向量上可登记的处理函数总数 */
+#define INTERRUPT_MAX_ACTIONS   64
+
+/* 异常数量（向量0-31） */
+#define INTERRUPT_EXCEPTIONS    32
+
+/* 中断入口保存的寄存器（低地址在前，与入口汇编的压栈顺序一致） */
+typedef struct interrupt_frame {
+    uint32_t gs, fs, es, ds;
+    uint32_t edi, esi, ebp, esp_dummy, ebx, edx, ecx, eax;  /* pushad */
+    uint32_t vector;
+    uint32_t error_code;                /* CPU不压错误码时为0 */
+    uint32_t eip, cs, eflags;
+    uint32_t user_esp, user_ss;         /* 仅在从用户态进入时有效 */
+} interrupt_frame_t;
+
+/* 中断处理函数类型：同一向量上的处理函数依次调用 */
+typedef void (*interrupt_handler_t)(interrupt_frame_t *frame, void *data);
+
+/* 没有处理函数的中断（异常时通常不返回） */
+typedef void (*interrupt_unhandled_t)(interrupt_frame_t *frame);
+
+/* 中断控制器操作（参数为IRQ号，不是向量） */
+typedef struct interrupt_controller {
+    const char *name;
+    void (*enable)(uint8_t irq);                     /* 取消屏蔽 */
+    void (*disable)(uint8_t irq);                    /* 屏蔽 */
+    void (*eoi)(uint8_t irq);                        /* 中断结束 */
+    int (*set_affinity)(uint8_t irq, uint32_t cpu);  /* 投递到指定CPU，可为NULL */
+} interrupt_controller_t;
 
 /* 函数声明 */
 
@@ -38,7 +77,26 @@ typedef void (*interrupt_handler_t)(void);
 int interrupt_init(void);
 
 /**
- * @brief 设置中断处理函数
+ * @brief 在向量的处理链末尾登记处理函数（共享中断）
+ * @param vector 中断向量
+ * @param handler 处理函数
+ * @param data 传给处理函数的参数
+ * @param name 在中断统计表中显示的名称
+ * @return 0成功，-1处理函数表已满
+ */
+int interrupt_register(uint8_t vector, interrupt_handler_t handler, void *data,
+                       const char *name);
+
+/**
+ * @brief 从向量的处理链中移除处理函数（等待正在执行的处理结束，不能在中断中调用）
+ * @param vector 中断向量
+ * @param handler 处理函数
+ * @param data 登记时的参数
+ */
+void interrupt_unregister(uint8_t vector, interrupt_handler_t handler, void *data);
+
+/**
+ * @brief 设置中断处理函数（替换整条处理链）
  * @param vector 中断向量
  * @param handler 处理函数
  * @return 0成功，-1失败
@@ -46,11 +104,41 @@ int interrupt_init(void);
 int interrupt_set_handler(uint8_t vector, interrupt_handler_t handler);
 
 /**
- * @brief 移除中断处理函数
+ * @brief 移除向量上的所有处理函数
  * @param vector 中断向量
  */
 void interrupt_remove_handler(uint8_t vector);
 
+/**
+ * @brief 设置没有处理函数时的回调
+ * @param hook 回调，NULL表示只计数
+ */
+void interrupt_set_unhandled_hook(interrupt_unhandled_t hook);
+
+/**
+ * @brief 中断分发（由中断入口汇编在关中断状态下调用）
+ * @param frame 保存的寄存器
+ */
+void interrupt_dispatch(interrupt_frame_t *frame);
+
+/**
+ * @brief 读取向量在某个CPU上的统计
+ * @param vector 中断向量
+ * @param cpu 逻辑CPU编号
+ * @param cycles 输出累计处理周期数，可为NULL
+ * @return 中断次数
+ */
+uint32_t interrupt_get_count(uint8_t vector, uint32_t cpu, uint64_t *cycles);
+
+/**
+ * @brief 生成类似/proc/interrupts的统计表（src内核经SYS_KSTAT的KSTAT_INTERRUPTS读取）
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @param ncpus 显示的CPU列数
+ * @return 写入的字符数
+ */
+int interrupt_show(char *buf, size_t size, uint32_t ncpus);
+
 /**
  * @brief 启用中断
  * @param vector 中断向量
@@ -63,6 +151,32 @@ void interrupt_enable(uint8_t vector);
  */
 void interrupt_disable(uint8_t vector);
 
+/**
+ * @brief 切换中断控制器（默认是8259A PIC）
+ * @param controller 控制器操作
+ */
+void interrupt_set_controller(const interrupt_controller_t *controller);
+
+/**
+ * @brief 获取当前中断控制器
+ * @return 控制器操作
+ */
+const interrupt_controller_t *interrupt_get_controller(void);
+
+/**
+ * @brief 通知中断控制器中断处理结束
+ * @param vector 中断向量
+ */
+void interrupt_eoi(uint8_t vector);
+
+/**
+ * @brief 设置外部中断投递的CPU
+ * @param vector 中断向量
+ * @param cpu 逻辑CPU编号
+ * @return 0成功，-1向量无效或控制器不支持
+ */
+int interrupt_set_affinity(uint8_t vector, uint32_t cpu);
+
 /**
  * @brief 启用全局中断
  */
@@ -96,7 +210,7 @@ static inline void interrupt_restore(uint32_t flags) {
 }
 
 /**
- * @brief 检查是否在中断上下文中
+ * @brief 检查是否在中断上下文中（外部中断或IPI，不含异常）
  * @return 1在中断上下文中，0不在
  */
 int interrupt_in_context(void);
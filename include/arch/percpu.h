@@ -0,0 +1,132 @@
+/**
+ * @file percpu.h
+ * @brief 每CPU数据区
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 用DEFINE_PER_CPU定义的变量放在.data.percpu段中作为模板。
+ * setup_per_cpu_areas()为每个CPU复制一份模板，每个CPU的GDT中
+ * 有一个基址为“副本地址 - 模板地址”的数据段，加载到%fs后，
+ * this_cpu_read/this_cpu_write编译为一条%fs段前缀的mov指令。
+ *
+ * 在加载%fs之前（以及不使用每CPU段的内核中）%fs是平坦段，
+ * 访问的就是模板本身，相当于单CPU。
+ */
+
+#ifndef _ARCH_PERCPU_H
+#define _ARCH_PERCPU_H
+
+#include <stdint.h>
+#include <arch/cpu.h>
+
+/* 每CPU数据段选择子（GDT第6项），每个CPU的GDT中基址不同 */
+#define PERCPU_SELECTOR     0x30
+
+/* 每个CPU数据区的大小上限 */
+#define PERCPU_AREA_SIZE    8192
+
+/* 模板段名 */
+#define PERCPU_SECTION      ".data.percpu"
+
+/**
+ * @brief 定义/声明每CPU变量
+ */
+#define DEFINE_PER_CPU(type, name) \
+    __attribute__((section(PERCPU_SECTION))) __typeof__(type) name
+
+#define DEFINE_PER_CPU_ALIGNED(type, name) \
+    __attribute__((section(PERCPU_SECTION), aligned(CACHE_LINE_SIZE))) __typeof__(type) name
+
+#define DECLARE_PER_CPU(type, name) \
+    extern __typeof__(type) name
+
+/* 模板段边界（链接脚本提供） */
+extern char __per_cpu_start[];
+extern char __per_cpu_end[];
+
+/* 各CPU副本相对模板的偏移 */
+extern uint32_t per_cpu_offset[NR_CPUS];
+
+/* 当前CPU的编号和副本偏移 */
+DECLARE_PER_CPU(uint32_t, cpu_number);
+DECLARE_PER_CPU(uint32_t, this_cpu_off);
+
+/* 大小不是1/2/4字节的变量不能用单条指令访问（链接时报错） */
+extern void __bad_percpu_size(void);
+
+/**
+ * @brief 读取当前CPU的每CPU变量
+ */
+#define this_cpu_read(var) ({                                               \
+    __typeof__(var) __ret;                                                  \
+    switch (sizeof(var)) {                                                  \
+    case 1:                                                                 \
+        __asm__ volatile("movb %%fs:%1, %b0" : "=q"(__ret) : "m"(var));      \
+        break;                                                              \
+    case 2:                                                                 \
+        __asm__ volatile("movw %%fs:%1, %w0" : "=r"(__ret) : "m"(var));      \
+        break;                                                              \
+    case 4:                                                                 \
+        __asm__ volatile("movl %%fs:%1, %k0" : "=r"(__ret) : "m"(var));      \
+        break;                                                              \
+    default:                                                                \
+        __bad_percpu_size();                                                \
+    }                                                                       \
+    __ret;                                                                  \
+})
+
+/* 对当前CPU副本执行单条读-改-写指令，对本CPU中断是原子的 */
+#define __this_cpu_op(op, var, val) do {                                    \
+    __typeof__(var) __val = (val);                                          \
+    switch (sizeof(var)) {                                                  \
+    case 1:                                                                 \
+        __asm__ volatile(op "b %b1, %%fs:%0" : "+m"(var) : "qi"(__val));     \
+        break;                                                              \
+    case 2:                                                                 \
+        __asm__ volatile(op "w %w1, %%fs:%0" : "+m"(var) : "ri"(__val));     \
+        break;                                                              \
+    case 4:                                                                 \
+        __asm__ volatile(op "l %k1, %%fs:%0" : "+m"(var) : "ri"(__val));     \
+        break;                                                              \
+    default:                                                                \
+        __bad_percpu_size();                                                \
+    }                                                                       \
+} while (0)
+
+/**
+ * @brief 写入/累加/按位修改当前CPU的每CPU变量
+ */
+#define this_cpu_write(var, val)    __this_cpu_op("mov", var, val)
+#define this_cpu_add(var, val)      __this_cpu_op("add", var, val)
+#define this_cpu_sub(var, val)      __this_cpu_op("sub", var, val)
+#define this_cpu_inc(var)           this_cpu_add(var, 1)
+#define this_cpu_dec(var)           this_cpu_sub(var, 1)
+#define this_cpu_or(var, val)       __this_cpu_op("or", var, val)
+#define this_cpu_and(var, val)      __this_cpu_op("and", var, val)
+
+/**
+ * @brief 每CPU变量的地址
+ */
+#define per_cpu_ptr(ptr, cpu) \
+    ((__typeof__(ptr))((uintptr_t)(ptr) + per_cpu_offset[(cpu)]))
+
+#define this_cpu_ptr(ptr) \
+    ((__typeof__(ptr))((uintptr_t)(ptr) + this_cpu_read(this_cpu_off)))
+
+#define per_cpu(var, cpu)           (*per_cpu_ptr(&(var), (cpu)))
+
+/**
+ * @brief 获取当前CPU编号
+ * @return 逻辑CPU编号（BSP为0）
+ */
+static inline uint32_t arch_cpu_id(void) {
+    return this_cpu_read(cpu_number);
+}
+
+/**
+ * @brief 为所有CPU建立每CPU数据区（BSP在加载%fs之前调用一次）
+ * @return 成功返回0，模板超过PERCPU_AREA_SIZE返回-1
+ */
+int setup_per_cpu_areas(void);
+
+#endif /* _ARCH_PERCPU_H */
@@ -0,0 +1,46 @@
+/**
+ * @file pic.h
+ * @brief 8259A可编程中断控制器
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 没有IOAPIC时的后备中断控制器。主片IRQ0-7映射到IRQ_BASE开始的
+ * 向量，从片IRQ8-15紧随其后，级联在主片IRQ2上。
+ */
+
+#ifndef _ARCH_PIC_H
+#define _ARCH_PIC_H
+
+#include <stdint.h>
+#include <arch/interrupt.h>
+
+/* PIC端口 */
+#define PIC1_COMMAND    0x20
+#define PIC1_DATA       0x21
+#define PIC2_COMMAND    0xA0
+#define PIC2_DATA       0xA1
+
+/* PIC命令 */
+#define PIC_EOI         0x20
+#define PIC_READ_ISR    0x0B
+
+/* 8259A控制器操作 */
+extern const interrupt_controller_t pic_controller;
+
+/**
+ * @brief 重新映射向量并屏蔽所有IRQ
+ */
+void pic_init(void);
+
+/**
+ * @brief 屏蔽所有IRQ（切换到IOAPIC后调用）
+ */
+void pic_disable(void);
+
+/**
+ * @brief 获取屏蔽字
+ * @return 每位对应一个IRQ，1表示屏蔽
+ */
+uint16_t pic_get_mask(void);
+
+#endif /* _ARCH_PIC_H */
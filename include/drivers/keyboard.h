@@ -9,6 +9,7 @@
 #define _KEYBOARD_H
 
 #include <stdint.h>
+#include <arch/interrupt.h>
 
 /* 键盘控制器端口 */
 #define KEYBOARD_DATA_PORT    0x60
@@ -98,9 +99,11 @@ typedef void (*keyboard_handler_t)(const keyboard_event_t *event);
 int keyboard_init(void);
 
 /**
- * @brief 键盘中断处理函数
+ * @brief 键盘中断处理函数（上半部：读出扫描码并调度下半部）
+ * @param frame 中断现场
+ * @param data 登记时的参数
  */
-void keyboard_interrupt_handler(void);
+void keyboard_interrupt_handler(interrupt_frame_t *frame, void *data);
 
 /**
  * @brief 读取键盘事件
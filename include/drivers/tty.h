@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <drivers/vga.h>
 #include <drivers/keyboard.h>
+#include <kernel/wait.h>
 
 /* TTY配置 */
 #define MAX_TTYS            8       /* 最大TTY数量 */
@@ -44,6 +45,8 @@ typedef struct {
     uint8_t crlf;           /* CR-LF转换 */
     uint8_t tab_expand;     /* Tab扩展 */
     uint8_t flow_control;   /* 流控制 */
+    uint8_t vmin;           /* 生模式：tty_read至少读取的字符数 */
+    uint8_t vtime;          /* 生模式：字符间超时（0.1秒），vmin为0时是总超时 */
 } tty_config_t;
 
 /* TTY行规程 */
@@ -82,7 +85,9 @@ typedef struct tty_device {
 
     /* 输入相关 */
     keyboard_handler_t keyboard_handler;  /* 键盘处理器 */
-    uint32_t input_timeout;               /* 输入超时 */
+    uint32_t input_timeout;               /* 读取等待输入的毫秒数上限，见tty_set_input_timeout */
+    wait_queue_head_t read_wait;          /* 在tty_read中等待输入的线程 */
+    spinlock_t input_lock;                /* 保护输入缓冲区：键盘tasklet写入，读者在进程上下文取出 */
 
     /* 统计信息 */
     uint32_t bytes_read;              /* 读取字节数 */
@@ -146,6 +151,12 @@ int tty_close(int minor);
  * @param buffer 缓冲区
  * @param size 要读取的大小
  * @return 实际读取的字节数，-1失败
+ *
+ * 熟模式下睡眠直到有完整的一行，最多返回一行（含换行符）。
+ * 生模式按vmin/vtime：vmin>0时睡眠直到读到vmin个字符，vtime非0时
+ * 读到第一个字符后每个字符间最多等待vtime；vmin为0时有数据立即返回，
+ * 否则最多等待vtime。不能睡眠（中断上下文、调度器未启动）时只返回
+ * 已有的数据。
  */
 int tty_read(int minor, char *buffer, size_t size);
 
@@ -292,6 +303,15 @@ int tty_flush_input(int minor);
  */
 int tty_flush_output(int minor);
 
+/**
+ * @brief 设置输入超时
+ * @param minor 次设备号
+ * @param timeout 熟模式下等待一行的最长时间(毫秒)，0表示一直等待；
+ *                生模式下vmin和vtime都为0时等待数据的时间，0表示不等待
+ * @return 0成功，-1失败
+ */
+int tty_set_input_timeout(int minor, uint32_t timeout);
+
 /* 内联函数 */
 static inline int tty_is_valid_minor(int minor) {
     return (minor >= 0 && minor < MAX_TTYS);
@@ -0,0 +1,33 @@
+/**
+ * @file lock_bench.h
+ * @brief 自旋锁压力测试
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#ifndef _KERNEL_LOCK_BENCH_H
+#define _KERNEL_LOCK_BENCH_H
+
+#include <stdint.h>
+
+/* 每轮测试时长（毫秒） */
+#define LOCK_BENCH_WINDOW_MS    200
+
+/**
+ * @brief 建立每CPU数据区，经AP启动跳板唤醒AP进入lock_bench_secondary
+ * @return 上线的CPU数量（包括BSP）
+ */
+uint32_t lock_bench_start_cpus(void);
+
+/**
+ * @brief 在BSP上运行压力测试并通过COM1输出结果
+ * @param ncpus 参与测试的CPU数量（包括BSP）
+ */
+void lock_bench_run(uint32_t ncpus);
+
+/**
+ * @brief 从处理器参与压力测试（不返回）
+ */
+void lock_bench_secondary(void);
+
+#endif /* _KERNEL_LOCK_BENCH_H */
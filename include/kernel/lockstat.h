@@ -0,0 +1,72 @@
+/**
+ * @file lockstat.h
+ * @brief 锁竞争统计（CONFIG_LOCK_STAT）
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 按锁名称汇总获取次数、竞争次数、等待/持有周期和关中断时长，
+ * 同名的锁实例计入同一项。时间单位为TSC周期。
+ */
+
+#ifndef _KERNEL_LOCKSTAT_H
+#define _KERNEL_LOCKSTAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* 最多统计的锁名称数量 */
+#define LOCKSTAT_MAX_CLASSES    64
+
+/* 单个锁名称的统计数据 */
+typedef struct lock_class_stat {
+    const char *name;           /* 锁名称 */
+    volatile uint32_t busy;     /* 更新统计时的内部互斥 */
+    uint32_t acquisitions;      /* 获取次数 */
+    uint32_t contended;         /* 需要等待的获取次数 */
+    uint64_t wait_total;        /* 累计等待周期 */
+    uint64_t wait_max;          /* 最长等待周期 */
+    uint64_t hold_max;          /* 最长持有周期 */
+    uint64_t irqoff_max;        /* irqsave路径最长关中断周期 */
+} lock_class_stat_t;
+
+#ifdef CONFIG_LOCK_STAT
+
+/**
+ * @brief 查找或登记锁名称对应的统计项
+ * @param name 锁名称
+ * @return 统计项，表满时返回NULL
+ */
+lock_class_stat_t *lockstat_class(const char *name);
+
+/**
+ * @brief 记录一次获取
+ * @param stat 统计项
+ * @param wait_cycles 等待周期
+ * @param contended 是否发生竞争
+ */
+void lockstat_acquired(lock_class_stat_t *stat, uint64_t wait_cycles, int contended);
+
+/**
+ * @brief 记录一次释放
+ * @param stat 统计项
+ * @param hold_cycles 持有周期
+ * @param irqoff_cycles 关中断周期（未关中断时为0）
+ */
+void lockstat_released(lock_class_stat_t *stat, uint64_t hold_cycles, uint64_t irqoff_cycles);
+
+/**
+ * @brief 生成统计报告文本（/proc/lock_stat格式，经SYS_KSTAT的KSTAT_LOCK读取）
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @return 写入的字节数
+ */
+int lockstat_show(char *buf, size_t size);
+
+/**
+ * @brief 清零所有统计数据
+ */
+void lockstat_clear(void);
+
+#endif /* CONFIG_LOCK_STAT */
+
+#endif /* _KERNEL_LOCKSTAT_H */
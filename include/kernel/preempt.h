@@ -0,0 +1,49 @@
+/**
+ * @file preempt.h
+ * @brief 禁止抢占计数
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 每个CPU一个计数，持有自旋锁（spinlock、qspinlock、rwlock）和处于
+ * RCU读临界区时非0。时钟中断出口只在计数为0时抢占当前线程：被抢占的
+ * 锁持有者会让同一CPU上的其他线程永远自旋，被抢占的RCU读者则会在
+ * 宽限期结束后继续使用已释放的数据。
+ *
+ * 计数为非0期间线程不会被换下，也就不会迁移，加减总落在同一个CPU上；
+ * 每次修改是一条带%fs前缀的指令，对本CPU的中断是原子的。
+ * 计数期间被推迟的抢占由下一次中断出口完成。
+ */
+
+#ifndef _KERNEL_PREEMPT_H
+#define _KERNEL_PREEMPT_H
+
+#include <stdint.h>
+#include <arch/cpu.h>
+#include <arch/percpu.h>
+
+DECLARE_PER_CPU(uint32_t, __preempt_count);
+
+/**
+ * @brief 禁止抢占（可嵌套）
+ */
+static inline void preempt_disable(void) {
+    this_cpu_inc(__preempt_count);
+    barrier();
+}
+
+/**
+ * @brief 允许抢占
+ */
+static inline void preempt_enable(void) {
+    barrier();
+    this_cpu_dec(__preempt_count);
+}
+
+/**
+ * @brief 当前CPU的禁止抢占计数
+ */
+static inline uint32_t preempt_count(void) {
+    return this_cpu_read(__preempt_count);
+}
+
+#endif /* _KERNEL_PREEMPT_H */
@@ -0,0 +1,99 @@
+/**
+ * @file qspinlock.h
+ * @brief MCS排队自旋锁
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 每个等待者在自己CPU的队列节点上自旋，释放时只唤醒队列中的下一个，
+ * 锁竞争产生的缓存行流量不随CPU数量增长。
+ */
+
+#ifndef _KERNEL_QSPINLOCK_H
+#define _KERNEL_QSPINLOCK_H
+
+#include <stdint.h>
+#include <arch/cpu.h>
+#include <kernel/spinlock.h>
+
+/* 每个CPU可同时持有的排队锁层数（进程上下文、软中断、中断、NMI） */
+#define QSPINLOCK_MAX_NESTING   4
+
+/* 队列节点（每CPU每层一个，独占缓存行） */
+typedef struct qspinlock_node {
+    struct qspinlock_node *volatile next;   /* 队列中的下一个等待者 */
+    volatile uint32_t locked;               /* 前驱释放锁时置1 */
+    volatile uint32_t in_use;               /* 节点是否被占用 */
+} __attribute__((aligned(CACHE_LINE_SIZE))) qspinlock_node_t;
+
+/* 排队自旋锁结构 */
+typedef struct {
+    qspinlock_node_t *volatile tail;    /* 队尾节点，NULL表示空闲 */
+    qspinlock_node_t *holder;           /* 持有者使用的节点 */
+    uint32_t owner;                     /* 锁持有者CPU */
+    const char *name;                   /* 锁名称 */
+#ifdef CONFIG_LOCK_STAT
+    lock_class_stat_t *stat;            /* 按名称汇总的统计项（首次获取时登记） */
+    uint64_t acquired_at;               /* 获取时的TSC */
+    uint64_t irqoff_at;                 /* irqsave关中断时的TSC，0表示未关中断 */
+#endif
+} qspinlock_t;
+
+/* 定义并初始化排队自旋锁 */
+#define QSPINLOCK_INITIALIZER(lockname) \
+    { .tail = 0, .holder = 0, .owner = SPINLOCK_NO_OWNER, .name = #lockname }
+
+#define DEFINE_QSPINLOCK(lockname) \
+    qspinlock_t lockname = QSPINLOCK_INITIALIZER(lockname)
+
+/* 函数声明 */
+
+/**
+ * @brief 初始化排队自旋锁
+ * @param lock 锁指针
+ * @param name 锁名称
+ */
+void qspinlock_init(qspinlock_t *lock, const char *name);
+
+/**
+ * @brief 获取排队自旋锁
+ * @param lock 锁指针
+ */
+void qspinlock_lock(qspinlock_t *lock);
+
+/**
+ * @brief 释放排队自旋锁
+ * @param lock 锁指针
+ */
+void qspinlock_unlock(qspinlock_t *lock);
+
+/**
+ * @brief 尝试获取排队自旋锁
+ * @param lock 锁指针
+ * @return 1成功获取，0失败
+ */
+int qspinlock_trylock(qspinlock_t *lock);
+
+/**
+ * @brief 获取排队自旋锁并禁用中断
+ * @param lock 锁指针
+ * @return 中断状态
+ */
+uint32_t qspinlock_lock_irqsave(qspinlock_t *lock);
+
+/**
+ * @brief 释放排队自旋锁并恢复中断
+ * @param lock 锁指针
+ * @param flags 中断状态
+ */
+void qspinlock_unlock_irqrestore(qspinlock_t *lock, uint32_t flags);
+
+/**
+ * @brief 检查排队自旋锁状态
+ * @param lock 锁指针
+ * @return 1已锁定，0未锁定
+ */
+static inline int qspinlock_is_locked(qspinlock_t *lock) {
+    return lock->tail != 0;
+}
+
+#endif /* _KERNEL_QSPINLOCK_H */
@@ -0,0 +1,100 @@
+/**
+ * @file rcu.h
+ * @brief 基于静止状态的RCU（QSBR）
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 读者不加锁、不写共享数据，只禁止抢占。每个CPU在主动调度、空闲和
+ * 时钟中断打断用户态时报告静止状态，所有在线CPU都报告过之后，宽限期
+ * 结束，旧数据才可以释放。读临界区内不能睡眠或主动调度；时钟抢占
+ * 会推迟到读临界区结束之后。
+ */
+
+#ifndef _KERNEL_RCU_H
+#define _KERNEL_RCU_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/cpu.h>
+#include <kernel/preempt.h>
+
+/* 由成员指针得到外层结构指针 */
+#ifndef container_of
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif
+
+/* 延迟回调头，嵌入到需要延迟释放的结构中 */
+struct rcu_head {
+    struct rcu_head *next;                  /* 回调链表 */
+    uint32_t gp;                            /* 需要等待的宽限期序号 */
+    void (*func)(struct rcu_head *head);    /* 宽限期结束后调用 */
+};
+
+/**
+ * @brief 进入读临界区
+ */
+static inline void rcu_read_lock(void) {
+    preempt_disable();
+}
+
+/**
+ * @brief 离开读临界区
+ */
+static inline void rcu_read_unlock(void) {
+    preempt_enable();
+}
+
+/* 读取受RCU保护的指针 */
+#define rcu_dereference(p) \
+    ({ __typeof__(p) _p = *(volatile __typeof__(p) *)&(p); barrier(); _p; })
+
+/* 发布新指针：先完成初始化，再让读者看到 */
+#define rcu_assign_pointer(p, v) \
+    do { barrier(); *(volatile __typeof__(p) *)&(p) = (v); } while (0)
+
+/**
+ * @brief 报告当前CPU处于静止状态（主动调度和空闲循环调用）
+ */
+void rcu_quiescent_state(void);
+
+/**
+ * @brief 时钟中断打断了用户态：记录静止状态，回调留给下一次rcu_quiescent_state
+ */
+void rcu_user_tick(void);
+
+/**
+ * @brief 等待一个完整的宽限期（不能在读临界区或持有自旋锁时调用）
+ */
+void synchronize_rcu(void);
+
+/**
+ * @brief 宽限期结束后异步调用func
+ * @param head 嵌入在对象中的回调头
+ * @param func 回调函数，通常用于释放对象
+ */
+void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *head));
+
+/**
+ * @brief 将CPU加入宽限期检测
+ * @param cpu CPU编号
+ */
+void rcu_cpu_online(uint32_t cpu);
+
+/**
+ * @brief 将CPU移出宽限期检测
+ * @param cpu CPU编号
+ */
+void rcu_cpu_offline(uint32_t cpu);
+
+/**
+ * @brief 当前CPU进入停机空闲（关中断调用），停机期间不参与宽限期检测
+ */
+void rcu_idle_enter(void);
+
+/**
+ * @brief 中断入口调用：停机空闲中的CPU重新参与宽限期检测
+ */
+void rcu_irq_enter(void);
+
+#endif /* _KERNEL_RCU_H */
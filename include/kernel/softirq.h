@@ -0,0 +1,136 @@
+/**
+ * @file softirq.h
+ * @brief 软中断和tasklet（中断下半部）
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 中断处理分为两级：上半部在关中断的硬中断上下文中只应答设备、
+ * 把数据放进队列并触发软中断；下半部在中断出口（嵌套已退出）
+ * 开中断执行，耗时的处理不再延长关中断时间。
+ *
+ * 软中断是每CPU的待处理位图，在哪个CPU上触发就在哪个CPU上执行。
+ * 一轮处理中反复被重新触发时，剩余工作交给唤醒回调（每CPU的
+ * ksoftirqd线程），避免下半部饿死普通线程。
+ *
+ * tasklet建立在TASKLET_SOFTIRQ之上：同一个tasklet同一时刻
+ * 只在一个CPU上运行，处理函数不需要考虑自身的并发。
+ */
+
+#ifndef _KERNEL_SOFTIRQ_H
+#define _KERNEL_SOFTIRQ_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* 软中断号，数值越小越先执行 */
+enum {
+    HI_SOFTIRQ = 0,         /* 高优先级tasklet */
+    TIMER_SOFTIRQ,          /* 定时器 */
+    TASKLET_SOFTIRQ,        /* 普通tasklet */
+    NR_SOFTIRQS
+};
+
+/* 一轮处理中重新检查待处理位图的次数上限 */
+#define SOFTIRQ_MAX_RESTART     10
+
+/* 软中断处理函数 */
+typedef void (*softirq_action_t)(void);
+
+/* tasklet状态位 */
+#define TASKLET_STATE_SCHED     0x1     /* 已在某个CPU的队列中 */
+#define TASKLET_STATE_RUN       0x2     /* 正在某个CPU上运行 */
+
+/* tasklet */
+typedef struct tasklet {
+    struct tasklet *next;
+    volatile uint32_t state;
+    void (*func)(void *data);
+    void *data;
+} tasklet_t;
+
+/* 静态定义tasklet */
+#define DECLARE_TASKLET(name, fn, arg) \
+    tasklet_t name = { .next = NULL, .state = 0, .func = (fn), .data = (arg) }
+
+/**
+ * @brief 初始化软中断（登记tasklet软中断）
+ */
+void softirq_init(void);
+
+/**
+ * @brief 登记软中断处理函数
+ * @param nr 软中断号
+ * @param action 处理函数（开中断执行）
+ */
+void open_softirq(uint32_t nr, softirq_action_t action);
+
+/**
+ * @brief 在当前CPU上触发软中断
+ * @param nr 软中断号
+ */
+void raise_softirq(uint32_t nr);
+
+/**
+ * @brief 触发软中断（调用者已关中断，例如硬中断处理函数）
+ * @param nr 软中断号
+ */
+void raise_softirq_irqoff(uint32_t nr);
+
+/**
+ * @brief 当前CPU待处理的软中断位图
+ */
+uint32_t softirq_pending(void);
+
+/**
+ * @brief 执行当前CPU待处理的软中断
+ *
+ * 在硬中断或软中断上下文中调用时直接返回（由外层负责）。
+ */
+void do_softirq(void);
+
+/**
+ * @brief 检查当前CPU是否正在执行软中断
+ * @return 1是，0否
+ */
+int softirq_in_context(void);
+
+/**
+ * @brief 设置处理不完时的唤醒回调（在关中断的中断出口调用）
+ * @param hook 回调，通常唤醒本CPU的ksoftirqd
+ */
+void softirq_set_wakeup_hook(void (*hook)(void));
+
+/**
+ * @brief 软中断在某个CPU上的执行次数
+ * @param nr 软中断号
+ * @param cpu CPU编号
+ */
+uint32_t softirq_get_count(uint32_t nr, uint32_t cpu);
+
+/**
+ * @brief 初始化tasklet
+ * @param t tasklet
+ * @param func 处理函数
+ * @param data 传给处理函数的参数
+ */
+void tasklet_init(tasklet_t *t, void (*func)(void *data), void *data);
+
+/**
+ * @brief 把tasklet加入当前CPU的队列（已在队列中则不重复加入）
+ * @param t tasklet
+ */
+void tasklet_schedule(tasklet_t *t);
+
+/**
+ * @brief 以高优先级调度tasklet（在普通tasklet和定时器之前运行）
+ * @param t tasklet
+ */
+void tasklet_hi_schedule(tasklet_t *t);
+
+/**
+ * @brief 等待tasklet执行完毕并且不再在队列中（不能在软中断中调用）
+ * @param t tasklet
+ */
+void tasklet_kill(tasklet_t *t);
+
+#endif /* _KERNEL_SOFTIRQ_H */
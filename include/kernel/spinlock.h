@@ -9,19 +9,37 @@
 #define _KERNEL_SPINLOCK_H
 
 #include <stdint.h>
+#include <arch/cpu.h>
+#include <kernel/lockstat.h>
 
-/* 自旋锁结构 */
+/* 未被持有时owner字段的值 */
+#define SPINLOCK_NO_OWNER   0xFFFFFFFF
+
+/* 自旋锁结构（票号锁，按申请顺序获得） */
 typedef struct {
-    volatile uint32_t lock;     /* 锁状态 */
-    uint32_t owner;             /* 锁持有者 */
+    union {
+        volatile uint32_t lock;             /* 锁状态 */
+        struct {
+            volatile uint16_t owner_ticket; /* 当前持有者的票号 */
+            volatile uint16_t next_ticket;  /* 下一个分配的票号 */
+        } tickets;
+    };
+    uint32_t owner;             /* 锁持有者CPU */
+    uint32_t contended;         /* 需要等待的获取次数 */
     const char *name;           /* 锁名称 */
+#ifdef CONFIG_LOCK_STAT
+    lock_class_stat_t *stat;    /* 按名称汇总的统计项（首次获取时登记） */
+    uint64_t acquired_at;       /* 获取时的TSC */
+    uint64_t irqoff_at;         /* irqsave关中断时的TSC，0表示未关中断 */
+#endif
 } spinlock_t;
 
 /* 定义并初始化自旋锁 */
-#define SPINLOCK_INITIALIZER(name) { .lock = 0, .owner = 0, .name = #name }
+#define SPINLOCK_INITIALIZER(lockname) \
+    { .lock = 0, .owner = SPINLOCK_NO_OWNER, .contended = 0, .name = #lockname }
 
-#define DEFINE_SPINLOCK(name) \
-    spinlock_t name = SPINLOCK_INITIALIZER(name)
+#define DEFINE_SPINLOCK(lockname) \
+    spinlock_t lockname = SPINLOCK_INITIALIZER(lockname)
 
 /* 函数声明 */
 
@@ -58,6 +76,17 @@ int spinlock_trylock(spinlock_t *lock);
  */
 int spinlock_is_locked(spinlock_t *lock);
 
+/**
+ * @brief 获取等待该锁的CPU数量
+ * @param lock 自旋锁指针
+ * @return 等待者数量
+ */
+static inline uint32_t spinlock_waiters(spinlock_t *lock) {
+    uint32_t val = lock->lock;
+    uint16_t diff = (uint16_t)((val >> 16) - (val & 0xFFFF));
+    return diff ? diff - 1u : 0u;
+}
+
 /**
  * @brief 获取自旋锁并禁用中断
  * @param lock 自旋锁指针
@@ -84,6 +113,198 @@ void spinlock_lock_irq(spinlock_t *lock);
  */
 void spinlock_unlock_irq(spinlock_t *lock);
 
+/* 读写锁写者持有标志（其余位为读者计数） */
+#define RWLOCK_WRITER       0x80000000
+
+/* 读写锁结构（写者优先：有写者等待时新读者不再进入） */
+typedef struct {
+    volatile uint32_t state;            /* 写者标志和读者计数 */
+    volatile uint32_t writers_waiting;  /* 等待中的写者数量 */
+    uint32_t owner;                     /* 写者CPU */
+    const char *name;                   /* 锁名称 */
+#ifdef CONFIG_LOCK_STAT
+    lock_class_stat_t *stat;            /* 按名称汇总的统计项（首次获取时登记） */
+    uint64_t acquired_at;               /* 写者获取时的TSC（读者不统计持有时间） */
+    uint64_t irqoff_at;                 /* 写者irqsave关中断时的TSC，0表示未关中断 */
+#endif
+} rwlock_t;
+
+/* 定义并初始化读写锁 */
+#define RWLOCK_INITIALIZER(lockname) \
+    { .state = 0, .writers_waiting = 0, .owner = SPINLOCK_NO_OWNER, .name = #lockname }
+
+#define DEFINE_RWLOCK(lockname) \
+    rwlock_t lockname = RWLOCK_INITIALIZER(lockname)
+
+/**
+ * @brief 初始化读写锁
+ * @param lock 读写锁指针
+ * @param name 锁名称
+ */
+void rwlock_init(rwlock_t *lock, const char *name);
+
+/**
+ * @brief 获取读锁（可与其他读者并发）
+ * @param lock 读写锁指针
+ */
+void rwlock_read_lock(rwlock_t *lock);
+
+/**
+ * @brief 释放读锁
+ * @param lock 读写锁指针
+ */
+void rwlock_read_unlock(rwlock_t *lock);
+
+/**
+ * @brief 获取写锁（独占）
+ * @param lock 读写锁指针
+ */
+void rwlock_write_lock(rwlock_t *lock);
+
+/**
+ * @brief 释放写锁
+ * @param lock 读写锁指针
+ */
+void rwlock_write_unlock(rwlock_t *lock);
+
+/**
+ * @brief 尝试获取读锁
+ * @param lock 读写锁指针
+ * @return 1成功获取，0失败
+ */
+int rwlock_read_trylock(rwlock_t *lock);
+
+/**
+ * @brief 尝试获取写锁
+ * @param lock 读写锁指针
+ * @return 1成功获取，0失败
+ */
+int rwlock_write_trylock(rwlock_t *lock);
+
+/**
+ * @brief 获取读锁并禁用中断
+ * @param lock 读写锁指针
+ * @return 中断状态
+ */
+uint32_t rwlock_read_lock_irqsave(rwlock_t *lock);
+
+/**
+ * @brief 释放读锁并恢复中断
+ * @param lock 读写锁指针
+ * @param flags 中断状态
+ */
+void rwlock_read_unlock_irqrestore(rwlock_t *lock, uint32_t flags);
+
+/**
+ * @brief 获取写锁并禁用中断
+ * @param lock 读写锁指针
+ * @return 中断状态
+ */
+uint32_t rwlock_write_lock_irqsave(rwlock_t *lock);
+
+/**
+ * @brief 释放写锁并恢复中断
+ * @param lock 读写锁指针
+ * @param flags 中断状态
+ */
+void rwlock_write_unlock_irqrestore(rwlock_t *lock, uint32_t flags);
+
+/* 顺序锁结构（读者不加锁，发现写入后重试） */
+typedef struct {
+    volatile uint32_t sequence;     /* 奇数表示写入进行中 */
+    spinlock_t lock;                /* 写者之间互斥 */
+} seqlock_t;
+
+/* 定义并初始化顺序锁 */
+#define SEQLOCK_INITIALIZER(lockname) \
+    { .sequence = 0, .lock = SPINLOCK_INITIALIZER(lockname) }
+
+#define DEFINE_SEQLOCK(lockname) \
+    seqlock_t lockname = SEQLOCK_INITIALIZER(lockname)
+
+/**
+ * @brief 初始化顺序锁
+ * @param sl 顺序锁指针
+ * @param name 锁名称
+ */
+static inline void seqlock_init(seqlock_t *sl, const char *name) {
+    sl->sequence = 0;
+    spinlock_init(&sl->lock, name);
+}
+
+/**
+ * @brief 开始读取
+ * @param sl 顺序锁指针
+ * @return 读取开始时的序号
+ */
+static inline uint32_t seqlock_read_begin(const seqlock_t *sl) {
+    uint32_t seq;
+
+    while ((seq = sl->sequence) & 1) {
+        cpu_relax();  /* 写入进行中 */
+    }
+    barrier();
+    return seq;
+}
+
+/**
+ * @brief 检查读取期间是否发生写入
+ * @param sl 顺序锁指针
+ * @param seq seqlock_read_begin返回的序号
+ * @return 1需要重试，0读取有效
+ */
+static inline int seqlock_read_retry(const seqlock_t *sl, uint32_t seq) {
+    barrier();
+    return sl->sequence != seq;
+}
+
+/**
+ * @brief 开始写入
+ * @param sl 顺序锁指针
+ */
+static inline void seqlock_write_lock(seqlock_t *sl) {
+    spinlock_lock(&sl->lock);
+    sl->sequence++;
+    barrier();
+}
+
+/**
+ * @brief 结束写入
+ * @param sl 顺序锁指针
+ */
+static inline void seqlock_write_unlock(seqlock_t *sl) {
+    barrier();
+    sl->sequence++;
+    spinlock_unlock(&sl->lock);
+}
+
+/**
+ * @brief 关中断并开始写入
+ * @param sl 顺序锁指针
+ * @return 中断状态
+ *
+ * 中断或软中断中也有写者（或读者）时，进程上下文的写者必须用这一对：
+ * 持锁期间被本CPU的中断打断，中断中的写者会在同一把锁上自旋，读者
+ * 则会在奇数序号上永远等待。
+ */
+static inline uint32_t seqlock_write_lock_irqsave(seqlock_t *sl) {
+    uint32_t flags = spinlock_lock_irqsave(&sl->lock);
+    sl->sequence++;
+    barrier();
+    return flags;
+}
+
+/**
+ * @brief 结束写入并恢复中断
+ * @param sl 顺序锁指针
+ * @param flags seqlock_write_lock_irqsave返回的中断状态
+ */
+static inline void seqlock_write_unlock_irqrestore(seqlock_t *sl, uint32_t flags) {
+    barrier();
+    sl->sequence++;
+    spinlock_unlock_irqrestore(&sl->lock, flags);
+}
+
 /**
  * @brief 自旋锁断言（调试用）
  * @param lock 自旋锁指针
@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <drivers/tty.h>
+#include <kernel/rcu.h>
 
 /* 终端类型 */
 typedef enum {
@@ -24,7 +25,8 @@ typedef enum {
     TERMINAL_STATE_INACTIVE = 0,   /* 非活动 */
     TERMINAL_STATE_ACTIVE,         /* 活动 */
     TERMINAL_STATE_FOCUSED,        /* 焦点 */
-    TERMINAL_STATE_SUSPENDED       /* 挂起 */
+    TERMINAL_STATE_SUSPENDED,      /* 挂起 */
+    TERMINAL_STATE_RELEASING       /* 已销毁，等待读者退出后回收 */
 } terminal_state_t;
 
 /* 终端控制序列类型 */
@@ -76,8 +78,8 @@ typedef struct {
     uint8_t escape_pos;            /* 转义序列位置 */
 } terminal_t;
 
-/* 终端会话 */
-typedef struct {
+/* 终端会话（读者通过RCU遍历会话链表） */
+typedef struct terminal_session {
     uint32_t session_id;           /* 会话ID */
     uint32_t user_id;              /* 用户ID */
     uint32_t group_id;             /* 组ID */
@@ -86,6 +88,7 @@ typedef struct {
     char shell[64];                /* Shell程序 */
     terminal_t *terminal;          /* 关联终端 */
     struct terminal_session *next; /* 下一个会话 */
+    struct rcu_head rcu;           /* 延迟释放 */
 } terminal_session_t;
 
 /* 终端历史记录 */
@@ -133,16 +136,16 @@ terminal_t *terminal_create(const char *name, terminal_type_t type, int tty_mino
 int terminal_destroy(terminal_t *terminal);
 
 /**
- * @brief 查找终端
+ * @brief 查找终端（调用者持有rcu_read_lock）
  * @param name 终端名称
- * @return 终端指针，NULL未找到
+ * @return 终端指针，NULL未找到；只在调用者的RCU读临界区内有效
  */
 terminal_t *terminal_find_by_name(const char *name);
 
 /**
- * @brief 根据TTY查找终端
+ * @brief 根据TTY查找终端（调用者持有rcu_read_lock）
  * @param tty_minor TTY次设备号
- * @return 终端指针，NULL未找到
+ * @return 终端指针，NULL未找到；只在调用者的RCU读临界区内有效
  */
 terminal_t *terminal_find_by_tty(int tty_minor);
 
@@ -280,9 +283,9 @@ terminal_session_t *terminal_session_create(terminal_t *terminal, uint32_t user_
 int terminal_session_destroy(terminal_session_t *session);
 
 /**
- * @brief 查找会话
+ * @brief 查找会话（调用者持有rcu_read_lock）
  * @param session_id 会话ID
- * @return 会话指针，NULL未找到
+ * @return 会话指针，NULL未找到；只在调用者的RCU读临界区内有效
  */
 terminal_session_t *terminal_session_find(uint32_t session_id);
 
@@ -0,0 +1,152 @@
+/**
+ * @file timer_wheel.h
+ * @brief 内核定时器（分层时间轮）
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 定时器按到期节拍放进分层时间轮：第一层256个槽，每槽对应一个节拍；
+ * 之上四层各64个槽，每槽覆盖下一层一整圈。插入只需按剩余节拍数选层、
+ * 按到期时间的对应位选槽，删除通过pprev直接摘链，都是O(1)。
+ * 第一层转完一圈时把上一层当前槽的定时器重新分散到下面各层（级联）。
+ *
+ * 时钟节拍（或动态时钟停掉节拍后的补算）通过timer_wheel_update推进时间，
+ * 到期的定时器在TIMER_SOFTIRQ中开中断执行，处理函数不能睡眠。
+ *
+ * schedule_timeout在定时器之上实现带超时的线程睡眠；没有登记调度器
+ * 睡眠接口（TTY系统单独运行）或处于中断上下文时，调用者退回到轮询。
+ */
+
+#ifndef _KERNEL_TIMER_WHEEL_H
+#define _KERNEL_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* 时钟频率 */
+#define HZ                      100
+
+/* 时间轮层次 */
+#define TVR_BITS                8
+#define TVN_BITS                6
+#define TVR_SIZE                (1u << TVR_BITS)
+#define TVN_SIZE                (1u << TVN_BITS)
+#define TVR_MASK                (TVR_SIZE - 1)
+#define TVN_MASK                (TVN_SIZE - 1)
+#define TVN_LEVELS              4
+
+/* 一次能定时的最长节拍数，更远的到期时间被截断 */
+#define TIMER_MAX_TIMEOUT       0xFFFFFFFFu
+
+/* 毫秒转换为节拍（向上取整，非0的超时至少一个节拍） */
+#define msecs_to_jiffies(ms)    ((uint32_t)(((uint64_t)(ms) * HZ + 999) / 1000))
+
+/* 定时器 */
+typedef struct timer_list {
+    struct timer_list *next;
+    struct timer_list **pprev;          /* 指向前一个节点的next，NULL表示未挂入 */
+    uint64_t expires;                   /* 到期的节拍 */
+    void (*function)(struct timer_list *timer);
+    void *data;
+} timer_list_t;
+
+/* 静态定义定时器 */
+#define DEFINE_TIMER(name, fn, arg) \
+    timer_list_t name = { .next = NULL, .pprev = NULL, .expires = 0, \
+                          .function = (fn), .data = (arg) }
+
+/* 线程睡眠接口（由调度器登记） */
+typedef struct {
+    void *(*current)(void);             /* 当前线程 */
+    void (*block)(void);                /* 睡眠直到被唤醒（可能提前返回） */
+    void (*wake)(void *thread);         /* 唤醒线程 */
+} timer_sleep_ops_t;
+
+/**
+ * @brief 初始化时间轮并登记TIMER_SOFTIRQ
+ * @param now 当前节拍
+ */
+void timer_wheel_init(uint64_t now);
+
+/**
+ * @brief 推进时间（时钟中断中调用，中断已关闭），有定时器时触发TIMER_SOFTIRQ
+ * @param now 当前节拍
+ */
+void timer_wheel_update(uint64_t now);
+
+/**
+ * @brief 时间轮看到的当前节拍
+ */
+uint64_t timer_get_jiffies(void);
+
+/**
+ * @brief 最早的定时器到期时间（动态时钟据此决定空闲睡眠多久）
+ * @param expires 输出到期节拍
+ * @return 没有定时器时返回0
+ */
+int timer_wheel_next_expiry(uint64_t *expires);
+
+/**
+ * @brief 初始化定时器
+ * @param timer 定时器
+ * @param function 到期处理函数（软中断上下文）
+ * @param data 处理函数使用的参数
+ */
+void timer_setup(timer_list_t *timer, void (*function)(timer_list_t *timer), void *data);
+
+/**
+ * @brief 按timer->expires挂入定时器
+ * @param timer 未挂入的定时器
+ */
+void add_timer(timer_list_t *timer);
+
+/**
+ * @brief 修改到期时间，未挂入时挂入
+ * @param timer 定时器
+ * @param expires 新的到期节拍
+ * @return 修改前已挂入返回1，否则0
+ */
+int mod_timer(timer_list_t *timer, uint64_t expires);
+
+/**
+ * @brief 取消定时器（处理函数可能仍在其他CPU上运行）
+ * @return 取消前已挂入返回1，否则0
+ */
+int del_timer(timer_list_t *timer);
+
+/**
+ * @brief 取消定时器并等待正在运行的处理函数返回（不能在处理函数中调用）
+ * @return 取消前已挂入返回1，否则0
+ */
+int del_timer_sync(timer_list_t *timer);
+
+/**
+ * @brief 定时器是否已挂入
+ */
+static inline int timer_pending(const timer_list_t *timer) {
+    return timer->pprev != NULL;
+}
+
+/**
+ * @brief 登记线程睡眠接口
+ */
+void timer_set_sleep_ops(const timer_sleep_ops_t *ops);
+
+/**
+ * @brief 当前可以睡眠的线程
+ * @return 没有睡眠接口或处于中断/软中断上下文时返回NULL
+ */
+void *sleep_current(void);
+
+/**
+ * @brief 唤醒由sleep_current得到的线程（NULL时忽略）
+ */
+void sleep_wake(void *thread);
+
+/**
+ * @brief 睡眠直到超时或被sleep_wake唤醒
+ * @param ticks 超时节拍数
+ * @return 剩余节拍数，超时或不能睡眠时返回0；调用者应重新检查等待的条件
+ */
+uint32_t schedule_timeout(uint32_t ticks);
+
+#endif /* _KERNEL_TIMER_WHEEL_H */
@@ -0,0 +1,115 @@
+/**
+ * @file wait.h
+ * @brief 等待队列
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 等待某个条件的线程把自己挂到等待队列上再检查条件，条件不满足就睡眠；
+ * 让条件成立的一方（通常是中断下半部）调用wake_up唤醒队列上的全部线程，
+ * 没有人等待时唤醒只是一次空链表检查。
+ *
+ * 先挂入再检查、唤醒时持队列锁遍历，保证不会错过唤醒：唤醒发生在检查之后、
+ * 睡眠之前时，调度器记下待处理的唤醒，睡眠立即返回，线程重新检查条件。
+ */
+
+#ifndef _KERNEL_WAIT_H
+#define _KERNEL_WAIT_H
+
+#include <stdint.h>
+#include <kernel/spinlock.h>
+#include <kernel/timer_wheel.h>
+
+/* 等待项（通常在等待者的栈上） */
+typedef struct wait_queue_entry {
+    struct wait_queue_entry *next;
+    struct wait_queue_entry **pprev;    /* 指向前一个节点的next，NULL表示未挂入 */
+    void *thread;                       /* 等待的线程，NULL表示不能睡眠 */
+} wait_queue_entry_t;
+
+/* 等待队列头 */
+typedef struct {
+    spinlock_t lock;
+    wait_queue_entry_t *first;
+} wait_queue_head_t;
+
+/* 静态定义等待队列 */
+#define DECLARE_WAIT_QUEUE_HEAD(name) \
+    wait_queue_head_t name = { .lock = SPINLOCK_INITIALIZER(name), .first = NULL }
+
+/**
+ * @brief 初始化等待队列
+ */
+void init_waitqueue_head(wait_queue_head_t *wq);
+
+/**
+ * @brief 初始化等待项，记录当前线程
+ */
+void init_wait(wait_queue_entry_t *wait);
+
+/**
+ * @brief 挂入等待队列（已挂入或不能睡眠时不做任何事），之后再检查条件
+ */
+void prepare_to_wait(wait_queue_head_t *wq, wait_queue_entry_t *wait);
+
+/**
+ * @brief 从等待队列摘下
+ */
+void finish_wait(wait_queue_head_t *wq, wait_queue_entry_t *wait);
+
+/**
+ * @brief 唤醒等待队列上的全部线程（可以在中断和软中断上下文调用）
+ * @return 唤醒的线程数
+ */
+int wake_up(wait_queue_head_t *wq);
+
+/**
+ * @brief 等待队列上是否有线程
+ */
+static inline int waitqueue_active(const wait_queue_head_t *wq) {
+    return wq->first != NULL;
+}
+
+/**
+ * @brief 睡眠直到条件成立或超时
+ * @param wq 等待队列
+ * @param condition 条件表达式，每次被唤醒后重新求值
+ * @param ticks 超时节拍数，TIMER_MAX_TIMEOUT表示一直等待
+ * @return 条件成立时返回剩余节拍数（至少为1），超时或不能睡眠时返回0
+ *
+ * 中断上下文或调度器未启动时不能睡眠，只检查一次条件。
+ */
+#define wait_event_timeout(wq, condition, ticks) ({                         \
+    uint64_t __deadline = timer_get_jiffies() + (ticks);                    \
+    uint32_t __left = 1;                                                    \
+    wait_queue_entry_t __wait;                                              \
+                                                                            \
+    init_wait(&__wait);                                                     \
+    while (1) {                                                             \
+        prepare_to_wait((wq), &__wait);                                     \
+        if (condition) {                                                    \
+            break;                                                          \
+        }                                                                   \
+        uint64_t __now = timer_get_jiffies();                               \
+        if (!__wait.thread || __now >= __deadline) {                        \
+            __left = 0;                                                     \
+            break;                                                          \
+        }                                                                   \
+        schedule_timeout((uint32_t)(__deadline - __now));                   \
+    }                                                                       \
+    finish_wait((wq), &__wait);                                             \
+                                                                            \
+    if (__left) {                                                           \
+        uint64_t __now = timer_get_jiffies();                               \
+        __left = __deadline > __now ? (uint32_t)(__deadline - __now) : 1;   \
+    }                                                                       \
+    __left;                                                                 \
+})
+
+/**
+ * @brief 睡眠直到条件成立
+ * @return 0条件成立，-1不能睡眠且条件不成立
+ */
+#define wait_event(wq, condition) \
+    (wait_event_timeout((wq), (condition), TIMER_MAX_TIMEOUT) ? 0 : -1)
+
+#endif /* _KERNEL_WAIT_H */
@@ -0,0 +1,169 @@
+/**
+ * @file futex.h
+ * @brief 快速用户态锁：futex系统调用和互斥锁/条件变量
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 锁的状态放在用户内存的一个32位字里，加锁解锁用原子指令在用户态完成，
+ * 只有需要睡眠或唤醒时才进入内核：
+ *
+ *   FUTEX_WAIT     *uaddr仍等于val时睡眠，直到被唤醒或超时（毫秒，0表示
+ *                  一直等待）；值已改变时立即返回FUTEX_EAGAIN
+ *   FUTEX_WAKE     唤醒最多val个在uaddr上等待的线程，返回唤醒数
+ *   FUTEX_REQUEUE  唤醒val个，再把最多val2个剩余等待者移到uaddr2上，
+ *                  返回唤醒数与移动数之和
+ *
+ * 内核按uaddr的物理地址区分futex，映射到不同虚拟地址的同一页也是同一个。
+ * 比较和入队在同一把锁下完成：先改值再FUTEX_WAKE的一方不会错过等待者。
+ */
+
+#ifndef _SYS_FUTEX_H
+#define _SYS_FUTEX_H
+
+#include <stdint.h>
+
+/* 系统调用号（与内核kernel.h一致） */
+#define FUTEX_SYS               16
+
+/* 操作 */
+#define FUTEX_WAIT              0
+#define FUTEX_WAKE              1
+#define FUTEX_REQUEUE           2
+
+/* 返回的错误码（与内核kernel.h一致） */
+#define FUTEX_EINVAL            (-1)
+#define FUTEX_EAGAIN            (-8)    /* WAIT时值已改变 */
+#define FUTEX_ETIMEDOUT         (-9)    /* WAIT超时 */
+
+static inline int32_t futex(volatile uint32_t *uaddr, uint32_t op, uint32_t val,
+                            uint32_t val2, volatile uint32_t *uaddr2) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+                      : "=a"(ret)
+                      : "a"(FUTEX_SYS), "b"((uint32_t)(uintptr_t)uaddr), "c"(op),
+                        "d"(val), "S"(val2), "D"((uint32_t)(uintptr_t)uaddr2)
+                      : "memory");
+    return ret;
+}
+
+/*
+ * 互斥锁：0未锁，1已锁且无人等待，2已锁且可能有人等待。
+ * 无竞争时加锁和解锁各一条原子指令；只有状态为2时解锁才进入内核唤醒。
+ */
+typedef struct {
+    volatile uint32_t state;
+} umutex_t;
+
+#define UMUTEX_INITIALIZER      { 0 }
+
+static inline void umutex_init(umutex_t *m) {
+    m->state = 0;
+}
+
+/**
+ * @brief 尝试加锁
+ * @return 0成功，FUTEX_EAGAIN已被持有
+ */
+static inline int umutex_trylock(umutex_t *m) {
+    return __sync_bool_compare_and_swap(&m->state, 0, 1) ? 0 : FUTEX_EAGAIN;
+}
+
+/**
+ * @brief 加锁
+ */
+static inline void umutex_lock(umutex_t *m) {
+    uint32_t c = __sync_val_compare_and_swap(&m->state, 0, 1);
+
+    if (c == 0) {
+        return;
+    }
+
+    /* 有竞争：标记为有人等待再睡眠，醒来后同样以2的状态取锁 */
+    if (c != 2) {
+        c = __sync_lock_test_and_set(&m->state, 2);
+    }
+    while (c != 0) {
+        futex(&m->state, FUTEX_WAIT, 2, 0, 0);
+        c = __sync_lock_test_and_set(&m->state, 2);
+    }
+}
+
+/**
+ * @brief 解锁
+ */
+static inline void umutex_unlock(umutex_t *m) {
+    if (__sync_fetch_and_sub(&m->state, 1) != 1) {
+        m->state = 0;
+        futex(&m->state, FUTEX_WAKE, 1, 0, 0);
+    }
+}
+
+/*
+ * 条件变量：seq每次signal/broadcast加一。等待者记下seq后解锁睡眠，
+ * 期间seq改变则FUTEX_WAIT立即返回，不会错过通知。
+ */
+typedef struct {
+    volatile uint32_t seq;
+    umutex_t *volatile mutex;           /* 等待者使用的互斥锁，broadcast据此requeue */
+} ucond_t;
+
+#define UCOND_INITIALIZER       { 0, 0 }
+
+static inline void ucond_init(ucond_t *c) {
+    c->seq = 0;
+    c->mutex = 0;
+}
+
+/**
+ * @brief 等待条件变量（调用者持有m，返回时重新持有m）
+ * @param timeout 超时时间(毫秒)，0表示一直等待
+ * @return 0被唤醒（可能是虚假唤醒，调用者应重新检查条件），FUTEX_ETIMEDOUT超时
+ */
+static inline int ucond_timedwait(ucond_t *c, umutex_t *m, uint32_t timeout) {
+    uint32_t seq = c->seq;
+    int ret;
+
+    c->mutex = m;
+    umutex_unlock(m);
+
+    ret = futex(&c->seq, FUTEX_WAIT, seq, timeout, 0);
+
+    /* 可能是被requeue到m上后唤醒的，以有人等待的状态取锁，解锁时接着唤醒下一个 */
+    while (__sync_lock_test_and_set(&m->state, 2) != 0) {
+        futex(&m->state, FUTEX_WAIT, 2, 0, 0);
+    }
+
+    return ret == FUTEX_ETIMEDOUT ? FUTEX_ETIMEDOUT : 0;
+}
+
+static inline int ucond_wait(ucond_t *c, umutex_t *m) {
+    return ucond_timedwait(c, m, 0);
+}
+
+/**
+ * @brief 唤醒一个等待者
+ */
+static inline void ucond_signal(ucond_t *c) {
+    __sync_fetch_and_add(&c->seq, 1);
+    futex(&c->seq, FUTEX_WAKE, 1, 0, 0);
+}
+
+/**
+ * @brief 唤醒全部等待者
+ *
+ * 只唤醒一个，其余移到互斥锁上：被唤醒者以状态2持锁，解锁时逐个唤醒，
+ * 避免所有等待者同时醒来争抢同一把锁。
+ */
+static inline void ucond_broadcast(ucond_t *c) {
+    umutex_t *m = c->mutex;
+
+    __sync_fetch_and_add(&c->seq, 1);
+
+    if (m) {
+        futex(&c->seq, FUTEX_REQUEUE, 1, 0x7FFFFFFF, &m->state);
+    } else {
+        futex(&c->seq, FUTEX_WAKE, 0x7FFFFFFF, 0, 0);
+    }
+}
+
+#endif /* _SYS_FUTEX_H */
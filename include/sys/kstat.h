@@ -0,0 +1,46 @@
+/**
+ * @file kstat.h
+ * @brief 内核统计表读取接口
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 系统中没有procfs，SYS_KSTAT把一张内核统计表生成为文本写进用户缓冲区，
+ * 内容与Linux下对应的/proc文件相同；KSTAT_CLEAR清零支持清零的表。
+ * 缓冲区不够时输出被截断，返回写入的字节数。
+ */
+
+#ifndef _SYS_KSTAT_H
+#define _SYS_KSTAT_H
+
+#include <stdint.h>
+
+/* 系统调用号（与内核kernel.h一致） */
+#define KSTAT_SYS               17
+
+/* 统计表 */
+#define KSTAT_LOCK              0       /* 锁竞争（/proc/lock_stat，需CONFIG_LOCK_STAT） */
+#define KSTAT_TICK              1       /* 每CPU时钟节拍和空闲唤醒（/proc/tick_stat） */
+#define KSTAT_SYSCALLS          2       /* 每个系统调用的次数和耗时（/proc/syscalls） */
+#define KSTAT_INTERRUPTS        3       /* 每CPU各中断向量的次数和耗时（/proc/interrupts） */
+#define KSTAT_SCHED             4       /* 每个线程的运行和就绪等待时间（/proc/<pid>/schedstat） */
+#define KSTAT_NR_TABLES         5
+
+/* 操作 */
+#define KSTAT_READ              0
+#define KSTAT_CLEAR             1
+
+/* 返回的错误码（与内核kernel.h一致） */
+#define KSTAT_EINVAL            (-1)
+#define KSTAT_ENOENT            (-3)    /* 内核没有这张表（未启用对应配置） */
+
+static inline int32_t kstat(uint32_t table, uint32_t op, char *buf, uint32_t len) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+                      : "=a"(ret)
+                      : "a"(KSTAT_SYS), "b"(table), "c"(op),
+                        "d"((uint32_t)(uintptr_t)buf), "S"(len)
+                      : "memory");
+    return ret;
+}
+
+#endif /* _SYS_KSTAT_H */
@@ -0,0 +1,258 @@
+/**
+ * @file uring.h
+ * @brief 提交/完成环：批量系统调用接口
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * SYS_URING_SETUP在内核中建立一对环并映射到调用进程：用户态把请求
+ * （SQE）写进提交环、推进sq_tail，内核依次执行后把结果（CQE）写进
+ * 完成环、推进cq_tail。一次SYS_URING_ENTER可以提交整批请求，
+ * 复制或列目录的整个循环只需一次进入内核。
+ *
+ * 带URING_SQE_LINK的请求和下一个请求组成链：前一个失败（结果为负）时
+ * 链上后续请求以ERROR_CANCELED完成；URING_SQE_FD_PREV/URING_SQE_LEN_PREV
+ * 用链上前一个请求的结果作为文件描述符/长度（open后read、read后write）。
+ *
+ * 以URING_SETUP_SQPOLL建立时内核线程轮询提交环，用户态只写内存，
+ * 不进入内核；轮询线程空闲超过sq_thread_idle毫秒后睡眠并置
+ * URING_SQ_NEED_WAKEUP，此时需要SYS_URING_ENTER带URING_ENTER_SQ_WAKEUP唤醒。
+ */
+
+#ifndef _SYS_URING_H
+#define _SYS_URING_H
+
+#include <stdint.h>
+
+/* 系统调用号（与内核kernel.h一致） */
+#define URING_SYS_SETUP         14
+#define URING_SYS_ENTER         15
+
+/* 环映射到的用户地址：每个环一个槽 */
+#define URING_MAP_BASE          0xBF000000u
+#define URING_MAP_SLOT          0x00020000u
+#define URING_MAX_RINGS         8
+#define URING_MAX_ENTRIES       256
+
+/* 建立标志 */
+#define URING_SETUP_SQPOLL      0x01    /* 内核线程轮询提交环 */
+
+/* 进入标志 */
+#define URING_ENTER_GETEVENTS   0x01    /* 等待min_complete个完成 */
+#define URING_ENTER_SQ_WAKEUP   0x02    /* 唤醒睡眠的轮询线程 */
+#define URING_ENTER_RELEASE     0x04    /* 释放环 */
+
+/* sq_flags */
+#define URING_SQ_NEED_WAKEUP    0x01    /* 轮询线程已睡眠 */
+
+/* 操作码 */
+#define URING_OP_NOP            0
+#define URING_OP_READ           1       /* fd, addr, len */
+#define URING_OP_WRITE          2       /* fd, addr, len */
+#define URING_OP_OPEN           3       /* addr=路径, op_flags=打开标志, len=权限 */
+#define URING_OP_CLOSE          4       /* fd */
+#define URING_OP_STAT           5       /* addr=路径, addr2=stat缓冲区 */
+
+/* SQE标志 */
+#define URING_SQE_LINK          0x01    /* 与下一个请求组成链 */
+#define URING_SQE_FD_PREV       0x02    /* fd取链上前一个请求的结果 */
+#define URING_SQE_LEN_PREV      0x04    /* len取链上前一个请求的结果 */
+
+/* 提交队列项 */
+typedef struct uring_sqe {
+    uint8_t opcode;
+    uint8_t flags;                      /* URING_SQE_* */
+    uint16_t reserved;
+    int32_t fd;
+    uint32_t addr;
+    uint32_t addr2;
+    uint32_t len;
+    uint32_t op_flags;
+    uint64_t user_data;                 /* 原样带回CQE */
+} uring_sqe_t;
+
+/* 完成队列项 */
+typedef struct uring_cqe {
+    uint64_t user_data;
+    int32_t res;                        /* 与对应系统调用的返回值相同 */
+    uint32_t flags;
+} uring_cqe_t;
+
+/* 环头部（映射区开头），SQE和CQE数组按偏移放在后面 */
+typedef struct uring_ring {
+    volatile uint32_t sq_head;          /* 内核推进 */
+    volatile uint32_t sq_tail;          /* 用户推进 */
+    volatile uint32_t cq_head;          /* 用户推进 */
+    volatile uint32_t cq_tail;          /* 内核推进 */
+    uint32_t sq_entries;                /* 2的幂 */
+    uint32_t cq_entries;                /* 2的幂，是sq_entries的两倍 */
+    volatile uint32_t sq_flags;         /* URING_SQ_* */
+    volatile uint32_t cq_overflow;      /* 完成环满时丢弃的CQE数 */
+    uint32_t sqes_off;
+    uint32_t cqes_off;
+} uring_ring_t;
+
+/* SYS_URING_SETUP参数 */
+typedef struct uring_params {
+    uint32_t sq_entries;                /* 输入：提交环长度，向上取2的幂 */
+    uint32_t flags;                     /* 输入：URING_SETUP_* */
+    uint32_t sq_thread_idle;            /* 输入：轮询线程空闲多少毫秒后睡眠 */
+    uint32_t cq_entries;                /* 输出 */
+    uint32_t ring_addr;                 /* 输出：映射区的用户地址 */
+    uint32_t ring_size;                 /* 输出：映射区大小 */
+} uring_params_t;
+
+/* 用户态句柄 */
+typedef struct {
+    uring_ring_t *ring;
+    uring_sqe_t *sqes;
+    uring_cqe_t *cqes;
+    uint32_t id;
+    uint32_t flags;
+    uint32_t sqe_tail;                  /* 已取出但尚未提交的位置 */
+} uring_t;
+
+static inline int32_t uring_syscall(uint32_t nr, uint32_t a1, uint32_t a2,
+                                    uint32_t a3, uint32_t a4) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+                      : "=a"(ret)
+                      : "a"(nr), "b"(a1), "c"(a2), "d"(a3), "S"(a4)
+                      : "memory");
+    return ret;
+}
+
+/**
+ * @brief 建立环
+ * @param entries 提交环长度
+ * @param flags URING_SETUP_*
+ * @return 0成功，负数为错误码
+ */
+static inline int uring_queue_init(uint32_t entries, uint32_t flags, uring_t *u) {
+    uring_params_t p = { .sq_entries = entries, .flags = flags, .sq_thread_idle = 10 };
+
+    int32_t id = uring_syscall(URING_SYS_SETUP, (uint32_t)(uintptr_t)&p, 0, 0, 0);
+    if (id < 0) {
+        return id;
+    }
+
+    u->ring = (uring_ring_t *)(uintptr_t)p.ring_addr;
+    u->sqes = (uring_sqe_t *)((uint8_t *)u->ring + u->ring->sqes_off);
+    u->cqes = (uring_cqe_t *)((uint8_t *)u->ring + u->ring->cqes_off);
+    u->id = (uint32_t)id;
+    u->flags = flags;
+    u->sqe_tail = u->ring->sq_tail;
+    return 0;
+}
+
+/**
+ * @brief 释放环
+ */
+static inline void uring_queue_exit(uring_t *u) {
+    uring_syscall(URING_SYS_ENTER, u->id, 0, 0, URING_ENTER_RELEASE);
+    u->ring = 0;
+}
+
+/**
+ * @brief 取一个空闲SQE（清零），提交环满时返回NULL
+ */
+static inline uring_sqe_t *uring_get_sqe(uring_t *u) {
+    uring_ring_t *ring = u->ring;
+
+    if (u->sqe_tail - ring->sq_head >= ring->sq_entries) {
+        return 0;
+    }
+
+    uring_sqe_t *sqe = &u->sqes[u->sqe_tail++ & (ring->sq_entries - 1)];
+    *sqe = (uring_sqe_t){ 0 };
+    return sqe;
+}
+
+static inline void uring_prep_rw(uring_sqe_t *sqe, uint8_t op, int32_t fd,
+                                 const void *buf, uint32_t len) {
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->addr = (uint32_t)(uintptr_t)buf;
+    sqe->len = len;
+}
+
+static inline void uring_prep_read(uring_sqe_t *sqe, int32_t fd, void *buf, uint32_t len) {
+    uring_prep_rw(sqe, URING_OP_READ, fd, buf, len);
+}
+
+static inline void uring_prep_write(uring_sqe_t *sqe, int32_t fd, const void *buf, uint32_t len) {
+    uring_prep_rw(sqe, URING_OP_WRITE, fd, buf, len);
+}
+
+static inline void uring_prep_open(uring_sqe_t *sqe, const char *path, uint32_t flags, uint32_t mode) {
+    uring_prep_rw(sqe, URING_OP_OPEN, -1, path, mode);
+    sqe->op_flags = flags;
+}
+
+static inline void uring_prep_close(uring_sqe_t *sqe, int32_t fd) {
+    uring_prep_rw(sqe, URING_OP_CLOSE, fd, 0, 0);
+}
+
+static inline void uring_prep_stat(uring_sqe_t *sqe, const char *path, void *statbuf) {
+    uring_prep_rw(sqe, URING_OP_STAT, -1, path, 0);
+    sqe->addr2 = (uint32_t)(uintptr_t)statbuf;
+}
+
+/**
+ * @brief 已完成但尚未取走的CQE数
+ */
+static inline uint32_t uring_cq_ready(const uring_t *u) {
+    return u->ring->cq_tail - u->ring->cq_head;
+}
+
+/**
+ * @brief 发布取出的SQE并等待至少wait_nr个完成
+ * @return 本次提交的SQE数，负数为错误码
+ *
+ * 轮询模式下只在轮询线程睡眠时进入内核，等待完成时在用户态自旋。
+ */
+static inline int uring_submit_and_wait(uring_t *u, uint32_t wait_nr) {
+    uring_ring_t *ring = u->ring;
+    uint32_t to_submit = u->sqe_tail - ring->sq_tail;
+
+    /* SQE内容先于tail对内核可见 */
+    __asm__ volatile ("" ::: "memory");
+    ring->sq_tail = u->sqe_tail;
+
+    if (u->flags & URING_SETUP_SQPOLL) {
+        /* tail的写入必须先于读取sq_flags，否则可能错过轮询线程入睡 */
+        __sync_synchronize();
+        if (ring->sq_flags & URING_SQ_NEED_WAKEUP) {
+            int32_t ret = uring_syscall(URING_SYS_ENTER, u->id, 0, 0, URING_ENTER_SQ_WAKEUP);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+        while (uring_cq_ready(u) < wait_nr) {
+            __asm__ volatile ("pause");
+        }
+        return (int)to_submit;
+    }
+
+    return uring_syscall(URING_SYS_ENTER, u->id, to_submit, wait_nr,
+                         wait_nr ? URING_ENTER_GETEVENTS : 0);
+}
+
+/**
+ * @brief 取下一个CQE，没有时返回NULL；用完后调用uring_cqe_seen
+ */
+static inline uring_cqe_t *uring_peek_cqe(uring_t *u) {
+    uring_ring_t *ring = u->ring;
+
+    if (ring->cq_head == ring->cq_tail) {
+        return 0;
+    }
+    __asm__ volatile ("" ::: "memory");
+    return &u->cqes[ring->cq_head & (ring->cq_entries - 1)];
+}
+
+static inline void uring_cqe_seen(uring_t *u) {
+    __asm__ volatile ("" ::: "memory");
+    u->ring->cq_head++;
+}
+
+#endif /* _SYS_URING_H */
@@ -0,0 +1,106 @@
+/**
+ * @file vdso.h
+ * @brief 用户空间直接读取的内核数据页（vvar）
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 内核把一个只读页映射到每个进程的VVAR_ADDR，导出单调/实时时钟的
+ * 换算参数和前台TTY；当前CPU编号由每个CPU各自GDT中的一个段描述符
+ * 给出（段界限即CPU编号，用户态用lsl读取）。这些查询都不进入内核。
+ *
+ * 时钟参数由内核在每个时钟节拍更新，用顺序计数保护：计数为奇数时
+ * 内核正在写，读前读后计数不同则重读。
+ */
+
+#ifndef _SYS_VDSO_H
+#define _SYS_VDSO_H
+
+#include <stdint.h>
+
+/* vvar页的用户地址（用户空间最高的一页） */
+#define VVAR_ADDR           0xBFFFF000u
+
+/* 段界限为CPU编号的段选择子（GDT第7项，RPL 3） */
+#define VDSO_CPU_SELECTOR   0x3B
+
+/* 用户态读取周期数的方式 */
+#define VCLOCK_JIFFIES      0   /* 周期数为vvar中的jiffies */
+#define VCLOCK_TSC          1   /* 周期数为rdtsc */
+
+/* vvar页内容（内核写，用户只读） */
+typedef struct vvar_data {
+    volatile uint32_t seq;              /* 顺序计数 */
+    uint32_t vclock_mode;               /* VCLOCK_* */
+    uint64_t cycle_last;                /* 上次累加时的周期数 */
+    uint64_t base_ns;                   /* cycle_last对应的单调时间 */
+    uint64_t base_frac;                 /* 不足1纳秒的部分（<< shift） */
+    uint64_t real_offset;               /* 实时时钟减单调时钟 */
+    uint32_t mult;                      /* 纳秒 = (周期数 * mult) >> shift */
+    uint32_t shift;
+    uint64_t jiffies;                   /* VCLOCK_JIFFIES的周期数 */
+    volatile int32_t current_tty;       /* 前台TTY编号 */
+} vvar_data_t;
+
+/**
+ * @brief vvar页
+ */
+static inline const volatile vvar_data_t *vvar_get(void) {
+    return (const volatile vvar_data_t *)VVAR_ADDR;
+}
+
+/**
+ * @brief 读取时钟（纳秒）
+ * @param realtime 非0读实时时钟（1970年以来），0读单调时钟（启动以来）
+ */
+static inline uint64_t vdso_clock_ns(int realtime) {
+    const volatile vvar_data_t *vvar = vvar_get();
+    uint32_t seq;
+    uint64_t cycles, ns;
+
+    do {
+        while ((seq = vvar->seq) & 1) {
+            __asm__ volatile ("pause");
+        }
+        __asm__ volatile ("" ::: "memory");
+
+        if (vvar->vclock_mode == VCLOCK_TSC) {
+            uint32_t low, high;
+            __asm__ volatile ("rdtsc" : "=a"(low), "=d"(high));
+            cycles = ((uint64_t)high << 32) | low;
+        } else {
+            cycles = vvar->jiffies;
+        }
+
+        uint64_t delta = cycles - vvar->cycle_last;
+        if ((int64_t)delta < 0) {
+            delta = 0;
+        }
+
+        ns = vvar->base_ns + ((delta * vvar->mult + vvar->base_frac) >> vvar->shift);
+        if (realtime) {
+            ns += vvar->real_offset;
+        }
+
+        __asm__ volatile ("" ::: "memory");
+    } while (vvar->seq != seq);
+
+    return ns;
+}
+
+/**
+ * @brief 当前CPU编号（线程随时可能迁移，结果只是提示）
+ */
+static inline uint32_t vdso_getcpu(void) {
+    uint32_t cpu;
+    __asm__ volatile ("lsl %1, %0" : "=r"(cpu) : "r"((uint32_t)VDSO_CPU_SELECTOR));
+    return cpu;
+}
+
+/**
+ * @brief 前台TTY编号
+ */
+static inline int vdso_get_tty(void) {
+    return vvar_get()->current_tty;
+}
+
+#endif /* _SYS_VDSO_H */
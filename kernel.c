@@ -175,6 +175,12 @@ void print_multiboot_info(struct multiboot_info *mbi) {
     }
 }
 
+#ifdef CONFIG_LOCK_BENCH
+// Spinlock stress test (kernel/lock_bench.c)
+uint32_t lock_bench_start_cpus(void);
+void lock_bench_run(uint32_t ncpus);
+#endif
+
 // Main kernel function
 void kernel_main(struct multiboot_info *mbi, unsigned int magic) {
     clear_screen();
@@ -218,6 +224,11 @@ void kernel_main(struct multiboot_info *mbi, unsigned int magic) {
     print_string("Type 'help' for commands (not implemented yet)\n");
     print_string("Press Ctrl+Alt+Del to reboot\n");
 
+#ifdef CONFIG_LOCK_BENCH
+    // Wake the APs into lock_bench_secondary, then run on every online CPU
+    lock_bench_run(lock_bench_start_cpus());
+#endif
+
     // Simple kernel loop
     while (1) {
         // In a real kernel, we would have an idle loop here
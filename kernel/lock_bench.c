@@ -0,0 +1,373 @@
+/**
+ * @file lock_bench.c
+ * @brief 自旋锁压力测试实现
+ * @author Vest-OS Team
+ * @date 2024
+ *
+ * 所有CPU在同一把锁上循环加锁/解锁，统计每秒获取次数。
+ * 结果写到COM1，测试结束后通过isa-debug-exit退出QEMU。
+ *
+ * 测试内核不带调度器和ACPI解析，AP由lock_bench_start_cpus经src内核的
+ * 实模式跳板（smp_boot.asm）逐个唤醒：每个CPU装入自己的GDT，%fs指向
+ * 自己的每CPU数据区，arch_cpu_id()和MCS队列节点才真正按CPU区分。
+ */
+
+#include <kernel/lock_bench.h>
+#include <kernel/spinlock.h>
+#include <kernel/qspinlock.h>
+#include <arch/cpu.h>
+#include <arch/io.h>
+#include <arch/percpu.h>
+
+/* 串口和QEMU退出端口 */
+#define BENCH_COM1          0x3F8
+#define BENCH_EXIT_PORT     0xF4
+
+/* PIT通道2校准参数 */
+#define PIT_HZ              1193182
+#define PIT_CALIBRATE_MS    10
+
+/* AP启动：跳板地址与src/kernel/hal/x86/32bit/smp.h一致，QEMU中LAPIC在默认地址 */
+#define BENCH_TRAMPOLINE_ADDR   0x8000
+#define BENCH_LAPIC_BASE        0xFEE00000
+#define BENCH_LAPIC_ID          0x020
+#define BENCH_LAPIC_SVR         0x0F0
+#define BENCH_LAPIC_ESR         0x280
+#define BENCH_LAPIC_ICR_LOW     0x300
+#define BENCH_LAPIC_ICR_HIGH    0x310
+#define BENCH_ICR_INIT          0x00500
+#define BENCH_ICR_STARTUP       0x00600
+#define BENCH_ICR_PENDING       0x01000
+#define BENCH_ICR_ASSERT        0x04000
+#define BENCH_ICR_LEVEL         0x08000
+#define BENCH_AP_STACK_SIZE     4096
+#define BENCH_AP_TIMEOUT_US     20000
+
+/* 跳板的启动参数（布局与smp_boot.asm一致） */
+typedef struct {
+    uint32_t cr3;
+    uint32_t stack;
+    uint32_t entry;
+    uint32_t cpu;
+} __attribute__((packed)) bench_boot_params_t;
+
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_end[];
+extern uint8_t smp_trampoline_params[];
+
+/* 测试的锁类型 */
+enum {
+    BENCH_LOCK_TICKET = 0,
+    BENCH_LOCK_MCS,
+    BENCH_LOCK_COUNT
+};
+
+static const char *bench_lock_names[BENCH_LOCK_COUNT] = { "ticket", "mcs" };
+
+/* 测试状态 */
+static struct {
+    volatile uint32_t generation;   /* 每轮递增，从处理器据此开始 */
+    volatile uint32_t running;      /* 本轮是否仍在进行 */
+    volatile uint32_t done;         /* 已结束本轮的从处理器数量 */
+    volatile uint32_t total;        /* 本轮总获取次数 */
+    volatile uint32_t kind;         /* 本轮锁类型 */
+    volatile uint32_t finished;     /* 全部测试结束 */
+} bench;
+
+/* 每CPU的GDT：0x08代码段、0x10数据段、0x30每CPU数据段 */
+static uint64_t bench_gdt[NR_CPUS][PERCPU_SELECTOR / 8 + 1] __attribute__((aligned(8)));
+static uint8_t bench_ap_stacks[NR_CPUS][BENCH_AP_STACK_SIZE] __attribute__((aligned(16)));
+static volatile uint32_t bench_online = 1;
+static uint32_t bench_tsc_khz;
+
+static DEFINE_SPINLOCK(bench_ticket_lock);
+static DEFINE_QSPINLOCK(bench_mcs_lock);
+static volatile uint32_t bench_shared;
+
+/**
+ * @brief 串口输出字符串
+ */
+static void bench_puts(const char *s) {
+    while (*s) {
+        while (!(inb(BENCH_COM1 + 5) & 0x20)) {
+            cpu_relax();
+        }
+        outb(BENCH_COM1, (uint8_t)*s++);
+    }
+}
+
+/**
+ * @brief 串口输出无符号整数
+ */
+static void bench_put_uint(uint32_t value) {
+    char buf[11];
+    int i = sizeof(buf) - 1;
+
+    buf[i] = '\0';
+    do {
+        buf[--i] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    bench_puts(&buf[i]);
+}
+
+/**
+ * @brief 用PIT通道2校准TSC频率
+ * @return 每毫秒TSC周期数
+ */
+static uint32_t bench_calibrate_tsc_khz(void) {
+    uint32_t latch = PIT_HZ / (1000 / PIT_CALIBRATE_MS);
+
+    /* 打开通道2门控，关闭扬声器 */
+    outb(0x61, (inb(0x61) & ~0x02) | 0x01);
+
+    /* 通道2，先低后高字节，模式0 */
+    outb(0x43, 0xB0);
+    outb(0x42, latch & 0xFF);
+    outb(0x42, (latch >> 8) & 0xFF);
+
+    uint64_t start = rdtsc();
+    while (!(inb(0x61) & 0x20)) {
+        /* 等待计数结束 */
+    }
+    uint64_t end = rdtsc();
+
+    return (uint32_t)(end - start) / PIT_CALIBRATE_MS;
+}
+
+/**
+ * @brief 按TSC忙等
+ */
+static void bench_udelay(uint32_t us) {
+    uint64_t cycles = (uint64_t)(bench_tsc_khz / 1000) * us;
+    uint64_t start = rdtsc();
+
+    while (rdtsc() - start < cycles) {
+        cpu_relax();
+    }
+}
+
+static inline uint32_t bench_lapic_read(uint32_t reg) {
+    return *(volatile uint32_t *)(BENCH_LAPIC_BASE + reg);
+}
+
+static inline void bench_lapic_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t *)(BENCH_LAPIC_BASE + reg) = value;
+}
+
+/**
+ * @brief 发送IPI并等待投递完成
+ */
+static void bench_send_icr(uint32_t apic_id, uint32_t low) {
+    bench_lapic_write(BENCH_LAPIC_ICR_HIGH, apic_id << 24);
+    bench_lapic_write(BENCH_LAPIC_ICR_LOW, low);
+    while (bench_lapic_read(BENCH_LAPIC_ICR_LOW) & BENCH_ICR_PENDING) {
+        cpu_relax();
+    }
+}
+
+/**
+ * @brief 段描述符（4KB粒度、32位）
+ */
+static uint64_t bench_gdt_entry(uint32_t base, uint8_t access) {
+    return 0xFFFFULL |
+           ((uint64_t)(base & 0xFFFFFF) << 16) |
+           ((uint64_t)access << 40) |
+           (0xFULL << 48) |
+           (0xCULL << 52) |
+           ((uint64_t)(base >> 24) << 56);
+}
+
+/**
+ * @brief 装入CPU自己的GDT并重新加载段寄存器，%fs指向本CPU的每CPU数据区
+ */
+static void bench_load_gdt(uint32_t cpu) {
+    uint64_t *gdt = bench_gdt[cpu];
+    struct {
+        uint16_t limit;
+        uint32_t base;
+    } __attribute__((packed)) ptr = { sizeof(bench_gdt[0]) - 1, (uint32_t)gdt };
+
+    gdt[1] = bench_gdt_entry(0, 0x9A);
+    gdt[2] = bench_gdt_entry(0, 0x92);
+    gdt[PERCPU_SELECTOR / 8] = bench_gdt_entry(per_cpu_offset[cpu], 0x92);
+
+    __asm__ volatile("lgdt %0\n\t"
+                     "ljmp $0x08, $1f\n"
+                     "1:\n\t"
+                     "movw $0x10, %%ax\n\t"
+                     "movw %%ax, %%ds\n\t"
+                     "movw %%ax, %%es\n\t"
+                     "movw %%ax, %%gs\n\t"
+                     "movw %%ax, %%ss\n\t"
+                     "movw %1, %%ax\n\t"
+                     "movw %%ax, %%fs"
+                     : : "m"(ptr), "i"(PERCPU_SELECTOR) : "eax", "memory");
+}
+
+/**
+ * @brief AP的C入口（跳板在AP自己的栈上调用）
+ */
+static void bench_ap_entry(uint32_t cpu) {
+    bench_load_gdt(cpu);
+
+    barrier();
+    __sync_fetch_and_add(&bench_online, 1);
+
+    lock_bench_secondary();
+}
+
+/**
+ * @brief 唤醒一个AP并等待它上线
+ */
+static int bench_boot_ap(uint32_t apic_id, uint32_t cpu) {
+    bench_boot_params_t *params = (bench_boot_params_t *)
+        (BENCH_TRAMPOLINE_ADDR + (smp_trampoline_params - smp_trampoline_start));
+    uint32_t online = bench_online;
+
+    params->cr3 = 0;    /* 测试内核不开分页 */
+    params->stack = (uint32_t)&bench_ap_stacks[cpu][BENCH_AP_STACK_SIZE];
+    params->entry = (uint32_t)bench_ap_entry;
+    params->cpu = cpu;
+    __sync_synchronize();
+
+    /* INIT，等待10ms，然后最多两次STARTUP */
+    bench_send_icr(apic_id, BENCH_ICR_INIT | BENCH_ICR_ASSERT | BENCH_ICR_LEVEL);
+    bench_udelay(200);
+    bench_send_icr(apic_id, BENCH_ICR_INIT | BENCH_ICR_LEVEL);
+    bench_udelay(10000);
+
+    for (int i = 0; i < 2 && bench_online == online; i++) {
+        bench_lapic_write(BENCH_LAPIC_ESR, 0);
+        bench_send_icr(apic_id, BENCH_ICR_STARTUP | (BENCH_TRAMPOLINE_ADDR >> 12));
+        bench_udelay(200);
+    }
+
+    for (uint32_t waited = 0; waited < BENCH_AP_TIMEOUT_US && bench_online == online;
+         waited += 100) {
+        bench_udelay(100);
+    }
+
+    return bench_online != online;
+}
+
+/**
+ * @brief 建立每CPU数据区并启动AP，AP进入lock_bench_secondary
+ */
+uint32_t lock_bench_start_cpus(void) {
+    bench_tsc_khz = bench_calibrate_tsc_khz();
+
+    if (setup_per_cpu_areas() != 0) {
+        return 1;
+    }
+    bench_load_gdt(0);
+
+    /* 复制跳板到低端内存 */
+    uint8_t *dst = (uint8_t *)BENCH_TRAMPOLINE_ADDR;
+    for (uint8_t *src = smp_trampoline_start; src < smp_trampoline_end; src++) {
+        *dst++ = *src;
+    }
+
+    bench_lapic_write(BENCH_LAPIC_SVR, bench_lapic_read(BENCH_LAPIC_SVR) | 0x100);
+
+    /* QEMU按0、1、2……分配APIC ID：依次唤醒，第一个没有响应的ID之后不再尝试 */
+    uint32_t bsp = bench_lapic_read(BENCH_LAPIC_ID) >> 24;
+    for (uint32_t apic_id = 0; apic_id < 256 && bench_online < NR_CPUS; apic_id++) {
+        if (apic_id != bsp && !bench_boot_ap(apic_id, bench_online)) {
+            break;
+        }
+    }
+
+    return bench_online;
+}
+
+/**
+ * @brief 一次加锁/解锁
+ */
+static inline void bench_acquire_release(uint32_t kind) {
+    if (kind == BENCH_LOCK_TICKET) {
+        spinlock_lock(&bench_ticket_lock);
+        bench_shared++;
+        spinlock_unlock(&bench_ticket_lock);
+    } else {
+        qspinlock_lock(&bench_mcs_lock);
+        bench_shared++;
+        qspinlock_unlock(&bench_mcs_lock);
+    }
+}
+
+/**
+ * @brief 从处理器参与压力测试
+ */
+void lock_bench_secondary(void) {
+    uint32_t seen = bench.generation;
+
+    while (!bench.finished) {
+        if (bench.generation == seen) {
+            cpu_relax();
+            continue;
+        }
+        seen = bench.generation;
+
+        uint32_t kind = bench.kind;
+        uint32_t count = 0;
+        while (bench.running) {
+            bench_acquire_release(kind);
+            count++;
+        }
+
+        __sync_fetch_and_add(&bench.total, count);
+        __sync_fetch_and_add(&bench.done, 1);
+    }
+
+    for (;;) {
+        __asm__ volatile("cli; hlt");
+    }
+}
+
+/**
+ * @brief 在BSP上运行压力测试
+ */
+void lock_bench_run(uint32_t ncpus) {
+    uint32_t tsc_khz = bench_tsc_khz ? bench_tsc_khz : bench_calibrate_tsc_khz();
+    uint64_t window = (uint64_t)tsc_khz * LOCK_BENCH_WINDOW_MS;
+
+    for (uint32_t kind = 0; kind < BENCH_LOCK_COUNT; kind++) {
+        bench.kind = kind;
+        bench.total = 0;
+        bench.done = 0;
+        bench.running = 1;
+        barrier();
+        bench.generation++;
+
+        uint64_t start = rdtsc();
+        uint32_t count = 0;
+        while (rdtsc() - start < window) {
+            for (int i = 0; i < 64; i++) {
+                bench_acquire_release(kind);
+            }
+            count += 64;
+        }
+
+        bench.running = 0;
+        while (bench.done < ncpus - 1) {
+            cpu_relax();
+        }
+
+        uint32_t total = bench.total + count;
+
+        bench_puts("lockbench: cpus=");
+        bench_put_uint(ncpus);
+        bench_puts(" lock=");
+        bench_puts(bench_lock_names[kind]);
+        bench_puts(" acquisitions/s=");
+        bench_put_uint(total / LOCK_BENCH_WINDOW_MS * 1000);
+        bench_puts("\n");
+    }
+
+    bench.finished = 1;
+
+    /* isa-debug-exit：通知QEMU退出 */
+    outl(BENCH_EXIT_PORT, 0);
+}
@@ -0,0 +1,252 @@
+/**
+ * @file lockstat.c
+ * @brief 锁竞争统计实现
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#ifdef CONFIG_LOCK_STAT
+
+#include <kernel/lockstat.h>
+#include <kernel/string.h>
+#include <arch/cpu.h>
+#include <arch/interrupt.h>
+
+/* 统计表（只增不删，登记后指针长期有效） */
+static lock_class_stat_t lockstat_classes[LOCKSTAT_MAX_CLASSES];
+static volatile uint32_t lockstat_nr_classes;
+static volatile uint32_t lockstat_register_busy;
+
+/* 表满后丢弃的锁名称数量 */
+static volatile uint32_t lockstat_overflow;
+
+/**
+ * @brief 获取统计项的内部互斥（不能使用spinlock_t，否则会递归统计）
+ *
+ * 中断里释放的锁也会更新同一统计项，持有期间必须关中断，
+ * 否则本CPU的中断会在这里永远自旋。
+ */
+static inline uint32_t lockstat_stat_lock(volatile uint32_t *busy) {
+    uint32_t flags = interrupt_save_and_disable();
+
+    while (__sync_lock_test_and_set(busy, 1)) {
+        while (*busy) {
+            cpu_relax();
+        }
+    }
+    return flags;
+}
+
+static inline void lockstat_stat_unlock(volatile uint32_t *busy, uint32_t flags) {
+    __sync_lock_release(busy);
+    interrupt_restore(flags);
+}
+
+/**
+ * @brief 查找或登记锁名称对应的统计项
+ */
+lock_class_stat_t *lockstat_class(const char *name) {
+    uint32_t count = lockstat_nr_classes;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (lockstat_classes[i].name == name ||
+            strcmp(lockstat_classes[i].name, name) == 0) {
+            return &lockstat_classes[i];
+        }
+    }
+
+    uint32_t flags = lockstat_stat_lock(&lockstat_register_busy);
+
+    /* 持有互斥后重新查找新登记的项 */
+    lock_class_stat_t *stat = NULL;
+    for (uint32_t i = count; i < lockstat_nr_classes; i++) {
+        if (strcmp(lockstat_classes[i].name, name) == 0) {
+            stat = &lockstat_classes[i];
+            break;
+        }
+    }
+
+    if (!stat) {
+        if (lockstat_nr_classes < LOCKSTAT_MAX_CLASSES) {
+            stat = &lockstat_classes[lockstat_nr_classes];
+            stat->name = name;
+            barrier();
+            lockstat_nr_classes++;
+        } else {
+            lockstat_overflow++;
+        }
+    }
+
+    lockstat_stat_unlock(&lockstat_register_busy, flags);
+    return stat;
+}
+
+/**
+ * @brief 记录一次获取
+ */
+void lockstat_acquired(lock_class_stat_t *stat, uint64_t wait_cycles, int contended) {
+    if (!stat) {
+        return;
+    }
+
+    uint32_t flags = lockstat_stat_lock(&stat->busy);
+    stat->acquisitions++;
+    if (contended) {
+        stat->contended++;
+        stat->wait_total += wait_cycles;
+        if (wait_cycles > stat->wait_max) {
+            stat->wait_max = wait_cycles;
+        }
+    }
+    lockstat_stat_unlock(&stat->busy, flags);
+}
+
+/**
+ * @brief 记录一次释放
+ */
+void lockstat_released(lock_class_stat_t *stat, uint64_t hold_cycles, uint64_t irqoff_cycles) {
+    if (!stat) {
+        return;
+    }
+
+    uint32_t flags = lockstat_stat_lock(&stat->busy);
+    if (hold_cycles > stat->hold_max) {
+        stat->hold_max = hold_cycles;
+    }
+    if (irqoff_cycles > stat->irqoff_max) {
+        stat->irqoff_max = irqoff_cycles;
+    }
+    lockstat_stat_unlock(&stat->busy, flags);
+}
+
+/* 报告输出位置 */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} lockstat_out_t;
+
+/**
+ * @brief 追加字符串，左对齐到width列
+ */
+static void lockstat_put(lockstat_out_t *out, const char *s, size_t width) {
+    size_t n = 0;
+
+    while (*s && out->len + 1 < out->size) {
+        out->buf[out->len++] = *s++;
+        n++;
+    }
+    while (n < width && out->len + 1 < out->size) {
+        out->buf[out->len++] = ' ';
+        n++;
+    }
+}
+
+/**
+ * @brief 追加64位无符号整数，右对齐到width列
+ *
+ * 按16位分段做除法，避免依赖libgcc的64位除法。
+ */
+static void lockstat_put_u64(lockstat_out_t *out, uint64_t value, size_t width) {
+    char digits[21];
+    char field[24];
+    int n = 0;
+
+    do {
+        uint32_t limbs[4] = {
+            (uint32_t)(value >> 48) & 0xFFFF, (uint32_t)(value >> 32) & 0xFFFF,
+            (uint32_t)(value >> 16) & 0xFFFF, (uint32_t)value & 0xFFFF
+        };
+        uint32_t rem = 0;
+
+        for (int i = 0; i < 4; i++) {
+            uint32_t cur = (rem << 16) | limbs[i];
+            limbs[i] = cur / 10;
+            rem = cur % 10;
+        }
+
+        digits[n++] = (char)('0' + rem);
+        value = ((uint64_t)limbs[0] << 48) | ((uint64_t)limbs[1] << 32) |
+                ((uint64_t)limbs[2] << 16) | limbs[3];
+    } while (value);
+
+    size_t pos = 0;
+    while (pos + n < width && pos < sizeof(field) - 1 - (size_t)n) {
+        field[pos++] = ' ';
+    }
+    while (n > 0) {
+        field[pos++] = digits[--n];
+    }
+    field[pos] = '\0';
+
+    lockstat_put(out, " ", 0);
+    lockstat_put(out, field, 0);
+}
+
+/**
+ * @brief 生成统计报告文本
+ */
+int lockstat_show(char *buf, size_t size) {
+    lockstat_out_t out = { buf, size, 0 };
+
+    if (!buf || size == 0) {
+        return 0;
+    }
+
+    lockstat_put(&out, "lock_stat version 0.1 (cycles)\n", 0);
+    lockstat_put(&out, "name", 20);
+    lockstat_put(&out, "   acquisitions  contended      wait-total     wait-max"
+                       "     hold-max   irqoff-max\n", 0);
+
+    uint32_t count = lockstat_nr_classes;
+    for (uint32_t i = 0; i < count; i++) {
+        lock_class_stat_t *stat = &lockstat_classes[i];
+
+        /* 取快照，避免输出时长时间占用统计互斥 */
+        uint32_t flags = lockstat_stat_lock(&stat->busy);
+        lock_class_stat_t snap = *stat;
+        lockstat_stat_unlock(&stat->busy, flags);
+
+        lockstat_put(&out, snap.name, 20);
+        lockstat_put_u64(&out, snap.acquisitions, 14);
+        lockstat_put_u64(&out, snap.contended, 10);
+        lockstat_put_u64(&out, snap.wait_total, 15);
+        lockstat_put_u64(&out, snap.wait_max, 12);
+        lockstat_put_u64(&out, snap.hold_max, 12);
+        lockstat_put_u64(&out, snap.irqoff_max, 12);
+        lockstat_put(&out, "\n", 0);
+    }
+
+    if (lockstat_overflow) {
+        lockstat_put(&out, "dropped classes:", 0);
+        lockstat_put_u64(&out, lockstat_overflow, 0);
+        lockstat_put(&out, "\n", 0);
+    }
+
+    out.buf[out.len] = '\0';
+    return (int)out.len;
+}
+
+/**
+ * @brief 清零所有统计数据
+ */
+void lockstat_clear(void) {
+    uint32_t count = lockstat_nr_classes;
+
+    for (uint32_t i = 0; i < count; i++) {
+        lock_class_stat_t *stat = &lockstat_classes[i];
+
+        uint32_t flags = lockstat_stat_lock(&stat->busy);
+        stat->acquisitions = 0;
+        stat->contended = 0;
+        stat->wait_total = 0;
+        stat->wait_max = 0;
+        stat->hold_max = 0;
+        stat->irqoff_max = 0;
+        lockstat_stat_unlock(&stat->busy, flags);
+    }
+
+    lockstat_overflow = 0;
+}
+
+#endif /* CONFIG_LOCK_STAT */
@@ -8,6 +8,7 @@
 #include <kernel/memory.h>
 #include <kernel/string.h>
 #include <arch/interrupt.h>
+#include <kernel/qspinlock.h>
 
 /* 简单的内存分配器实现 */
 #define HEAP_SIZE  (1024 * 1024)  /* 1MB堆 */
@@ -21,13 +22,13 @@ typedef struct memory_block {
 
 static char heap[HEAP_SIZE];
 static memory_block_t *heap_head = NULL;
-static spinlock_t memory_lock;
+static qspinlock_t memory_lock;
 
 /**
  * @brief 初始化内存管理
  */
 int memory_init(void) {
-    spinlock_init(&memory_lock, "memory");
+    qspinlock_init(&memory_lock, "memory");
 
     heap_head = (memory_block_t*)heap;
     heap_head->size = HEAP_SIZE - sizeof(memory_block_t);
@@ -98,17 +99,17 @@ void *kmalloc_flags(size_t size, int flags) {
     /* 对齐大小 */
     size = (size + BLOCK_SIZE - 1) & ~(BLOCK_SIZE - 1);
 
-    uint32_t irq_state = spinlock_lock_irqsave(&memory_lock);
+    uint32_t irq_state = qspinlock_lock_irqsave(&memory_lock);
 
     memory_block_t *block = find_block(size);
     if (block) {
         split_block(block, size);
         block->free = 0;
-        spinlock_unlock_irqrestore(&memory_lock, irq_state);
+        qspinlock_unlock_irqrestore(&memory_lock, irq_state);
         return (char*)block + sizeof(memory_block_t);
     }
 
-    spinlock_unlock_irqrestore(&memory_lock, irq_state);
+    qspinlock_unlock_irqrestore(&memory_lock, irq_state);
     return NULL;
 }
 
@@ -122,12 +123,12 @@ void kfree(void *ptr) {
 
     memory_block_t *block = (memory_block_t*)((char*)ptr - sizeof(memory_block_t));
 
-    uint32_t irq_state = spinlock_lock_irqsave(&memory_lock);
+    uint32_t irq_state = qspinlock_lock_irqsave(&memory_lock);
 
     block->free = 1;
     merge_blocks();
 
-    spinlock_unlock_irqrestore(&memory_lock, irq_state);
+    qspinlock_unlock_irqrestore(&memory_lock, irq_state);
 }
 
 /**
@@ -0,0 +1,47 @@
+/**
+ * @file percpu.c
+ * @brief 每CPU数据区
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#include <arch/percpu.h>
+
+/* 每个CPU的编号和副本偏移（模板中为0，即BSP） */
+DEFINE_PER_CPU(uint32_t, cpu_number);
+DEFINE_PER_CPU(uint32_t, this_cpu_off);
+
+/* 禁止抢占计数（见kernel/preempt.h） */
+DEFINE_PER_CPU(uint32_t, __preempt_count);
+
+uint32_t per_cpu_offset[NR_CPUS];
+
+/* 各CPU的副本 */
+static uint8_t per_cpu_areas[NR_CPUS][PERCPU_AREA_SIZE]
+    __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/**
+ * @brief 为所有CPU建立每CPU数据区
+ */
+int setup_per_cpu_areas(void) {
+    uint32_t size = (uint32_t)(__per_cpu_end - __per_cpu_start);
+
+    if (size > PERCPU_AREA_SIZE) {
+        return -1;
+    }
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        uint8_t *area = per_cpu_areas[cpu];
+
+        /* 复制模板，保留静态初始值 */
+        for (uint32_t i = 0; i < size; i++) {
+            area[i] = (uint8_t)__per_cpu_start[i];
+        }
+
+        per_cpu_offset[cpu] = (uint32_t)area - (uint32_t)__per_cpu_start;
+        per_cpu(cpu_number, cpu) = cpu;
+        per_cpu(this_cpu_off, cpu) = per_cpu_offset[cpu];
+    }
+
+    return 0;
+}
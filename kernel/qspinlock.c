@@ -0,0 +1,207 @@
+/**
+ * @file qspinlock.c
+ * @brief MCS排队自旋锁实现
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#include <kernel/qspinlock.h>
+#include <kernel/preempt.h>
+#include <arch/interrupt.h>
+#include <arch/cpu.h>
+
+/* EFLAGS中断允许位 */
+#define EFLAGS_IF           0x200
+
+/* 每CPU队列节点 */
+static qspinlock_node_t qspinlock_nodes[NR_CPUS][QSPINLOCK_MAX_NESTING];
+
+#ifdef CONFIG_LOCK_STAT
+/**
+ * @brief 获取成功后记录统计
+ */
+static inline void qspinlock_stat_acquired(qspinlock_t *lock, uint64_t start, int contended) {
+    if (!lock->stat) {
+        lock->stat = lockstat_class(lock->name);
+    }
+
+    lock->acquired_at = rdtsc();
+    lockstat_acquired(lock->stat, lock->acquired_at - start, contended);
+}
+
+/**
+ * @brief 释放前记录持有时间
+ */
+static inline void qspinlock_stat_released(qspinlock_t *lock) {
+    lockstat_released(lock->stat, rdtsc() - lock->acquired_at, 0);
+}
+#endif
+
+/**
+ * @brief 占用当前CPU的一个空闲队列节点
+ */
+static qspinlock_node_t *qspinlock_get_node(uint32_t cpu) {
+    qspinlock_node_t *nodes = qspinlock_nodes[cpu % NR_CPUS];
+
+    for (;;) {
+        for (int i = 0; i < QSPINLOCK_MAX_NESTING; i++) {
+            if (!nodes[i].in_use && !__sync_lock_test_and_set(&nodes[i].in_use, 1)) {
+                return &nodes[i];
+            }
+        }
+        cpu_relax();
+    }
+}
+
+/**
+ * @brief 初始化排队自旋锁
+ */
+void qspinlock_init(qspinlock_t *lock, const char *name) {
+    lock->tail = 0;
+    lock->holder = 0;
+    lock->owner = SPINLOCK_NO_OWNER;
+    lock->name = name ? name : "unknown";
+#ifdef CONFIG_LOCK_STAT
+    lock->stat = NULL;
+    lock->acquired_at = 0;
+    lock->irqoff_at = 0;
+#endif
+}
+
+/**
+ * @brief 获取排队自旋锁
+ */
+void qspinlock_lock(qspinlock_t *lock) {
+#ifdef CONFIG_LOCK_STAT
+    uint64_t start = rdtsc();
+#endif
+
+    /* 队列节点属于当前CPU，从取节点到释放都不能被抢占 */
+    preempt_disable();
+
+    uint32_t cpu = arch_cpu_id();
+    qspinlock_node_t *node = qspinlock_get_node(cpu);
+
+    node->next = 0;
+    node->locked = 0;
+
+    /* 把自己挂到队尾 */
+    qspinlock_node_t *prev = __sync_lock_test_and_set(&lock->tail, node);
+    if (prev) {
+        prev->next = node;
+
+        /* 只在自己的节点上自旋 */
+        while (!node->locked) {
+            cpu_relax();
+        }
+    }
+
+    barrier();
+    lock->holder = node;
+    lock->owner = cpu;
+
+#ifdef CONFIG_LOCK_STAT
+    qspinlock_stat_acquired(lock, start, prev != 0);
+#endif
+}
+
+/**
+ * @brief 释放排队自旋锁
+ */
+void qspinlock_unlock(qspinlock_t *lock) {
+    qspinlock_node_t *node = lock->holder;
+
+#ifdef CONFIG_LOCK_STAT
+    qspinlock_stat_released(lock);
+#endif
+
+    lock->owner = SPINLOCK_NO_OWNER;
+    barrier();
+
+    if (!node->next) {
+        /* 没有等待者，直接清空队尾 */
+        if (__sync_bool_compare_and_swap(&lock->tail, node, 0)) {
+            node->in_use = 0;
+            preempt_enable();
+            return;
+        }
+
+        /* 后继者已交换队尾但尚未链接 */
+        while (!node->next) {
+            cpu_relax();
+        }
+    }
+
+    /* 把锁交给后继者 */
+    node->next->locked = 1;
+    node->in_use = 0;
+    preempt_enable();
+}
+
+/**
+ * @brief 尝试获取排队自旋锁
+ */
+int qspinlock_trylock(qspinlock_t *lock) {
+    if (lock->tail) {
+        return 0;  /* 锁已被持有 */
+    }
+
+    preempt_disable();
+
+    uint32_t cpu = arch_cpu_id();
+    qspinlock_node_t *node = qspinlock_get_node(cpu);
+    node->next = 0;
+    node->locked = 0;
+
+    if (!__sync_bool_compare_and_swap(&lock->tail, 0, node)) {
+        node->in_use = 0;
+        preempt_enable();
+        return 0;  /* 获取失败 */
+    }
+
+    barrier();
+    lock->holder = node;
+    lock->owner = cpu;
+
+#ifdef CONFIG_LOCK_STAT
+    qspinlock_stat_acquired(lock, rdtsc(), 0);
+#endif
+    return 1;  /* 获取成功 */
+}
+
+/**
+ * @brief 获取排队自旋锁并禁用中断
+ */
+uint32_t qspinlock_lock_irqsave(qspinlock_t *lock) {
+#ifdef CONFIG_LOCK_STAT
+    uint64_t irqoff_at = rdtsc();
+#endif
+    uint32_t flags = interrupt_save_and_disable();
+    qspinlock_lock(lock);
+
+#ifdef CONFIG_LOCK_STAT
+    /* 只统计由本次调用关闭中断的情况 */
+    lock->irqoff_at = (flags & EFLAGS_IF) ? irqoff_at : 0;
+#endif
+    return flags;
+}
+
+/**
+ * @brief 释放排队自旋锁并恢复中断
+ */
+void qspinlock_unlock_irqrestore(qspinlock_t *lock, uint32_t flags) {
+#ifdef CONFIG_LOCK_STAT
+    /* 关中断时长要算到恢复中断为止 */
+    uint64_t irqoff_at = lock->irqoff_at;
+    lock->irqoff_at = 0;
+    lock_class_stat_t *stat = lock->stat;
+#endif
+    qspinlock_unlock(lock);
+    interrupt_restore(flags);
+
+#ifdef CONFIG_LOCK_STAT
+    if (irqoff_at) {
+        lockstat_released(stat, 0, rdtsc() - irqoff_at);
+    }
+#endif
+}
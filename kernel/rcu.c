@@ -0,0 +1,195 @@
+/**
+ * @file rcu.c
+ * @brief 基于静止状态的RCU实现
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#include <kernel/rcu.h>
+#include <kernel/spinlock.h>
+#include <arch/interrupt.h>
+#include <arch/percpu.h>
+
+/* 每CPU静止状态记录 */
+typedef struct {
+    volatile uint32_t qs_seq;   /* 最近一次静止状态时看到的宽限期序号 */
+} __attribute__((aligned(CACHE_LINE_SIZE))) rcu_data_t;
+
+static rcu_data_t rcu_data[NR_CPUS];
+
+/* 当前CPU因停机空闲暂时退出了宽限期检测 */
+static DEFINE_PER_CPU(uint32_t, rcu_idle);
+
+/* 最新开始的宽限期序号 */
+static volatile uint32_t rcu_gp_seq;
+
+/* 参与检测的CPU（启动时只有BSP） */
+static volatile uint32_t rcu_online_mask = 1;
+
+/* 待执行回调（按宽限期序号递增排列） */
+static struct rcu_head *rcu_cb_head;
+static struct rcu_head **rcu_cb_tail = &rcu_cb_head;
+static DEFINE_SPINLOCK(rcu_cb_lock);
+
+/**
+ * @brief 当前CPU在数组中的位置
+ */
+static inline uint32_t rcu_this_cpu(void) {
+    return arch_cpu_id() % NR_CPUS;
+}
+
+/**
+ * @brief 计算所有在线CPU都已经过的宽限期序号
+ */
+static uint32_t rcu_completed_seq(void) {
+    uint32_t completed = rcu_gp_seq;
+    uint32_t mask = rcu_online_mask;
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        if (!(mask & (1u << cpu))) {
+            continue;
+        }
+        uint32_t seq = rcu_data[cpu].qs_seq;
+        if ((int32_t)(seq - completed) < 0) {
+            completed = seq;
+        }
+    }
+
+    return completed;
+}
+
+/**
+ * @brief 执行宽限期已经结束的回调
+ */
+static void rcu_process_callbacks(void) {
+    if (!rcu_cb_head) {
+        return;  /* 没有回调 */
+    }
+
+    /* 中断处理程序也可能调用call_rcu */
+    uint32_t flags = interrupt_save_and_disable();
+    if (!spinlock_trylock(&rcu_cb_lock)) {
+        interrupt_restore(flags);
+        return;  /* 其他CPU正在处理 */
+    }
+
+    uint32_t completed = rcu_completed_seq();
+    struct rcu_head *done = NULL;
+    struct rcu_head **done_tail = &done;
+
+    while (rcu_cb_head && (int32_t)(completed - rcu_cb_head->gp) >= 0) {
+        *done_tail = rcu_cb_head;
+        done_tail = &rcu_cb_head->next;
+        rcu_cb_head = rcu_cb_head->next;
+    }
+    *done_tail = NULL;
+    if (!rcu_cb_head) {
+        rcu_cb_tail = &rcu_cb_head;
+    }
+
+    spinlock_unlock(&rcu_cb_lock);
+    interrupt_restore(flags);
+
+    /* 在锁外执行回调 */
+    while (done) {
+        struct rcu_head *next = done->next;
+        done->func(done);
+        done = next;
+    }
+}
+
+/**
+ * @brief 报告当前CPU处于静止状态
+ */
+void rcu_quiescent_state(void) {
+    barrier();
+    rcu_data[rcu_this_cpu()].qs_seq = rcu_gp_seq;
+
+    rcu_process_callbacks();
+}
+
+/**
+ * @brief 时钟中断打断了用户态
+ *
+ * 用户态不可能处在读临界区内。只记录序号，不在中断中执行回调；
+ * 一直运行用户程序的CPU因此不会拖住宽限期。
+ */
+void rcu_user_tick(void) {
+    barrier();
+    rcu_data[rcu_this_cpu()].qs_seq = rcu_gp_seq;
+}
+
+/**
+ * @brief 等待一个完整的宽限期
+ */
+void synchronize_rcu(void) {
+    /* 原子操作同时充当完整内存屏障，之前的删除对读者可见 */
+    uint32_t gp = __sync_add_and_fetch(&rcu_gp_seq, 1);
+    uint32_t self = rcu_this_cpu();
+
+    rcu_data[self].qs_seq = gp;
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        while ((rcu_online_mask & (1u << cpu)) &&
+               (int32_t)(rcu_data[cpu].qs_seq - gp) < 0) {
+            cpu_relax();
+        }
+    }
+}
+
+/**
+ * @brief 宽限期结束后异步调用func
+ */
+void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *head)) {
+    head->func = func;
+    head->next = NULL;
+
+    uint32_t flags = spinlock_lock_irqsave(&rcu_cb_lock);
+    head->gp = __sync_add_and_fetch(&rcu_gp_seq, 1);
+    *rcu_cb_tail = head;
+    rcu_cb_tail = &head->next;
+    spinlock_unlock_irqrestore(&rcu_cb_lock, flags);
+}
+
+/**
+ * @brief 将CPU加入宽限期检测
+ */
+void rcu_cpu_online(uint32_t cpu) {
+    cpu %= NR_CPUS;
+
+    /* 上线前的读临界区不可能引用旧数据 */
+    rcu_data[cpu].qs_seq = rcu_gp_seq;
+    __sync_fetch_and_or(&rcu_online_mask, 1u << cpu);
+}
+
+/**
+ * @brief 将CPU移出宽限期检测
+ */
+void rcu_cpu_offline(uint32_t cpu) {
+    __sync_fetch_and_and(&rcu_online_mask, ~(1u << (cpu % NR_CPUS)));
+}
+
+/**
+ * @brief 进入停机空闲
+ *
+ * 停机的CPU没有读临界区，相当于一直处于静止状态；移出检测后
+ * synchronize_rcu不必等它醒来。
+ */
+void rcu_idle_enter(void) {
+    uint32_t cpu = rcu_this_cpu();
+
+    if (rcu_online_mask & (1u << cpu)) {
+        this_cpu_write(rcu_idle, 1);
+        rcu_cpu_offline(cpu);
+    }
+}
+
+/**
+ * @brief 中断入口：在处理函数读取受保护的数据之前重新加入检测
+ */
+void rcu_irq_enter(void) {
+    if (this_cpu_read(rcu_idle)) {
+        this_cpu_write(rcu_idle, 0);
+        rcu_cpu_online(rcu_this_cpu());
+    }
+}
@@ -0,0 +1,265 @@
+/**
+ * @file softirq.c
+ * @brief 软中断和tasklet实现
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#include <kernel/softirq.h>
+#include <arch/interrupt.h>
+#include <arch/percpu.h>
+
+/* 每CPU的tasklet队列 */
+typedef struct {
+    tasklet_t *head;
+    tasklet_t *tail;
+} tasklet_list_t;
+
+/* 软中断处理函数表 */
+static softirq_action_t softirq_vec[NR_SOFTIRQS];
+
+/* 处理不完时的唤醒回调 */
+static void (*softirq_wakeup_hook)(void);
+
+/* 每CPU待处理位图、是否正在执行软中断和执行次数 */
+static DEFINE_PER_CPU(uint32_t, softirq_pending_mask);
+static DEFINE_PER_CPU(uint32_t, softirq_active);
+static DEFINE_PER_CPU(uint32_t [NR_SOFTIRQS], softirq_count);
+
+/* 每CPU的tasklet队列 */
+static DEFINE_PER_CPU(tasklet_list_t, tasklet_vec);
+static DEFINE_PER_CPU(tasklet_list_t, tasklet_hi_vec);
+
+/**
+ * @brief 登记软中断处理函数
+ */
+void open_softirq(uint32_t nr, softirq_action_t action) {
+    if (nr < NR_SOFTIRQS) {
+        softirq_vec[nr] = action;
+    }
+}
+
+/**
+ * @brief 触发软中断（已关中断）
+ */
+void raise_softirq_irqoff(uint32_t nr) {
+    if (nr >= NR_SOFTIRQS) {
+        return;
+    }
+
+    this_cpu_or(softirq_pending_mask, 1u << nr);
+
+    /* 中断出口会处理；在线程上下文中触发则交给ksoftirqd */
+    if (!interrupt_in_context() && !softirq_in_context() && softirq_wakeup_hook) {
+        softirq_wakeup_hook();
+    }
+}
+
+/**
+ * @brief 触发软中断
+ */
+void raise_softirq(uint32_t nr) {
+    uint32_t flags = interrupt_save_and_disable();
+    raise_softirq_irqoff(nr);
+    interrupt_restore(flags);
+}
+
+/**
+ * @brief 当前CPU待处理的软中断位图
+ */
+uint32_t softirq_pending(void) {
+    return this_cpu_read(softirq_pending_mask);
+}
+
+/**
+ * @brief 检查当前CPU是否正在执行软中断
+ */
+int softirq_in_context(void) {
+    return this_cpu_read(softirq_active) != 0;
+}
+
+/**
+ * @brief 设置处理不完时的唤醒回调
+ */
+void softirq_set_wakeup_hook(void (*hook)(void)) {
+    softirq_wakeup_hook = hook;
+}
+
+/**
+ * @brief 软中断在某个CPU上的执行次数
+ */
+uint32_t softirq_get_count(uint32_t nr, uint32_t cpu) {
+    if (nr >= NR_SOFTIRQS || cpu >= NR_CPUS) {
+        return 0;
+    }
+    return per_cpu(softirq_count, cpu)[nr];
+}
+
+/**
+ * @brief 执行待处理的软中断（进入和返回时中断关闭）
+ */
+static void __do_softirq(void) {
+    uint32_t restart = SOFTIRQ_MAX_RESTART;
+    uint32_t pending;
+
+    this_cpu_write(softirq_active, 1);
+
+    while ((pending = this_cpu_read(softirq_pending_mask)) != 0) {
+        this_cpu_write(softirq_pending_mask, 0);
+
+        /* 处理期间允许硬中断，新触发的软中断在下一轮处理 */
+        interrupt_enable_global();
+
+        while (pending) {
+            uint32_t nr = (uint32_t)__builtin_ctz(pending);
+            pending &= pending - 1;
+
+            if (softirq_vec[nr]) {
+                softirq_vec[nr]();
+            }
+            this_cpu_inc(softirq_count[nr]);
+        }
+
+        interrupt_disable_global();
+
+        if (--restart == 0) {
+            break;
+        }
+    }
+
+    this_cpu_write(softirq_active, 0);
+
+    /* 持续有新工作：交给线程处理，让出中断出口 */
+    if (this_cpu_read(softirq_pending_mask) && softirq_wakeup_hook) {
+        softirq_wakeup_hook();
+    }
+}
+
+/**
+ * @brief 执行当前CPU待处理的软中断
+ */
+void do_softirq(void) {
+    if (interrupt_in_context() || softirq_in_context()) {
+        return;
+    }
+
+    uint32_t flags = interrupt_save_and_disable();
+    if (this_cpu_read(softirq_pending_mask)) {
+        __do_softirq();
+    }
+    interrupt_restore(flags);
+}
+
+/**
+ * @brief 初始化tasklet
+ */
+void tasklet_init(tasklet_t *t, void (*func)(void *data), void *data) {
+    t->next = NULL;
+    t->state = 0;
+    t->func = func;
+    t->data = data;
+}
+
+/**
+ * @brief 追加到队列末尾（已关中断）
+ */
+static void tasklet_enqueue(tasklet_list_t *list, tasklet_t *t) {
+    t->next = NULL;
+    if (list->tail) {
+        list->tail->next = t;
+    } else {
+        list->head = t;
+    }
+    list->tail = t;
+}
+
+static void __tasklet_schedule(tasklet_t *t, tasklet_list_t *vec, uint32_t nr) {
+    /* 已在某个CPU的队列中 */
+    if (__sync_fetch_and_or(&t->state, TASKLET_STATE_SCHED) & TASKLET_STATE_SCHED) {
+        return;
+    }
+
+    uint32_t flags = interrupt_save_and_disable();
+    tasklet_enqueue(this_cpu_ptr(vec), t);
+    raise_softirq_irqoff(nr);
+    interrupt_restore(flags);
+}
+
+/**
+ * @brief 调度tasklet
+ */
+void tasklet_schedule(tasklet_t *t) {
+    __tasklet_schedule(t, &tasklet_vec, TASKLET_SOFTIRQ);
+}
+
+/**
+ * @brief 以高优先级调度tasklet
+ */
+void tasklet_hi_schedule(tasklet_t *t) {
+    __tasklet_schedule(t, &tasklet_hi_vec, HI_SOFTIRQ);
+}
+
+/**
+ * @brief 运行本CPU队列中的tasklet（软中断上下文，开中断）
+ */
+static void tasklet_run_list(tasklet_list_t *vec, uint32_t nr) {
+    uint32_t flags = interrupt_save_and_disable();
+    tasklet_list_t *list = this_cpu_ptr(vec);
+    tasklet_t *t = list->head;
+    list->head = NULL;
+    list->tail = NULL;
+    interrupt_restore(flags);
+
+    while (t) {
+        tasklet_t *next = t->next;
+
+        if (__sync_fetch_and_or(&t->state, TASKLET_STATE_RUN) & TASKLET_STATE_RUN) {
+            /* 正在其他CPU上运行，放回队列下一轮再试 */
+            flags = interrupt_save_and_disable();
+            tasklet_enqueue(this_cpu_ptr(vec), t);
+            raise_softirq_irqoff(nr);
+            interrupt_restore(flags);
+        } else {
+            /* 先清除SCHED，运行期间可以再次被调度 */
+            __sync_fetch_and_and(&t->state, ~TASKLET_STATE_SCHED);
+            t->func(t->data);
+            __sync_fetch_and_and(&t->state, ~TASKLET_STATE_RUN);
+        }
+
+        t = next;
+    }
+}
+
+static void tasklet_action(void) {
+    tasklet_run_list(&tasklet_vec, TASKLET_SOFTIRQ);
+}
+
+static void tasklet_hi_action(void) {
+    tasklet_run_list(&tasklet_hi_vec, HI_SOFTIRQ);
+}
+
+/**
+ * @brief 等待tasklet执行完毕并且不再在队列中
+ */
+void tasklet_kill(tasklet_t *t) {
+    /* 占住SCHED位，之后的调度请求都被忽略 */
+    while (__sync_fetch_and_or(&t->state, TASKLET_STATE_SCHED) & TASKLET_STATE_SCHED) {
+        while (t->state & TASKLET_STATE_SCHED) {
+            cpu_relax();
+        }
+    }
+
+    while (t->state & TASKLET_STATE_RUN) {
+        cpu_relax();
+    }
+
+    __sync_fetch_and_and(&t->state, ~TASKLET_STATE_SCHED);
+}
+
+/**
+ * @brief 初始化软中断
+ */
+void softirq_init(void) {
+    open_softirq(HI_SOFTIRQ, tasklet_hi_action);
+    open_softirq(TASKLET_SOFTIRQ, tasklet_action);
+}
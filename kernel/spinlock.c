@@ -6,45 +6,141 @@
  */
 
 #include <kernel/spinlock.h>
+#include <kernel/preempt.h>
 #include <arch/interrupt.h>
+#include <arch/cpu.h>
+
+/* 票号增量：next_ticket位于锁字的高16位 */
+#define TICKET_NEXT_INC     (1u << 16)
+
+/* EFLAGS中断允许位 */
+#define EFLAGS_IF           0x200
+
+#ifdef CONFIG_LOCK_STAT
+/**
+ * @brief 获取成功后记录统计
+ */
+static inline void spinlock_stat_acquired(spinlock_t *lock, uint64_t start, int contended) {
+    if (!lock->stat) {
+        lock->stat = lockstat_class(lock->name);
+    }
+
+    lock->acquired_at = rdtsc();
+    lockstat_acquired(lock->stat, lock->acquired_at - start, contended);
+}
+
+/**
+ * @brief 释放前记录持有时间
+ */
+static inline void spinlock_stat_released(spinlock_t *lock) {
+    lockstat_released(lock->stat, rdtsc() - lock->acquired_at, 0);
+}
+
+/**
+ * @brief 读写锁获取成功后记录统计，只有写者记录获取时间
+ */
+static inline void rwlock_stat_acquired(rwlock_t *lock, uint64_t start, int contended,
+                                        int writer) {
+    if (!lock->stat) {
+        lock->stat = lockstat_class(lock->name);
+    }
+
+    uint64_t now = rdtsc();
+    if (writer) {
+        lock->acquired_at = now;
+    }
+    lockstat_acquired(lock->stat, now - start, contended);
+}
+#endif
+
+static int rwlock_read_tryenter(rwlock_t *lock);
 
 /**
  * @brief 初始化自旋锁
  */
 void spinlock_init(spinlock_t *lock, const char *name) {
     lock->lock = 0;
-    lock->owner = 0;
+    lock->owner = SPINLOCK_NO_OWNER;
+    lock->contended = 0;
     lock->name = name ? name : "unknown";
+#ifdef CONFIG_LOCK_STAT
+    lock->stat = NULL;
+    lock->acquired_at = 0;
+    lock->irqoff_at = 0;
+#endif
 }
 
 /**
  * @brief 获取自旋锁
  */
 void spinlock_lock(spinlock_t *lock) {
-    /* 简单的test-and-set实现 */
-    while (__sync_lock_test_and_set(&lock->lock, 1)) {
-        /* 自旋等待 */
-        __asm__ volatile("pause");
+#ifdef CONFIG_LOCK_STAT
+    uint64_t start = rdtsc();
+#endif
+
+    /* 持有期间不能被抢占：同一CPU上的下一个线程会一直等它 */
+    preempt_disable();
+
+    /* 领取票号，只有这一步写共享缓存行 */
+    uint32_t val = __sync_fetch_and_add(&lock->lock, TICKET_NEXT_INC);
+    uint16_t ticket = (uint16_t)(val >> 16);
+
+    if ((uint16_t)val != ticket) {
+        __sync_fetch_and_add(&lock->contended, 1);
+
+        /* 只读自旋，直到轮到自己 */
+        while (lock->tickets.owner_ticket != ticket) {
+            cpu_relax();
+        }
     }
-    lock->owner = 0;  /* 这里可以记录当前CPU */
+
+    barrier();
+    lock->owner = arch_cpu_id();
+
+#ifdef CONFIG_LOCK_STAT
+    spinlock_stat_acquired(lock, start, (uint16_t)val != ticket);
+#endif
 }
 
 /**
  * @brief 释放自旋锁
  */
 void spinlock_unlock(spinlock_t *lock) {
-    lock->owner = 0;
-    __sync_lock_release(&lock->lock);
+#ifdef CONFIG_LOCK_STAT
+    spinlock_stat_released(lock);
+#endif
+
+    lock->owner = SPINLOCK_NO_OWNER;
+    barrier();
+
+    /* 只有持有者修改owner_ticket，无需加锁前缀 */
+    lock->tickets.owner_ticket++;
+
+    preempt_enable();
 }
 
 /**
  * @brief 尝试获取自旋锁
  */
 int spinlock_trylock(spinlock_t *lock) {
-    if (__sync_lock_test_and_set(&lock->lock, 1)) {
+    uint32_t val = lock->lock;
+
+    if ((uint16_t)val != (uint16_t)(val >> 16)) {
+        return 0;  /* 锁已被持有 */
+    }
+
+    preempt_disable();
+    if (!__sync_bool_compare_and_swap(&lock->lock, val, val + TICKET_NEXT_INC)) {
+        preempt_enable();
         return 0;  /* 获取失败 */
     }
-    lock->owner = 0;
+
+    barrier();
+    lock->owner = arch_cpu_id();
+
+#ifdef CONFIG_LOCK_STAT
+    spinlock_stat_acquired(lock, rdtsc(), 0);
+#endif
     return 1;  /* 获取成功 */
 }
 
@@ -52,15 +148,24 @@ int spinlock_trylock(spinlock_t *lock) {
  * @brief 检查自旋锁状态
  */
 int spinlock_is_locked(spinlock_t *lock) {
-    return lock->lock != 0;
+    uint32_t val = lock->lock;
+    return (uint16_t)val != (uint16_t)(val >> 16);
 }
 
 /**
  * @brief 获取自旋锁并禁用中断
  */
 uint32_t spinlock_lock_irqsave(spinlock_t *lock) {
+#ifdef CONFIG_LOCK_STAT
+    uint64_t irqoff_at = rdtsc();
+#endif
     uint32_t flags = interrupt_save_and_disable();
     spinlock_lock(lock);
+
+#ifdef CONFIG_LOCK_STAT
+    /* 只统计由本次调用关闭中断的情况 */
+    lock->irqoff_at = (flags & EFLAGS_IF) ? irqoff_at : 0;
+#endif
     return flags;
 }
 
@@ -68,8 +173,19 @@ uint32_t spinlock_lock_irqsave(spinlock_t *lock) {
  * @brief 释放自旋锁并恢复中断
  */
 void spinlock_unlock_irqrestore(spinlock_t *lock, uint32_t flags) {
+#ifdef CONFIG_LOCK_STAT
+    /* 关中断时长要算到恢复中断为止 */
+    uint64_t irqoff_at = lock->irqoff_at;
+    lock->irqoff_at = 0;
+#endif
     spinlock_unlock(lock);
     interrupt_restore(flags);
+
+#ifdef CONFIG_LOCK_STAT
+    if (irqoff_at) {
+        lockstat_released(lock->stat, 0, rdtsc() - irqoff_at);
+    }
+#endif
 }
 
 /**
@@ -86,4 +202,202 @@ void spinlock_lock_irq(spinlock_t *lock) {
 void spinlock_unlock_irq(spinlock_t *lock) {
     spinlock_unlock(lock);
     interrupt_enable_global();
-}
\ No newline at end of file
+}
+/**
+ * @brief 初始化读写锁
+ */
+void rwlock_init(rwlock_t *lock, const char *name) {
+    lock->state = 0;
+    lock->writers_waiting = 0;
+    lock->owner = SPINLOCK_NO_OWNER;
+    lock->name = name ? name : "unknown";
+#ifdef CONFIG_LOCK_STAT
+    lock->stat = NULL;
+    lock->acquired_at = 0;
+    lock->irqoff_at = 0;
+#endif
+}
+
+/**
+ * @brief 获取读锁
+ */
+void rwlock_read_lock(rwlock_t *lock) {
+#ifdef CONFIG_LOCK_STAT
+    uint64_t start = rdtsc();
+#endif
+    int contended = 0;
+
+    while (!rwlock_read_tryenter(lock)) {
+        contended = 1;
+        /* 写者持有或等待时只读自旋 */
+        while ((lock->state & RWLOCK_WRITER) || lock->writers_waiting) {
+            cpu_relax();
+        }
+    }
+
+#ifdef CONFIG_LOCK_STAT
+    rwlock_stat_acquired(lock, start, contended, 0);
+#else
+    (void)contended;
+#endif
+}
+
+/**
+ * @brief 释放读锁
+ */
+void rwlock_read_unlock(rwlock_t *lock) {
+    __sync_fetch_and_sub(&lock->state, 1);
+    preempt_enable();
+}
+
+/**
+ * @brief 获取写锁
+ */
+void rwlock_write_lock(rwlock_t *lock) {
+#ifdef CONFIG_LOCK_STAT
+    uint64_t start = rdtsc();
+#endif
+    int contended = 0;
+
+    preempt_disable();
+
+    /* 先登记，阻止新读者进入 */
+    __sync_fetch_and_add(&lock->writers_waiting, 1);
+
+    for (;;) {
+        while (lock->state) {
+            contended = 1;
+            cpu_relax();  /* 等待读者退出和前一个写者释放 */
+        }
+        if (__sync_bool_compare_and_swap(&lock->state, 0, RWLOCK_WRITER)) {
+            break;
+        }
+        contended = 1;
+    }
+
+    __sync_fetch_and_sub(&lock->writers_waiting, 1);
+    lock->owner = arch_cpu_id();
+
+#ifdef CONFIG_LOCK_STAT
+    rwlock_stat_acquired(lock, start, contended, 1);
+#else
+    (void)contended;
+#endif
+}
+
+/**
+ * @brief 释放写锁
+ */
+void rwlock_write_unlock(rwlock_t *lock) {
+#ifdef CONFIG_LOCK_STAT
+    lockstat_released(lock->stat, rdtsc() - lock->acquired_at, 0);
+#endif
+
+    lock->owner = SPINLOCK_NO_OWNER;
+    barrier();
+    lock->state = 0;
+    preempt_enable();
+}
+
+/**
+ * @brief 尝试进入读者计数（不记录统计）
+ */
+static int rwlock_read_tryenter(rwlock_t *lock) {
+    uint32_t old = lock->state;
+
+    if ((old & RWLOCK_WRITER) || lock->writers_waiting) {
+        return 0;  /* 写者优先 */
+    }
+
+    preempt_disable();
+    if (!__sync_bool_compare_and_swap(&lock->state, old, old + 1)) {
+        preempt_enable();
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief 尝试获取读锁
+ */
+int rwlock_read_trylock(rwlock_t *lock) {
+    if (!rwlock_read_tryenter(lock)) {
+        return 0;
+    }
+
+#ifdef CONFIG_LOCK_STAT
+    rwlock_stat_acquired(lock, rdtsc(), 0, 0);
+#endif
+    return 1;
+}
+
+/**
+ * @brief 尝试获取写锁
+ */
+int rwlock_write_trylock(rwlock_t *lock) {
+    preempt_disable();
+    if (!__sync_bool_compare_and_swap(&lock->state, 0, RWLOCK_WRITER)) {
+        preempt_enable();
+        return 0;  /* 获取失败 */
+    }
+
+    lock->owner = arch_cpu_id();
+
+#ifdef CONFIG_LOCK_STAT
+    rwlock_stat_acquired(lock, rdtsc(), 0, 1);
+#endif
+    return 1;  /* 获取成功 */
+}
+
+/**
+ * @brief 获取读锁并禁用中断
+ */
+uint32_t rwlock_read_lock_irqsave(rwlock_t *lock) {
+    uint32_t flags = interrupt_save_and_disable();
+    rwlock_read_lock(lock);
+    return flags;
+}
+
+/**
+ * @brief 释放读锁并恢复中断
+ */
+void rwlock_read_unlock_irqrestore(rwlock_t *lock, uint32_t flags) {
+    rwlock_read_unlock(lock);
+    interrupt_restore(flags);
+}
+
+/**
+ * @brief 获取写锁并禁用中断
+ */
+uint32_t rwlock_write_lock_irqsave(rwlock_t *lock) {
+#ifdef CONFIG_LOCK_STAT
+    uint64_t irqoff_at = rdtsc();
+#endif
+    uint32_t flags = interrupt_save_and_disable();
+    rwlock_write_lock(lock);
+
+#ifdef CONFIG_LOCK_STAT
+    /* 只统计由本次调用关闭中断的情况 */
+    lock->irqoff_at = (flags & EFLAGS_IF) ? irqoff_at : 0;
+#endif
+    return flags;
+}
+
+/**
+ * @brief 释放写锁并恢复中断
+ */
+void rwlock_write_unlock_irqrestore(rwlock_t *lock, uint32_t flags) {
+#ifdef CONFIG_LOCK_STAT
+    /* 关中断时长要算到恢复中断为止 */
+    uint64_t irqoff_at = lock->irqoff_at;
+    lock->irqoff_at = 0;
+#endif
+    rwlock_write_unlock(lock);
+    interrupt_restore(flags);
+
+#ifdef CONFIG_LOCK_STAT
+    if (irqoff_at) {
+        lockstat_released(lock->stat, 0, rdtsc() - irqoff_at);
+    }
+#endif
+}
@@ -11,10 +11,11 @@
 #include <kernel/string.h>
 #include <kernel/memory.h>
 #include <kernel/spinlock.h>
+#include <kernel/rcu.h>
 
 /* 终端管理器全局实例 */
 static terminal_manager_t terminal_manager;
-static spinlock_t terminal_lock;
+static spinlock_t terminal_lock;  /* 只在修改者之间互斥，查找走RCU不加锁 */
 
 /* ANSI转义序列状态 */
 #define ANSI_STATE_NONE        0
@@ -35,9 +36,18 @@ static spinlock_t terminal_lock;
 /* 内部函数声明 */
 static int terminal_process_csi_sequence(terminal_t *terminal);
 static void terminal_reset_escape_state(terminal_t *terminal);
+static void terminal_session_free(struct rcu_head *head);
 static int terminal_execute_control(terminal_t *terminal, terminal_control_t ctrl,
                                    const char *params);
 
+/**
+ * @brief 终端槽位是否对查找可见
+ */
+static inline int terminal_slot_visible(const terminal_t *terminal) {
+    terminal_state_t state = *(volatile const terminal_state_t *)&terminal->state;
+    return state != TERMINAL_STATE_INACTIVE && state != TERMINAL_STATE_RELEASING;
+}
+
 /**
  * @brief 初始化终端管理器
  */
@@ -47,7 +57,7 @@ int terminal_manager_init(void) {
     }
 
     /* 初始化锁 */
-    spinlock_init(&terminal_lock);
+    spinlock_init(&terminal_lock, "terminal");
 
     /* 清零管理器 */
     memset(&terminal_manager, 0, sizeof(terminal_manager));
@@ -104,7 +114,6 @@ terminal_t *terminal_create(const char *name, terminal_type_t type, int tty_mino
     memset(terminal, 0, sizeof(terminal_t));
     strncpy(terminal->name, name, sizeof(terminal->name) - 1);
     terminal->type = type;
-    terminal->state = TERMINAL_STATE_ACTIVE;
     terminal->tty_minor = tty_minor;
     terminal->session_id = 0;
     terminal->process_id = 0;
@@ -131,6 +140,10 @@ terminal_t *terminal_create(const char *name, terminal_type_t type, int tty_mino
         return NULL;
     }
 
+    /* 初始化完成后再对无锁查找可见 */
+    barrier();
+    terminal->state = TERMINAL_STATE_ACTIVE;
+
     terminal_manager.terminal_count++;
     spinlock_unlock(&terminal_lock);
 
@@ -150,11 +163,17 @@ int terminal_destroy(terminal_t *terminal) {
     /* 关闭关联的TTY */
     tty_close(terminal->tty_minor);
 
-    /* 清空终端 */
+    /* 先对查找隐藏，槽位暂不回收 */
+    terminal->state = TERMINAL_STATE_RELEASING;
+    terminal_manager.terminal_count--;
+    spinlock_unlock(&terminal_lock);
+
+    /* 等待仍在遍历该槽位的读者退出 */
+    synchronize_rcu();
+
+    spinlock_lock(&terminal_lock);
     memset(terminal, 0, sizeof(terminal_t));
     terminal->state = TERMINAL_STATE_INACTIVE;
-
-    terminal_manager.terminal_count--;
     spinlock_unlock(&terminal_lock);
 
     return 0;
@@ -162,47 +181,42 @@ int terminal_destroy(terminal_t *terminal) {
 
 /**
  * @brief 查找终端
+ *
+ * 槽位在synchronize_rcu之后才清空，返回的终端在调用者退出RCU读临界区
+ * 之前保持有效，调用者必须在同一临界区内用完它。
  */
 terminal_t *terminal_find_by_name(const char *name) {
     if (!name) {
         return NULL;
     }
 
-    spinlock_lock(&terminal_lock);
-
     for (int i = 0; i < MAX_TTYS; i++) {
         terminal_t *terminal = &terminal_manager.terminals[i];
-        if (terminal->state != TERMINAL_STATE_INACTIVE &&
+        if (terminal_slot_visible(terminal) &&
             strcmp(terminal->name, name) == 0) {
-            spinlock_unlock(&terminal_lock);
             return terminal;
         }
     }
 
-    spinlock_unlock(&terminal_lock);
     return NULL;
 }
 
 /**
- * @brief 根据TTY查找终端
+ * @brief 根据TTY查找终端（调用者持有rcu_read_lock，见terminal_find_by_name）
  */
 terminal_t *terminal_find_by_tty(int tty_minor) {
     if (!tty_is_valid_minor(tty_minor)) {
         return NULL;
     }
 
-    spinlock_lock(&terminal_lock);
-
     for (int i = 0; i < MAX_TTYS; i++) {
         terminal_t *terminal = &terminal_manager.terminals[i];
-        if (terminal->state != TERMINAL_STATE_INACTIVE &&
+        if (terminal_slot_visible(terminal) &&
             terminal->tty_minor == tty_minor) {
-            spinlock_unlock(&terminal_lock);
             return terminal;
         }
     }
 
-    spinlock_unlock(&terminal_lock);
     return NULL;
 }
 
@@ -260,7 +274,9 @@ int terminal_set_focus(terminal_t *terminal) {
     }
 
     /* 设置焦点终端 */
+    spinlock_lock(&terminal_lock);
     terminal_manager.focused_terminal = terminal - terminal_manager.terminals;
+    spinlock_unlock(&terminal_lock);
 
     return 0;
 }
@@ -269,22 +285,26 @@ int terminal_set_focus(terminal_t *terminal) {
  * @brief 获取当前活动终端
  */
 terminal_t *terminal_get_active(void) {
-    if (terminal_manager.active_terminal < 0) {
+    int index = *(volatile int *)&terminal_manager.active_terminal;
+
+    if (index < 0) {
         return NULL;
     }
 
-    return &terminal_manager.terminals[terminal_manager.active_terminal];
+    return &terminal_manager.terminals[index];
 }
 
 /**
  * @brief 获取当前焦点终端
  */
 terminal_t *terminal_get_focused(void) {
-    if (terminal_manager.focused_terminal < 0) {
+    int index = *(volatile int *)&terminal_manager.focused_terminal;
+
+    if (index < 0) {
         return NULL;
     }
 
-    return &terminal_manager.terminals[terminal_manager.focused_terminal];
+    return &terminal_manager.terminals[index];
 }
 
 /**
@@ -594,7 +614,6 @@ terminal_session_t *terminal_session_create(terminal_t *terminal, uint32_t user_
 
     /* 初始化会话 */
     memset(session, 0, sizeof(terminal_session_t));
-    session->session_id = terminal_manager.next_session_id++;
     session->user_id = user_id;
     session->group_id = user_id;  /* 简化处理 */
     strncpy(session->username, username, sizeof(session->username) - 1);
@@ -602,50 +621,83 @@ terminal_session_t *terminal_session_create(terminal_t *terminal, uint32_t user_
     strncpy(session->working_dir, "/", sizeof(session->working_dir) - 1);
     session->terminal = terminal;
 
+    spinlock_lock(&terminal_lock);
+    session->session_id = terminal_manager.next_session_id++;
+
     /* 关联终端和会话 */
     terminal->session_id = session->session_id;
 
-    /* 添加到会话链表 */
+    /* 初始化完成后再发布到会话链表 */
     session->next = terminal_manager.sessions;
-    terminal_manager.sessions = session;
+    rcu_assign_pointer(terminal_manager.sessions, session);
+    spinlock_unlock(&terminal_lock);
 
     return session;
 }
 
 /**
- * @brief 终端状态变化通知
+ * @brief 宽限期结束后释放会话
  */
-void terminal_notify_state_change(terminal_t *terminal, terminal_state_t old_state,
-                                 terminal_state_t new_state) {
-    /* 这里可以实现状态变化的通知逻辑 */
+static void terminal_session_free(struct rcu_head *head) {
+    kfree(container_of(head, terminal_session_t, rcu));
 }
 
 /**
- * @brief 创建终端会话
+ * @brief 销毁终端会话
  */
-terminal_session_t *terminal_session_create(terminal_t *terminal, uint32_t user_id,
-                                           const char *username, const char *shell) {
-    if (!terminal || !username || !shell) {
-        return NULL;
+int terminal_session_destroy(terminal_session_t *session) {
+    if (!session) {
+        return -1;
     }
 
-    terminal_session_t *session = kmalloc(sizeof(terminal_session_t));
-    if (!session) {
-        return NULL;
+    spinlock_lock(&terminal_lock);
+
+    terminal_session_t **link = &terminal_manager.sessions;
+    while (*link && *link != session) {
+        link = &(*link)->next;
     }
 
-    memset(session, 0, sizeof(terminal_session_t));
-    session->session_id = terminal_manager.next_session_id++;
-    session->user_id = user_id;
-    session->group_id = user_id;
-    strncpy(session->username, username, sizeof(session->username) - 1);
-    strncpy(session->shell, shell, sizeof(session->shell) - 1);
-    strncpy(session->working_dir, "/", sizeof(session->working_dir) - 1);
-    session->terminal = terminal;
+    if (!*link) {
+        spinlock_unlock(&terminal_lock);
+        return -1;  /* 不在链表中 */
+    }
 
-    terminal->session_id = session->session_id;
-    session->next = terminal_manager.sessions;
-    terminal_manager.sessions = session;
+    /* 摘除后正在遍历的读者仍可通过session->next继续前进 */
+    rcu_assign_pointer(*link, session->next);
 
-    return session;
-}
\ No newline at end of file
+    if (session->terminal && session->terminal->session_id == session->session_id) {
+        session->terminal->session_id = 0;
+    }
+
+    spinlock_unlock(&terminal_lock);
+
+    call_rcu(&session->rcu, terminal_session_free);
+    return 0;
+}
+
+/**
+ * @brief 查找会话
+ *
+ * 会话经call_rcu释放，返回的指针只在调用者的RCU读临界区内有效。
+ */
+terminal_session_t *terminal_session_find(uint32_t session_id) {
+    terminal_session_t *found = NULL;
+
+    for (terminal_session_t *session = rcu_dereference(terminal_manager.sessions);
+         session; session = rcu_dereference(session->next)) {
+        if (session->session_id == session_id) {
+            found = session;
+            break;
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief 终端状态变化通知
+ */
+void terminal_notify_state_change(terminal_t *terminal, terminal_state_t old_state,
+                                 terminal_state_t new_state) {
+    /* 这里可以实现状态变化的通知逻辑 */
+}
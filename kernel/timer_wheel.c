@@ -0,0 +1,397 @@
+/**
+ * @file timer_wheel.c
+ * @brief 分层时间轮定时器实现
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#include <kernel/timer_wheel.h>
+#include <kernel/softirq.h>
+#include <kernel/spinlock.h>
+#include <arch/interrupt.h>
+
+/* 第n个上层的槽号 */
+#define TVN_INDEX(clk, n) \
+    ((uint32_t)((clk) >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+/* 时间轮 */
+typedef struct {
+    spinlock_t lock;
+    uint64_t clk;                               /* 下一个要处理的节拍 */
+    uint64_t now;                               /* 时钟中断推进到的节拍 */
+    timer_list_t *running;                      /* 正在执行处理函数的定时器 */
+    uint32_t nr_timers;                         /* 已挂入的定时器数 */
+    timer_list_t *tv1[TVR_SIZE];
+    timer_list_t *tvn[TVN_LEVELS][TVN_SIZE];
+} timer_base_t;
+
+static timer_base_t timer_base = {
+    .lock = SPINLOCK_INITIALIZER(timer_base),
+};
+
+/* 线程睡眠接口 */
+static const timer_sleep_ops_t *sleep_ops;
+
+/**
+ * @brief 挂到槽的链表头（持有锁）
+ */
+static void timer_link(timer_list_t **slot, timer_list_t *timer) {
+    timer->next = *slot;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+/**
+ * @brief 从所在链表摘下（持有锁）
+ */
+static void timer_unlink(timer_list_t *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * @brief 按剩余节拍选层选槽（持有锁）
+ */
+static void internal_add_timer(timer_base_t *base, timer_list_t *timer) {
+    uint64_t expires = timer->expires;
+    uint64_t idx = expires - base->clk;
+    timer_list_t **slot;
+
+    if ((int64_t)idx < 0) {
+        /* 已经到期：下一个节拍处理 */
+        slot = &base->tv1[base->clk & TVR_MASK];
+    } else if (idx < TVR_SIZE) {
+        slot = &base->tv1[expires & TVR_MASK];
+    } else {
+        if (idx > TIMER_MAX_TIMEOUT) {
+            idx = TIMER_MAX_TIMEOUT;
+            expires = base->clk + idx;
+        }
+
+        uint32_t level = 0;
+        while (level < TVN_LEVELS - 1 &&
+               idx >= (1ull << (TVR_BITS + (level + 1) * TVN_BITS))) {
+            level++;
+        }
+        slot = &base->tvn[level][TVN_INDEX(expires, level)];
+    }
+
+    timer_link(slot, timer);
+}
+
+/**
+ * @brief 把上层一个槽的定时器重新分散到下面各层（持有锁）
+ * @return 槽号，为0说明这一层也转完了一圈
+ */
+static uint32_t cascade(timer_base_t *base, uint32_t level, uint32_t index) {
+    timer_list_t *timer = base->tvn[level][index];
+    base->tvn[level][index] = NULL;
+
+    while (timer) {
+        timer_list_t *next = timer->next;
+        internal_add_timer(base, timer);
+        timer = next;
+    }
+
+    return index;
+}
+
+/**
+ * @brief TIMER_SOFTIRQ：处理到当前节拍为止到期的定时器
+ */
+static void run_timers(void) {
+    timer_base_t *base = &timer_base;
+    uint32_t flags = spinlock_lock_irqsave(&base->lock);
+
+    while (base->clk <= base->now) {
+        uint32_t index = (uint32_t)base->clk & TVR_MASK;
+
+        /* 第一层转完一圈：从上层取下一段时间的定时器 */
+        if (index == 0) {
+            for (uint32_t level = 0; level < TVN_LEVELS; level++) {
+                if (cascade(base, level, TVN_INDEX(base->clk, level)) != 0) {
+                    break;
+                }
+            }
+        }
+
+        base->clk++;
+
+        /* 摘下整个槽，链表头在本函数栈上，其他CPU仍可在持锁时删除其中的定时器 */
+        timer_list_t *list = base->tv1[index];
+        base->tv1[index] = NULL;
+        if (list) {
+            list->pprev = &list;
+        }
+
+        while (list) {
+            timer_list_t *timer = list;
+            timer_unlink(timer);
+            base->nr_timers--;
+            base->running = timer;
+
+            spinlock_unlock_irqrestore(&base->lock, flags);
+            timer->function(timer);
+            flags = spinlock_lock_irqsave(&base->lock);
+
+            base->running = NULL;
+        }
+    }
+
+    spinlock_unlock_irqrestore(&base->lock, flags);
+}
+
+/**
+ * @brief 初始化时间轮
+ */
+void timer_wheel_init(uint64_t now) {
+    uint32_t flags = spinlock_lock_irqsave(&timer_base.lock);
+    timer_base.clk = now;
+    timer_base.now = now;
+    spinlock_unlock_irqrestore(&timer_base.lock, flags);
+
+    open_softirq(TIMER_SOFTIRQ, run_timers);
+}
+
+/**
+ * @brief 推进时间（时钟中断，中断已关闭）
+ */
+void timer_wheel_update(uint64_t now) {
+    timer_base_t *base = &timer_base;
+
+    spinlock_lock(&base->lock);
+
+    base->now = now;
+    if (base->nr_timers == 0) {
+        /* 没有定时器：直接跟上，不必逐槽走过空的时间轮 */
+        base->clk = now + 1;
+    }
+
+    uint32_t pending = base->clk <= now;
+
+    spinlock_unlock(&base->lock);
+
+    if (pending) {
+        raise_softirq_irqoff(TIMER_SOFTIRQ);
+    }
+}
+
+/**
+ * @brief 时间轮看到的当前节拍
+ */
+uint64_t timer_get_jiffies(void) {
+    uint32_t flags = spinlock_lock_irqsave(&timer_base.lock);
+    uint64_t now = timer_base.now;
+    spinlock_unlock_irqrestore(&timer_base.lock, flags);
+    return now;
+}
+
+/**
+ * @brief 链表中最早的到期时间
+ */
+static uint64_t list_min_expires(const timer_list_t *timer, uint64_t min) {
+    for (; timer; timer = timer->next) {
+        if (timer->expires < min) {
+            min = timer->expires;
+        }
+    }
+    return min;
+}
+
+/**
+ * @brief 最早的定时器到期时间
+ *
+ * 第一层的槽对应确定的节拍，从当前位置往后第一个非空槽就是这一层最早的；
+ * 上层从当前槽的下一个开始找第一个非空槽（当前槽只可能放着转一整圈后
+ * 才到期的定时器），再在槽内取最小值。
+ */
+int timer_wheel_next_expiry(uint64_t *expires) {
+    timer_base_t *base = &timer_base;
+    uint32_t flags = spinlock_lock_irqsave(&base->lock);
+
+    if (base->nr_timers == 0) {
+        spinlock_unlock_irqrestore(&base->lock, flags);
+        return 0;
+    }
+
+    uint64_t min = UINT64_MAX;
+
+    for (uint32_t i = 0; i < TVR_SIZE; i++) {
+        uint64_t clk = base->clk + i;
+        if (base->tv1[clk & TVR_MASK]) {
+            min = clk;
+            break;
+        }
+    }
+
+    for (uint32_t level = 0; level < TVN_LEVELS; level++) {
+        uint32_t index = TVN_INDEX(base->clk, level);
+
+        for (uint32_t i = 1; i <= TVN_SIZE; i++) {
+            const timer_list_t *list = base->tvn[level][(index + i) & TVN_MASK];
+            if (list) {
+                min = list_min_expires(list, min);
+                break;
+            }
+        }
+    }
+
+    spinlock_unlock_irqrestore(&base->lock, flags);
+
+    *expires = min;
+    return 1;
+}
+
+/**
+ * @brief 初始化定时器
+ */
+void timer_setup(timer_list_t *timer, void (*function)(timer_list_t *timer), void *data) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->function = function;
+    timer->data = data;
+}
+
+/**
+ * @brief 按timer->expires挂入定时器
+ */
+void add_timer(timer_list_t *timer) {
+    mod_timer(timer, timer->expires);
+}
+
+/**
+ * @brief 修改到期时间，未挂入时挂入
+ */
+int mod_timer(timer_list_t *timer, uint64_t expires) {
+    timer_base_t *base = &timer_base;
+    uint32_t flags = spinlock_lock_irqsave(&base->lock);
+
+    int pending = timer_pending(timer);
+    if (pending) {
+        timer_unlink(timer);
+    } else {
+        base->nr_timers++;
+    }
+
+    timer->expires = expires;
+    internal_add_timer(base, timer);
+
+    spinlock_unlock_irqrestore(&base->lock, flags);
+    return pending;
+}
+
+/**
+ * @brief 取消定时器
+ */
+int del_timer(timer_list_t *timer) {
+    /* 未挂入时不必取锁 */
+    if (!timer_pending(timer)) {
+        return 0;
+    }
+
+    timer_base_t *base = &timer_base;
+    uint32_t flags = spinlock_lock_irqsave(&base->lock);
+
+    int pending = timer_pending(timer);
+    if (pending) {
+        timer_unlink(timer);
+        base->nr_timers--;
+    }
+
+    spinlock_unlock_irqrestore(&base->lock, flags);
+    return pending;
+}
+
+/**
+ * @brief 取消定时器并等待正在运行的处理函数返回
+ */
+int del_timer_sync(timer_list_t *timer) {
+    timer_base_t *base = &timer_base;
+
+    for (;;) {
+        uint32_t flags = spinlock_lock_irqsave(&base->lock);
+
+        int pending = timer_pending(timer);
+        if (pending) {
+            timer_unlink(timer);
+            base->nr_timers--;
+        }
+
+        int running = base->running == timer;
+
+        spinlock_unlock_irqrestore(&base->lock, flags);
+
+        if (!running) {
+            return pending;
+        }
+        cpu_relax();
+    }
+}
+
+/**
+ * @brief 登记线程睡眠接口
+ */
+void timer_set_sleep_ops(const timer_sleep_ops_t *ops) {
+    sleep_ops = ops;
+}
+
+/**
+ * @brief 当前可以睡眠的线程
+ */
+void *sleep_current(void) {
+    if (!sleep_ops || interrupt_in_context() || softirq_in_context()) {
+        return NULL;
+    }
+    return sleep_ops->current();
+}
+
+/**
+ * @brief 唤醒线程
+ */
+void sleep_wake(void *thread) {
+    if (thread && sleep_ops) {
+        sleep_ops->wake(thread);
+    }
+}
+
+/**
+ * @brief 超时定时器：唤醒睡眠的线程
+ */
+static void process_timeout(timer_list_t *timer) {
+    sleep_wake(timer->data);
+}
+
+/**
+ * @brief 睡眠直到超时或被唤醒
+ */
+uint32_t schedule_timeout(uint32_t ticks) {
+    void *thread = sleep_current();
+
+    /* 不能睡眠：让调用者重新检查条件 */
+    if (!thread || ticks == 0) {
+        cpu_relax();
+        return 0;
+    }
+
+    uint64_t expires = timer_get_jiffies() + ticks;
+
+    timer_list_t timer;
+    timer_setup(&timer, process_timeout, thread);
+    mod_timer(&timer, expires);
+
+    sleep_ops->block();
+
+    /* 定时器在栈上，返回前确保处理函数不再引用它 */
+    del_timer_sync(&timer);
+
+    uint64_t now = timer_get_jiffies();
+    return expires > now ? (uint32_t)(expires - now) : 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file wait.c
+ * @brief 等待队列实现
+ * @author Vest-OS Team
+ * @date 2024
+ */
+
+#include <kernel/wait.h>
+
+/**
+ * @brief 初始化等待队列
+ */
+void init_waitqueue_head(wait_queue_head_t *wq) {
+    spinlock_init(&wq->lock, "wait_queue");
+    wq->first = NULL;
+}
+
+/**
+ * @brief 初始化等待项
+ */
+void init_wait(wait_queue_entry_t *wait) {
+    wait->next = NULL;
+    wait->pprev = NULL;
+    wait->thread = sleep_current();
+}
+
+/**
+ * @brief 挂入等待队列
+ */
+void prepare_to_wait(wait_queue_head_t *wq, wait_queue_entry_t *wait) {
+    if (!wait->thread || wait->pprev) {
+        return;
+    }
+
+    /* 唤醒者持锁遍历，挂入之后对条件的检查一定看得到唤醒前的写入 */
+    uint32_t flags = spinlock_lock_irqsave(&wq->lock);
+
+    wait->next = wq->first;
+    if (wait->next) {
+        wait->next->pprev = &wait->next;
+    }
+    wq->first = wait;
+    wait->pprev = &wq->first;
+
+    spinlock_unlock_irqrestore(&wq->lock, flags);
+}
+
+/**
+ * @brief 从等待队列摘下
+ */
+void finish_wait(wait_queue_head_t *wq, wait_queue_entry_t *wait) {
+    if (!wait->pprev) {
+        return;
+    }
+
+    uint32_t flags = spinlock_lock_irqsave(&wq->lock);
+
+    *wait->pprev = wait->next;
+    if (wait->next) {
+        wait->next->pprev = wait->pprev;
+    }
+    wait->next = NULL;
+    wait->pprev = NULL;
+
+    spinlock_unlock_irqrestore(&wq->lock, flags);
+}
+
+/**
+ * @brief 唤醒等待队列上的全部线程
+ */
+int wake_up(wait_queue_head_t *wq) {
+    int woken = 0;
+
+    /* 等待者在finish_wait中自己摘链，重复唤醒只会让它多检查一次条件 */
+    uint32_t flags = spinlock_lock_irqsave(&wq->lock);
+
+    for (wait_queue_entry_t *wait = wq->first; wait; wait = wait->next) {
+        sleep_wake(wait->thread);
+        woken++;
+    }
+
+    spinlock_unlock_irqrestore(&wq->lock, flags);
+
+    return woken;
+}
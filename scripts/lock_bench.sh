@@ -0,0 +1,40 @@
+#!/bin/bash
+# Vest-OS Lock Benchmark
+# 在QEMU中以1-8个vCPU运行自旋锁压力测试，比较ticket锁与MCS锁
+
+set -e
+
+# Colors
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+BLUE='\033[0;34m'
+NC='\033[0m'
+
+# Configuration
+BENCH_IMG="${1:-kernel_bench.bin}"
+MAX_CPUS="${MAX_CPUS:-8}"
+QEMU="${QEMU:-qemu-system-i386}"
+
+echo -e "${BLUE}Vest-OS Lock Benchmark${NC}"
+echo "======================"
+
+if ! command -v "$QEMU" &> /dev/null; then
+    echo -e "${RED}Error: $QEMU not found${NC}"
+    echo "Please install QEMU: sudo apt-get install qemu-system-x86"
+    exit 1
+fi
+
+if [ ! -f "$BENCH_IMG" ]; then
+    echo -e "${RED}Error: $BENCH_IMG not found, run 'make lock-bench'${NC}"
+    exit 1
+fi
+
+for cpus in $(seq 1 "$MAX_CPUS"); do
+    # isa-debug-exit以非零状态退出，这里不视为失败
+    "$QEMU" -kernel "$BENCH_IMG" -smp "$cpus" -m 64M \
+        -display none -serial stdio -no-reboot \
+        -device isa-debug-exit,iobase=0xf4,iosize=0x04 2>/dev/null \
+        | grep "^lockbench:" || true
+done
+
+echo -e "${GREEN}Lock benchmark completed${NC}"
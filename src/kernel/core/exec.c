@@ -0,0 +1,311 @@
+/*
+ * Vest-OS ELF加载
+ * 把PT_LOAD段登记为按需映射的VMA，切换地址空间后从新程序入口返回用户态
+ */
+
+#include <kernel.h>
+#include <exec.h>
+#include <elf.h>
+#include <mm.h>
+#include <pagecache.h>
+#include <sched.h>
+#include <syscall.h>
+#include <uring.h>
+#include <arch/interrupt.h>
+
+// 检查过的可执行文件
+struct exec_image {
+    struct vm_file *file;
+    Elf32_Ehdr ehdr;
+    Elf32_Phdr phdrs[EXEC_PHNUM_MAX];
+    uint32_t phdr_addr;                 // 程序头在新地址空间中的地址，0表示未被加载
+};
+
+// 复制到内核的参数：argc个argv字符串后接envc个envp字符串
+struct exec_args {
+    char *strings;
+    uint32_t size;
+    uint32_t argc;
+    uint32_t envc;
+};
+
+/**
+ * 复制用户态的路径
+ */
+static int exec_copy_path(char *dst, uint32_t path_addr)
+{
+    int len = strncpy_from_user(dst, path_addr, VM_FILE_NAME_MAX);
+
+    if (len == ERROR_INVALID) {
+        return ERROR_INVALID;
+    }
+    return len > 0 ? 0 : ERROR_NOENT;   // 空路径或过长
+}
+
+/**
+ * 复制一个以NULL结尾的字符串指针数组，返回0或错误码
+ */
+static int exec_copy_strings(struct exec_args *args, uint32_t vec_addr, uint32_t *count)
+{
+    *count = 0;
+    if (!vec_addr) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; ; i++) {
+        uint32_t slot = vec_addr + i * sizeof(uint32_t);
+        uint32_t str;
+        if (slot < vec_addr || copy_from_user(&str, slot, sizeof(str)) != 0) {
+            return ERROR_INVALID;
+        }
+        if (!str) {
+            return 0;
+        }
+
+        int len = strncpy_from_user(args->strings + args->size, str,
+                                    EXEC_ARG_MAX - args->size);
+        if (len < 0) {
+            return len;                 // ERROR_INVALID或超出EXEC_ARG_MAX的ERROR_NOMEM
+        }
+        args->size += len + 1;
+        (*count)++;
+    }
+}
+
+/**
+ * 读入并检查文件头和程序头
+ */
+static int exec_check_image(struct exec_image *image)
+{
+    Elf32_Ehdr *eh = &image->ehdr;
+
+    if (vm_file_read(image->file, 0, eh, sizeof(*eh)) != sizeof(*eh)) {
+        return ERROR_INVALID;
+    }
+
+    if (eh->e_ident[0] != ELFMAG0 || eh->e_ident[1] != ELFMAG1 ||
+        eh->e_ident[2] != ELFMAG2 || eh->e_ident[3] != ELFMAG3 ||
+        eh->e_ident[EI_CLASS] != ELFCLASS32 || eh->e_ident[EI_DATA] != ELFDATA2LSB ||
+        eh->e_ident[EI_VERSION] != EV_CURRENT ||
+        eh->e_type != ET_EXEC || eh->e_machine != EM_386 ||
+        eh->e_phentsize != sizeof(Elf32_Phdr) ||
+        eh->e_phnum == 0 || eh->e_phnum > EXEC_PHNUM_MAX) {
+        return ERROR_INVALID;
+    }
+
+    uint32_t ph_size = eh->e_phnum * sizeof(Elf32_Phdr);
+    if (vm_file_read(image->file, eh->e_phoff, image->phdrs, ph_size) != (int32_t)ph_size) {
+        return ERROR_INVALID;
+    }
+
+    // 段必须按地址升序、互不重叠（按页取整后），且都在栈以下
+    uint32_t prev_end = MM_USER_BASE;
+    int entry_ok = 0;
+
+    image->phdr_addr = 0;
+
+    for (uint32_t i = 0; i < eh->e_phnum; i++) {
+        const Elf32_Phdr *ph = &image->phdrs[i];
+
+        if (ph->p_type == PT_INTERP) {
+            return ERROR_INVALID;       // 只支持静态链接
+        }
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
+            continue;
+        }
+
+        uint32_t start = ph->p_vaddr & ~(PAGE_SIZE - 1);
+        uint32_t end = ph->p_vaddr + ph->p_memsz;
+
+        if (ph->p_filesz > ph->p_memsz ||
+            ph->p_offset + ph->p_filesz < ph->p_offset ||
+            ph->p_offset + ph->p_filesz > image->file->size ||
+            (ph->p_vaddr & (PAGE_SIZE - 1)) != (ph->p_offset & (PAGE_SIZE - 1)) ||
+            end < ph->p_vaddr || end > EXEC_STACK_TOP - EXEC_STACK_SIZE ||
+            start < prev_end) {
+            return ERROR_INVALID;
+        }
+        prev_end = (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+        if (eh->e_entry >= ph->p_vaddr && eh->e_entry < end && (ph->p_flags & PF_X)) {
+            entry_ok = 1;
+        }
+
+        if (eh->e_phoff >= ph->p_offset &&
+            eh->e_phoff + ph_size <= ph->p_offset + ph->p_filesz) {
+            image->phdr_addr = ph->p_vaddr + (eh->e_phoff - ph->p_offset);
+        }
+    }
+
+    return entry_ok ? 0 : ERROR_INVALID;
+}
+
+/**
+ * 登记PT_LOAD段和栈
+ */
+static int exec_map_image(struct mm_struct *mm, const struct exec_image *image)
+{
+    for (uint32_t i = 0; i < image->ehdr.e_phnum; i++) {
+        const Elf32_Phdr *ph = &image->phdrs[i];
+
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
+            continue;
+        }
+
+        uint32_t start = ph->p_vaddr & ~(PAGE_SIZE - 1);
+        uint32_t end = (ph->p_vaddr + ph->p_memsz + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+        uint32_t flags = 0;
+
+        if (ph->p_flags & PF_R) {
+            flags |= VM_READ;
+        }
+        if (ph->p_flags & PF_W) {
+            flags |= VM_WRITE;
+        }
+        if (ph->p_flags & PF_X) {
+            flags |= VM_EXEC;
+        }
+
+        int ret = mm_map(mm, start, end, flags, ph->p_filesz ? image->file : NULL,
+                         ph->p_offset & ~(PAGE_SIZE - 1), ph->p_vaddr + ph->p_filesz);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    return mm_map(mm, EXEC_STACK_TOP - EXEC_STACK_SIZE, EXEC_STACK_TOP,
+                  VM_READ | VM_WRITE, NULL, 0, 0);
+}
+
+/**
+ * 在新栈上布置参数和辅助向量（已切换到新地址空间），返回栈指针
+ */
+static uint32_t exec_setup_stack(const struct exec_args *args, const struct exec_image *image)
+{
+    uint32_t sp = EXEC_STACK_TOP - args->size;
+    uint32_t strings = sp;
+
+    memcpy((void *)strings, args->strings, args->size);
+
+    uint32_t nr_auxv = image->phdr_addr ? 6 : 3;
+    uint32_t words = 1 + (args->argc + 1) + (args->envc + 1) + nr_auxv * 2;
+
+    sp = (sp - words * sizeof(uint32_t)) & ~15u;
+
+    uint32_t *p = (uint32_t *)sp;
+    uint32_t offset = 0;
+
+    *p++ = args->argc;
+    for (uint32_t i = 0; i < args->argc; i++) {
+        *p++ = strings + offset;
+        offset += strlen(args->strings + offset) + 1;
+    }
+    *p++ = 0;
+    for (uint32_t i = 0; i < args->envc; i++) {
+        *p++ = strings + offset;
+        offset += strlen(args->strings + offset) + 1;
+    }
+    *p++ = 0;
+
+    if (image->phdr_addr) {
+        *p++ = AT_PHDR;
+        *p++ = image->phdr_addr;
+        *p++ = AT_PHENT;
+        *p++ = sizeof(Elf32_Phdr);
+        *p++ = AT_PHNUM;
+        *p++ = image->ehdr.e_phnum;
+    }
+    *p++ = AT_PAGESZ;
+    *p++ = PAGE_SIZE;
+    *p++ = AT_ENTRY;
+    *p++ = image->ehdr.e_entry;
+    *p++ = AT_NULL;
+    *p++ = 0;
+
+    return sp;
+}
+
+/**
+ * SYS_EXEC
+ */
+int32_t sys_exec(uint32_t path_addr, uint32_t argv_addr, uint32_t envp_addr,
+                 uint32_t arg4, uint32_t arg5)
+{
+    (void)arg4;
+    (void)arg5;
+
+    struct thread *self = current_thread();
+    if (!self || !self->stack) {
+        return ERROR_INVALID;
+    }
+
+    // 两个入口都把用户寄存器保存在内核栈顶
+    interrupt_frame_t *frame =
+        (interrupt_frame_t *)((uint8_t *)self->stack + KTHREAD_STACK_SIZE) - 1;
+    if ((frame->cs & 3) != 3) {
+        return ERROR_INVALID;
+    }
+
+    char path[VM_FILE_NAME_MAX];
+    int ret = exec_copy_path(path, path_addr);
+    if (ret != 0) {
+        return ret;
+    }
+
+    struct exec_image *image = kmalloc(sizeof(struct exec_image));
+    struct exec_args args = { .strings = kmalloc(EXEC_ARG_MAX) };
+    struct mm_struct *mm = self->mm;
+
+    image->file = vm_file_lookup(path);
+    if (!image->file) {
+        ret = ERROR_NOENT;
+        goto out;
+    }
+
+    ret = exec_check_image(image);
+    if (ret == 0) {
+        ret = exec_copy_strings(&args, argv_addr, &args.argc);
+    }
+    if (ret == 0) {
+        ret = exec_copy_strings(&args, envp_addr, &args.envc);
+    }
+    if (ret != 0) {
+        goto out;
+    }
+
+    // 第一次exec使用新的页目录，不继承调用者原有的任何映射
+    if (!mm) {
+        mm = mm_create(NULL);
+        if (!mm) {
+            ret = ERROR_NOMEM;
+            goto out;
+        }
+    }
+
+    // 不能再失败：释放旧程序的环，拆除旧程序的映射，切换到新地址空间
+    uring_exec_release();
+    mm_clear(mm);
+    self->mm = mm;
+    self->page_dir = mm->page_dir;
+    switch_page_directory(mm->page_dir);
+
+    if (exec_map_image(mm, image) != 0) {
+        kernel_panic("exec: 登记已检查过的段失败");
+    }
+
+    uint32_t sp = exec_setup_stack(&args, image);
+
+    frame->edi = 0;
+    frame->esi = 0;
+    frame->ebp = 0;
+    frame->ebx = 0;
+    frame->edx = 0;
+    frame->ecx = 0;
+    frame->eip = image->ehdr.e_entry;
+    frame->user_esp = sp;
+
+out:
+    kfree(args.strings);
+    kfree(image);
+    return ret;                         // 成功时作为新程序入口处的eax（0）
+}
@@ -0,0 +1,287 @@
+/*
+ * Vest-OS futex
+ * 用户态锁只在需要睡眠或唤醒时进入内核，等待者按物理地址散列到桶中
+ */
+
+#include <kernel.h>
+#include <futex.h>
+#include <mm.h>
+#include <syscall.h>
+#include <arch/cpu.h>
+#include <kernel/spinlock.h>
+#include <kernel/timer_wheel.h>
+
+#define FUTEX_HASH_BITS     6
+#define FUTEX_HASH_SIZE     (1u << FUTEX_HASH_BITS)
+
+struct futex_bucket;
+
+// 等待者（在等待线程的内核栈上）
+struct futex_q {
+    struct futex_q *next;
+    struct futex_q **pprev;             // 指向前一个节点的next，NULL表示已摘链
+    struct futex_bucket *bucket;        // 所在的桶，requeue时改变
+    uint32_t key;                       // uaddr的物理地址
+    void *thread;
+};
+
+// 散列桶：不同桶的锁在不同缓存行上
+struct futex_bucket {
+    spinlock_t lock;
+    struct futex_q *first;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+static struct futex_bucket futex_queues[FUTEX_HASH_SIZE] = {
+    [0 ... FUTEX_HASH_SIZE - 1] = { .lock = SPINLOCK_INITIALIZER(futex_bucket) },
+};
+
+/**
+ * 用户地址对应的key（物理地址），不可写时返回0
+ *
+ * 先按写访问装入该页：尚未访问过的页在此处映射，文件页的写时复制也在
+ * 此处完成。否则只读过该字的等待者以共享的页缓存页为key，唤醒者写入后
+ * 换到私有页，两边的key不同，唤醒丢失
+ */
+static uint32_t futex_key(uint32_t uaddr)
+{
+    if (uaddr & 3 || !mm_access_ok(uaddr, sizeof(uint32_t), 1)) {
+        return 0;
+    }
+    return get_physical_address(current_page_directory(), uaddr);
+}
+
+static struct futex_bucket *futex_hash(uint32_t key)
+{
+    // 同一页内相邻的字也分散到不同桶
+    return &futex_queues[((key >> 2) * 0x9E3779B1u) >> (32 - FUTEX_HASH_BITS)];
+}
+
+/**
+ * 挂到桶的链表头（持有桶锁）
+ */
+static void futex_link(struct futex_bucket *bucket, struct futex_q *q)
+{
+    q->next = bucket->first;
+    if (q->next) {
+        q->next->pprev = &q->next;
+    }
+    bucket->first = q;
+    q->pprev = &bucket->first;
+    q->bucket = bucket;
+}
+
+/**
+ * 从桶中摘下（持有桶锁）
+ */
+static void futex_unlink(struct futex_q *q)
+{
+    *q->pprev = q->next;
+    if (q->next) {
+        q->next->pprev = q->pprev;
+    }
+    q->next = NULL;
+    q->pprev = NULL;
+}
+
+/**
+ * 摘链并唤醒（持有桶锁）：等待者返回前要取同一把锁，解锁前q一直有效
+ */
+static void futex_wake_one(struct futex_q *q)
+{
+    futex_unlink(q);
+    sleep_wake(q->thread);
+}
+
+/**
+ * 按地址顺序取两个桶的锁，避免两个requeue相互死锁
+ */
+static uint32_t futex_lock_pair(struct futex_bucket *a, struct futex_bucket *b)
+{
+    if (a > b) {
+        struct futex_bucket *tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    uint32_t flags = spinlock_lock_irqsave(&a->lock);
+    if (a != b) {
+        spinlock_lock(&b->lock);
+    }
+    return flags;
+}
+
+static void futex_unlock_pair(struct futex_bucket *a, struct futex_bucket *b, uint32_t flags)
+{
+    if (a != b) {
+        spinlock_unlock(&b->lock);
+    }
+    spinlock_unlock_irqrestore(&a->lock, flags);
+}
+
+/**
+ * 等待结束后摘链
+ * @return 1仍在链上（超时），0已被唤醒者摘下
+ */
+static int futex_unqueue(struct futex_q *q)
+{
+    while (1) {
+        struct futex_bucket *bucket = *(struct futex_bucket *volatile *)&q->bucket;
+        uint32_t flags = spinlock_lock_irqsave(&bucket->lock);
+
+        // 取锁期间被requeue到别的桶：换到新桶重试
+        if (q->bucket != bucket) {
+            spinlock_unlock_irqrestore(&bucket->lock, flags);
+            continue;
+        }
+
+        int queued = q->pprev != NULL;
+        if (queued) {
+            futex_unlink(q);
+        }
+
+        spinlock_unlock_irqrestore(&bucket->lock, flags);
+        return queued;
+    }
+}
+
+/**
+ * FUTEX_WAIT
+ */
+static int32_t futex_wait(uint32_t uaddr, uint32_t val, uint32_t timeout_ms)
+{
+    void *self = sleep_current();
+    uint32_t key = futex_key(uaddr);
+
+    if (!key) {
+        return ERROR_INVALID;
+    }
+    if (!self) {
+        return ERROR_AGAIN;
+    }
+
+    struct futex_q q = { .key = key, .thread = self };
+    struct futex_bucket *bucket = futex_hash(key);
+
+    // 在桶锁下比较：修改值的一方随后的FUTEX_WAKE要取同一把锁
+    uint32_t flags = spinlock_lock_irqsave(&bucket->lock);
+    if (*(volatile uint32_t *)uaddr != val) {
+        spinlock_unlock_irqrestore(&bucket->lock, flags);
+        return ERROR_AGAIN;
+    }
+    futex_link(bucket, &q);
+    spinlock_unlock_irqrestore(&bucket->lock, flags);
+
+    uint64_t deadline = timer_get_jiffies() + msecs_to_jiffies(timeout_ms);
+
+    while (*(struct futex_q **volatile *)&q.pprev) {
+        if (!timeout_ms) {
+            schedule_timeout(TIMER_MAX_TIMEOUT);
+            continue;
+        }
+
+        uint64_t now = timer_get_jiffies();
+        if (now >= deadline) {
+            break;
+        }
+        schedule_timeout((uint32_t)(deadline - now));
+    }
+
+    return futex_unqueue(&q) ? ERROR_TIMEOUT : 0;
+}
+
+/**
+ * FUTEX_WAKE
+ * @return 唤醒的线程数
+ */
+static int32_t futex_wake(uint32_t uaddr, uint32_t nr_wake)
+{
+    uint32_t key = futex_key(uaddr);
+
+    if (!key) {
+        return ERROR_INVALID;
+    }
+
+    struct futex_bucket *bucket = futex_hash(key);
+    int32_t woken = 0;
+
+    uint32_t flags = spinlock_lock_irqsave(&bucket->lock);
+
+    struct futex_q *q = bucket->first;
+    while (q && (uint32_t)woken < nr_wake) {
+        struct futex_q *next = q->next;
+        if (q->key == key) {
+            futex_wake_one(q);
+            woken++;
+        }
+        q = next;
+    }
+
+    spinlock_unlock_irqrestore(&bucket->lock, flags);
+
+    return woken;
+}
+
+/**
+ * FUTEX_REQUEUE
+ * @return 唤醒数与移动数之和
+ */
+static int32_t futex_requeue(uint32_t uaddr, uint32_t nr_wake,
+                             uint32_t nr_requeue, uint32_t uaddr2)
+{
+    uint32_t key1 = futex_key(uaddr);
+    uint32_t key2 = futex_key(uaddr2);
+
+    if (!key1 || !key2) {
+        return ERROR_INVALID;
+    }
+
+    struct futex_bucket *b1 = futex_hash(key1);
+    struct futex_bucket *b2 = futex_hash(key2);
+    uint32_t woken = 0;
+    uint32_t requeued = 0;
+
+    uint32_t flags = futex_lock_pair(b1, b2);
+
+    struct futex_q *q = b1->first;
+    while (q && (woken < nr_wake || requeued < nr_requeue)) {
+        struct futex_q *next = q->next;
+
+        if (q->key == key1) {
+            if (woken < nr_wake) {
+                futex_wake_one(q);
+                woken++;
+            } else {
+                // 同一个桶只需改key；否则移到新桶，等待者通过q->bucket找到它
+                q->key = key2;
+                if (b1 != b2) {
+                    futex_unlink(q);
+                    futex_link(b2, q);
+                }
+                requeued++;
+            }
+        }
+        q = next;
+    }
+
+    futex_unlock_pair(b1, b2, flags);
+
+    return (int32_t)(woken + requeued);
+}
+
+/**
+ * SYS_FUTEX
+ */
+int32_t sys_futex(uint32_t uaddr, uint32_t op, uint32_t val,
+                  uint32_t val2, uint32_t uaddr2)
+{
+    switch (op) {
+        case FUTEX_WAIT:
+            return futex_wait(uaddr, val, val2);
+        case FUTEX_WAKE:
+            return futex_wake(uaddr, val);
+        case FUTEX_REQUEUE:
+            return futex_requeue(uaddr, val, val2, uaddr2);
+        default:
+            return ERROR_INVALID;
+    }
+}
@@ -6,6 +6,11 @@
 #include <kernel.h>
 #include <hal/memory.h>
 #include <hal/cpu.h>
+#include <kernel/qspinlock.h>
+#include <arch/percpu.h>
+#include <arch/interrupt.h>
+#include <vdso.h>
+#include <mm.h>
 
 // 内存管理器结构
 struct memory_manager {
@@ -14,12 +19,11 @@ struct memory_manager {
     uint32_t total_pages;
     uint32_t free_pages;
     uint32_t used_pages;
-    spinlock_t frame_lock;
+    qspinlock_t frame_lock;
 
     // 虚拟内存管理
     struct page_directory *kernel_page_dir;
-    struct page_directory *current_page_dir;
-    spinlock_t page_lock;
+    qspinlock_t page_lock;
 
     // 堆管理器
     struct heap kernel_heap;
@@ -29,6 +33,9 @@ struct memory_manager {
 // 全局内存管理器
 static struct memory_manager memory_manager;
 
+// 每个CPU当前加载的页目录（CR3）
+static DEFINE_PER_CPU(struct page_directory *, current_page_dir);
+
 // 内核堆开始和结束地址
 extern uint32_t __heap_start;
 extern uint32_t __heap_end;
@@ -77,19 +84,19 @@ static void init_physical_memory(struct multiboot_info *mb_info)
  */
 uint32_t alloc_page_frame(void)
 {
-    spinlock_lock(&memory_manager.frame_lock);
+    qspinlock_lock(&memory_manager.frame_lock);
 
     for (uint32_t i = 0; i < memory_manager.total_pages; i++) {
         if (!memory_manager.page_frames[i].used) {
             memory_manager.page_frames[i].used = 1;
             memory_manager.free_pages--;
             memory_manager.used_pages++;
-            spinlock_unlock(&memory_manager.frame_lock);
+            qspinlock_unlock(&memory_manager.frame_lock);
             return i * PAGE_SIZE;
         }
     }
 
-    spinlock_unlock(&memory_manager.frame_lock);
+    qspinlock_unlock(&memory_manager.frame_lock);
     kernel_panic("内存耗尽");
     return 0;
 }
@@ -104,7 +111,7 @@ void free_page_frame(uint32_t physical_addr)
         return;
     }
 
-    spinlock_lock(&memory_manager.frame_lock);
+    qspinlock_lock(&memory_manager.frame_lock);
 
     if (memory_manager.page_frames[frame_index].used) {
         memory_manager.page_frames[frame_index].used = 0;
@@ -113,7 +120,7 @@ void free_page_frame(uint32_t physical_addr)
         memory_manager.used_pages--;
     }
 
-    spinlock_unlock(&memory_manager.frame_lock);
+    qspinlock_unlock(&memory_manager.frame_lock);
 }
 
 /**
@@ -135,6 +142,10 @@ struct page_directory* create_page_directory(void)
         page_dir->entries[i] = boot_page_dir.entries[i];
     }
 
+    // 所有进程共享的只读vvar页
+    uint32_t vvar_phys = get_physical_address(&boot_page_dir, (uint32_t)vdso_vvar_page());
+    map_page(page_dir, VVAR_ADDR, vvar_phys, PAGE_USER | PAGE_NOFREE);
+
     return page_dir;
 }
 
@@ -155,7 +166,7 @@ void destroy_page_directory(struct page_directory *page_dir)
 
             // 释放页表中的页面
             for (int j = 0; j < 1024; j++) {
-                if (page_table->entries[j] & 0x1) {
+                if ((page_table->entries[j] & 0x1) && !(page_table->entries[j] & PAGE_NOFREE)) {
                     uint32_t physical_addr = page_table->entries[j] & 0xFFFFF000;
                     free_page_frame(physical_addr);
                 }
@@ -178,7 +189,7 @@ int map_page(struct page_directory *page_dir, uint32_t virtual_addr, uint32_t ph
     uint32_t page_dir_index = (virtual_addr >> 22) & 0x3FF;
     uint32_t page_table_index = (virtual_addr >> 12) & 0x3FF;
 
-    spinlock_lock(&memory_manager.page_lock);
+    qspinlock_lock(&memory_manager.page_lock);
 
     // 检查页表是否存在
     if (!(page_dir->entries[page_dir_index] & 0x1)) {
@@ -189,8 +200,8 @@ int map_page(struct page_directory *page_dir, uint32_t virtual_addr, uint32_t ph
         // 清空页表
         memset(page_table, 0, PAGE_SIZE);
 
-        // 设置页目录项
-        page_dir->entries[page_dir_index] = page_table_addr | flags | 0x1;  // Present
+        // 设置页目录项：权限由页表项决定，页目录项对整张页表放开写
+        page_dir->entries[page_dir_index] = page_table_addr | (flags & PAGE_USER) | PAGE_WRITE | PAGE_PRESENT;
     }
 
     // 获取页表
@@ -203,7 +214,7 @@ int map_page(struct page_directory *page_dir, uint32_t virtual_addr, uint32_t ph
     // 刷新TLB
     flush_tlb_page((void*)virtual_addr);
 
-    spinlock_unlock(&memory_manager.page_lock);
+    qspinlock_unlock(&memory_manager.page_lock);
     return 0;
 }
 
@@ -215,11 +226,11 @@ int unmap_page(struct page_directory *page_dir, uint32_t virtual_addr)
     uint32_t page_dir_index = (virtual_addr >> 22) & 0x3FF;
     uint32_t page_table_index = (virtual_addr >> 12) & 0x3FF;
 
-    spinlock_lock(&memory_manager.page_lock);
+    qspinlock_lock(&memory_manager.page_lock);
 
     // 检查页表是否存在
     if (!(page_dir->entries[page_dir_index] & 0x1)) {
-        spinlock_unlock(&memory_manager.page_lock);
+        qspinlock_unlock(&memory_manager.page_lock);
         return -1;  // 页面未映射
     }
 
@@ -230,16 +241,19 @@ int unmap_page(struct page_directory *page_dir, uint32_t virtual_addr)
     // 清除页表项
     if (page_table->entries[page_table_index] & 0x1) {
         uint32_t physical_addr = page_table->entries[page_table_index] & 0xFFFFF000;
+        uint32_t shared = page_table->entries[page_table_index] & PAGE_NOFREE;
         page_table->entries[page_table_index] = 0;
 
-        // 释放物理页帧
-        free_page_frame(physical_addr);
+        // 释放物理页帧（共享页不属于这个地址空间）
+        if (!shared) {
+            free_page_frame(physical_addr);
+        }
 
         // 刷新TLB
         flush_tlb_page((void*)virtual_addr);
     }
 
-    spinlock_unlock(&memory_manager.page_lock);
+    qspinlock_unlock(&memory_manager.page_lock);
     return 0;
 }
 
@@ -271,14 +285,58 @@ uint32_t get_physical_address(struct page_directory *page_dir, uint32_t virtual_
 }
 
 /**
- * 切换页目录
+ * 虚拟地址的页表项，页表不存在时返回0
+ */
+uint32_t get_page_entry(struct page_directory *page_dir, uint32_t virtual_addr)
+{
+    uint32_t page_dir_index = (virtual_addr >> 22) & 0x3FF;
+    uint32_t page_table_index = (virtual_addr >> 12) & 0x3FF;
+
+    if (!(page_dir->entries[page_dir_index] & 0x1)) {
+        return 0;
+    }
+
+    struct page_table *page_table = (struct page_table*)(page_dir->entries[page_dir_index] & 0xFFFFF000);
+    return page_table->entries[page_table_index];
+}
+
+/**
+ * 当前CPU加载的页目录
+ */
+struct page_directory *current_page_directory(void)
+{
+    return this_cpu_read(current_page_dir);
+}
+
+/**
+ * 切换页目录（已经加载时不重写CR3，避免无谓地清空TLB）
  */
 void switch_page_directory(struct page_directory *page_dir)
 {
-    memory_manager.current_page_dir = page_dir;
+    if (this_cpu_read(current_page_dir) == page_dir) {
+        return;
+    }
+
+    this_cpu_write(current_page_dir, page_dir);
     write_cr3((uint32_t)page_dir);
 }
 
+/**
+ * 大批取消映射后调用：其他CPU可能还加载着这个页目录（内核线程沿用
+ * 上一个线程的地址空间），清掉它们的记录，下次切换到它时重写CR3
+ * 清空旧的TLB项
+ */
+void invalidate_page_directory(struct page_directory *page_dir)
+{
+    uint32_t self = arch_cpu_id();
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        if (cpu != self && per_cpu(current_page_dir, cpu) == page_dir) {
+            per_cpu(current_page_dir, cpu) = NULL;
+        }
+    }
+}
+
 /**
  * 内核堆分配器
  */
@@ -312,7 +370,12 @@ void* kmalloc_aligned(size_t size, size_t alignment)
  */
 void page_fault_handler(uint32_t error_code, uint32_t fault_addr)
 {
-    uint32_t physical_addr = get_physical_address(memory_manager.current_page_dir, fault_addr);
+    // 用户地址空间中按需映射的页
+    if (handle_mm_fault(fault_addr, error_code) == 0) {
+        return;
+    }
+
+    uint32_t physical_addr = get_physical_address(this_cpu_read(current_page_dir), fault_addr);
 
     kernel_printk("页故障:\n");
     kernel_printk("  故障地址: 0x%08x\n", fault_addr);
@@ -340,6 +403,16 @@ void page_fault_handler(uint32_t error_code, uint32_t fault_addr)
     kernel_panic("未处理的页故障");
 }
 
+/**
+ * 页故障中断（向量14）：错误码在帧中，故障地址在CR2
+ */
+static void page_fault_interrupt(interrupt_frame_t *frame, void *data)
+{
+    (void)data;
+
+    page_fault_handler(frame->error_code, read_cr2());
+}
+
 /**
  * 初始化内存管理
  */
@@ -348,8 +421,8 @@ void memory_init(struct multiboot_info *mb_info)
     kernel_printk("初始化内存管理...\n");
 
     // 初始化锁
-    spinlock_init(&memory_manager.frame_lock);
-    spinlock_init(&memory_manager.page_lock);
+    qspinlock_init(&memory_manager.frame_lock, "frame");
+    qspinlock_init(&memory_manager.page_lock, "page");
     spinlock_init(&memory_manager.heap_lock);
 
     // 初始化物理内存管理
@@ -357,7 +430,7 @@ void memory_init(struct multiboot_info *mb_info)
 
     // 设置引导页目录
     memory_manager.kernel_page_dir = &boot_page_dir;
-    memory_manager.current_page_dir = &boot_page_dir;
+    this_cpu_write(current_page_dir, &boot_page_dir);
 
     // 初始化内核堆
     uint32_t heap_start = (uint32_t)&__heap_end;
@@ -365,7 +438,7 @@ void memory_init(struct multiboot_info *mb_info)
     heap_init(&memory_manager.kernel_heap, (void*)heap_start, heap_size);
 
     // 设置页故障处理程序
-    set_interrupt_handler(14, page_fault_handler);
+    interrupt_register(14, page_fault_interrupt, NULL, "page-fault");
 
     kernel_printk("内存管理初始化完成\n");
     kernel_printk("  可用页数: %d\n", memory_manager.free_pages);
@@ -0,0 +1,271 @@
+/*
+ * Vest-OS 用户地址空间
+ * 记录合法的用户地址范围，页在第一次访问时映射
+ */
+
+#include <kernel.h>
+#include <mm.h>
+#include <pagecache.h>
+#include <sched.h>
+#include <kernel/spinlock.h>
+
+/**
+ * 创建地址空间
+ */
+struct mm_struct *mm_create(struct page_directory *page_dir)
+{
+    if (!page_dir) {
+        page_dir = create_page_directory();
+        if (!page_dir) {
+            return NULL;
+        }
+    }
+
+    struct mm_struct *mm = kmalloc(sizeof(struct mm_struct));
+    memset(mm, 0, sizeof(struct mm_struct));
+    mm->page_dir = page_dir;
+    spinlock_init(&mm->lock, "mm");
+
+    return mm;
+}
+
+/**
+ * 取消所有VMA
+ */
+void mm_clear(struct mm_struct *mm)
+{
+    uint32_t flags = spinlock_lock_irqsave(&mm->lock);
+    struct vm_area *vma = mm->vmas;
+    mm->vmas = NULL;
+    spinlock_unlock_irqrestore(&mm->lock, flags);
+
+    while (vma) {
+        struct vm_area *next = vma->next;
+
+        // 只释放私有页，页缓存的页带PAGE_NOFREE
+        for (uint32_t addr = vma->start; addr < vma->end; addr += PAGE_SIZE) {
+            if (get_page_entry(mm->page_dir, addr) & PAGE_PRESENT) {
+                unmap_page(mm->page_dir, addr);
+            }
+        }
+
+        kfree(vma);
+        vma = next;
+    }
+
+    invalidate_page_directory(mm->page_dir);
+}
+
+/**
+ * 添加VMA
+ */
+int mm_map(struct mm_struct *mm, uint32_t start, uint32_t end, uint32_t flags,
+           struct vm_file *file, uint32_t file_offset, uint32_t file_end)
+{
+    if ((start | end | file_offset) & (PAGE_SIZE - 1) ||
+        start < MM_USER_BASE || end > MM_USER_TOP || start >= end) {
+        return ERROR_INVALID;
+    }
+
+    struct vm_area *vma = kmalloc(sizeof(struct vm_area));
+    vma->start = start;
+    vma->end = end;
+    vma->flags = flags;
+    vma->file = file;
+    vma->file_offset = file_offset;
+    vma->file_end = file ? file_end : start;
+
+    uint32_t irq = spinlock_lock_irqsave(&mm->lock);
+
+    struct vm_area **link = &mm->vmas;
+    while (*link && (*link)->end <= start) {
+        link = &(*link)->next;
+    }
+    if (*link && (*link)->start < end) {
+        spinlock_unlock_irqrestore(&mm->lock, irq);
+        kfree(vma);
+        return ERROR_INVALID;
+    }
+    vma->next = *link;
+    *link = vma;
+
+    spinlock_unlock_irqrestore(&mm->lock, irq);
+    return 0;
+}
+
+/**
+ * 包含addr的VMA（持有mm->lock）
+ */
+static struct vm_area *mm_find_vma(struct mm_struct *mm, uint32_t addr)
+{
+    for (struct vm_area *vma = mm->vmas; vma && vma->start <= addr; vma = vma->next) {
+        if (addr < vma->end) {
+            return vma;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 用户地址空间的页故障
+ */
+int handle_mm_fault(uint32_t fault_addr, uint32_t error_code)
+{
+    struct thread *self = current_thread();
+    struct mm_struct *mm = self ? self->mm : NULL;
+
+    if (!mm || fault_addr > USER_SPACE_END) {
+        return ERROR_INVALID;
+    }
+
+    uint32_t page = fault_addr & ~(PAGE_SIZE - 1);
+    int write = (error_code & PF_WRITE) != 0;
+
+    // VMA只在mm_clear中释放，而mm_clear只由拥有它的线程在exec时调用；
+    // 复制一份后在锁外准备页
+    uint32_t irq = spinlock_lock_irqsave(&mm->lock);
+    struct vm_area *found = mm_find_vma(mm, page);
+    struct vm_area vma;
+    if (found) {
+        vma = *found;
+    }
+    spinlock_unlock_irqrestore(&mm->lock, irq);
+
+    if (!found || (write && !(vma.flags & VM_WRITE))) {
+        return ERROR_PERM;
+    }
+
+    uint32_t index = (vma.file_offset + (page - vma.start)) >> PAGE_SHIFT;
+    uint32_t phys;
+    uint32_t flags = PAGE_USER;
+
+    if (vma.file && !write && page + PAGE_SIZE <= vma.file_end) {
+        // 整页都是文件内容：直接映射页缓存，可写映射保持只读直到第一次写
+        phys = vm_file_get_page(vma.file, index);
+        if (!phys) {
+            return ERROR_IO;
+        }
+        flags |= PAGE_NOFREE;
+    } else {
+        phys = alloc_page_frame();
+        memset((void *)phys, 0, PAGE_SIZE);
+
+        if (vma.file && page < vma.file_end) {
+            uint32_t src = vm_file_get_page(vma.file, index);
+            if (!src) {
+                free_page_frame(phys);
+                return ERROR_IO;
+            }
+
+            uint32_t len = vma.file_end - page;
+            memcpy((void *)phys, (const void *)src, len < PAGE_SIZE ? len : PAGE_SIZE);
+        }
+
+        if (vma.flags & VM_WRITE) {
+            flags |= PAGE_WRITE;
+        }
+    }
+
+    // 装入前重新检查：同一地址空间的其他线程可能已经处理了这一页
+    irq = spinlock_lock_irqsave(&mm->lock);
+
+    uint32_t pte = get_page_entry(mm->page_dir, page);
+    if ((pte & PAGE_PRESENT) && (!write || (pte & PAGE_WRITE))) {
+        spinlock_unlock_irqrestore(&mm->lock, irq);
+        if (!(flags & PAGE_NOFREE)) {
+            free_page_frame(phys);
+        }
+        return 0;
+    }
+
+    // 写时复制时旧页是页缓存的页（PAGE_NOFREE），直接覆盖页表项
+    map_page(mm->page_dir, page, phys, flags);
+
+    spinlock_unlock_irqrestore(&mm->lock, irq);
+    return 0;
+}
+
+/**
+ * 当前线程能否访问[addr, addr + size)：每页都已作为用户页（write时为可写
+ * 用户页）映射，或在VMA中且能成功装入。检查通过后访问不会产生无法处理
+ * 的页故障
+ */
+bool mm_access_ok(uint32_t addr, uint32_t size, int write)
+{
+    if (size == 0) {
+        return true;
+    }
+    if (addr > USER_SPACE_END || size - 1 > USER_SPACE_END - addr) {
+        return false;
+    }
+
+    struct page_directory *page_dir = current_page_directory();
+    uint32_t need = PAGE_PRESENT | PAGE_USER | (write ? PAGE_WRITE : 0);
+    uint32_t last = (addr + size - 1) & ~(PAGE_SIZE - 1);
+
+    for (uint32_t page = addr & ~(PAGE_SIZE - 1); ; page += PAGE_SIZE) {
+        uint32_t pte = get_page_entry(page_dir, page);
+
+        // 环和vvar、第一次exec之前的程序不在VMA中，直接映射为用户页
+        if ((pte & need) != need &&
+            handle_mm_fault(page, PF_USER | (write ? PF_WRITE : 0)) != 0) {
+            return false;
+        }
+        if (page == last) {
+            return true;
+        }
+    }
+}
+
+/**
+ * 从用户空间复制size字节，范围不可访问时返回ERROR_INVALID
+ */
+int copy_from_user(void *dst, uint32_t src, uint32_t size)
+{
+    if (!mm_access_ok(src, size, 0)) {
+        return ERROR_INVALID;
+    }
+    memcpy(dst, (const void *)src, size);
+    return 0;
+}
+
+/**
+ * 复制size字节到用户空间，范围不可写时返回ERROR_INVALID
+ */
+int copy_to_user(uint32_t dst, const void *src, uint32_t size)
+{
+    if (!mm_access_ok(dst, size, 1)) {
+        return ERROR_INVALID;
+    }
+    memcpy((void *)dst, src, size);
+    return 0;
+}
+
+/**
+ * 复制用户空间以'\0'结尾的字符串（最多size字节，含结尾）
+ * @return 字符串长度；不可访问时返回ERROR_INVALID，size字节内没有结尾时返回ERROR_NOMEM
+ */
+int strncpy_from_user(char *dst, uint32_t src, uint32_t size)
+{
+    uint32_t i = 0;
+
+    while (i < size) {
+        // 逐页检查，字符串可以在任意位置结束
+        uint32_t chunk = PAGE_SIZE - (src + i) % PAGE_SIZE;
+        if (chunk > size - i) {
+            chunk = size - i;
+        }
+        if (!mm_access_ok(src + i, chunk, 0)) {
+            return ERROR_INVALID;
+        }
+
+        for (uint32_t end = i + chunk; i < end; i++) {
+            dst[i] = *(const char *)(src + i);
+            if (!dst[i]) {
+                return (int)i;
+            }
+        }
+    }
+
+    return ERROR_NOMEM;
+}
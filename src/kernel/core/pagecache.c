@@ -0,0 +1,174 @@
+/*
+ * Vest-OS 页缓存
+ * 文件页按需读入一次，之后由所有映射它的地址空间共享
+ */
+
+#include <kernel.h>
+#include <pagecache.h>
+#include <kernel/spinlock.h>
+
+// 已注册的文件
+static struct vm_file *vm_files;
+static DEFINE_SPINLOCK(vm_files_lock);
+
+/**
+ * 内存镜像的read_page：private指向文件内容
+ */
+static int vm_memory_read_page(struct vm_file *file, uint32_t index, void *buf)
+{
+    uint32_t offset = index << PAGE_SHIFT;
+    uint32_t len = file->size - offset;
+
+    if (len > PAGE_SIZE) {
+        len = PAGE_SIZE;
+    }
+
+    memcpy(buf, (const uint8_t *)file->private + offset, len);
+    memset((uint8_t *)buf + len, 0, PAGE_SIZE - len);
+    return 0;
+}
+
+/**
+ * 按路径查找（持有vm_files_lock）
+ */
+static struct vm_file *vm_file_find(const char *name)
+{
+    for (struct vm_file *file = vm_files; file; file = file->next) {
+        if (strcmp(file->name, name) == 0) {
+            return file;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 注册文件
+ */
+struct vm_file *vm_file_register(const char *name, uint32_t size,
+                                 vm_read_page_fn read_page, void *private)
+{
+    size_t name_len = strlen(name);
+
+    if (!name_len || name_len >= VM_FILE_NAME_MAX || !read_page) {
+        return NULL;
+    }
+
+    struct vm_file *file = kmalloc(sizeof(struct vm_file));
+    memset(file, 0, sizeof(struct vm_file));
+    memcpy(file->name, name, name_len + 1);
+    file->size = size;
+    file->read_page = read_page;
+    file->private = private;
+    spinlock_init(&file->lock, "vm_file");
+
+    file->nr_pages = (size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    if (file->nr_pages) {
+        file->pages = kmalloc(file->nr_pages * sizeof(uint32_t));
+        memset(file->pages, 0, file->nr_pages * sizeof(uint32_t));
+    }
+
+    uint32_t flags = spinlock_lock_irqsave(&vm_files_lock);
+    if (vm_file_find(name)) {
+        spinlock_unlock_irqrestore(&vm_files_lock, flags);
+        if (file->pages) {
+            kfree(file->pages);
+        }
+        kfree(file);
+        return NULL;
+    }
+    file->next = vm_files;
+    vm_files = file;
+    spinlock_unlock_irqrestore(&vm_files_lock, flags);
+
+    return file;
+}
+
+/**
+ * 注册已在内存中的镜像（例如启动模块），内容必须一直有效
+ */
+struct vm_file *vm_file_register_memory(const char *name, const void *data, uint32_t size)
+{
+    return vm_file_register(name, size, vm_memory_read_page, (void *)data);
+}
+
+/**
+ * 按路径查找文件
+ */
+struct vm_file *vm_file_lookup(const char *name)
+{
+    uint32_t flags = spinlock_lock_irqsave(&vm_files_lock);
+    struct vm_file *file = vm_file_find(name);
+    spinlock_unlock_irqrestore(&vm_files_lock, flags);
+
+    return file;
+}
+
+/**
+ * 第index页的物理帧
+ *
+ * 读入在锁外进行；两个CPU同时读入同一页时，后装入的一方丢弃自己的页。
+ */
+uint32_t vm_file_get_page(struct vm_file *file, uint32_t index)
+{
+    if (index >= file->nr_pages) {
+        return 0;
+    }
+
+    uint32_t page = ((volatile uint32_t *)file->pages)[index];
+    if (page) {
+        return page;
+    }
+
+    page = alloc_page_frame();
+    if (file->read_page(file, index, (void *)page) != 0) {
+        free_page_frame(page);
+        return 0;
+    }
+
+    uint32_t flags = spinlock_lock_irqsave(&file->lock);
+    uint32_t cached = file->pages[index];
+    if (!cached) {
+        file->pages[index] = page;
+        file->nr_cached++;
+    }
+    spinlock_unlock_irqrestore(&file->lock, flags);
+
+    if (cached) {
+        free_page_frame(page);
+        return cached;
+    }
+    return page;
+}
+
+/**
+ * 经页缓存读取
+ */
+int32_t vm_file_read(struct vm_file *file, uint32_t offset, void *buf, uint32_t len)
+{
+    if (offset >= file->size) {
+        return 0;
+    }
+    if (len > file->size - offset) {
+        len = file->size - offset;
+    }
+
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t pos = offset + done;
+        uint32_t page = vm_file_get_page(file, pos >> PAGE_SHIFT);
+        if (!page) {
+            return ERROR_IO;
+        }
+
+        uint32_t in_page = pos & (PAGE_SIZE - 1);
+        uint32_t chunk = PAGE_SIZE - in_page;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+
+        memcpy((uint8_t *)buf + done, (const uint8_t *)page + in_page, chunk);
+        done += chunk;
+    }
+
+    return (int32_t)done;
+}
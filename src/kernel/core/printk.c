@@ -0,0 +1,575 @@
+/*
+ * Vest-OS 内核日志
+ * 无锁多生产者环形缓冲区，格式化和控制台输出延迟执行
+ */
+
+#include <kernel.h>
+#include <klog.h>
+#include <ktime.h>
+#include <hal/cpu.h>
+
+// klog_fetch返回值
+#define KLOG_FETCH_OK       0
+#define KLOG_FETCH_PENDING  1   // 记录尚未提交
+#define KLOG_FETCH_LOST     2   // 记录已被覆盖
+
+// 编译器屏障（x86的存储顺序由硬件保证）
+#define klog_barrier() asm volatile ("" ::: "memory")
+
+// 日志环
+static struct klog_record klog_ring[KLOG_RING_SIZE];
+
+// 下一个待分配的序号
+static volatile uint32_t klog_head = 0;
+
+// 控制台消费者位置
+static uint32_t klog_tail = 0;
+
+// klog_clear之后的第一个序号
+static uint32_t klog_clear_seq = 0;
+
+// 控制台输出被覆盖而丢失的记录数
+static uint32_t klog_dropped_count = 0;
+
+// 同一时刻只允许一个CPU执行klog_flush
+static volatile uint32_t klog_flushing = 0;
+
+// 控制台输出回调和级别阈值
+static klog_console_t klog_console = NULL;
+static int klog_console_level = 8;
+
+// 格式化输出缓冲区
+struct klog_buf {
+    char *data;
+    size_t size;
+    size_t len;
+};
+
+/**
+ * 解析"<N>"级别前缀
+ */
+static uint8_t klog_parse_level(const char **format)
+{
+    const char *fmt = *format;
+
+    if (fmt[0] == '<' && fmt[1] >= '0' && fmt[1] <= '7' && fmt[2] == '>') {
+        *format = fmt + 3;
+        return (uint8_t)(fmt[1] - '0');
+    }
+
+    return KLOG_DEFAULT_LEVEL;
+}
+
+/**
+ * 按格式串保存原始参数，%s参数拷贝到记录内
+ */
+static void klog_capture(struct klog_record *rec, const char *fmt, va_list args)
+{
+    uint32_t n = 0;
+    uint32_t text_used = 0;
+
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+
+        // 标志和宽度
+        while (*p == '-' || *p == '0' || *p == '+' || *p == ' ' || *p == '#') {
+            p++;
+        }
+        if (*p == '*') {
+            if (n >= KLOG_MAX_ARGS) {
+                break;
+            }
+            rec->args[n++] = va_arg(args, uint32_t);
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+
+        int longs = 0;
+        while (*p == 'l') {
+            longs++;
+            p++;
+        }
+
+        if (*p == '\0') {
+            break;
+        }
+
+        if (*p == '%') {
+            continue;
+        }
+
+        if (*p == 's') {
+            const char *s = va_arg(args, const char *);
+            if (n >= KLOG_MAX_ARGS) {
+                break;
+            }
+            if (!s) {
+                s = "(null)";
+            }
+
+            rec->args[n++] = text_used < KLOG_TEXT_SIZE ? text_used : KLOG_TEXT_SIZE - 1;
+            while (*s && text_used < KLOG_TEXT_SIZE - 1) {
+                rec->text[text_used++] = *s++;
+            }
+            if (text_used < KLOG_TEXT_SIZE) {
+                rec->text[text_used++] = '\0';
+            }
+        } else if (longs >= 2) {
+            uint64_t value = va_arg(args, uint64_t);
+            if (n + 2 > KLOG_MAX_ARGS) {
+                break;
+            }
+            rec->args[n++] = (uint32_t)value;
+            rec->args[n++] = (uint32_t)(value >> 32);
+        } else {
+            uint32_t value = va_arg(args, uint32_t);
+            if (n >= KLOG_MAX_ARGS) {
+                break;
+            }
+            rec->args[n++] = value;
+        }
+    }
+
+    rec->nargs = (uint8_t)n;
+}
+
+/**
+ * 记录一条日志（热路径：不格式化，不访问I/O端口）
+ */
+void klog_vprintk(const char *format, va_list args)
+{
+    uint8_t level = klog_parse_level(&format);
+
+    // 占用一个序号，多个CPU可以同时写入不同的槽位
+    uint32_t seq = __sync_fetch_and_add(&klog_head, 1);
+    struct klog_record *rec = &klog_ring[seq & KLOG_RING_MASK];
+
+    rec->seq = 0;
+    klog_barrier();
+
+    rec->level = level;
+    rec->cpu = (uint16_t)get_cpu_id();
+    rec->timestamp = ktime_get_ns();
+    rec->fmt = format;
+    rec->text[KLOG_TEXT_SIZE - 1] = '\0';
+    klog_capture(rec, format, args);
+
+    // 提交记录
+    klog_barrier();
+    rec->seq = seq + 1;
+}
+
+/**
+ * 内核输出函数
+ */
+void kernel_printk(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    klog_vprintk(format, args);
+    va_end(args);
+}
+
+/**
+ * 复制一条记录，检测未提交或已被覆盖的情况
+ */
+static int klog_fetch(uint32_t seq, struct klog_record *out)
+{
+    const struct klog_record *rec = &klog_ring[seq & KLOG_RING_MASK];
+
+    if (klog_head - seq > KLOG_RING_SIZE) {
+        return KLOG_FETCH_LOST;
+    }
+
+    uint32_t tag = rec->seq;
+    klog_barrier();
+
+    if (tag != seq + 1) {
+        return (int32_t)(tag - (seq + 1)) > 0 ? KLOG_FETCH_LOST : KLOG_FETCH_PENDING;
+    }
+
+    *out = *rec;
+    klog_barrier();
+
+    // 复制期间被生产者覆盖
+    if (rec->seq != tag) {
+        return KLOG_FETCH_LOST;
+    }
+
+    return KLOG_FETCH_OK;
+}
+
+/**
+ * 写入一个字符（超出部分只计数）
+ */
+static void klog_putc(struct klog_buf *buf, char c)
+{
+    if (buf->len + 1 < buf->size) {
+        buf->data[buf->len] = c;
+    }
+    buf->len++;
+}
+
+/**
+ * 64位除法（只用32位运算，内核不链接libgcc）
+ */
+static uint32_t klog_divmod(uint64_t *value, uint32_t base)
+{
+    uint32_t hi = (uint32_t)(*value >> 32);
+    uint32_t lo = (uint32_t)*value;
+    uint32_t parts[4] = { hi >> 16, hi & 0xFFFF, lo >> 16, lo & 0xFFFF };
+    uint32_t rem = 0;
+
+    for (int i = 0; i < 4; i++) {
+        uint32_t cur = (rem << 16) | parts[i];
+        parts[i] = cur / base;
+        rem = cur % base;
+    }
+
+    *value = ((uint64_t)((parts[0] << 16) | parts[1]) << 32) |
+             ((parts[2] << 16) | parts[3]);
+    return rem;
+}
+
+/**
+ * 输出数字
+ */
+static void klog_put_number(struct klog_buf *buf, uint64_t value, uint32_t base,
+                            int width, int zero_pad, int left, int negative, int upper)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[24];
+    int len = 0;
+
+    do {
+        tmp[len++] = digits[klog_divmod(&value, base)];
+    } while (value != 0);
+
+    // 补零时负号在填充之前输出
+    if (negative && !zero_pad) {
+        tmp[len++] = '-';
+    }
+
+    int pad = width - len - (negative && zero_pad ? 1 : 0);
+
+    if (negative && zero_pad) {
+        klog_putc(buf, '-');
+    }
+
+    if (!left) {
+        while (pad-- > 0) {
+            klog_putc(buf, zero_pad ? '0' : ' ');
+        }
+    }
+
+    while (len > 0) {
+        klog_putc(buf, tmp[--len]);
+    }
+
+    if (left) {
+        while (pad-- > 0) {
+            klog_putc(buf, ' ');
+        }
+    }
+}
+
+/**
+ * 按保存的参数格式化消息正文
+ */
+static void klog_format_message(struct klog_buf *buf, const struct klog_record *rec)
+{
+    uint32_t n = 0;
+
+    for (const char *p = rec->fmt; *p; p++) {
+        if (*p != '%') {
+            klog_putc(buf, *p);
+            continue;
+        }
+        p++;
+
+        int left = 0;
+        int zero_pad = 0;
+        int width = 0;
+
+        while (*p == '-' || *p == '0' || *p == '+' || *p == ' ' || *p == '#') {
+            if (*p == '-') {
+                left = 1;
+            } else if (*p == '0') {
+                zero_pad = 1;
+            }
+            p++;
+        }
+        if (*p == '*') {
+            width = n < rec->nargs ? (int)rec->args[n] : 0;
+            n++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            width = width * 10 + (*p - '0');
+            p++;
+        }
+
+        int longs = 0;
+        while (*p == 'l') {
+            longs++;
+            p++;
+        }
+
+        if (*p == '\0') {
+            break;
+        }
+
+        if (*p == '%') {
+            klog_putc(buf, '%');
+            continue;
+        }
+
+        // 参数在记录时被截断
+        uint32_t need = longs >= 2 && *p != 's' ? 2 : 1;
+        if (n + need > rec->nargs) {
+            klog_putc(buf, '?');
+            n += need;
+            continue;
+        }
+
+        uint64_t value = rec->args[n];
+        if (need == 2) {
+            value |= (uint64_t)rec->args[n + 1] << 32;
+        }
+        n += need;
+
+        switch (*p) {
+            case 'd':
+            case 'i': {
+                int64_t sv = need == 2 ? (int64_t)value : (int64_t)(int32_t)value;
+                int negative = sv < 0;
+                klog_put_number(buf, negative ? (uint64_t)-sv : (uint64_t)sv, 10,
+                                width, zero_pad, left, negative, 0);
+                break;
+            }
+
+            case 'u':
+                klog_put_number(buf, value, 10, width, zero_pad, left, 0, 0);
+                break;
+
+            case 'x':
+            case 'X':
+                klog_put_number(buf, value, 16, width, zero_pad, left, 0, *p == 'X');
+                break;
+
+            case 'o':
+                klog_put_number(buf, value, 8, width, zero_pad, left, 0, 0);
+                break;
+
+            case 'p':
+                klog_putc(buf, '0');
+                klog_putc(buf, 'x');
+                klog_put_number(buf, value, 16, 8, 1, 0, 0, 0);
+                break;
+
+            case 'c':
+                klog_putc(buf, (char)value);
+                break;
+
+            case 's': {
+                const char *s = &rec->text[value < KLOG_TEXT_SIZE ? value : KLOG_TEXT_SIZE - 1];
+                int len = 0;
+                while (s[len]) {
+                    len++;
+                }
+                if (!left) {
+                    for (int i = len; i < width; i++) {
+                        klog_putc(buf, ' ');
+                    }
+                }
+                for (int i = 0; i < len; i++) {
+                    klog_putc(buf, s[i]);
+                }
+                if (left) {
+                    for (int i = len; i < width; i++) {
+                        klog_putc(buf, ' ');
+                    }
+                }
+                break;
+            }
+
+            default:
+                klog_putc(buf, '%');
+                klog_putc(buf, *p);
+                break;
+        }
+    }
+}
+
+/**
+ * 格式化一条记录，with_header为真时加上级别和时间戳
+ */
+static size_t klog_format_record(const struct klog_record *rec, char *data, size_t size,
+                                 int with_header)
+{
+    struct klog_buf buf = { data, size, 0 };
+
+    if (with_header) {
+        // 时间戳为启动以来的秒数，精确到微秒
+        uint32_t nsec;
+        uint64_t sec = div_u64_rem(rec->timestamp, NSEC_PER_SEC, &nsec);
+
+        klog_putc(&buf, '<');
+        klog_putc(&buf, (char)('0' + rec->level));
+        klog_putc(&buf, '>');
+        klog_putc(&buf, '[');
+        klog_put_number(&buf, sec, 10, 5, 0, 0, 0, 0);
+        klog_putc(&buf, '.');
+        klog_put_number(&buf, nsec / NSEC_PER_USEC, 10, 6, 1, 0, 0, 0);
+        klog_putc(&buf, ']');
+        klog_putc(&buf, ' ');
+    }
+
+    klog_format_message(&buf, rec);
+
+    if (buf.len >= size) {
+        buf.len = size - 1;
+    }
+    data[buf.len] = '\0';
+
+    return buf.len;
+}
+
+/**
+ * 消费日志环并输出到控制台
+ */
+void klog_flush(void)
+{
+    // 其他CPU正在输出，由它负责清空
+    if (__sync_lock_test_and_set(&klog_flushing, 1)) {
+        return;
+    }
+
+    while (klog_tail != klog_head) {
+        struct klog_record rec;
+        char line[KLOG_LINE_MAX];
+
+        // 消费者落后超过一圈，跳过被覆盖的记录
+        if (klog_head - klog_tail > KLOG_RING_SIZE) {
+            uint32_t oldest = klog_head - KLOG_RING_SIZE;
+            klog_dropped_count += oldest - klog_tail;
+            klog_tail = oldest;
+            continue;
+        }
+
+        int ret = klog_fetch(klog_tail, &rec);
+        if (ret == KLOG_FETCH_PENDING) {
+            break;
+        }
+
+        if (ret == KLOG_FETCH_OK && klog_console && rec.level < klog_console_level) {
+            size_t len = klog_format_record(&rec, line, sizeof(line), 0);
+            klog_console(line, len);
+        } else if (ret == KLOG_FETCH_LOST) {
+            klog_dropped_count++;
+        }
+
+        klog_tail++;
+    }
+
+    __sync_lock_release(&klog_flushing);
+}
+
+/**
+ * 设置控制台输出回调
+ */
+void klog_set_console(klog_console_t console)
+{
+    klog_console = console;
+}
+
+/**
+ * 设置控制台输出级别（级别小于该值的消息才输出）
+ */
+void klog_set_console_level(int level)
+{
+    klog_console_level = level;
+}
+
+/**
+ * 读取环中保留的全部日志（dmesg）
+ */
+int klog_read_all(char *buf, size_t size)
+{
+    uint32_t head = klog_head;
+    uint32_t seq = head > KLOG_RING_SIZE ? head - KLOG_RING_SIZE : 0;
+    size_t total = 0;
+
+    if ((int32_t)(klog_clear_seq - seq) > 0) {
+        seq = klog_clear_seq;
+    }
+
+    for (; seq != head && total + 1 < size; seq++) {
+        struct klog_record rec;
+
+        int ret = klog_fetch(seq, &rec);
+        if (ret == KLOG_FETCH_PENDING) {
+            break;
+        }
+        if (ret == KLOG_FETCH_LOST) {
+            continue;
+        }
+
+        total += klog_format_record(&rec, buf + total, size - total, 1);
+    }
+
+    return (int)total;
+}
+
+/**
+ * 清除dmesg可见的日志
+ */
+void klog_clear(void)
+{
+    klog_clear_seq = klog_head;
+}
+
+/**
+ * 获取控制台丢失的记录数
+ */
+uint32_t klog_dropped(void)
+{
+    return klog_dropped_count;
+}
+
+/**
+ * SYS_SYSLOG系统调用
+ */
+int sys_syslog(int type, char *buf, int len)
+{
+    int ret;
+
+    switch (type) {
+        case KLOG_ACTION_READ_ALL:
+        case KLOG_ACTION_READ_CLEAR:
+            if (!buf || len <= 0) {
+                return ERROR_INVALID;
+            }
+            ret = klog_read_all(buf, (size_t)len);
+            if (type == KLOG_ACTION_READ_CLEAR) {
+                klog_clear();
+            }
+            return ret;
+
+        case KLOG_ACTION_CLEAR:
+            klog_clear();
+            return 0;
+
+        case KLOG_ACTION_SIZE_BUFFER:
+            return KLOG_RING_SIZE * KLOG_LINE_MAX;
+
+        default:
+            return ERROR_INVALID;
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * Vest-OS 上下文切换微基准
+ * 两个绑定在同一CPU上的线程轮流让出CPU，测量每次切换的TSC周期；
+ * 分别测量不使用FPU和每轮都使用FPU（惰性保存/恢复）的线程
+ */
+
+#include <kernel.h>
+#include <sched.h>
+#include <klog.h>
+#include <hal/cpu.h>
+#include <hal/fpu.h>
+
+// 基准状态
+static struct {
+    volatile uint32_t turn;         // 0: ping运行，1: pong运行
+    volatile uint32_t remaining;    // 剩余往返次数
+    volatile uint32_t done;         // 结束的线程数
+    uint32_t use_fpu;               // 每轮执行一条FPU指令
+    uint64_t start;
+    uint64_t end;
+} pingpong;
+
+/**
+ * 等待轮到自己，然后把机会交给对方
+ */
+static void pingpong_thread(void *arg)
+{
+    uint32_t me = (uint32_t)arg;
+
+    while (pingpong.remaining) {
+        while (pingpong.turn != me && pingpong.remaining) {
+            sched_yield();
+        }
+
+        // 切换走时TS已置位：第一条FPU指令触发#NM并恢复本线程的状态
+        if (pingpong.use_fpu) {
+            asm volatile ("fldz; fstp %%st(0)" ::: "memory");
+        }
+
+        if (me == 0 && pingpong.remaining) {
+            pingpong.remaining--;
+        }
+        pingpong.turn = !me;
+    }
+
+    if (me == 0) {
+        pingpong.end = rdtsc();
+    }
+    __sync_fetch_and_add(&pingpong.done, 1);
+}
+
+/**
+ * 运行一轮ping-pong，返回每次切换的平均周期数（失败返回0）
+ */
+static uint32_t pingpong_run(uint32_t cpu, uint32_t iterations, uint32_t use_fpu)
+{
+    pingpong.turn = 0;
+    pingpong.remaining = iterations;
+    pingpong.done = 0;
+    pingpong.use_fpu = use_fpu;
+
+    struct thread *ping = create_thread(NULL);
+    struct thread *pong = create_thread(NULL);
+    if (!ping || !pong) {
+        kernel_printk(KERN_ERR "schedbench: 无法创建线程\n");
+        return 0;
+    }
+
+    // 两个线程都绑定在当前CPU，测量的是纯切换开销
+    thread_set_affinity(ping, CPUMASK_CPU(cpu));
+    thread_set_affinity(pong, CPUMASK_CPU(cpu));
+
+    pingpong.start = rdtsc();
+    thread_start(ping, pingpong_thread, (void *)0);
+    thread_start(pong, pingpong_thread, (void *)1);
+
+    while (pingpong.done < 2) {
+        sched_yield();
+    }
+
+    // 每次往返包含两次切换
+    uint64_t cycles = pingpong.end - pingpong.start;
+    return (uint32_t)(cycles >> 1) / (iterations ? iterations : 1);
+}
+
+/**
+ * 运行ping-pong基准，输出不使用和使用FPU时每次切换的平均周期数
+ */
+void sched_bench_pingpong(uint32_t iterations)
+{
+    uint32_t cpu = sched_this_cpu();
+    struct fpu_stat before, after;
+
+    uint32_t plain = pingpong_run(cpu, iterations, 0);
+
+    fpu_get_stat(cpu, &before);
+    uint32_t with_fpu = pingpong_run(cpu, iterations, 1);
+    fpu_get_stat(cpu, &after);
+
+    kernel_printk(KERN_INFO "schedbench: cpu=%u round-trips=%u cycles/switch=%u fpu-cycles/switch=%u\n",
+                  cpu, iterations, plain, with_fpu);
+    kernel_printk(KERN_INFO "schedbench: #NM=%u fpu-saves=%u fpu-restores=%u\n",
+                  after.traps - before.traps, after.saves - before.saves,
+                  after.restores - before.restores);
+}
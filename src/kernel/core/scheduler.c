@@ -0,0 +1,898 @@
+/*
+ * Vest-OS 调度器
+ * 每CPU优先级位图运行队列、交互奖励、时钟抢占、空闲窃取和CPU亲和性
+ */
+
+#include <kernel.h>
+#include <sched.h>
+#include <klog.h>
+#include <ktime.h>
+#include <hal/cpu.h>
+#include <hal/fpu.h>
+#include <kernel/rcu.h>
+#include <kernel/preempt.h>
+#include <hal/smp.h>
+#include <arch/interrupt.h>
+#include <kernel/softirq.h>
+#include <kernel/timer_wheel.h>
+
+// 每CPU运行队列
+static DEFINE_PER_CPU(struct runqueue, runqueue);
+#define cpu_rq(cpu)     per_cpu_ptr(&runqueue, (cpu))
+
+// 启动上下文使用的静态线程结构（作为各CPU的空闲线程）
+static DEFINE_PER_CPU(struct thread, idle_thread);
+
+// 下一个线程ID
+static volatile uint32_t next_tid = 1;
+
+// 所有由create_thread创建、尚未释放的线程（不含空闲线程）
+static struct thread *thread_list;
+static DEFINE_SPINLOCK(thread_list_lock);
+
+// 上下文切换（汇编实现），返回切换前的线程
+struct thread *switch_context(struct thread *prev, struct thread *next);
+
+// 新线程第一次被切换到时的入口（汇编实现）
+void sched_thread_start(void);
+
+// 由汇编入口调用
+void sched_finish_switch(struct thread *prev);
+void sched_thread_entry(void) __attribute__((noreturn));
+
+// 保存被调用者保存寄存器，切换栈指针，在新栈上恢复
+asm (
+    ".text\n"
+    ".global switch_context\n"
+    "switch_context:\n"
+    "    movl 4(%esp), %eax\n"          // prev
+    "    movl 8(%esp), %edx\n"          // next
+    "    pushl %ebp\n"
+    "    pushl %ebx\n"
+    "    pushl %esi\n"
+    "    pushl %edi\n"
+    "    movl %esp, (%eax)\n"           // prev->esp
+    "    movl (%edx), %esp\n"           // next->esp
+    "    popl %edi\n"
+    "    popl %esi\n"
+    "    popl %ebx\n"
+    "    popl %ebp\n"
+    "    ret\n"                         // eax仍是prev
+    "\n"
+    ".global sched_thread_start\n"
+    "sched_thread_start:\n"
+    "    pushl %eax\n"
+    "    call sched_finish_switch\n"
+    "    addl $4, %esp\n"
+    "    sti\n"
+    "    call sched_thread_entry\n"
+);
+
+/**
+ * 当前CPU编号
+ */
+uint32_t sched_this_cpu(void)
+{
+    return this_cpu_read(cpu_number);
+}
+
+/**
+ * 当前CPU的运行队列
+ */
+static inline struct runqueue *this_rq(void)
+{
+    return this_cpu_ptr(&runqueue);
+}
+
+/**
+ * 获取当前线程
+ */
+struct thread *current_thread(void)
+{
+    return this_rq()->curr;
+}
+
+/**
+ * 根据睡眠得分计算动态优先级
+ *
+ * sleep_avg从0到SCHED_MAX_SLEEP_AVG线性映射为-SCHED_MAX_BONUS到
+ * +SCHED_MAX_BONUS的奖励，经常睡眠的交互线程优先级提高。
+ */
+static uint32_t effective_prio(struct thread *thread)
+{
+    int bonus = (int)(thread->sleep_avg * (2 * SCHED_MAX_BONUS + 1) / (SCHED_MAX_SLEEP_AVG + 1))
+                - SCHED_MAX_BONUS;
+    int prio = (int)thread->static_prio - bonus;
+
+    if (prio < 0) {
+        prio = 0;
+    } else if (prio >= SCHED_PRIO_LEVELS) {
+        prio = SCHED_PRIO_LEVELS - 1;
+    }
+
+    return (uint32_t)prio;
+}
+
+/**
+ * 加入对应优先级的队尾（调用者持有rq->lock）
+ */
+static void rq_enqueue(struct runqueue *rq, struct thread *thread)
+{
+    uint32_t prio = thread->prio;
+
+    thread->next = NULL;
+    if (rq->tail[prio]) {
+        rq->tail[prio]->next = thread;
+    } else {
+        rq->head[prio] = thread;
+    }
+    rq->tail[prio] = thread;
+    rq->bitmap |= 1u << prio;
+    rq->nr_running++;
+    thread->ready_since = sched_clock();
+}
+
+/**
+ * 位图中最低的置位（最高优先级）
+ */
+static inline uint32_t sched_find_first_bit(uint32_t bitmap)
+{
+    uint32_t bit;
+    asm ("bsfl %1, %0" : "=r"(bit) : "rm"(bitmap));
+    return bit;
+}
+
+/**
+ * 取出最高优先级中第一个可以在cpu上运行的线程（调用者持有rq->lock）
+ *
+ * 通常直接命中位图最低位队列的队首；只有遇到上下文尚未保存完毕
+ * 或亲和性不允许的线程时才继续向后查找。
+ */
+static struct thread *rq_dequeue(struct runqueue *rq, uint32_t cpu, struct thread *self)
+{
+    uint32_t bits = rq->bitmap;
+
+    while (bits) {
+        uint32_t prio = sched_find_first_bit(bits);
+        struct thread *prev = NULL;
+
+        for (struct thread *t = rq->head[prio]; t; prev = t, t = t->next) {
+            if ((t->on_cpu && t != self) || !(t->affinity & CPUMASK_CPU(cpu))) {
+                continue;
+            }
+
+            if (prev) {
+                prev->next = t->next;
+            } else {
+                rq->head[prio] = t->next;
+            }
+            if (rq->tail[prio] == t) {
+                rq->tail[prio] = prev;
+            }
+            if (!rq->head[prio]) {
+                rq->bitmap &= ~(1u << prio);
+            }
+            t->next = NULL;
+            rq->nr_running--;
+            return t;
+        }
+
+        bits &= bits - 1;
+    }
+
+    return NULL;
+}
+
+/**
+ * 为可运行线程选择CPU：优先留在原CPU，否则选亲和性内最空闲的
+ */
+static uint32_t select_cpu(struct thread *thread)
+{
+    if (cpu_rq(thread->cpu)->online && (thread->affinity & CPUMASK_CPU(thread->cpu))) {
+        return thread->cpu;
+    }
+
+    uint32_t best = thread->cpu;
+    uint32_t best_load = 0xFFFFFFFF;
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct runqueue *rq = cpu_rq(cpu);
+        if (!rq->online || !(thread->affinity & CPUMASK_CPU(cpu))) {
+            continue;
+        }
+        uint32_t load = rq->nr_running + (rq->curr != rq->idle);
+        if (load < best_load) {
+            best = cpu;
+            best_load = load;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * 把线程放入目标CPU的运行队列，目标CPU空闲时让它尽快调度
+ */
+static void sched_enqueue(struct thread *thread)
+{
+    uint32_t cpu = select_cpu(thread);
+    struct runqueue *rq = cpu_rq(cpu);
+
+    uint32_t flags = spinlock_lock_irqsave(&rq->lock);
+    thread->cpu = cpu;
+    rq_enqueue(rq, thread);
+
+    // 比当前线程优先级高则抢占（空闲线程不在任何优先级上）
+    bool kick = false;
+    if (rq->curr == rq->idle || thread->prio < rq->curr->prio) {
+        kick = !rq->need_resched;
+        rq->need_resched = 1;
+    }
+    spinlock_unlock_irqrestore(&rq->lock, flags);
+
+    // 远端CPU可能停在hlt中，用IPI让它立即调度
+    if (kick) {
+        smp_send_reschedule(cpu);
+    }
+}
+
+/**
+ * 从最忙的队列窃取一个线程到本地队列
+ */
+static struct thread *sched_steal(uint32_t cpu)
+{
+    struct runqueue *busiest = NULL;
+    uint32_t max_load = 0;
+
+    // 无锁估计各队列负载
+    for (uint32_t i = 0; i < NR_CPUS; i++) {
+        struct runqueue *rq = cpu_rq(i);
+        if (i == cpu || !rq->online) {
+            continue;
+        }
+        if (rq->nr_running > max_load) {
+            max_load = rq->nr_running;
+            busiest = rq;
+        }
+    }
+
+    if (!busiest) {
+        return NULL;
+    }
+
+    spinlock_lock(&busiest->lock);
+    struct thread *thread = rq_dequeue(busiest, cpu, NULL);
+    spinlock_unlock(&busiest->lock);
+
+    if (thread) {
+        thread->cpu = cpu;
+        cpu_rq(cpu)->steals++;
+    }
+
+    return thread;
+}
+
+/**
+ * 加入线程链表
+ */
+static void thread_list_add(struct thread *thread)
+{
+    uint32_t flags = spinlock_lock_irqsave(&thread_list_lock);
+    thread->next_all = thread_list;
+    thread_list = thread;
+    spinlock_unlock_irqrestore(&thread_list_lock, flags);
+}
+
+/**
+ * 释放线程控制块和内核栈，先从线程链表中摘除
+ */
+static void thread_free(struct thread *thread)
+{
+    uint32_t flags = spinlock_lock_irqsave(&thread_list_lock);
+    struct thread **link = &thread_list;
+    while (*link && *link != thread) {
+        link = &(*link)->next_all;
+    }
+    if (*link) {
+        *link = thread->next_all;
+    }
+    spinlock_unlock_irqrestore(&thread_list_lock, flags);
+
+    kfree(thread->stack);
+    kfree(thread);
+}
+
+/**
+ * 切换完成后在新线程上下文中执行
+ *
+ * 此时prev的寄存器已经保存，可以让其他CPU运行它或回收它。
+ */
+void sched_finish_switch(struct thread *prev)
+{
+    uint32_t state = prev->state;
+    uint32_t requeue = prev->requeue;
+
+    // 被唤醒的线程已由sched_wake入队，这里只重新放入被换下时仍在运行的线程
+    prev->requeue = 0;
+    barrier();
+    prev->on_cpu = 0;
+
+    if (requeue) {
+        sched_enqueue(prev);
+    } else if (state == THREAD_DEAD) {
+        thread_free(prev);
+    }
+}
+
+/**
+ * 新线程的C入口
+ */
+void sched_thread_entry(void)
+{
+    struct thread *self = current_thread();
+
+    self->entry(self->arg);
+    thread_exit();
+}
+
+/**
+ * 选择下一个线程并切换（不报告RCU静止状态）
+ */
+static void __schedule(void)
+{
+    uint32_t flags = local_irq_save();
+    uint32_t cpu = sched_this_cpu();
+    struct runqueue *rq = cpu_rq(cpu);
+    struct thread *prev = rq->curr;
+
+    rq->need_resched = 0;
+
+    spinlock_lock(&rq->lock);
+    struct thread *next = rq_dequeue(rq, cpu, prev);
+    spinlock_unlock(&rq->lock);
+
+    if (!next) {
+        next = sched_steal(cpu);
+    }
+
+    int prev_runnable = (prev->state == THREAD_RUNNING) &&
+                        (prev->affinity & CPUMASK_CPU(cpu));
+
+    if (!next) {
+        // 没有其他可运行线程：继续当前线程，或回到空闲线程
+        if (prev_runnable || prev == rq->idle) {
+            prev->timeslice = SCHED_TIMESLICE_TICKS;
+            local_irq_restore(flags);
+            return;
+        }
+        next = rq->idle;
+    }
+
+    if (next == prev) {
+        // 被唤醒后又从本地队列取回自己
+        prev->state = THREAD_RUNNING;
+        prev->timeslice = SCHED_TIMESLICE_TICKS;
+        local_irq_restore(flags);
+        return;
+    }
+
+    // 仍可运行的prev在切换完成后重新入队（可能迁移到其他CPU）
+    if (prev->state == THREAD_RUNNING) {
+        prev->state = THREAD_RUNNABLE;
+        prev->requeue = (prev != rq->idle);
+    }
+
+    // 运行和等待时间统计
+    uint64_t now = sched_clock();
+    if (prev != rq->idle) {
+        prev->runtime_ns += now - prev->exec_start;
+    }
+    if (next != rq->idle) {
+        next->wait_ns += now - next->ready_since;
+    }
+    next->exec_start = now;
+    next->nr_switches++;
+
+    next->state = THREAD_RUNNING;
+    next->on_cpu = 1;
+    next->cpu = cpu;
+    next->timeslice = SCHED_TIMESLICE_TICKS;
+    rq->curr = next;
+    rq->switches++;
+
+    cpu_set_kernel_stack(next->stack ? (uint32_t)next->stack + KTHREAD_STACK_SIZE : 0);
+
+    // 内核线程不访问用户空间，不必切换地址空间
+    if (next->page_dir) {
+        switch_page_directory(next->page_dir);
+    }
+
+    // 只有本时间片用过FPU的线程需要保存，next第一次使用FPU时再恢复
+    fpu_switch_out(prev);
+
+    prev = switch_context(prev, next);
+    sched_finish_switch(prev);
+
+    local_irq_restore(flags);
+}
+
+/**
+ * 主动调度
+ */
+void schedule(void)
+{
+    // 主动让出CPU的线程不在读临界区内，这是RCU静止状态
+    rcu_quiescent_state();
+    __schedule();
+}
+
+/**
+ * 时钟中断中调用：消耗时间片，空闲CPU定期尝试窃取
+ */
+void scheduler_tick(void)
+{
+    struct runqueue *rq = this_rq();
+    struct thread *curr = rq->curr;
+
+    if (!rq->online) {
+        return;
+    }
+
+    if (curr == rq->idle) {
+        if (rq->nr_running) {
+            rq->need_resched = 1;
+        } else if (--rq->balance_ticks == 0) {
+            rq->balance_ticks = SCHED_BALANCE_TICKS;
+            rq->need_resched = 1;
+        }
+        return;
+    }
+
+    // 运行消耗睡眠得分，时间片用完时按新的得分重新排队
+    if (curr->sleep_avg > 0) {
+        curr->sleep_avg--;
+    }
+
+    if (curr->timeslice > 0) {
+        curr->timeslice--;
+    }
+    if (curr->timeslice == 0) {
+        curr->prio = effective_prio(curr);
+        rq->need_resched = 1;
+    }
+}
+
+/**
+ * 中断返回前的抢占点
+ *
+ * 被打断的代码持有自旋锁或处在RCU读临界区时不抢占，need_resched保留
+ * 到下一次中断出口。抢占不报告RCU静止状态，静止状态只来自主动调度、
+ * 空闲和打断用户态的时钟中断。
+ */
+void sched_preempt(void)
+{
+    if (this_rq()->need_resched && !preempt_count()) {
+        __schedule();
+    }
+}
+
+/**
+ * 中断出口（interrupt_asm.asm在interrupt_dispatch之后调用）
+ * 唤醒了停掉节拍的空闲CPU时先恢复节拍，再开中断执行下半部，最后检查抢占。
+ * 嵌套中断或打断了软中断时返回的是外层处理函数，由外层完成这些步骤
+ */
+void interrupt_exit(void)
+{
+    if (interrupt_in_context() || softirq_in_context()) {
+        return;
+    }
+
+    tick_nohz_idle_exit();
+    do_softirq();
+    sched_preempt();
+}
+
+/**
+ * 主动让出CPU
+ */
+void sched_yield(void)
+{
+    schedule();
+}
+
+/**
+ * 当前线程睡眠，直到sched_wake
+ *
+ * 调用者应先在等待条件对应的结构中登记自己，再调用本函数；
+ * 登记之后发生的唤醒不会丢失。可能提前返回，调用者需重新检查条件。
+ */
+void sched_block(void)
+{
+    struct thread *self = current_thread();
+
+    // 登记之后、睡眠之前已被唤醒
+    if (__sync_lock_test_and_set(&self->wake_pending, 0)) {
+        return;
+    }
+
+    self->sleep_start = jiffies;
+
+    if (!__sync_bool_compare_and_swap(&self->state, THREAD_RUNNING, THREAD_BLOCKED)) {
+        return;
+    }
+
+    // 唤醒方在状态改变前只留下了标记：撤销睡眠
+    if (self->wake_pending &&
+        __sync_bool_compare_and_swap(&self->state, THREAD_BLOCKED, THREAD_RUNNING)) {
+        self->wake_pending = 0;
+        return;
+    }
+
+    schedule();
+}
+
+/**
+ * 唤醒睡眠的线程；线程还没睡下时留下标记，它的下一次sched_block直接返回
+ *
+ * BLOCKED→RUNNABLE由唤醒方完成并入队，即使线程还没从CPU上换下：
+ * rq_dequeue不会在其他CPU上取出on_cpu的线程，切换完成时
+ * sched_finish_switch也不会再次入队（requeue只由schedule设置）。
+ */
+void sched_wake(struct thread *thread)
+{
+    for (;;) {
+        if (__sync_bool_compare_and_swap(&thread->state, THREAD_BLOCKED, THREAD_RUNNABLE)) {
+            // 睡得越久得分越高，等待终端输入的线程因此排在批处理任务之前
+            uint32_t slept = (uint32_t)(jiffies - thread->sleep_start);
+            uint32_t sleep_avg = thread->sleep_avg + slept;
+
+            thread->sleep_avg = sleep_avg > SCHED_MAX_SLEEP_AVG ? SCHED_MAX_SLEEP_AVG : sleep_avg;
+            thread->prio = effective_prio(thread);
+
+            sched_enqueue(thread);
+            return;
+        }
+
+        thread->wake_pending = 1;
+        memory_barrier();
+
+        // 标记之后才进入睡眠的线程可能没有看到它，再试一次
+        if (thread->state != THREAD_BLOCKED) {
+            return;
+        }
+    }
+}
+
+/**
+ * 分配线程控制块和内核栈
+ */
+struct thread *create_thread(struct process *proc)
+{
+    struct thread *thread = kmalloc(sizeof(struct thread));
+    if (!thread) {
+        return NULL;
+    }
+
+    memset(thread, 0, sizeof(struct thread));
+
+    thread->stack = kmalloc(KTHREAD_STACK_SIZE);
+    if (!thread->stack) {
+        kfree(thread);
+        return NULL;
+    }
+
+    thread->tid = __sync_fetch_and_add(&next_tid, 1);
+    thread->state = THREAD_NEW;
+    thread->process = proc;
+    thread->affinity = CPUMASK_ALL;
+    thread->cpu = sched_this_cpu();
+    thread->static_prio = SCHED_PRIO_DEFAULT;
+    thread->prio = SCHED_PRIO_DEFAULT;
+
+    thread_list_add(thread);
+    return thread;
+}
+
+/**
+ * 释放尚未启动的线程；当前线程则直接退出
+ */
+void destroy_thread(struct thread *thread)
+{
+    if (thread == current_thread()) {
+        thread_exit();
+    }
+
+    if (thread->state == THREAD_NEW) {
+        thread_free(thread);
+    }
+}
+
+/**
+ * 设置入口并让线程开始运行
+ */
+int thread_start(struct thread *thread, void (*entry)(void *arg), void *arg)
+{
+    if (!thread || !entry || thread->state != THREAD_NEW) {
+        return ERROR_INVALID;
+    }
+
+    thread->entry = entry;
+    thread->arg = arg;
+
+    // 初始栈：switch_context弹出的四个寄存器，返回到sched_thread_start
+    uint32_t *sp = (uint32_t *)((uint8_t *)thread->stack + KTHREAD_STACK_SIZE);
+    *--sp = (uint32_t)sched_thread_start;
+    *--sp = 0;  // ebp
+    *--sp = 0;  // ebx
+    *--sp = 0;  // esi
+    *--sp = 0;  // edi
+    thread->esp = (uint32_t)sp;
+
+    thread->state = THREAD_RUNNABLE;
+    sched_enqueue(thread);
+
+    return ERROR_NONE;
+}
+
+/**
+ * 创建并启动内核线程
+ */
+struct thread *kthread_create(const char *name, void (*entry)(void *arg), void *arg)
+{
+    struct thread *thread = create_thread(NULL);
+    if (!thread) {
+        return NULL;
+    }
+
+    if (name) {
+        for (int i = 0; i < THREAD_NAME_LEN - 1 && name[i]; i++) {
+            thread->name[i] = name[i];
+        }
+    }
+
+    thread_start(thread, entry, arg);
+    return thread;
+}
+
+/**
+ * 设置CPU亲和性，当前所在CPU不在掩码内时在下次调度迁移
+ */
+int thread_set_affinity(struct thread *thread, cpumask_t mask)
+{
+    mask &= CPUMASK_ALL;
+    if (!thread || !mask) {
+        return ERROR_INVALID;
+    }
+
+    thread->affinity = mask;
+
+    if (!(mask & CPUMASK_CPU(thread->cpu))) {
+        cpu_rq(thread->cpu)->need_resched = 1;
+        if (thread == current_thread()) {
+            schedule();
+        } else {
+            smp_send_reschedule(thread->cpu);
+        }
+    }
+
+    return ERROR_NONE;
+}
+
+/**
+ * 设置基础优先级，下次入队时生效
+ */
+int thread_set_priority(struct thread *thread, uint32_t prio)
+{
+    if (!thread || prio >= SCHED_PRIO_LEVELS) {
+        return ERROR_INVALID;
+    }
+
+    thread->static_prio = prio;
+    thread->prio = effective_prio(thread);
+    return ERROR_NONE;
+}
+
+/**
+ * 读取线程的调度统计
+ */
+void sched_get_stat(struct thread *thread, struct sched_stat *stat)
+{
+    uint32_t flags = local_irq_save();
+
+    stat->runtime_ns = thread->runtime_ns;
+    stat->wait_ns = thread->wait_ns;
+    stat->nr_switches = thread->nr_switches;
+    stat->prio = thread->prio;
+
+    // 正在运行的线程加上本次已运行的时间
+    if (thread->state == THREAD_RUNNING) {
+        stat->runtime_ns += sched_clock() - thread->exec_start;
+    }
+
+    local_irq_restore(flags);
+}
+
+// 统计表输出位置
+struct sched_out {
+    char *buf;
+    size_t size;
+    size_t len;
+};
+
+static void sched_put(struct sched_out *out, const char *s)
+{
+    while (*s && out->len + 1 < out->size) {
+        out->buf[out->len++] = *s++;
+    }
+}
+
+/**
+ * 追加64位无符号整数，右对齐到width列
+ */
+static void sched_put_u64(struct sched_out *out, uint64_t value, uint32_t width)
+{
+    char field[24];
+    int pos = sizeof(field) - 1;
+
+    field[pos] = '\0';
+    do {
+        uint32_t digit;
+        value = div_u64_rem(value, 10, &digit);
+        field[--pos] = (char)('0' + digit);
+    } while (value);
+
+    while ((uint32_t)(sizeof(field) - 1 - pos) < width && pos > 0) {
+        field[--pos] = ' ';
+    }
+
+    sched_put(out, &field[pos]);
+}
+
+/**
+ * 生成调度统计表（SYS_KSTAT的KSTAT_SCHED）：每个线程的ID、名字、累计运行时间、
+ * 累计就绪等待时间（纳秒）、被调度运行的次数和动态优先级
+ */
+int sched_stat_show(char *buf, size_t size)
+{
+    struct sched_out out = { buf, size, 0 };
+
+    if (!buf || size == 0) {
+        return 0;
+    }
+
+    sched_put(&out, "  tid  name                  runtime_ns         wait_ns  switches  prio\n");
+
+    // 持有链表锁，线程不会在遍历中被释放
+    uint32_t flags = spinlock_lock_irqsave(&thread_list_lock);
+
+    for (struct thread *thread = thread_list; thread; thread = thread->next_all) {
+        struct sched_stat stat;
+        const char *name = thread->name[0] ? thread->name : "-";
+
+        if (thread->state == THREAD_NEW || thread->state == THREAD_DEAD) {
+            continue;
+        }
+
+        sched_get_stat(thread, &stat);
+
+        sched_put_u64(&out, thread->tid, 5);
+        sched_put(&out, "  ");
+        sched_put(&out, name);
+        for (size_t pad = strlen(name); pad < THREAD_NAME_LEN; pad++) {
+            sched_put(&out, " ");
+        }
+        sched_put_u64(&out, stat.runtime_ns, 16);
+        sched_put_u64(&out, stat.wait_ns, 16);
+        sched_put_u64(&out, stat.nr_switches, 10);
+        sched_put_u64(&out, stat.prio, 6);
+        sched_put(&out, "\n");
+    }
+
+    spinlock_unlock_irqrestore(&thread_list_lock, flags);
+
+    out.buf[out.len] = '\0';
+    return (int)out.len;
+}
+
+/**
+ * 结束当前线程，资源在切换走之后释放
+ */
+void thread_exit(void)
+{
+    struct thread *self = current_thread();
+
+    disable_interrupts();
+    self->state = THREAD_DEAD;
+    schedule();
+
+    // 不会返回
+    for (;;) {
+        cpu_halt();
+    }
+}
+
+/**
+ * 把当前CPU的启动上下文登记为空闲线程，并加入调度
+ */
+void sched_cpu_online(uint32_t cpu)
+{
+    struct runqueue *rq = cpu_rq(cpu);
+    struct thread *idle = per_cpu_ptr(&idle_thread, cpu);
+
+    spinlock_init(&rq->lock, "runqueue");
+    idle->tid = 0;
+    idle->state = THREAD_RUNNING;
+    idle->on_cpu = 1;
+    idle->cpu = cpu;
+    idle->affinity = CPUMASK_CPU(cpu);
+    idle->name[0] = 'i';
+    idle->name[1] = 'd';
+    idle->name[2] = 'l';
+    idle->name[3] = 'e';
+
+    rq->idle = idle;
+    rq->curr = idle;
+    rq->balance_ticks = SCHED_BALANCE_TICKS;
+    barrier();
+    rq->online = 1;
+
+    rcu_cpu_online(cpu);
+    ksoftirqd_start(cpu);
+}
+
+/**
+ * 共享驱动（键盘、TTY）的睡眠接口：空闲线程不能睡眠
+ */
+static void *sched_sleep_current(void)
+{
+    struct runqueue *rq = this_rq();
+
+    return rq->curr == rq->idle ? NULL : rq->curr;
+}
+
+static void sched_sleep_wake(void *thread)
+{
+    sched_wake(thread);
+}
+
+static const timer_sleep_ops_t sched_sleep_ops = {
+    .current = sched_sleep_current,
+    .block = sched_block,
+    .wake = sched_sleep_wake,
+};
+
+/**
+ * 初始化调度器（BSP）
+ */
+void scheduler_init(void)
+{
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        memset(cpu_rq(cpu), 0, sizeof(struct runqueue));
+        memset(per_cpu_ptr(&idle_thread, cpu), 0, sizeof(struct thread));
+    }
+
+    ksoftirqd_init();
+    timer_set_sleep_ops(&sched_sleep_ops);
+    sched_cpu_online(sched_this_cpu());
+
+    kernel_printk(KERN_INFO "调度器: 每CPU运行队列, 时间片%d节拍\n", SCHED_TIMESLICE_TICKS);
+}
+
+/**
+ * 空闲循环：有线程可运行（或可窃取）就调度，否则停机等待中断
+ */
+void sched_idle_loop(void)
+{
+    struct runqueue *rq = this_rq();
+
+    for (;;) {
+        disable_interrupts();
+        if (rq->need_resched || rq->nr_running) {
+            enable_interrupts();
+            schedule();
+            continue;
+        }
+
+        cpu_idle();
+    }
+}
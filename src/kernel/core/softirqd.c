@@ -0,0 +1,68 @@
+/*
+ * Vest-OS 软中断线程
+ * 中断出口一轮处理不完的软中断交给每CPU的ksoftirqd，作为普通线程参与调度，
+ * 持续的中断负载不会让下半部饿死其他线程
+ */
+
+#include <kernel.h>
+#include <sched.h>
+#include <klog.h>
+#include <kernel/softirq.h>
+#include <arch/percpu.h>
+
+static DEFINE_PER_CPU(struct thread *, ksoftirqd);
+
+/**
+ * 唤醒本CPU的ksoftirqd（中断出口关中断调用）
+ */
+static void ksoftirqd_wakeup(void)
+{
+    struct thread *thread = this_cpu_read(ksoftirqd);
+
+    if (thread) {
+        sched_wake(thread);
+    }
+}
+
+/**
+ * ksoftirqd主循环：处理待处理的软中断，没有则睡眠
+ */
+static void ksoftirqd_thread(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        while (softirq_pending()) {
+            do_softirq();
+            sched_preempt();
+        }
+        sched_block();
+    }
+}
+
+/**
+ * 初始化软中断并登记唤醒回调（BSP，scheduler_init调用）
+ */
+void ksoftirqd_init(void)
+{
+    softirq_init();
+    softirq_set_wakeup_hook(ksoftirqd_wakeup);
+}
+
+/**
+ * 为当前CPU创建绑定的ksoftirqd（sched_cpu_online调用）
+ */
+void ksoftirqd_start(uint32_t cpu)
+{
+    struct thread *thread = create_thread(NULL);
+    if (!thread) {
+        kernel_printk(KERN_ERR "softirq: CPU%d 无法创建ksoftirqd\n", cpu);
+        return;
+    }
+
+    memcpy(thread->name, "ksoftirqd", 10);
+    thread_set_affinity(thread, CPUMASK_CPU(cpu));
+
+    this_cpu_write(ksoftirqd, thread);
+    thread_start(thread, ksoftirqd_thread, NULL);
+}
@@ -0,0 +1,318 @@
+/*
+ * Vest-OS 系统调用分发
+ * int 0x80和SYSENTER两个入口建立相同的中断帧，在这里按调用号查表分发，
+ * 并按CPU统计每个调用的次数和耗时
+ */
+
+#include <kernel.h>
+#include <syscall.h>
+#include <uring.h>
+#include <futex.h>
+#include <exec.h>
+#include <mm.h>
+#include <sched.h>
+#include <klog.h>
+#include <ktime.h>
+#include <timer.h>
+#include <arch/cpu.h>
+#include <arch/percpu.h>
+#include <arch/interrupt.h>
+#include <hal/smp.h>
+#include <kernel/lockstat.h>
+#include <sys/kstat.h>
+
+// 系统调用处理函数：参数依次来自ebx、ecx、edx、esi、edi
+typedef int32_t (*syscall_fn_t)(uint32_t arg1, uint32_t arg2, uint32_t arg3,
+                                uint32_t arg4, uint32_t arg5);
+
+struct syscall_desc {
+    syscall_fn_t fn;
+    const char *name;
+};
+
+// 每CPU统计（在本CPU上返回的调用计入本CPU）
+static DEFINE_PER_CPU(uint32_t [NR_SYSCALLS], syscall_count);
+static DEFINE_PER_CPU(uint64_t [NR_SYSCALLS], syscall_cycles);
+
+/**
+ * SYS_SYSLOG：读取或清空内核日志
+ */
+static int32_t sys_syslog_entry(uint32_t type, uint32_t buf, uint32_t len,
+                                uint32_t arg4, uint32_t arg5)
+{
+    (void)arg4;
+    (void)arg5;
+
+    if (type != KLOG_ACTION_READ_ALL && type != KLOG_ACTION_READ_CLEAR) {
+        return sys_syslog((int)type, NULL, 0);
+    }
+    if (!buf || (int32_t)len <= 0) {
+        return ERROR_INVALID;
+    }
+
+    // 先检查用户缓冲区，读清空时不会在复制失败后丢掉日志
+    if (len > KLOG_RING_SIZE * KLOG_LINE_MAX) {
+        len = KLOG_RING_SIZE * KLOG_LINE_MAX;
+    }
+    if (!mm_access_ok(buf, len, 1)) {
+        return ERROR_INVALID;
+    }
+
+    char *kbuf = kmalloc(len);
+    if (!kbuf) {
+        return ERROR_NOMEM;
+    }
+
+    int32_t ret = sys_syslog((int)type, kbuf, (int)len);
+    if (ret > 0 && copy_to_user(buf, kbuf, (uint32_t)ret) != 0) {
+        ret = ERROR_INVALID;
+    }
+
+    kfree(kbuf);
+    return ret;
+}
+
+/**
+ * 中断统计表，每个已上线的CPU一列
+ */
+static int kstat_interrupts_show(char *buf, size_t size)
+{
+    return interrupt_show(buf, size, smp_num_online());
+}
+
+// SYS_KSTAT可读的统计表，没有clear的表不支持清零
+static const struct {
+    int (*show)(char *buf, size_t size);
+    void (*clear)(void);
+} kstat_tables[KSTAT_NR_TABLES] = {
+#ifdef CONFIG_LOCK_STAT
+    [KSTAT_LOCK] = { lockstat_show, lockstat_clear },
+#endif
+    [KSTAT_TICK] = { tick_stat_show, NULL },
+    [KSTAT_SYSCALLS] = { syscall_stat_show, NULL },
+    [KSTAT_INTERRUPTS] = { kstat_interrupts_show, NULL },
+    [KSTAT_SCHED] = { sched_stat_show, NULL },
+};
+
+// 单次输出的上限
+#define KSTAT_BUF_MAX   (16 * 1024)
+
+/**
+ * SYS_KSTAT：生成或清零一张内核统计表
+ * @return 写入的字节数
+ */
+static int32_t sys_kstat(uint32_t table, uint32_t op, uint32_t buf, uint32_t len,
+                         uint32_t arg5)
+{
+    (void)arg5;
+
+    if (table >= KSTAT_NR_TABLES) {
+        return ERROR_INVALID;
+    }
+    if (!kstat_tables[table].show) {
+        return ERROR_NOENT;
+    }
+
+    if (op == KSTAT_CLEAR) {
+        if (!kstat_tables[table].clear) {
+            return ERROR_INVALID;
+        }
+        kstat_tables[table].clear();
+        return 0;
+    }
+    if (op != KSTAT_READ || !buf || len == 0) {
+        return ERROR_INVALID;
+    }
+
+    if (len > KSTAT_BUF_MAX) {
+        len = KSTAT_BUF_MAX;
+    }
+
+    char *kbuf = kmalloc(len);
+    if (!kbuf) {
+        return ERROR_NOMEM;
+    }
+
+    int32_t ret = kstat_tables[table].show(kbuf, len);
+    if (ret > 0 && copy_to_user(buf, kbuf, (uint32_t)ret) != 0) {
+        ret = ERROR_INVALID;
+    }
+
+    kfree(kbuf);
+    return ret;
+}
+
+/**
+ * SYS_GETTID：当前线程ID（不做任何工作，用来测量系统调用本身的开销）
+ */
+static int32_t sys_gettid(uint32_t arg1, uint32_t arg2, uint32_t arg3,
+                          uint32_t arg4, uint32_t arg5)
+{
+    (void)arg1;
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    struct thread *self = current_thread();
+
+    return self ? (int32_t)self->tid : 0;
+}
+
+// 系统调用表，未实现的调用号为空
+static const struct syscall_desc syscall_table[NR_SYSCALLS] = {
+    [SYS_EXEC]   = { sys_exec,         "exec" },
+    [SYS_SYSLOG] = { sys_syslog_entry, "syslog" },
+    [SYS_GETTID] = { sys_gettid,       "gettid" },
+    [SYS_URING_SETUP] = { sys_uring_setup, "uring_setup" },
+    [SYS_URING_ENTER] = { sys_uring_enter, "uring_enter" },
+    [SYS_FUTEX] = { sys_futex, "futex" },
+    [SYS_KSTAT] = { sys_kstat, "kstat" },
+};
+
+/**
+ * 按调用号分发系统调用
+ */
+int32_t syscall_handler(uint32_t syscall_number, uint32_t arg1, uint32_t arg2,
+                        uint32_t arg3, uint32_t arg4, uint32_t arg5)
+{
+    if (syscall_number >= NR_SYSCALLS || !syscall_table[syscall_number].fn) {
+        return ERROR_INVALID;
+    }
+
+    uint64_t start = rdtsc();
+    int32_t ret = syscall_table[syscall_number].fn(arg1, arg2, arg3, arg4, arg5);
+    uint64_t cycles = rdtsc() - start;
+
+    // 调用期间可能被抢占或迁移，更新统计时关中断固定在当前CPU
+    uint32_t flags = interrupt_save_and_disable();
+    this_cpu_inc(syscall_count[syscall_number]);
+    *this_cpu_ptr(&syscall_cycles[syscall_number]) += cycles;
+    interrupt_restore(flags);
+
+    return ret;
+}
+
+/**
+ * 系统调用入口（开中断）：参数取自用户寄存器，返回值写回eax
+ */
+void syscall_entry(interrupt_frame_t *frame)
+{
+    frame->eax = (uint32_t)syscall_handler(frame->eax, frame->ebx, frame->ecx,
+                                           frame->edx, frame->esi, frame->edi);
+}
+
+/**
+ * SYSENTER入口：frame->user_esp中是用户的ebp，从它指向的用户栈取返回地址
+ */
+void sysenter_dispatch(interrupt_frame_t *frame)
+{
+    uint32_t user_stack = frame->user_esp;
+    uint32_t ret_addr;
+
+    if (user_stack & 3 || copy_from_user(&ret_addr, user_stack, sizeof(ret_addr)) != 0) {
+        // 没有返回地址可以回到用户态：这是调用线程自己的错误，只结束该线程
+        struct thread *self = current_thread();
+        kernel_printk(KERN_ERR "SYSENTER: 线程%u的用户栈0x%x无效，结束线程\n",
+                      self ? self->tid : 0, user_stack);
+        thread_exit();
+    }
+
+    frame->eip = ret_addr;
+    frame->user_esp = user_stack + sizeof(uint32_t);
+
+    syscall_entry(frame);
+}
+
+/**
+ * 所有CPU上的调用次数和耗时之和
+ */
+void syscall_get_stat(uint32_t nr, uint64_t *count, uint64_t *cycles)
+{
+    *count = 0;
+    *cycles = 0;
+
+    if (nr >= NR_SYSCALLS) {
+        return;
+    }
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        *count += per_cpu(syscall_count, cpu)[nr];
+        *cycles += per_cpu(syscall_cycles, cpu)[nr];
+    }
+}
+
+// 统计表输出位置
+struct syscall_out {
+    char *buf;
+    size_t size;
+    size_t len;
+};
+
+static void syscall_put(struct syscall_out *out, const char *s)
+{
+    while (*s && out->len + 1 < out->size) {
+        out->buf[out->len++] = *s++;
+    }
+}
+
+/**
+ * 追加64位无符号整数，右对齐到width列
+ */
+static void syscall_put_u64(struct syscall_out *out, uint64_t value, uint32_t width)
+{
+    char field[24];
+    int pos = sizeof(field) - 1;
+
+    field[pos] = '\0';
+    do {
+        uint32_t digit;
+        value = div_u64_rem(value, 10, &digit);
+        field[--pos] = (char)('0' + digit);
+    } while (value);
+
+    while ((uint32_t)(sizeof(field) - 1 - pos) < width && pos > 0) {
+        field[--pos] = ' ';
+    }
+
+    syscall_put(out, &field[pos]);
+}
+
+/**
+ * 生成syscalls表（SYS_KSTAT的KSTAT_SYSCALLS）：每个已实现调用的次数、总周期数和平均周期数
+ */
+int syscall_stat_show(char *buf, size_t size)
+{
+    struct syscall_out out = { buf, size, 0 };
+
+    if (!buf || size == 0) {
+        return 0;
+    }
+
+    syscall_put(&out, " nr  name              calls        cycles  cycles/call\n");
+
+    for (uint32_t nr = 0; nr < NR_SYSCALLS; nr++) {
+        const struct syscall_desc *desc = &syscall_table[nr];
+        uint64_t count, cycles;
+
+        if (!desc->fn) {
+            continue;
+        }
+
+        syscall_get_stat(nr, &count, &cycles);
+
+        syscall_put_u64(&out, nr, 3);
+        syscall_put(&out, "  ");
+        syscall_put(&out, desc->name);
+        for (size_t pad = strlen(desc->name); pad < 12; pad++) {
+            syscall_put(&out, " ");
+        }
+        syscall_put_u64(&out, count, 11);
+        syscall_put_u64(&out, cycles, 14);
+        syscall_put_u64(&out, count ? div_u64_rem(cycles, (uint32_t)count, NULL) : 0, 13);
+        syscall_put(&out, "\n");
+    }
+
+    out.buf[out.len] = '\0';
+    return (int)out.len;
+}
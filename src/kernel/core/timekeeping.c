@@ -0,0 +1,298 @@
+/*
+ * Vest-OS 时间维护
+ * 单调时钟和实时时钟：不变TSC时钟源（退回到时钟节拍），开机时从CMOS RTC取实时时间
+ */
+
+#include <kernel.h>
+#include <ktime.h>
+#include <vdso.h>
+#include <timer.h>
+#include <klog.h>
+#include <hal/cpu.h>
+#include <hal/tsc.h>
+#include <kernel/spinlock.h>
+#include <arch/interrupt.h>
+
+// TSC换算的移位：mult约为2^22*1000000/kHz，1GHz以上TSC的误差在1ppm以内
+#define TSC_SHIFT           22
+
+// CMOS RTC端口和寄存器
+#define CMOS_ADDRESS        0x70
+#define CMOS_DATA           0x71
+#define RTC_SECONDS         0x00
+#define RTC_MINUTES         0x02
+#define RTC_HOURS           0x04
+#define RTC_DAY             0x07
+#define RTC_MONTH           0x08
+#define RTC_YEAR            0x09
+#define RTC_STATUS_A        0x0A
+#define RTC_STATUS_B        0x0B
+
+#define RTC_UPDATE_IN_PROGRESS  0x80    // 状态A：正在更新
+#define RTC_24HOUR              0x02    // 状态B：24小时制
+#define RTC_BINARY              0x04    // 状态B：二进制（否则BCD）
+
+static uint64_t jiffies_read(void)
+{
+    return jiffies;
+}
+
+static uint64_t tsc_read(void)
+{
+    return rdtsc();
+}
+
+// 时钟节拍：精度为一个节拍
+static const struct clocksource clocksource_jiffies = {
+    .name = "jiffies",
+    .read = jiffies_read,
+    .mult = NSEC_PER_SEC / HZ,
+    .shift = 0,
+    .vclock_mode = VCLOCK_JIFFIES,
+};
+
+// 不变TSC，mult在校准后确定
+static struct clocksource clocksource_tsc = {
+    .name = "tsc",
+    .read = tsc_read,
+    .mult = 0,
+    .shift = TSC_SHIFT,
+    .vclock_mode = VCLOCK_TSC,
+};
+
+// 时间维护状态
+static struct timekeeper tk = {
+    .clock = &clocksource_jiffies,
+};
+
+static DEFINE_SEQLOCK(tk_lock);
+
+/**
+ * 把上次累加以来的周期数计入基准时间（持有写锁）
+ */
+static void timekeeping_forward(void)
+{
+    const struct clocksource *clock = tk.clock;
+    uint64_t now = clock->read();
+    uint64_t delta = now - tk.cycle_last;
+
+    // 其他CPU的TSC可能略慢，不让时间倒退
+    if ((int64_t)delta < 0) {
+        return;
+    }
+
+    uint64_t scaled = delta * clock->mult + tk.base_frac;
+
+    tk.base_ns += scaled >> clock->shift;
+    tk.base_frac = scaled & ((1ull << clock->shift) - 1);
+    tk.cycle_last = now;
+}
+
+/**
+ * 读取单调时间（纳秒）
+ */
+uint64_t ktime_get_ns(void)
+{
+    uint32_t seq;
+    uint64_t ns;
+
+    do {
+        seq = seqlock_read_begin(&tk_lock);
+
+        const struct clocksource *clock = tk.clock;
+        uint64_t delta = clock->read() - tk.cycle_last;
+        if ((int64_t)delta < 0) {
+            delta = 0;
+        }
+
+        ns = tk.base_ns + ((delta * clock->mult + tk.base_frac) >> clock->shift);
+    } while (seqlock_read_retry(&tk_lock, seq));
+
+    return ns;
+}
+
+/**
+ * 读取实时时间（1970年以来的纳秒）
+ */
+uint64_t ktime_get_real_ns(void)
+{
+    uint32_t seq;
+    uint64_t offset;
+
+    do {
+        seq = seqlock_read_begin(&tk_lock);
+        offset = tk.real_offset;
+    } while (seqlock_read_retry(&tk_lock, seq));
+
+    return ktime_get_ns() + offset;
+}
+
+/**
+ * 按时钟类型读取秒和纳秒
+ */
+int ktime_get_ts(uint32_t clock, struct ktimespec *ts)
+{
+    uint64_t ns;
+
+    if (!ts) {
+        return ERROR_INVALID;
+    }
+
+    if (clock == CLOCK_MONOTONIC) {
+        ns = ktime_get_ns();
+    } else if (clock == CLOCK_REALTIME) {
+        ns = ktime_get_real_ns();
+    } else {
+        return ERROR_INVALID;
+    }
+
+    ts->tv_sec = (uint32_t)div_u64_rem(ns, NSEC_PER_SEC, &ts->tv_nsec);
+    return ERROR_NONE;
+}
+
+/**
+ * 设置实时时间（单调时钟不受影响）
+ */
+void ktime_set_real_ns(uint64_t ns)
+{
+    uint32_t flags = seqlock_write_lock_irqsave(&tk_lock);
+
+    timekeeping_forward();
+    tk.real_offset = ns - tk.base_ns;
+    vdso_update_time(&tk);
+
+    seqlock_write_unlock_irqrestore(&tk_lock, flags);
+}
+
+/**
+ * 当前时钟源
+ */
+const struct clocksource *clocksource_current(void)
+{
+    return tk.clock;
+}
+
+/**
+ * 时钟节拍（时间维护CPU，中断已关闭）：累加周期数，保证读者的乘法不溢出
+ */
+void timekeeping_tick(void)
+{
+    seqlock_write_lock(&tk_lock);
+    timekeeping_forward();
+    vdso_update_time(&tk);
+    seqlock_write_unlock(&tk_lock);
+}
+
+/**
+ * 切换时钟源，已经过的时间按旧时钟源结算
+ */
+static void timekeeping_change_clocksource(const struct clocksource *clock)
+{
+    uint32_t flags = seqlock_write_lock_irqsave(&tk_lock);
+
+    timekeeping_forward();
+    tk.clock = clock;
+    tk.cycle_last = clock->read();
+    tk.base_frac = 0;
+    vdso_update_time(&tk);
+
+    seqlock_write_unlock_irqrestore(&tk_lock, flags);
+}
+
+static uint8_t cmos_read(uint8_t reg)
+{
+    outb(CMOS_ADDRESS, reg);
+    return inb(CMOS_DATA);
+}
+
+static uint32_t bcd_to_bin(uint8_t value)
+{
+    return (value & 0x0F) + (value >> 4) * 10;
+}
+
+/**
+ * 公历日期到1970-01-01的天数
+ */
+static uint32_t days_since_epoch(uint32_t year, uint32_t month, uint32_t day)
+{
+    // 从三月开始计年，闰日落在年末
+    if (month <= 2) {
+        year--;
+        month += 12;
+    }
+
+    uint32_t era = year / 400;
+    uint32_t yoe = year - era * 400;
+    uint32_t doy = (153 * (month - 3) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + doe - 719468;
+}
+
+/**
+ * 读取CMOS RTC（1970年以来的秒数）
+ */
+static uint32_t rtc_read_seconds(void)
+{
+    uint8_t sec, min, hour, day, mon, year;
+
+    // 避开更新周期，连续两次读到相同的值才采用
+    do {
+        while (cmos_read(RTC_STATUS_A) & RTC_UPDATE_IN_PROGRESS) {
+            cpu_relax();
+        }
+
+        sec = cmos_read(RTC_SECONDS);
+        min = cmos_read(RTC_MINUTES);
+        hour = cmos_read(RTC_HOURS);
+        day = cmos_read(RTC_DAY);
+        mon = cmos_read(RTC_MONTH);
+        year = cmos_read(RTC_YEAR);
+    } while (sec != cmos_read(RTC_SECONDS) || min != cmos_read(RTC_MINUTES));
+
+    uint8_t status = cmos_read(RTC_STATUS_B);
+    bool pm = (hour & 0x80) != 0;
+    hour &= 0x7F;
+
+    uint32_t s = sec, m = min, h = hour, d = day, mo = mon, y = year;
+    if (!(status & RTC_BINARY)) {
+        s = bcd_to_bin(sec);
+        m = bcd_to_bin(min);
+        h = bcd_to_bin(hour);
+        d = bcd_to_bin(day);
+        mo = bcd_to_bin(mon);
+        y = bcd_to_bin(year);
+    }
+
+    // 12小时制：12点是0点，下午加12
+    if (!(status & RTC_24HOUR)) {
+        h %= 12;
+        if (pm) {
+            h += 12;
+        }
+    }
+
+    // 没有读世纪寄存器，两位年份按2000年之后处理
+    y += 2000;
+
+    return days_since_epoch(y, mo, d) * 86400 + h * 3600 + m * 60 + s;
+}
+
+/**
+ * 初始化时间维护（BSP，timer_init中调用）：校准TSC并读取RTC
+ */
+void timekeeping_init(void)
+{
+    if (tsc_init()) {
+        uint64_t mult = div_u64_rem((uint64_t)NSEC_PER_MSEC << TSC_SHIFT, tsc_get_khz(), NULL);
+
+        if (mult > 0 && mult <= 0xFFFFFFFFu) {
+            clocksource_tsc.mult = (uint32_t)mult;
+            timekeeping_change_clocksource(&clocksource_tsc);
+        }
+    }
+
+    ktime_set_real_ns((uint64_t)rtc_read_seconds() * NSEC_PER_SEC);
+
+    kernel_printk(KERN_INFO "时间维护: 时钟源 %s\n", tk.clock->name);
+}
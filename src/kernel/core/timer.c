@@ -0,0 +1,384 @@
+/*
+ * Vest-OS 系统时钟
+ * 周期时钟节拍（PIT通道0，有LAPIC时改用各CPU的LAPIC定时器）驱动jiffies和调度器。
+ * 动态时钟：CPU空闲时按下一个到期事件编程单次LAPIC定时并停掉节拍，
+ * 被唤醒后（中断出口）恢复周期节拍并补算跳过的节拍数。
+ * 推进jiffies的同时推进内核定时器的时间轮。
+ */
+
+#include <kernel.h>
+#include <timer.h>
+#include <ktime.h>
+#include <sched.h>
+#include <hal/cpu.h>
+#include <klog.h>
+#include <arch/interrupt.h>
+#include <kernel/rcu.h>
+#include <kernel/spinlock.h>
+#include <hal/apic.h>
+#include <hal/smp.h>
+
+// PIT端口
+#define PIT_CHANNEL0    0x40
+#define PIT_COMMAND     0x43
+
+// PIT通道2（门控和输出状态在端口0x61）
+#define PIT_CHANNEL2    0x42
+#define PIT_GATE_PORT   0x61
+
+volatile uint64_t jiffies = 0;
+
+// 负责推进jiffies的CPU
+#define TIMEKEEPING_CPU     0
+
+// 每CPU动态时钟状态
+struct tick_sched {
+    uint32_t idle;                  // 在空闲循环中（已登记到nohz_idle_mask）
+    uint32_t tick_stopped;          // 周期节拍已停，单次定时等待唤醒
+    uint32_t sleep_count;           // 单次定时的LAPIC初始计数
+    uint32_t tick_frac;             // 补算时不足一个节拍的LAPIC计数
+    struct tick_stat stat;
+};
+
+static DEFINE_PER_CPU(struct tick_sched, tick_sched);
+
+// 各CPU都用LAPIC定时器产生节拍时才能停掉节拍
+static bool tick_nohz_enabled;
+static uint32_t tick_period;            // 每个节拍的LAPIC计数
+
+// 在空闲循环中的CPU
+static volatile uint32_t nohz_idle_mask;
+
+// 时间维护CPU停掉了节拍，其他CPU开始工作时需要叫醒它
+static volatile uint32_t nohz_timekeeper_stopped;
+
+// 上次输出统计时的快照（计算每秒唤醒次数）
+static uint64_t tick_stat_last_jiffies;
+static uint32_t tick_stat_last_wakeups[NR_CPUS];
+static DEFINE_SPINLOCK(tick_stat_lock);     // 保护快照，并发读取者各自的间隔不重叠
+
+/**
+ * 初始化PIT为HZ频率的周期模式并打开IRQ0（投递到BSP）
+ */
+void timer_init(void)
+{
+    uint32_t divisor = PIT_FREQUENCY / HZ;
+
+    // 通道0，先低后高字节，模式3（方波）
+    outb(PIT_COMMAND, 0x36);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, (divisor >> 8) & 0xFF);
+
+    // 内核定时器由jiffies推进
+    timer_wheel_init(jiffies);
+
+    // 登记处理函数并取消IRQ0屏蔽
+    interrupt_register(IRQ_TIMER, timer_interrupt, NULL, "timer");
+    interrupt_enable(IRQ_TIMER);
+
+    kernel_printk(KERN_INFO "时钟: PIT %d Hz\n", HZ);
+
+    // 用PIT校准TSC，选定时钟源
+    timekeeping_init();
+}
+
+/**
+ * 时钟节拍（PIT或LAPIC定时器中断，中断已关闭）
+ */
+void timer_tick(void)
+{
+    struct tick_sched *ts = this_cpu_ptr(&tick_sched);
+
+    ts->stat.timer_irqs++;
+
+    // 停掉节拍期间的单次定时到期：节拍在中断出口补算
+    if (ts->tick_stopped) {
+        return;
+    }
+
+    if (sched_this_cpu() == TIMEKEEPING_CPU) {
+        jiffies++;
+        timekeeping_tick();
+        timer_wheel_update(jiffies);
+    }
+
+    scheduler_tick();
+}
+
+/**
+ * PIT时钟中断处理（EOI由分发代码发送，时间片用完在中断返回前切换）
+ */
+void timer_interrupt(interrupt_frame_t *frame, void *data)
+{
+    (void)data;
+
+    // 打断的是用户态：不可能在RCU读临界区内
+    if (frame->cs & 3) {
+        rcu_user_tick();
+    }
+    timer_tick();
+}
+
+/**
+ * BSP改用LAPIC定时器产生节拍并启用动态时钟（smp_init校准LAPIC定时器后调用）
+ * PIT通道0停用，通道2仍用于timer_udelay
+ */
+void timer_use_lapic(void)
+{
+    tick_period = lapic_timer_period(HZ);
+    if (!tick_period) {
+        return;
+    }
+
+    interrupt_disable(IRQ_TIMER);
+    lapic_timer_start(HZ);
+    tick_nohz_enabled = true;
+
+    kernel_printk(KERN_INFO "时钟: LAPIC定时器 %d Hz，空闲时停止节拍\n", HZ);
+}
+
+/**
+ * 本CPU空闲时可以睡眠的节拍数（0或1表示保持周期节拍）
+ */
+static uint32_t tick_nohz_sleep_ticks(uint32_t cpu)
+{
+    uint32_t ticks = NOHZ_MAX_SLEEP_TICKS;
+
+    if (cpu == TIMEKEEPING_CPU) {
+        uint32_t nr_online = smp_num_online();
+        uint32_t online = nr_online >= 32 ? 0xFFFFFFFFu : (1u << nr_online) - 1;
+
+        // 先公布再检查，与tick_nohz_idle_exit中的先清除再检查配对
+        __sync_lock_test_and_set(&nohz_timekeeper_stopped, 1);
+
+        // 其他CPU在运行时继续为它们推进jiffies
+        if ((nohz_idle_mask & online) != online) {
+            nohz_timekeeper_stopped = 0;
+            return 0;
+        }
+
+        // 定时器队列中最早的到期时间
+        uint64_t expires;
+        if (timer_wheel_next_expiry(&expires)) {
+            uint64_t now = jiffies;
+            if (expires <= now + 1) {
+                nohz_timekeeper_stopped = 0;
+                return 0;
+            }
+            if (expires - now < ticks) {
+                ticks = (uint32_t)(expires - now);
+            }
+        }
+    }
+
+    // 32位计数器能表示的最长时间
+    if (ticks > 0xFFFFFFFFu / tick_period) {
+        ticks = 0xFFFFFFFFu / tick_period;
+    }
+
+    return ticks;
+}
+
+/**
+ * 进入空闲（关中断，停机之前调用）：没有近期事件则停掉周期节拍
+ */
+void tick_nohz_idle_enter(void)
+{
+    struct tick_sched *ts = this_cpu_ptr(&tick_sched);
+    uint32_t cpu = sched_this_cpu();
+
+    ts->idle = 1;
+    if (!tick_nohz_enabled) {
+        return;
+    }
+
+    __sync_fetch_and_or(&nohz_idle_mask, CPUMASK_CPU(cpu));
+
+    uint32_t ticks = tick_nohz_sleep_ticks(cpu);
+    if (ticks <= 1) {
+        return;
+    }
+
+    ts->sleep_count = ticks * tick_period;
+    ts->tick_stopped = 1;
+    ts->stat.tick_stops++;
+
+    lapic_timer_oneshot(ts->sleep_count);
+}
+
+/**
+ * 离开空闲（关中断，中断出口和空闲循环调用）：恢复周期节拍并补算jiffies
+ */
+void tick_nohz_idle_exit(void)
+{
+    struct tick_sched *ts = this_cpu_ptr(&tick_sched);
+    uint32_t cpu = sched_this_cpu();
+
+    if (!ts->idle) {
+        return;
+    }
+
+    ts->idle = 0;
+    ts->stat.idle_wakeups++;
+
+    if (!tick_nohz_enabled) {
+        return;
+    }
+
+    // 原子操作同时是完整屏障，之后读取nohz_timekeeper_stopped
+    __sync_fetch_and_and(&nohz_idle_mask, ~CPUMASK_CPU(cpu));
+
+    if (!ts->tick_stopped) {
+        return;
+    }
+
+    uint32_t remaining = lapic_timer_remaining();
+    lapic_timer_start(HZ);
+    ts->tick_stopped = 0;
+
+    // 按LAPIC计数补算睡眠期间的节拍，不足一个节拍的部分留到下次
+    uint32_t elapsed = ts->sleep_count - remaining;
+    uint32_t ticks = elapsed / tick_period;
+
+    ts->tick_frac += elapsed % tick_period;
+    if (ts->tick_frac >= tick_period) {
+        ts->tick_frac -= tick_period;
+        ticks++;
+    }
+    ts->stat.skipped_ticks += ticks;
+
+    if (cpu == TIMEKEEPING_CPU) {
+        nohz_timekeeper_stopped = 0;
+        jiffies += ticks;
+        timekeeping_tick();
+        timer_wheel_update(jiffies);
+    } else if (remaining && nohz_timekeeper_stopped) {
+        // 不是自己的定时到期，可能有工作要做：让时间维护CPU恢复节拍
+        smp_send_reschedule(TIMEKEEPING_CPU);
+    }
+}
+
+/**
+ * 读取某个CPU的时钟统计
+ */
+void tick_get_stat(uint32_t cpu, struct tick_stat *stat)
+{
+    if (cpu >= NR_CPUS || !stat) {
+        return;
+    }
+    *stat = per_cpu_ptr(&tick_sched, cpu)->stat;
+}
+
+// 统计表输出位置
+struct tick_out {
+    char *buf;
+    size_t size;
+    size_t len;
+};
+
+static void tick_put(struct tick_out *out, const char *s)
+{
+    while (*s && out->len + 1 < out->size) {
+        out->buf[out->len++] = *s++;
+    }
+}
+
+static void tick_put_u32(struct tick_out *out, uint32_t value, uint32_t width)
+{
+    char field[12];
+    int pos = sizeof(field) - 1;
+
+    field[pos] = '\0';
+    do {
+        field[--pos] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    while ((uint32_t)(sizeof(field) - 1 - pos) < width && pos > 0) {
+        field[--pos] = ' ';
+    }
+
+    tick_put(out, &field[pos]);
+}
+
+/**
+ * 生成tick_stat表（SYS_KSTAT的KSTAT_TICK）：每CPU每秒唤醒次数（自上次读取）、时钟中断数、
+ * 空闲唤醒数、停掉节拍的次数和跳过的节拍数
+ */
+int tick_stat_show(char *buf, size_t size)
+{
+    struct tick_out out = { buf, size, 0 };
+
+    if (!buf || size == 0) {
+        return 0;
+    }
+
+    spinlock_lock(&tick_stat_lock);
+
+    uint64_t now = jiffies;
+    uint32_t elapsed = (uint32_t)(now - tick_stat_last_jiffies);
+    uint32_t ncpus = smp_num_online();
+
+    tick_put(&out, tick_nohz_enabled ? "nohz: on\n" : "nohz: off (periodic)\n");
+    tick_put(&out, "CPU  wakeups/s  timer-irqs  idle-wakeups  tick-stops  skipped-ticks\n");
+
+    for (uint32_t cpu = 0; cpu < ncpus && cpu < NR_CPUS; cpu++) {
+        struct tick_stat stat;
+        tick_get_stat(cpu, &stat);
+
+        uint32_t delta = stat.idle_wakeups - tick_stat_last_wakeups[cpu];
+        tick_stat_last_wakeups[cpu] = stat.idle_wakeups;
+
+        tick_put_u32(&out, cpu, 3);
+        tick_put_u32(&out, elapsed ? delta * HZ / elapsed : 0, 11);
+        tick_put_u32(&out, stat.timer_irqs, 12);
+        tick_put_u32(&out, stat.idle_wakeups, 14);
+        tick_put_u32(&out, stat.tick_stops, 12);
+        tick_put_u32(&out, stat.skipped_ticks, 15);
+        tick_put(&out, "\n");
+    }
+
+    tick_stat_last_jiffies = now;
+
+    spinlock_unlock(&tick_stat_lock);
+
+    out.buf[out.len] = '\0';
+    return (int)out.len;
+}
+
+/**
+ * 忙等指定微秒（PIT通道2单次计数，不依赖时钟中断，可在关中断时使用）
+ */
+void timer_udelay(uint32_t us)
+{
+    while (us) {
+        // 16位计数器一次最多约54ms
+        uint32_t chunk = us > 50000 ? 50000 : us;
+        uint32_t count = chunk * (PIT_FREQUENCY / 1000) / 1000;
+        if (count == 0) {
+            count = 1;
+        }
+
+        // 打开通道2门控，关闭扬声器
+        outb(PIT_GATE_PORT, (inb(PIT_GATE_PORT) & ~0x02) | 0x01);
+
+        // 通道2，先低后高字节，模式0（计数结束时输出变高）
+        outb(PIT_COMMAND, 0xB0);
+        outb(PIT_CHANNEL2, count & 0xFF);
+        outb(PIT_CHANNEL2, (count >> 8) & 0xFF);
+
+        while (!(inb(PIT_GATE_PORT) & 0x20)) {
+            asm volatile ("pause");
+        }
+
+        us -= chunk;
+    }
+}
+
+/**
+ * 调度器计时（纳秒，单调时钟；没有不变TSC时精度为一个时钟节拍）
+ */
+uint64_t sched_clock(void)
+{
+    return ktime_get_ns();
+}
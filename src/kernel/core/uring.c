@@ -0,0 +1,507 @@
+/*
+ * Vest-OS 提交/完成环
+ * 一次进入内核执行整批系统调用，轮询模式下由内核线程执行，用户态不进入内核
+ */
+
+#include <kernel.h>
+#include <uring.h>
+#include <mm.h>
+#include <syscall.h>
+#include <sched.h>
+#include <klog.h>
+#include <arch/cpu.h>
+#include <kernel/spinlock.h>
+#include <kernel/timer_wheel.h>
+#include <kernel/wait.h>
+
+// 轮询线程空闲时间的默认值和上限（毫秒）
+#define URING_IDLE_DEFAULT_MS   10
+#define URING_IDLE_MAX_MS       1000
+
+// 环的内核状态
+struct uring_ctx {
+    uint32_t in_use;                    // 槽已被占用（建立中或已建立）
+    uint32_t ready;                     // 建立完成，可以进入
+    uint32_t releasing;                 // 正在释放，不再接受新的进入
+    volatile uint32_t users;            // 正在SYS_URING_ENTER中使用环的线程数
+    uint32_t flags;                     // URING_SETUP_*
+    struct page_directory *page_dir;    // 建立者的地址空间
+    struct process *process;            // 建立者所属进程，exec时据此释放
+    uring_ring_t *ring;                 // 映射区的内核地址
+    uring_sqe_t *sqes;
+    uring_cqe_t *cqes;
+    uint32_t user_addr;                 // 映射区的用户地址
+    uint32_t size;                      // 映射区大小（整页）
+    volatile uint32_t submitting;       // 有人正在消费提交环
+
+    // 链状态：一批提交可能在链中间结束，跨批保留
+    uint32_t link_active;
+    uint32_t link_failed;
+    int32_t link_res;
+
+    // 轮询模式
+    struct thread *poller;
+    uint32_t idle_ticks;
+    volatile uint32_t stop;
+    volatile uint32_t poller_exited;
+
+    wait_queue_head_t cq_wait;          // 等待完成的线程，以及等待users归零的释放者
+};
+
+static struct uring_ctx uring_ctxs[URING_MAX_RINGS];
+static DEFINE_SPINLOCK(uring_lock);
+
+/**
+ * 向上取2的幂
+ */
+static uint32_t roundup_pow_of_two(uint32_t n)
+{
+    uint32_t v = 1;
+
+    while (v < n) {
+        v <<= 1;
+    }
+    return v;
+}
+
+/**
+ * 写一个CQE，完成环满时丢弃并计数
+ */
+static void uring_post_cqe(struct uring_ctx *ctx, uint64_t user_data, int32_t res)
+{
+    uring_ring_t *ring = ctx->ring;
+    uint32_t tail = ring->cq_tail;
+
+    if (tail - ring->cq_head >= ring->cq_entries) {
+        ring->cq_overflow++;
+        return;
+    }
+
+    uring_cqe_t *cqe = &ctx->cqes[tail & (ring->cq_entries - 1)];
+    cqe->user_data = user_data;
+    cqe->res = res;
+    cqe->flags = 0;
+
+    // CQE内容先于tail对用户态可见
+    barrier();
+    ring->cq_tail = tail + 1;
+
+    wake_up(&ctx->cq_wait);
+}
+
+/**
+ * 把一个SQE转换成系统调用执行
+ */
+static int32_t uring_issue(struct uring_ctx *ctx, const uring_sqe_t *sqe)
+{
+    uint32_t fd = (uint32_t)sqe->fd;
+    uint32_t len = sqe->len;
+
+    if (sqe->flags & (URING_SQE_FD_PREV | URING_SQE_LEN_PREV)) {
+        if (!ctx->link_active) {
+            return ERROR_INVALID;
+        }
+        if (sqe->flags & URING_SQE_FD_PREV) {
+            fd = (uint32_t)ctx->link_res;
+        }
+        if (sqe->flags & URING_SQE_LEN_PREV) {
+            len = (uint32_t)ctx->link_res;
+        }
+    }
+
+    switch (sqe->opcode) {
+        case URING_OP_NOP:
+            return 0;
+        case URING_OP_READ:
+            return syscall_handler(SYS_READ, fd, sqe->addr, len, 0, 0);
+        case URING_OP_WRITE:
+            return syscall_handler(SYS_WRITE, fd, sqe->addr, len, 0, 0);
+        case URING_OP_OPEN:
+            return syscall_handler(SYS_OPEN, sqe->addr, sqe->op_flags, len, 0, 0);
+        case URING_OP_CLOSE:
+            return syscall_handler(SYS_CLOSE, fd, 0, 0, 0, 0);
+        case URING_OP_STAT:
+            return syscall_handler(SYS_STAT, sqe->addr, sqe->addr2, 0, 0, 0);
+        default:
+            return ERROR_INVALID;
+    }
+}
+
+/**
+ * 执行提交环中最多max个请求（调用者已取得submitting，处在建立者的地址空间）
+ * @return 执行的请求数
+ */
+static uint32_t uring_submit(struct uring_ctx *ctx, uint32_t max)
+{
+    uring_ring_t *ring = ctx->ring;
+    uint32_t head = ring->sq_head;
+    uint32_t tail = ring->sq_tail;
+    uint32_t count = 0;
+
+    // 用户态写坏的tail最多按一整圈处理
+    if (tail - head > ring->sq_entries) {
+        tail = head + ring->sq_entries;
+    }
+
+    // 读到tail之后再读SQE
+    barrier();
+
+    while (head != tail && count < max) {
+        // 用户态可能同时改写SQE，先复制一份
+        uring_sqe_t sqe = ctx->sqes[head & (ring->sq_entries - 1)];
+        int32_t res;
+
+        head++;
+        count++;
+
+        if (ctx->link_failed) {
+            res = ERROR_CANCELED;
+        } else {
+            res = uring_issue(ctx, &sqe);
+        }
+
+        uring_post_cqe(ctx, sqe.user_data, res);
+
+        if (sqe.flags & URING_SQE_LINK) {
+            ctx->link_active = 1;
+            ctx->link_res = res;
+            if (res < 0) {
+                ctx->link_failed = 1;
+            }
+        } else {
+            ctx->link_active = 0;
+            ctx->link_failed = 0;
+        }
+
+        // 让用户态尽早复用已经消费的SQE
+        ring->sq_head = head;
+    }
+
+    return count;
+}
+
+/**
+ * 提交环中是否有未消费的请求
+ */
+static inline bool uring_sq_pending(const struct uring_ctx *ctx)
+{
+    return ctx->ring->sq_tail != ctx->ring->sq_head;
+}
+
+/**
+ * 轮询线程：持续消费提交环，空闲sq_thread_idle后睡眠等待SYS_URING_ENTER唤醒
+ */
+static void uring_sq_thread(void *arg)
+{
+    struct uring_ctx *ctx = arg;
+    uring_ring_t *ring = ctx->ring;
+    uint64_t idle_until = timer_get_jiffies() + ctx->idle_ticks;
+
+    while (!ctx->stop) {
+        if (uring_submit(ctx, ring->sq_entries)) {
+            idle_until = timer_get_jiffies() + ctx->idle_ticks;
+            continue;
+        }
+
+        if (timer_get_jiffies() < idle_until) {
+            sched_yield();
+            continue;
+        }
+
+        // 先置标志再检查一次：用户态写tail后读标志，两边至少有一方看到对方
+        __sync_fetch_and_or(&ring->sq_flags, URING_SQ_NEED_WAKEUP);
+        __sync_synchronize();
+
+        if (!uring_sq_pending(ctx) && !ctx->stop) {
+            sched_block();
+        }
+
+        __sync_fetch_and_and(&ring->sq_flags, ~URING_SQ_NEED_WAKEUP);
+        idle_until = timer_get_jiffies() + ctx->idle_ticks;
+    }
+
+    ctx->poller_exited = 1;
+    thread_exit();
+}
+
+/**
+ * 启动轮询线程，运行在建立者的地址空间
+ */
+static int uring_start_poller(struct uring_ctx *ctx, uint32_t id)
+{
+    struct thread *thread = create_thread(NULL);
+    if (!thread) {
+        return ERROR_NOMEM;
+    }
+
+    // 线程名uring_sq<编号>
+    const char name[] = "uring_sq";
+    for (uint32_t i = 0; i < sizeof(name) - 1; i++) {
+        thread->name[i] = name[i];
+    }
+    thread->name[sizeof(name) - 1] = (char)('0' + id);
+
+    thread->page_dir = ctx->page_dir;
+    ctx->poller = thread;
+
+    return thread_start(thread, uring_sq_thread, ctx);
+}
+
+/**
+ * 取消映射并释放环（调用者处在建立者的地址空间，轮询线程已退出）
+ */
+static void uring_free(struct uring_ctx *ctx)
+{
+    for (uint32_t off = 0; off < ctx->size; off += PAGE_SIZE) {
+        unmap_page(ctx->page_dir, ctx->user_addr + off);
+    }
+
+    kfree(ctx->ring);
+
+    uint32_t flags = spinlock_lock_irqsave(&uring_lock);
+    memset(ctx, 0, sizeof(*ctx));
+    spinlock_unlock_irqrestore(&uring_lock, flags);
+}
+
+/**
+ * 取得环的使用权：已建立、属于调用者的地址空间且不在释放中，否则返回NULL
+ */
+static struct uring_ctx *uring_get(uint32_t id)
+{
+    struct uring_ctx *ctx = &uring_ctxs[id];
+
+    uint32_t flags = spinlock_lock_irqsave(&uring_lock);
+    if (!ctx->ready || ctx->releasing || ctx->page_dir != current_page_directory()) {
+        ctx = NULL;
+    } else {
+        ctx->users++;
+    }
+    spinlock_unlock_irqrestore(&uring_lock, flags);
+
+    return ctx;
+}
+
+/**
+ * 归还使用权；释放者在uring_lock下清空环，唤醒也在锁内完成
+ */
+static void uring_put(struct uring_ctx *ctx)
+{
+    uint32_t flags = spinlock_lock_irqsave(&uring_lock);
+    ctx->users--;
+    if (ctx->releasing) {
+        wake_up(&ctx->cq_wait);
+    }
+    spinlock_unlock_irqrestore(&uring_lock, flags);
+}
+
+/**
+ * 停止轮询线程并释放环
+ * @param own_refs 调用者自己持有的使用权（0或1）
+ */
+static int32_t uring_release(struct uring_ctx *ctx, uint32_t own_refs)
+{
+    uint32_t flags = spinlock_lock_irqsave(&uring_lock);
+    if (!ctx->ready || ctx->releasing) {
+        spinlock_unlock_irqrestore(&uring_lock, flags);
+        return ERROR_INVALID;           // 另一个线程已在释放
+    }
+    ctx->releasing = 1;
+    spinlock_unlock_irqrestore(&uring_lock, flags);
+
+    // 等待完成的线程看到releasing后返回，之后不会再有人进入
+    wake_up(&ctx->cq_wait);
+    wait_event(&ctx->cq_wait, ctx->users == own_refs);
+
+    if (ctx->poller) {
+        ctx->stop = 1;
+        sched_wake(ctx->poller);
+
+        while (!ctx->poller_exited) {
+            schedule_timeout(1);
+        }
+    }
+
+    // 轮询线程已退出、没有其他进入者，提交环不会再有人消费
+    while (__sync_lock_test_and_set(&ctx->submitting, 1)) {
+        cpu_relax();
+    }
+
+    uring_free(ctx);
+    return ERROR_NONE;
+}
+
+/**
+ * SYS_URING_SETUP：建立环并映射到调用者的地址空间，返回环编号
+ */
+int32_t sys_uring_setup(uint32_t params_addr, uint32_t arg2, uint32_t arg3,
+                        uint32_t arg4, uint32_t arg5)
+{
+    (void)arg2;
+    (void)arg3;
+    (void)arg4;
+    (void)arg5;
+
+    // 结果写回同一结构，建环之前确认它可写，建好之后不会再失败
+    uring_params_t params;
+    if (!mm_access_ok(params_addr, sizeof(params), 1) ||
+        copy_from_user(&params, params_addr, sizeof(params)) != 0) {
+        return ERROR_INVALID;
+    }
+
+    if (params.sq_entries == 0 || params.sq_entries > URING_MAX_ENTRIES ||
+        (params.flags & ~URING_SETUP_SQPOLL)) {
+        return ERROR_INVALID;
+    }
+
+    // 占一个槽
+    uint32_t flags = spinlock_lock_irqsave(&uring_lock);
+    uint32_t id;
+    for (id = 0; id < URING_MAX_RINGS; id++) {
+        if (!uring_ctxs[id].in_use) {
+            uring_ctxs[id].in_use = 1;
+            break;
+        }
+    }
+    spinlock_unlock_irqrestore(&uring_lock, flags);
+
+    if (id == URING_MAX_RINGS) {
+        return ERROR_BUSY;
+    }
+
+    struct uring_ctx *ctx = &uring_ctxs[id];
+    init_waitqueue_head(&ctx->cq_wait);
+
+    uint32_t sq_entries = roundup_pow_of_two(params.sq_entries);
+    uint32_t cq_entries = sq_entries * 2;
+    uint32_t sqes_off = (sizeof(uring_ring_t) + 63) & ~63u;
+    uint32_t cqes_off = sqes_off + sq_entries * sizeof(uring_sqe_t);
+    uint32_t size = (cqes_off + cq_entries * sizeof(uring_cqe_t) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    ctx->ring = kmalloc_aligned(size, PAGE_SIZE);
+    if (!ctx->ring) {
+        ctx->in_use = 0;
+        return ERROR_NOMEM;
+    }
+    memset(ctx->ring, 0, size);
+
+    ctx->flags = params.flags;
+    ctx->page_dir = current_page_directory();
+    ctx->process = current_thread()->process;
+    ctx->sqes = (uring_sqe_t *)((uint8_t *)ctx->ring + sqes_off);
+    ctx->cqes = (uring_cqe_t *)((uint8_t *)ctx->ring + cqes_off);
+    ctx->user_addr = URING_MAP_BASE + id * URING_MAP_SLOT;
+    ctx->size = size;
+
+    ctx->ring->sq_entries = sq_entries;
+    ctx->ring->cq_entries = cq_entries;
+    ctx->ring->sqes_off = sqes_off;
+    ctx->ring->cqes_off = cqes_off;
+
+    // 环是内核堆中的页，进程退出时不能交给页帧分配器
+    for (uint32_t off = 0; off < size; off += PAGE_SIZE) {
+        uint32_t phys = get_physical_address(ctx->page_dir, (uint32_t)ctx->ring + off);
+        map_page(ctx->page_dir, ctx->user_addr + off, phys, PAGE_USER | PAGE_WRITE | PAGE_NOFREE);
+    }
+
+    if (params.flags & URING_SETUP_SQPOLL) {
+        uint32_t idle_ms = params.sq_thread_idle ? params.sq_thread_idle : URING_IDLE_DEFAULT_MS;
+        if (idle_ms > URING_IDLE_MAX_MS) {
+            idle_ms = URING_IDLE_MAX_MS;
+        }
+        ctx->idle_ticks = msecs_to_jiffies(idle_ms);
+
+        int ret = uring_start_poller(ctx, id);
+        if (ret != ERROR_NONE) {
+            uring_free(ctx);
+            return ret;
+        }
+    }
+
+    params.sq_entries = sq_entries;
+    params.cq_entries = cq_entries;
+    params.ring_addr = ctx->user_addr;
+    params.ring_size = size;
+    copy_to_user(params_addr, &params, sizeof(params));
+
+    flags = spinlock_lock_irqsave(&uring_lock);
+    ctx->ready = 1;
+    spinlock_unlock_irqrestore(&uring_lock, flags);
+
+    return (int32_t)id;
+}
+
+/**
+ * exec拆除地址空间之前释放调用者建立的所有环：停止轮询线程，取消映射
+ */
+void uring_exec_release(void)
+{
+    struct page_directory *page_dir = current_page_directory();
+    struct process *process = current_thread()->process;
+
+    for (uint32_t id = 0; id < URING_MAX_RINGS; id++) {
+        struct uring_ctx *ctx = &uring_ctxs[id];
+
+        if (ctx->ready && ctx->page_dir == page_dir && ctx->process == process) {
+            uring_release(ctx, 0);
+        }
+    }
+}
+
+/**
+ * SYS_URING_ENTER：提交请求、唤醒轮询线程或等待完成
+ * @return 本次执行的请求数
+ */
+int32_t sys_uring_enter(uint32_t id, uint32_t to_submit, uint32_t min_complete,
+                        uint32_t flags, uint32_t arg5)
+{
+    (void)arg5;
+
+    if (id >= URING_MAX_RINGS) {
+        return ERROR_INVALID;
+    }
+
+    struct uring_ctx *ctx = uring_get(id);
+    if (!ctx) {
+        return ERROR_INVALID;
+    }
+
+    if (flags & URING_ENTER_RELEASE) {
+        // 释放后环已清空，不能再uring_put
+        int32_t ret = uring_release(ctx, 1);
+        if (ret != ERROR_NONE) {
+            uring_put(ctx);
+        }
+        return ret;
+    }
+
+    uring_ring_t *ring = ctx->ring;
+    uint32_t submitted = 0;
+
+    if (ctx->flags & URING_SETUP_SQPOLL) {
+        // 只有轮询线程消费提交环
+        if (flags & URING_ENTER_SQ_WAKEUP) {
+            sched_wake(ctx->poller);
+        }
+    } else if (to_submit) {
+        if (__sync_lock_test_and_set(&ctx->submitting, 1)) {
+            uring_put(ctx);
+            return ERROR_BUSY;
+        }
+        submitted = uring_submit(ctx, to_submit);
+        __sync_lock_release(&ctx->submitting);
+    }
+
+    if ((flags & URING_ENTER_GETEVENTS) && (ctx->flags & URING_SETUP_SQPOLL)) {
+        if (min_complete > ring->cq_entries) {
+            min_complete = ring->cq_entries;
+        }
+
+        // 非轮询模式的请求都已同步完成，只有轮询线程还会产生新的完成；
+        // 轮询线程每写一个CQE唤醒一次，环被释放时也唤醒
+        wait_event(&ctx->cq_wait,
+                   ring->cq_tail - ring->cq_head >= min_complete || ctx->releasing);
+    }
+
+    uring_put(ctx);
+    return (int32_t)submitted;
+}
@@ -0,0 +1,55 @@
+/*
+ * Vest-OS vvar页
+ * 把时钟参数和前台TTY放进映射到每个进程的只读页，用户态读取不进入内核
+ */
+
+#include <kernel.h>
+#include <vdso.h>
+#include <timer.h>
+#include <arch/cpu.h>
+
+// 独占一整页，映射给用户态时不会带出相邻的内核数据
+static union {
+    vvar_data_t data;
+    uint8_t page[PAGE_SIZE];
+} vvar_page __attribute__((aligned(PAGE_SIZE)));
+
+/**
+ * vvar页的内核地址
+ */
+void *vdso_vvar_page(void)
+{
+    return &vvar_page;
+}
+
+/**
+ * 复制时间维护参数（持有时间维护的写锁，只有一个写者）
+ */
+void vdso_update_time(const struct timekeeper *tk)
+{
+    vvar_data_t *vvar = &vvar_page.data;
+
+    // 奇数计数期间用户态读者重读
+    vvar->seq++;
+    barrier();
+
+    vvar->vclock_mode = tk->clock->vclock_mode;
+    vvar->cycle_last = tk->cycle_last;
+    vvar->base_ns = tk->base_ns;
+    vvar->base_frac = tk->base_frac;
+    vvar->real_offset = tk->real_offset;
+    vvar->mult = tk->clock->mult;
+    vvar->shift = tk->clock->shift;
+    vvar->jiffies = jiffies;
+
+    barrier();
+    vvar->seq++;
+}
+
+/**
+ * 更新前台TTY
+ */
+void vdso_update_tty(int tty_id)
+{
+    vvar_page.data.current_tty = tty_id;
+}
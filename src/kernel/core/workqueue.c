@@ -0,0 +1,385 @@
+/*
+ * Vest-OS 工作队列
+ * 每CPU工作线程池，按需增加线程，并发数有上限；延迟工作由内核定时器提交
+ */
+
+#include <kernel.h>
+#include <sched.h>
+#include <klog.h>
+#include <timer.h>
+#include <workqueue.h>
+#include <hal/smp.h>
+
+struct workqueue *system_wq;
+
+static void worker_thread(void *arg);
+
+/**
+ * 为线程池创建一个工作线程（线程上下文调用，nr_workers已由调用者增加）
+ */
+static bool create_worker(struct worker_pool *pool)
+{
+    struct worker *worker = kmalloc(sizeof(struct worker));
+    if (!worker) {
+        return false;
+    }
+
+    struct thread *thread = create_thread(NULL);
+    if (!thread) {
+        kfree(worker);
+        return false;
+    }
+
+    memcpy(thread->name, "kworker", 8);
+    thread_set_affinity(thread, CPUMASK_CPU(pool->cpu));
+
+    worker->thread = thread;
+    worker->pool = pool;
+    worker->next_idle = NULL;
+    worker->idle = false;
+    worker->current_work = NULL;
+    worker->current_seq = 0;
+    worker->hash_next = NULL;
+    worker->scheduled = NULL;
+
+    thread_start(thread, worker_thread, worker);
+    return true;
+}
+
+/**
+ * 取出一个空闲线程（持有池锁）
+ */
+static struct worker *pool_pop_idle(struct worker_pool *pool)
+{
+    struct worker *worker = pool->idle;
+
+    if (worker) {
+        pool->idle = worker->next_idle;
+        worker->idle = false;
+    }
+    return worker;
+}
+
+/**
+ * 工作地址对应的busy_hash桶
+ */
+static struct worker **busy_hash_slot(struct worker_pool *pool, struct work_struct *work)
+{
+    return &pool->busy_hash[((uint32_t)work >> 4) % WQ_BUSY_HASH_SIZE];
+}
+
+/**
+ * 正在执行work的线程（持有池锁）
+ */
+static struct worker *find_worker_executing_work(struct worker_pool *pool,
+                                                 struct work_struct *work)
+{
+    for (struct worker *worker = *busy_hash_slot(pool, work); worker;
+         worker = worker->hash_next) {
+        if (worker->current_work == work) {
+            return worker;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 把线程从busy_hash中摘除（持有池锁）
+ */
+static void busy_hash_del(struct worker_pool *pool, struct worker *worker)
+{
+    struct worker **link = busy_hash_slot(pool, worker->current_work);
+
+    while (*link != worker) {
+        link = &(*link)->hash_next;
+    }
+    *link = worker->hash_next;
+    worker->hash_next = NULL;
+    worker->current_work = NULL;
+}
+
+/**
+ * 工作线程：取工作执行，队列空则睡眠
+ */
+static void worker_thread(void *arg)
+{
+    struct worker *worker = arg;
+    struct worker_pool *pool = worker->pool;
+
+    for (;;) {
+        uint32_t flags = spinlock_lock_irqsave(&pool->lock);
+
+        struct work_struct *work = pool->head;
+        if (!work) {
+            // 可能被提前唤醒，不重复登记
+            if (!worker->idle) {
+                worker->idle = true;
+                worker->next_idle = pool->idle;
+                pool->idle = worker;
+            }
+            spinlock_unlock_irqrestore(&pool->lock, flags);
+            sched_block();
+            continue;
+        }
+
+        pool->head = work->next;
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+
+        // 上一个实例还在另一个线程中执行：交给它，避免同一工作并发执行。
+        // pending在交出的实例开始前一直为1，每个工作最多交出一个
+        struct worker *busy = find_worker_executing_work(pool, work);
+        if (busy) {
+            busy->scheduled = work;
+            spinlock_unlock_irqrestore(&pool->lock, flags);
+            continue;
+        }
+
+        worker->current_work = work;
+        worker->current_seq = work->seq;
+        struct worker **slot = busy_hash_slot(pool, work);
+        worker->hash_next = *slot;
+        *slot = worker;
+        pool->nr_running++;
+
+        // 还有积压且没有空闲线程：补一个，当前工作睡眠时其余工作不被阻塞
+        bool grow = pool->head && !pool->idle && pool->nr_workers < pool->max_active;
+        if (grow) {
+            pool->nr_workers++;
+        }
+
+        spinlock_unlock_irqrestore(&pool->lock, flags);
+
+        if (grow && !create_worker(pool)) {
+            flags = spinlock_lock_irqsave(&pool->lock);
+            pool->nr_workers--;
+            spinlock_unlock_irqrestore(&pool->lock, flags);
+        }
+
+        for (;;) {
+            // 先清除pending，处理函数可以重新提交自己
+            barrier();
+            work->pending = 0;
+
+            work->func(work);
+
+            flags = spinlock_lock_irqsave(&pool->lock);
+            pool->nr_done++;
+
+            // 执行期间被再次提交并交给了本线程：保持在busy_hash中接着执行
+            work = worker->scheduled;
+            worker->scheduled = NULL;
+            if (work) {
+                worker->current_seq = work->seq;
+            } else {
+                busy_hash_del(pool, worker);
+                pool->nr_running--;
+            }
+            spinlock_unlock_irqrestore(&pool->lock, flags);
+
+            wake_up(&pool->flush_wait);
+
+            if (!work) {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * 把已标记pending的工作加入CPU的线程池并唤醒一个空闲线程
+ */
+static void __queue_work(struct workqueue *wq, uint32_t cpu, struct work_struct *work)
+{
+    struct worker_pool *pool = &wq->pools[cpu < NR_CPUS ? cpu : 0];
+
+    // 该CPU上没有工作线程（创建队列时还未上线）
+    if (pool->nr_workers == 0) {
+        pool = &wq->pools[0];
+    }
+
+    uint32_t flags = spinlock_lock_irqsave(&pool->lock);
+
+    work->next = NULL;
+    if (pool->tail) {
+        pool->tail->next = work;
+    } else {
+        pool->head = work;
+    }
+    pool->tail = work;
+    work->seq = ++pool->nr_queued;
+
+    struct worker *worker = pool_pop_idle(pool);
+
+    spinlock_unlock_irqrestore(&pool->lock, flags);
+
+    if (worker) {
+        sched_wake(worker->thread);
+    }
+}
+
+/**
+ * 提交工作到指定CPU，已在队列中则返回false
+ */
+bool queue_work_on(uint32_t cpu, struct workqueue *wq, struct work_struct *work)
+{
+    if (!wq || !work || __sync_lock_test_and_set(&work->pending, 1)) {
+        return false;
+    }
+
+    __queue_work(wq, cpu, work);
+    return true;
+}
+
+/**
+ * 提交工作到当前CPU
+ */
+bool queue_work(struct workqueue *wq, struct work_struct *work)
+{
+    return queue_work_on(sched_this_cpu(), wq, work);
+}
+
+/**
+ * delay个时钟节拍后提交工作（delay为0时立即提交）
+ */
+bool queue_delayed_work(struct workqueue *wq, struct delayed_work *dwork, uint32_t delay)
+{
+    if (delay == 0) {
+        return queue_work(wq, &dwork->work);
+    }
+
+    if (!wq || __sync_lock_test_and_set(&dwork->work.pending, 1)) {
+        return false;
+    }
+
+    dwork->wq = wq;
+    dwork->cpu = sched_this_cpu();
+    mod_timer(&dwork->timer, jiffies + delay);
+    return true;
+}
+
+bool schedule_work(struct work_struct *work)
+{
+    return queue_work(system_wq, work);
+}
+
+bool schedule_delayed_work(struct delayed_work *dwork, uint32_t delay)
+{
+    return queue_delayed_work(system_wq, dwork, delay);
+}
+
+/**
+ * 延迟工作的定时器到期（TIMER_SOFTIRQ）：提交到原CPU的队列
+ */
+void delayed_work_timer_fn(timer_list_t *timer)
+{
+    struct delayed_work *dwork = timer->data;
+
+    __queue_work(dwork->wq, dwork->cpu, &dwork->work);
+}
+
+/**
+ * 序号不大于seq的工作是否都已完成
+ *
+ * 池中多个线程并发执行，工作不按入队顺序完成，完成数达到提交数并不
+ * 说明之前的工作都已结束。未完成的工作只可能在三处：队列中（FIFO，
+ * 只需看队头）、正在执行、或交给正在执行它的线程等待再次执行
+ */
+static bool pool_flushed(struct worker_pool *pool, uint64_t seq)
+{
+    uint32_t flags = spinlock_lock_irqsave(&pool->lock);
+    bool done = !pool->head || pool->head->seq > seq;
+
+    for (uint32_t i = 0; done && i < WQ_BUSY_HASH_SIZE; i++) {
+        for (struct worker *worker = pool->busy_hash[i]; worker; worker = worker->hash_next) {
+            if (worker->current_seq <= seq ||
+                (worker->scheduled && worker->scheduled->seq <= seq)) {
+                done = false;
+                break;
+            }
+        }
+    }
+
+    spinlock_unlock_irqrestore(&pool->lock, flags);
+    return done;
+}
+
+/**
+ * 等待调用前提交的工作全部完成（线程上下文，不能在该队列的工作中调用）
+ */
+void flush_workqueue(struct workqueue *wq)
+{
+    if (!wq) {
+        return;
+    }
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct worker_pool *pool = &wq->pools[cpu];
+
+        uint32_t flags = spinlock_lock_irqsave(&pool->lock);
+        uint64_t target = pool->nr_queued;
+        spinlock_unlock_irqrestore(&pool->lock, flags);
+
+        // 工作线程每完成一个工作唤醒一次
+        wait_event(&pool->flush_wait, pool_flushed(pool, target));
+    }
+}
+
+/**
+ * 创建工作队列，为每个在线CPU启动一个工作线程
+ */
+struct workqueue *alloc_workqueue(const char *name, uint32_t max_active)
+{
+    struct workqueue *wq = kmalloc(sizeof(struct workqueue));
+    if (!wq) {
+        return NULL;
+    }
+
+    memset(wq, 0, sizeof(struct workqueue));
+    wq->name = name;
+
+    if (max_active == 0 || max_active > WQ_MAX_ACTIVE) {
+        max_active = WQ_MAX_ACTIVE;
+    }
+
+    uint32_t online = smp_num_online();
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct worker_pool *pool = &wq->pools[cpu];
+
+        spinlock_init(&pool->lock, "worker_pool");
+        init_waitqueue_head(&pool->flush_wait);
+        pool->cpu = cpu;
+        pool->max_active = max_active;
+
+        if (cpu < online) {
+            pool->nr_workers = 1;
+            if (!create_worker(pool)) {
+                pool->nr_workers = 0;
+            }
+        }
+    }
+
+    if (wq->pools[0].nr_workers == 0) {
+        kernel_printk(KERN_ERR "workqueue: %s 无法创建工作线程\n", name);
+        kfree(wq);
+        return NULL;
+    }
+
+    return wq;
+}
+
+/**
+ * 初始化工作队列（所有CPU上线之后调用）
+ */
+void workqueue_init(void)
+{
+    system_wq = alloc_workqueue("events", WQ_MAX_ACTIVE);
+    if (!system_wq) {
+        kernel_panic("无法创建系统工作队列");
+    }
+
+    kernel_printk(KERN_INFO "工作队列: %d个CPU, 每CPU最多%d个工作线程\n",
+                  smp_num_online(), WQ_MAX_ACTIVE);
+}
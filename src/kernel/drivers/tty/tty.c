@@ -6,6 +6,8 @@
 #include <kernel.h>
 #include <drivers/tty.h>
 #include <hal/cpu.h>
+#include <klog.h>
+#include <vdso.h>
 
 // 最大TTY设备数
 #define MAX_TTY_DEVICES 16
@@ -271,6 +273,7 @@ int switch_tty(int tty_id)
     }
 
     current_tty = tty_id;
+    vdso_update_tty(tty_id);
 
     // 保存当前TTY的状态（如果需要的话）
     // 恢复目标TTY的状态（如果需要的话）
@@ -361,19 +364,11 @@ int tty_ioctl(int tty_id, uint32_t cmd, void *arg)
 }
 
 /**
- * 内核输出函数
+ * 内核日志控制台输出（由klog_flush调用）
  */
-void kernel_printk(const char *format, ...)
+static void klog_console_write(const char *data, size_t len)
 {
-    va_list args;
-    char buffer[1024];
-
-    va_start(args, format);
-    vsnprintf(buffer, sizeof(buffer), format, args);
-    va_end(args);
-
-    // 输出到当前TTY
-    tty_write(current_tty, buffer, strlen(buffer));
+    tty_write(current_tty, data, len);
 }
 
 /**
@@ -398,6 +393,11 @@ void tty_init(void)
 
     // 设置当前TTY为0
     current_tty = 0;
+    vdso_update_tty(0);
+
+    // 注册内核日志控制台并输出启动日志
+    klog_set_console(klog_console_write);
 
     kernel_printk("TTY子系统初始化完成\n");
+    klog_flush();
 }
\ No newline at end of file
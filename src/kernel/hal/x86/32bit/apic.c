@@ -0,0 +1,201 @@
+/*
+ * Vest-OS 本地APIC驱动
+ * IPI发送、中断应答和LAPIC周期定时器
+ */
+
+#include <kernel.h>
+#include <hal/cpu.h>
+#include <hal/apic.h>
+#include <timer.h>
+
+// LAPIC寄存器窗口（物理地址恒等映射）
+static volatile uint32_t *lapic_base = NULL;
+
+// 定时器校准结果：分频16下每秒的计数
+static uint32_t lapic_timer_freq = 0;
+
+// 校准窗口（微秒）
+#define LAPIC_CALIBRATE_US      10000
+
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    return lapic_base[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value)
+{
+    lapic_base[reg / 4] = value;
+    (void)lapic_base[LAPIC_ID / 4];  // 读回，确保写入完成
+}
+
+/**
+ * 等待上一个IPI发送完毕
+ */
+static void lapic_wait_icr(void)
+{
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        asm volatile ("pause");
+    }
+}
+
+/**
+ * 写ICR发送IPI（先写目标，写低32位时触发发送）
+ */
+static void lapic_send_icr(uint32_t apic_id, uint32_t low)
+{
+    uint32_t flags = local_irq_save();
+
+    lapic_wait_icr();
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, low);
+    lapic_wait_icr();
+
+    local_irq_restore(flags);
+}
+
+/**
+ * 记录LAPIC地址并启用BSP的LAPIC
+ */
+void lapic_init(uint32_t base)
+{
+    lapic_base = (volatile uint32_t *)(base ? base : LAPIC_DEFAULT_BASE);
+    lapic_enable();
+}
+
+/**
+ * 启用当前CPU的LAPIC（每个CPU各调用一次）
+ */
+void lapic_enable(void)
+{
+    // 清除错误状态（需要连续写两次）
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_ESR, 0);
+
+    // 接收所有优先级的中断
+    lapic_write(LAPIC_TPR, 0);
+
+    // 本地定时器和错误中断暂不使用
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+
+    // 软件启用，并设置伪中断向量
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    lapic_eoi();
+}
+
+/**
+ * LAPIC是否已初始化
+ */
+bool lapic_available(void)
+{
+    return lapic_base != NULL;
+}
+
+/**
+ * 当前CPU的APIC ID
+ */
+uint32_t lapic_id(void)
+{
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+/**
+ * 应答当前中断
+ */
+void lapic_eoi(void)
+{
+    lapic_base[LAPIC_EOI / 4] = 0;
+}
+
+/**
+ * 发送INIT IPI（断言后撤销）
+ */
+void lapic_send_init(uint32_t apic_id)
+{
+    lapic_send_icr(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT | LAPIC_ICR_LEVEL);
+    timer_udelay(200);
+    lapic_send_icr(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+}
+
+/**
+ * 发送STARTUP IPI，AP从 page * 4KB 处的实模式代码开始执行
+ */
+void lapic_send_startup(uint32_t apic_id, uint8_t page)
+{
+    lapic_write(LAPIC_ESR, 0);
+    lapic_send_icr(apic_id, LAPIC_ICR_STARTUP | page);
+}
+
+/**
+ * 向指定CPU发送固定向量IPI
+ */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector)
+{
+    lapic_send_icr(apic_id, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | vector);
+}
+
+/**
+ * 向除自己外的所有CPU发送IPI
+ */
+void lapic_broadcast_ipi(uint8_t vector)
+{
+    lapic_send_icr(0, LAPIC_ICR_ALL_BUT_SELF | LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | vector);
+}
+
+/**
+ * 用PIT校准LAPIC定时器频率（BSP调用一次，各CPU频率相同）
+ */
+void lapic_timer_calibrate(void)
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, 0x3);   // 16分频
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+
+    timer_udelay(LAPIC_CALIBRATE_US);
+
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    lapic_timer_freq = elapsed * (1000000 / LAPIC_CALIBRATE_US);
+}
+
+/**
+ * 启动当前CPU的LAPIC周期定时器
+ */
+void lapic_timer_start(uint32_t hz)
+{
+    if (!lapic_timer_freq || !hz) {
+        return;
+    }
+
+    lapic_write(LAPIC_TIMER_DIVIDE, 0x3);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, lapic_timer_freq / hz);
+}
+
+/**
+ * 频率为hz时每个周期的LAPIC定时器计数（未校准时为0）
+ */
+uint32_t lapic_timer_period(uint32_t hz)
+{
+    return hz ? lapic_timer_freq / hz : 0;
+}
+
+/**
+ * 单次定时：count个计数后产生一次定时器中断（替换正在运行的周期定时）
+ */
+void lapic_timer_oneshot(uint32_t count)
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, 0x3);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+/**
+ * 当前定时剩余的计数（单次定时到期后为0）
+ */
+uint32_t lapic_timer_remaining(void)
+{
+    return lapic_read(LAPIC_TIMER_CURRENT);
+}
@@ -0,0 +1,70 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <kernel.h>
+#include <stdint.h>
+
+/*
+ * Vest-OS 本地APIC
+ * 每个CPU一个LAPIC，负责处理器间中断（IPI）、中断应答和本地定时器
+ */
+
+// 默认LAPIC物理地址（MADT/MP表会给出实际地址）
+#define LAPIC_DEFAULT_BASE      0xFEE00000
+
+// LAPIC寄存器偏移
+#define LAPIC_ID                0x020
+#define LAPIC_VERSION           0x030
+#define LAPIC_TPR               0x080
+#define LAPIC_EOI               0x0B0
+#define LAPIC_SVR               0x0F0
+#define LAPIC_ESR               0x280
+#define LAPIC_ICR_LOW           0x300
+#define LAPIC_ICR_HIGH          0x310
+#define LAPIC_LVT_TIMER         0x320
+#define LAPIC_LVT_LINT0         0x350
+#define LAPIC_LVT_LINT1         0x360
+#define LAPIC_LVT_ERROR         0x370
+#define LAPIC_TIMER_INIT        0x380
+#define LAPIC_TIMER_CURRENT     0x390
+#define LAPIC_TIMER_DIVIDE      0x3E0
+
+// SVR位
+#define LAPIC_SVR_ENABLE        0x100
+
+// ICR字段
+#define LAPIC_ICR_FIXED         0x00000
+#define LAPIC_ICR_INIT          0x00500
+#define LAPIC_ICR_STARTUP       0x00600
+#define LAPIC_ICR_PENDING       0x01000
+#define LAPIC_ICR_ASSERT        0x04000
+#define LAPIC_ICR_LEVEL         0x08000
+#define LAPIC_ICR_ALL_BUT_SELF  0xC0000
+
+// LVT位
+#define LAPIC_LVT_MASKED        0x10000
+#define LAPIC_TIMER_PERIODIC    0x20000
+
+// LAPIC使用的中断向量（高于外部IRQ，优先级最高）
+#define LAPIC_TIMER_VECTOR      0xEF
+#define IPI_RESCHEDULE_VECTOR   0xF0
+#define IPI_STOP_VECTOR         0xF1
+#define LAPIC_SPURIOUS_VECTOR   0xFF
+
+// LAPIC接口
+void lapic_init(uint32_t base);
+void lapic_enable(void);
+bool lapic_available(void);
+uint32_t lapic_id(void);
+void lapic_eoi(void);
+void lapic_send_init(uint32_t apic_id);
+void lapic_send_startup(uint32_t apic_id, uint8_t page);
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+void lapic_broadcast_ipi(uint8_t vector);
+void lapic_timer_calibrate(void);
+void lapic_timer_start(uint32_t hz);
+uint32_t lapic_timer_period(uint32_t hz);
+void lapic_timer_oneshot(uint32_t count);
+uint32_t lapic_timer_remaining(void);
+
+#endif // APIC_H
@@ -124,36 +124,6 @@ load_gdt:
 .reload_cs:
     ret
 
-; 中断处理程序入口
-global interrupt_entry
-interrupt_entry:
-    ; 保存所有寄存器
-    pushad
-    push ds
-    push es
-    push fs
-    push gs
-
-    ; 加载内核数据段
-    mov ax, KERNEL_DS
-    mov ds, ax
-    mov es, ax
-    mov fs, ax
-    mov gs, ax
-
-    ; 调用C语言中断处理函数
-    call c_interrupt_handler
-
-    ; 恢复寄存器
-    pop gs
-    pop fs
-    pop es
-    pop ds
-    popad
-
-    ; 返回中断
-    iret
-
 ; TSS和任务状态段
 section .bss
 align 16
@@ -168,4 +138,36 @@ tss_descriptor:
     db 0x00         ; 段基址23:16
     db 10001001b    ; 类型=可用TSS32, P=1, DPL=0
     db 00000000b    ; 段界限19:16, G=0, D=0, L=0, AVL=0
-    db 0x00         ; 段基址31:24
\ No newline at end of file
+    db 0x00         ; 段基址31:24
+section .text
+
+; 加载GDT并刷新段寄存器（参数：gdt_ptr地址）
+global gdt_flush
+gdt_flush:
+    mov eax, [esp + 4]
+    lgdt [eax]
+
+    mov ax, KERNEL_DS
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    jmp KERNEL_CS:.flush_cs
+.flush_cs:
+    ret
+
+; 加载任务寄存器（参数：TSS选择子）
+global tss_flush
+tss_flush:
+    mov ax, [esp + 4]
+    ltr ax
+    ret
+
+; 加载IDT（参数：idt_ptr地址）
+global idt_flush
+idt_flush:
+    mov eax, [esp + 4]
+    lidt [eax]
+    ret
@@ -5,51 +5,78 @@
 
 #include <kernel.h>
 #include <hal/cpu.h>
+#include <hal/fpu.h>
+#include <klog.h>
+#include <kernel/rcu.h>
+#include <hal/smp.h>
+#include <arch/percpu.h>
+#include <arch/interrupt.h>
+#include <timer.h>
 
 // CPU特性检测
 static struct cpu_features cpu_features = {0};
 
-// GDT和IDT
-static struct gdt_entry gdt[5];
+// GDT和IDT：每个CPU一份GDT（ltr会把TSS描述符置为忙，不能共享），IDT共享
+static struct gdt_entry gdt[NR_CPUS][GDT_ENTRIES];
 static struct idt_entry idt[256];
-static struct gdt_ptr gdt_ptr;
+static struct gdt_ptr gdt_ptr[NR_CPUS];
 static struct idt_ptr idt_ptr;
 
-// TSS结构
-static struct tss_struct tss;
+// 每CPU的TSS
+static struct tss_struct tss[NR_CPUS];
+
+// SYSENTER进入内核时的临时栈：MSR中的ESP指向esp0，入口从中取出真正的内核栈。
+// 下面留出的空间供入口切换栈之前到来的NMI/调试异常压栈
+#define SYSENTER_STACK_WORDS 16
+
+static struct {
+    uint32_t scratch[SYSENTER_STACK_WORDS];
+    uint32_t esp0;
+} sysenter_stack[NR_CPUS] __attribute__((aligned(CACHE_LINE_SIZE)));
 
 /**
- * 初始化GDT
+ * 初始化指定CPU的GDT和TSS并加载
  */
-static void init_gdt(void)
+static void init_gdt(uint32_t cpu)
 {
+    struct gdt_entry *table = gdt[cpu];
+    struct tss_struct *cpu_tss = &tss[cpu];
+
     // 设置GDT指针
-    gdt_ptr.limit = sizeof(gdt) - 1;
-    gdt_ptr.base = (uint32_t)&gdt;
+    gdt_ptr[cpu].limit = sizeof(gdt[cpu]) - 1;
+    gdt_ptr[cpu].base = (uint32_t)table;
 
     // 清空GDT
-    memset(&gdt, 0, sizeof(gdt));
+    memset(table, 0, sizeof(gdt[cpu]));
 
     // 内核代码段 (0x08)
-    set_gdt_entry(0, 0, 0, 0, 0);                           // 空描述符
-    set_gdt_entry(1, 0, 0xFFFFFFFF, 0x9A, 0xCF);           // 内核代码段
-    set_gdt_entry(2, 0, 0xFFFFFFFF, 0x92, 0xCF);           // 内核数据段
-    set_gdt_entry(3, 0, 0xFFFFFFFF, 0xFA, 0xCF);           // 用户代码段
-    set_gdt_entry(4, 0, 0xFFFFFFFF, 0xF2, 0xCF);           // 用户数据段
-
-    // 加载GDT
-    gdt_flush((uint32_t)&gdt_ptr);
+    set_gdt_entry(table, 0, 0, 0, 0, 0);                           // 空描述符
+    set_gdt_entry(table, 1, 0, 0xFFFFFFFF, 0x9A, 0xCF);           // 内核代码段
+    set_gdt_entry(table, 2, 0, 0xFFFFFFFF, 0x92, 0xCF);           // 内核数据段
+    set_gdt_entry(table, 3, 0, 0xFFFFFFFF, 0xFA, 0xCF);           // 用户代码段
+    set_gdt_entry(table, 4, 0, 0xFFFFFFFF, 0xF2, 0xCF);           // 用户数据段
 
     // 设置TSS
-    memset(&tss, 0, sizeof(tss));
-    tss.ss0 = 0x10;  // 内核栈段选择子
-    tss.esp0 = 0;    // 内核栈指针（在切换时设置）
+    memset(cpu_tss, 0, sizeof(*cpu_tss));
+    cpu_tss->ss0 = KERNEL_DS;  // 内核栈段选择子
+    cpu_tss->esp0 = 0;         // 内核栈指针（在切换时设置）
+    cpu_tss->iomap_base = sizeof(*cpu_tss);
 
     // 设置TSS描述符
-    set_gdt_entry(5, (uint32_t)&tss, sizeof(tss) - 1, 0x89, 0x00);
+    set_gdt_entry(table, 5, (uint32_t)cpu_tss, sizeof(*cpu_tss) - 1, 0x89, 0x00);
+
+    // 每CPU数据段：基址是本CPU副本相对模板的偏移
+    set_gdt_entry(table, 6, per_cpu_offset[cpu], 0xFFFFFFFF, 0x92, 0xCF);
 
-    // 加载TSS
-    tss_flush(0x28);
+    // CPU编号段：只用来给用户态lsl，字节粒度，段界限即CPU编号
+    set_gdt_entry(table, 7, 0, cpu, 0xF2, 0x40);
+
+    // 加载GDT和TSS
+    gdt_flush((uint32_t)&gdt_ptr[cpu]);
+    tss_flush(TSS_SELECTOR);
+
+    // 此后this_cpu_*访问本CPU的副本
+    asm volatile ("movw %w0, %%fs" : : "r"(PERCPU_SELECTOR));
 }
 
 /**
@@ -64,23 +91,30 @@ static void init_idt(void)
     // 清空IDT
     memset(&idt, 0, sizeof(idt));
 
-    // 设置异常处理程序
-    for (int i = 0; i < 32; i++) {
-        set_idt_entry(i, (uint32_t)exception_handlers[i], 0x08, 0x8E);
+    // 所有向量都经interrupt_dispatch分发（异常、IRQ、LAPIC中断）
+    for (int i = 0; i < 256; i++) {
+        set_idt_entry(i, interrupt_stubs[i], KERNEL_CS, 0x8E);
     }
 
-    // 设置IRQ处理程序
-    for (int i = 32; i < 48; i++) {
-        set_idt_entry(i, (uint32_t)irq_handlers[i - 32], 0x08, 0x8E);
-    }
-
-    // 设置系统调用处理程序 (int 0x80)
-    set_idt_entry(0x80, (uint32_t)syscall_handler, 0x08, 0xEE);
+    // 设置系统调用处理程序 (int 0x80)，用户态可以触发
+    set_idt_entry(0x80, (uint32_t)syscall_int80_entry, KERNEL_CS, 0xEE);
 
     // 加载IDT
     idt_flush((uint32_t)&idt_ptr);
 }
 
+/**
+ * 没有处理函数的中断：异常无法恢复，其余（伪中断等）只计数
+ */
+static void cpu_unhandled_interrupt(interrupt_frame_t *frame)
+{
+    if (frame->vector < INTERRUPT_EXCEPTIONS) {
+        kernel_printk(KERN_EMERG "未处理的异常 %d, 错误码 0x%x, EIP 0x%x\n",
+                      frame->vector, frame->error_code, frame->eip);
+        kernel_panic("未处理的异常");
+    }
+}
+
 /**
  * 检测CPU特性
  */
@@ -100,30 +134,42 @@ static void detect_cpu_features(void)
     cpu_features.has_mmx  = (edx & (1 << 23)) != 0;
     cpu_features.has_sse  = (edx & (1 << 25)) != 0;
     cpu_features.has_sse2 = (edx & (1 << 26)) != 0;
+    cpu_features.has_apic = (edx & (1 << 9)) != 0;
+    cpu_features.has_tsc  = (edx & (1 << 4)) != 0;
+    cpu_features.has_fxsr = (edx & (1 << 24)) != 0;
+
+    // Pentium Pro（family 6, model < 3, stepping < 3）报告了SEP但指令不可用
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    cpu_features.has_sep = (edx & (1 << 11)) != 0 &&
+                           !(family == 6 && model < 3 && stepping < 3);
+
+    // 最大扩展功能号
+    cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    uint32_t max_ext = eax;
 
     // 获取扩展特性
-    cpuid(0x80000001, &eax, &ebx, &ecx, &edx);
-    cpu_features.has_nx = (edx & (1 << 20)) != 0;
+    if (max_ext >= 0x80000001) {
+        cpuid(0x80000001, &eax, &ebx, &ecx, &edx);
+        cpu_features.has_nx = (edx & (1 << 20)) != 0;
+    }
+
+    // 高级电源管理信息：不变TSC
+    if (max_ext >= 0x80000007) {
+        cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        cpu_features.has_invariant_tsc = cpu_features.has_tsc && (edx & (1 << 8)) != 0;
+    }
 }
 
 /**
- * 初始化中断控制器 (8259A PIC)
+ * 初始化中断控制器：先使用8259A PIC，smp_init找到IOAPIC后再切换
  */
 static void init_pic(void)
 {
-    // 重新映射PIC中断向量
-    outb(0x20, 0x11);  // 开始初始化主PIC
-    outb(0xA0, 0x11);  // 开始初始化从PIC
-    outb(0x21, 0x20);  // 主PIC中断向量偏移
-    outb(0xA1, 0x28);  // 从PIC中断向量偏移
-    outb(0x21, 0x04);  // 告诉主PIC从PIC在IRQ2
-    outb(0xA1, 0x02);  // 告诉从PIC级联标识
-    outb(0x21, 0x01);  // 8086模式
-    outb(0xA1, 0x01);  // 8086模式
-
-    // 屏蔽所有中断
-    outb(0x21, 0xFF);
-    outb(0xA1, 0xFF);
+    // 重新映射PIC中断向量并屏蔽所有中断
+    interrupt_init();
+    interrupt_set_unhandled_hook(cpu_unhandled_interrupt);
 }
 
 /**
@@ -161,12 +207,30 @@ void cpu_halt(void)
 }
 
 /**
- * 获取当前CPU ID (多核支持预留)
+ * 获取当前逻辑CPU编号（BSP为0）
  */
 uint32_t get_cpu_id(void)
 {
-    // 单核系统返回0
-    return 0;
+    return this_cpu_read(cpu_number);
+}
+
+/**
+ * 设置当前CPU从用户态进入内核时使用的栈
+ */
+void cpu_set_kernel_stack(uint32_t esp0)
+{
+    uint32_t cpu = this_cpu_read(cpu_number);
+
+    tss[cpu].esp0 = esp0;
+    sysenter_stack[cpu].esp0 = esp0;
+}
+
+/**
+ * 安装内核态中断门（IDT由所有CPU共享，立即生效）
+ */
+void cpu_set_idt_gate(uint8_t vector, void (*handler)(void))
+{
+    set_idt_entry(vector, (uint32_t)handler, KERNEL_CS, 0x8E);
 }
 
 /**
@@ -266,11 +330,26 @@ void invalidate_cache(void)
 }
 
 /**
- * CPU空闲等待
+ * CPU空闲等待（关中断调用，被中断唤醒后开中断返回）
  */
 void cpu_idle(void)
 {
-    asm volatile ("hlt");
+    // 没有近期事件则停掉周期节拍，停机期间不参与RCU宽限期
+    tick_nohz_idle_enter();
+    rcu_idle_enter();
+
+    // sti的下一条指令执行完之前不响应中断，避免丢失唤醒
+    asm volatile ("sti; hlt");
+
+    // 唤醒中断的出口通常已恢复节拍，这里处理其余情况
+    disable_interrupts();
+    rcu_irq_enter();
+    tick_nohz_idle_exit();
+    enable_interrupts();
+
+    // 空闲即静止状态，推进RCU宽限期；输出积压的内核日志
+    rcu_quiescent_state();
+    klog_flush();
 }
 
 /**
@@ -289,6 +368,55 @@ void serialize(void)
     asm volatile ("cpuid" ::: "eax", "ebx", "ecx", "edx");
 }
 
+/**
+ * 设置本CPU的SYSENTER入口：代码段KERNEL_CS（栈段为其后的KERNEL_DS，
+ * SYSEXIT返回到USER_CS/USER_DS，依赖GDT的排列顺序）
+ */
+static void init_sysenter(void)
+{
+    if (!cpu_features.has_sep) {
+        return;
+    }
+
+    uint32_t cpu = this_cpu_read(cpu_number);
+
+    wrmsr(MSR_IA32_SYSENTER_CS, KERNEL_CS);
+    wrmsr(MSR_IA32_SYSENTER_ESP, (uint32_t)&sysenter_stack[cpu].esp0);
+    wrmsr(MSR_IA32_SYSENTER_EIP, (uint32_t)sysenter_entry);
+}
+
+/**
+ * 启用必要的CPU特性（每个CPU各自设置）
+ */
+static void init_control_registers(void)
+{
+    uint32_t cr0 = read_cr0();
+    cr0 |= (1 << 16);  // 设置写保护
+    write_cr0(cr0);
+
+    uint32_t cr4 = read_cr4();
+    if (cpu_features.has_nx) {
+        cr4 |= (1 << 14);  // 启用NX位
+    }
+    write_cr4(cr4);
+
+    // FPU/SSE：惰性切换，第一次使用时触发#NM
+    fpu_init_cpu();
+
+    // 快速系统调用入口
+    init_sysenter();
+}
+
+/**
+ * 初始化AP：加载自己的GDT/TSS和共享的IDT
+ */
+void cpu_init_ap(uint32_t cpu)
+{
+    init_gdt(cpu);
+    idt_flush((uint32_t)&idt_ptr);
+    init_control_registers();
+}
+
 /**
  * 初始化CPU
  */
@@ -297,8 +425,13 @@ void cpu_init(void)
     // 检测CPU特性
     detect_cpu_features();
 
-    // 初始化GDT
-    init_gdt();
+    // 每CPU数据区必须在加载%fs之前建立
+    if (setup_per_cpu_areas() != 0) {
+        kernel_panic("每CPU数据超过PERCPU_AREA_SIZE");
+    }
+
+    // 初始化GDT（BSP是逻辑CPU0）
+    init_gdt(0);
 
     // 初始化IDT
     init_idt();
@@ -306,20 +439,15 @@ void cpu_init(void)
     // 初始化PIC
     init_pic();
 
-    // 启用必要的CPU特性
-    uint32_t cr0 = read_cr0();
-    cr0 |= (1 << 16);  // 设置写保护
-    write_cr0(cr0);
+    // 登记#NM处理函数
+    fpu_init();
 
-    uint32_t cr4 = read_cr4();
-    if (cpu_features.has_nx) {
-        cr4 |= (1 << 14);  // 启用NX位
-    }
-    write_cr4(cr4);
+    // 启用必要的CPU特性
+    init_control_registers();
 
     kernel_printk("CPU初始化完成\n");
-    kernel_printk("CPU特性: FPU=%d MMX=%d SSE=%d SSE2=%d NX=%d\n",
+    kernel_printk("CPU特性: FPU=%d MMX=%d SSE=%d SSE2=%d NX=%d SEP=%d\n",
                   cpu_features.has_fpu, cpu_features.has_mmx,
                   cpu_features.has_sse, cpu_features.has_sse2,
-                  cpu_features.has_nx);
+                  cpu_features.has_nx, cpu_features.has_sep);
 }
\ No newline at end of file
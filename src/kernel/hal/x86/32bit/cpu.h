@@ -4,6 +4,7 @@
 #include <kernel.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <arch/cpu.h>
 
 // GDT结构
 struct gdt_entry {
@@ -88,6 +89,9 @@ struct cpu_features {
     bool has_xmm2;
     bool has_3dnow;
     bool has_3dnow_ext;
+    bool has_tsc;
+    bool has_invariant_tsc;         // 频率恒定且在深度睡眠中不停（CPUID 0x80000007）
+    bool has_sep;                   // SYSENTER/SYSEXIT可用
 };
 
 // 段选择子
@@ -96,13 +100,19 @@ struct cpu_features {
 #define USER_CS   0x18
 #define USER_DS   0x20
 
+// GDT：空、内核代码/数据、用户代码/数据、TSS、每CPU数据段（%fs）、
+// 用户态lsl读取CPU编号的段（段界限为CPU编号，见<sys/vdso.h>）
+#define GDT_ENTRIES  8
+#define TSS_SELECTOR 0x28
+#define CPUNUM_SELECTOR 0x38
+
 // 外部函数声明
 extern void gdt_flush(uint32_t gdt_ptr);
 extern void tss_flush(uint16_t tss_selector);
 extern void idt_flush(uint32_t idt_ptr);
-extern void exception_handlers[32];
-extern void irq_handlers[16];
-extern void syscall_handler(void);
+extern uint32_t interrupt_stubs[256];
+extern void syscall_int80_entry(void);
+extern void sysenter_entry(void);
 
 // CPU相关函数
 void cpu_init(void);
@@ -111,6 +121,9 @@ void disable_interrupts(void);
 bool are_interrupts_enabled(void);
 void cpu_halt(void);
 uint32_t get_cpu_id(void);
+void cpu_set_kernel_stack(uint32_t esp0);
+void cpu_set_idt_gate(uint8_t vector, void (*handler)(void));
+void cpu_init_ap(uint32_t cpu);
 const struct cpu_features* get_cpu_features(void);
 
 // 控制寄存器操作
@@ -133,9 +146,9 @@ void memory_barrier(void);
 void serialize(void);
 
 // GDT操作
-static inline void set_gdt_entry(int num, uint32_t base, uint32_t limit,
-                                uint8_t access, uint8_t gran) {
-    struct gdt_entry *entry = &gdt[num];
+static inline void set_gdt_entry(struct gdt_entry *table, int num, uint32_t base,
+                                uint32_t limit, uint8_t access, uint8_t gran) {
+    struct gdt_entry *entry = &table[num];
 
     entry->limit_low = (limit & 0xFFFF);
     entry->base_low = (base & 0xFFFF);
@@ -176,6 +189,18 @@ static inline void cpuid(uint32_t code, uint32_t *eax, uint32_t *ebx,
                   : "a"(code));
 }
 
+// 保存EFLAGS并关中断
+static inline uint32_t local_irq_save(void) {
+    uint32_t flags;
+    asm volatile ("pushf; popl %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+// 恢复EFLAGS（包括中断允许位）
+static inline void local_irq_restore(uint32_t flags) {
+    asm volatile ("pushl %0; popf" : : "r"(flags) : "memory", "cc");
+}
+
 // I/O端口操作
 static inline void outb(uint16_t port, uint8_t value) {
     asm volatile ("outb %0, %1" : : "a"(value), "Nd"(port));
@@ -220,6 +245,13 @@ static inline void wrmsr(uint32_t msr, uint64_t value) {
     asm volatile ("wrmsr" : : "c"(msr), "a"(low), "d"(high));
 }
 
+// SYSENTER使用的MSR
+#define MSR_IA32_SYSENTER_CS    0x174
+#define MSR_IA32_SYSENTER_ESP   0x175
+#define MSR_IA32_SYSENTER_EIP   0x176
+
+// 时间戳计数器rdtsc()与TTY系统共用，见<arch/cpu.h>
+
 // 控制台I/O端口定义
 #define VGA_BASE       0xB8000
 #define VGA_WIDTH      80
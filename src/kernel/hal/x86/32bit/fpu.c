@@ -0,0 +1,176 @@
+/*
+ * Vest-OS 惰性FPU/SSE上下文切换
+ * CR0.TS + #NM：只有真正使用FPU的线程才保存和恢复FPU状态
+ */
+
+#include <kernel.h>
+#include <hal/cpu.h>
+#include <hal/fpu.h>
+#include <sched.h>
+#include <klog.h>
+#include <arch/interrupt.h>
+#include <arch/percpu.h>
+
+// CR0/CR4位
+#define CR0_MP          (1 << 1)    // WAIT/FWAIT也检查TS
+#define CR0_EM          (1 << 2)    // 没有FPU，模拟
+#define CR0_TS          (1 << 3)    // 任务已切换，下一条FPU指令触发#NM
+#define CR0_NE          (1 << 5)    // FPU错误通过#MF报告
+#define CR4_OSFXSR      (1 << 9)    // 操作系统支持FXSAVE/FXRSTOR和SSE
+#define CR4_OSXMMEXCPT  (1 << 10)   // 操作系统处理SIMD浮点异常
+
+// 寄存器中装着谁的FPU状态（本时间片用过FPU的线程），NULL表示TS已置位
+static DEFINE_PER_CPU(struct thread *, fpu_owner);
+static DEFINE_PER_CPU(struct fpu_stat, fpu_stat);
+
+// 使用FXSAVE/FXRSTOR（否则FNSAVE/FRSTOR，不含SSE状态）
+static bool fpu_fxsr;
+
+static inline void *fpu_state(struct thread *thread)
+{
+    return (void *)(((uint32_t)thread->fpu_area + FPU_STATE_ALIGN - 1) & ~(FPU_STATE_ALIGN - 1));
+}
+
+static inline void fpu_clts(void)
+{
+    asm volatile ("clts");
+}
+
+static inline void fpu_stts(void)
+{
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+static inline void fpu_save(void *state)
+{
+    if (fpu_fxsr) {
+        asm volatile ("fxsave (%0)" : : "r"(state) : "memory");
+    } else {
+        asm volatile ("fnsave (%0)" : : "r"(state) : "memory");
+    }
+}
+
+static inline void fpu_restore(const void *state)
+{
+    if (fpu_fxsr) {
+        asm volatile ("fxrstor (%0)" : : "r"(state) : "memory");
+    } else {
+        asm volatile ("frstor (%0)" : : "r"(state) : "memory");
+    }
+}
+
+/**
+ * 线程第一次使用FPU：复位x87和MXCSR
+ */
+static inline void fpu_reset(void)
+{
+    asm volatile ("fninit");
+
+    if (fpu_fxsr && get_cpu_features()->has_sse) {
+        uint32_t mxcsr = FPU_MXCSR_DEFAULT;
+        asm volatile ("ldmxcsr %0" : : "m"(mxcsr));
+    }
+}
+
+/**
+ * #NM：当前线程在TS置位时使用了FPU（中断门，关中断执行）
+ */
+static void fpu_nm_interrupt(interrupt_frame_t *frame, void *data)
+{
+    (void)frame;
+    (void)data;
+
+    struct thread *curr = current_thread();
+
+    fpu_clts();
+    this_cpu_inc(fpu_stat.traps);
+
+    // 上一个所有者切换走时已经保存，寄存器中没有需要保留的状态
+    if (curr->fpu_used) {
+        fpu_restore(fpu_state(curr));
+        this_cpu_inc(fpu_stat.restores);
+    } else {
+        fpu_reset();
+        curr->fpu_used = 1;
+        this_cpu_inc(fpu_stat.inits);
+    }
+
+    this_cpu_write(fpu_owner, curr);
+}
+
+/**
+ * 切换走prev之前调用（关中断）：只有本时间片用过FPU的线程需要保存
+ */
+void fpu_switch_out(struct thread *prev)
+{
+    if (this_cpu_read(fpu_owner) != prev) {
+        return;
+    }
+
+    // 退出的线程不再需要它的状态
+    if (prev->state != THREAD_DEAD) {
+        fpu_save(fpu_state(prev));
+        this_cpu_inc(fpu_stat.saves);
+    }
+
+    this_cpu_write(fpu_owner, NULL);
+    fpu_stts();
+}
+
+/**
+ * 读取某个CPU的FPU统计
+ */
+void fpu_get_stat(uint32_t cpu, struct fpu_stat *stat)
+{
+    if (cpu >= NR_CPUS || !stat) {
+        return;
+    }
+    *stat = *per_cpu_ptr(&fpu_stat, cpu);
+}
+
+/**
+ * 设置本CPU的FPU控制位（每个CPU各自调用），之后第一次使用FPU触发#NM
+ */
+void fpu_init_cpu(void)
+{
+    const struct cpu_features *features = get_cpu_features();
+
+    if (!features->has_fpu) {
+        return;
+    }
+
+    fpu_fxsr = features->has_fxsr;
+
+    uint32_t cr0 = read_cr0();
+    cr0 &= ~CR0_EM;
+    cr0 |= CR0_MP | CR0_NE;
+    write_cr0(cr0);
+
+    if (fpu_fxsr) {
+        uint32_t cr4 = read_cr4() | CR4_OSFXSR;
+        if (features->has_sse) {
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        write_cr4(cr4);
+    }
+
+    fpu_clts();
+    asm volatile ("fninit");
+    fpu_stts();
+}
+
+/**
+ * 登记#NM处理函数（BSP，interrupt_init之后调用）
+ */
+void fpu_init(void)
+{
+    if (!get_cpu_features()->has_fpu) {
+        kernel_printk(KERN_INFO "FPU: 不存在\n");
+        return;
+    }
+
+    interrupt_register(FPU_NM_VECTOR, fpu_nm_interrupt, NULL, "#NM");
+
+    kernel_printk(KERN_INFO "FPU: 惰性切换，%s\n",
+                  get_cpu_features()->has_fxsr ? "FXSAVE/FXRSTOR" : "FNSAVE/FRSTOR");
+}
@@ -0,0 +1,37 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <kernel.h>
+#include <stdint.h>
+
+/*
+ * Vest-OS 惰性FPU/SSE上下文切换
+ * 切换线程时不保存也不恢复FPU状态，只保证CR0.TS置位；线程在时间片内
+ * 第一次执行FPU/SSE指令时触发#NM，处理函数清除TS、恢复该线程的状态
+ * 并把它记为本CPU的FPU所有者。所有者被切换走时才保存状态（线程之后
+ * 可能在其他CPU上运行）。从不使用FPU的线程切换时没有额外开销。
+ */
+
+// #NM（设备不可用）异常向量
+#define FPU_NM_VECTOR           7
+
+// MXCSR复位值：屏蔽所有SIMD浮点异常
+#define FPU_MXCSR_DEFAULT       0x1F80
+
+struct thread;
+
+// 每CPU FPU统计
+struct fpu_stat {
+    uint32_t traps;                 // #NM次数
+    uint32_t inits;                 // 线程第一次使用FPU
+    uint32_t restores;              // 恢复已保存的状态
+    uint32_t saves;                 // 所有者被切换走时保存状态
+};
+
+// FPU接口
+void fpu_init(void);
+void fpu_init_cpu(void);
+void fpu_switch_out(struct thread *prev);
+void fpu_get_stat(uint32_t cpu, struct fpu_stat *stat);
+
+#endif // FPU_H
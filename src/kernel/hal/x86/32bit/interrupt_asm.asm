@@ -0,0 +1,70 @@
+; Vest-OS 32位中断入口
+; 每个向量一个小入口，统一保存寄存器后调用interrupt_dispatch(frame)
+
+[BITS 32]
+
+%define KERNEL_DS  0x10
+%define PERCPU_SEL 0x30
+
+extern interrupt_dispatch
+extern interrupt_exit
+
+section .text
+
+; 每个向量一个入口。CPU自己压入错误码的异常直接压向量号，
+; 其余向量先补一个0错误码，使帧布局一致
+%assign vec 0
+%rep 256
+interrupt_stub_ %+ vec:
+%if vec == 8 || (vec >= 10 && vec <= 14) || vec == 17 || vec == 21 || vec == 29 || vec == 30
+    push dword vec
+%else
+    push dword 0
+    push dword vec
+%endif
+    jmp interrupt_common
+%assign vec vec + 1
+%endrep
+
+; 公共入口：栈上已有 错误码、向量号 和CPU压入的返回现场
+interrupt_common:
+    pushad
+    push ds
+    push es
+    push fs
+    push gs
+
+    ; 内核数据段，%fs指向本CPU的每CPU数据区
+    mov ax, KERNEL_DS
+    mov ds, ax
+    mov es, ax
+    mov gs, ax
+    mov ax, PERCPU_SEL
+    mov fs, ax
+
+    ; interrupt_frame_t *frame
+    push esp
+    call interrupt_dispatch
+    add esp, 4
+
+    ; 嵌套已退出：处理下半部和抢占
+    call interrupt_exit
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popad
+    add esp, 8          ; 向量号和错误码
+    iret
+
+; 入口地址表（cpu.c据此填IDT）
+section .rodata
+align 4
+global interrupt_stubs
+interrupt_stubs:
+%assign vec 0
+%rep 256
+    dd interrupt_stub_ %+ vec
+%assign vec vec + 1
+%endrep
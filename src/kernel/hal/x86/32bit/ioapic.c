@@ -0,0 +1,242 @@
+/*
+ * Vest-OS IOAPIC驱动
+ * ISA IRQ路由、按IRQ设置投递CPU，LAPIC EOI
+ */
+
+#include <kernel.h>
+#include <hal/cpu.h>
+#include <hal/apic.h>
+#include <hal/smp.h>
+#include <hal/ioapic.h>
+#include <arch/pic.h>
+#include <kernel/spinlock.h>
+#include <klog.h>
+
+// IMCR端口（MP规范PIC模式）
+#define IMCR_ADDRESS        0x22
+#define IMCR_DATA           0x23
+#define IMCR_SELECT         0x70
+#define IMCR_APIC_MODE      0x01
+
+// 每个IRQ的路由
+struct ioapic_route {
+    volatile uint32_t *base;    // 所在IOAPIC
+    uint32_t pin;               // IOAPIC引脚
+    uint32_t gsi;               // 全局系统中断号
+    uint32_t low;               // 重定向表项低32位（不含屏蔽位）
+    uint32_t cpu;               // 投递的逻辑CPU
+    bool masked;
+};
+
+static struct ioapic_route ioapic_routes[IRQ_COUNT];
+
+// 重定向表访问通过选择/窗口寄存器对，多CPU需要互斥
+static DEFINE_SPINLOCK(ioapic_lock);
+
+static inline uint32_t ioapic_read(volatile uint32_t *base, uint32_t reg)
+{
+    base[IOAPIC_REGSEL / 4] = reg;
+    return base[IOAPIC_WINDOW / 4];
+}
+
+static inline void ioapic_write(volatile uint32_t *base, uint32_t reg, uint32_t value)
+{
+    base[IOAPIC_REGSEL / 4] = reg;
+    base[IOAPIC_WINDOW / 4] = value;
+}
+
+/**
+ * 写一个IRQ的重定向表项（先写目标，最后写低32位）
+ */
+static void ioapic_write_route(const struct ioapic_route *route)
+{
+    uint32_t reg = IOAPIC_REG_REDTBL + route->pin * 2;
+    uint32_t low = route->low | (route->masked ? IOAPIC_RTE_MASKED : 0);
+
+    ioapic_write(route->base, reg + 1, (uint32_t)smp_config.apic_ids[route->cpu] << 24);
+    ioapic_write(route->base, reg, low);
+}
+
+/**
+ * ISA IRQ对应的全局系统中断号
+ */
+uint32_t ioapic_irq_to_gsi(uint8_t irq)
+{
+    for (uint32_t i = 0; i < smp_config.nr_overrides; i++) {
+        if (smp_config.overrides[i].source == irq) {
+            return smp_config.overrides[i].gsi;
+        }
+    }
+    return irq;
+}
+
+/**
+ * IRQ当前投递的CPU
+ */
+uint32_t ioapic_irq_cpu(uint8_t irq)
+{
+    return irq < IRQ_COUNT ? ioapic_routes[irq].cpu : 0;
+}
+
+/**
+ * ISA IRQ的触发方式（默认高电平有效、边沿触发）
+ */
+static uint32_t ioapic_irq_flags(uint8_t irq)
+{
+    uint32_t low = 0;
+
+    for (uint32_t i = 0; i < smp_config.nr_overrides; i++) {
+        const struct smp_irq_override *ovr = &smp_config.overrides[i];
+        if (ovr->source != irq) {
+            continue;
+        }
+        if ((ovr->flags & INTI_POLARITY_MASK) == INTI_POLARITY_LOW) {
+            low |= IOAPIC_RTE_ACTIVE_LOW;
+        }
+        if ((ovr->flags & INTI_TRIGGER_MASK) == INTI_TRIGGER_LEVEL) {
+            low |= IOAPIC_RTE_LEVEL;
+        }
+        break;
+    }
+
+    return low;
+}
+
+static void ioapic_enable(uint8_t irq)
+{
+    struct ioapic_route *route = &ioapic_routes[irq];
+    if (!route->base) {
+        return;
+    }
+
+    uint32_t flags = spinlock_lock_irqsave(&ioapic_lock);
+    route->masked = false;
+    ioapic_write_route(route);
+    spinlock_unlock_irqrestore(&ioapic_lock, flags);
+}
+
+static void ioapic_disable(uint8_t irq)
+{
+    struct ioapic_route *route = &ioapic_routes[irq];
+    if (!route->base) {
+        return;
+    }
+
+    uint32_t flags = spinlock_lock_irqsave(&ioapic_lock);
+    route->masked = true;
+    ioapic_write_route(route);
+    spinlock_unlock_irqrestore(&ioapic_lock, flags);
+}
+
+static void ioapic_eoi(uint8_t irq)
+{
+    (void)irq;
+
+    // 一次MMIO写，无需访问PIC端口
+    lapic_eoi();
+}
+
+static int ioapic_set_affinity(uint8_t irq, uint32_t cpu)
+{
+    struct ioapic_route *route = &ioapic_routes[irq];
+    if (!route->base || cpu >= smp_config.nr_cpus) {
+        return -1;
+    }
+
+    uint32_t flags = spinlock_lock_irqsave(&ioapic_lock);
+    route->cpu = cpu;
+    ioapic_write_route(route);
+    spinlock_unlock_irqrestore(&ioapic_lock, flags);
+
+    return 0;
+}
+
+const interrupt_controller_t ioapic_controller = {
+    .name = "IO-APIC",
+    .enable = ioapic_enable,
+    .disable = ioapic_disable,
+    .eoi = ioapic_eoi,
+    .set_affinity = ioapic_set_affinity,
+};
+
+/**
+ * 查找负责某个GSI的IOAPIC
+ */
+static volatile uint32_t *ioapic_for_gsi(uint32_t gsi, uint32_t *pin)
+{
+    for (uint32_t i = 0; i < smp_config.nr_ioapics; i++) {
+        volatile uint32_t *base = (volatile uint32_t *)smp_config.ioapics[i].address;
+        uint32_t first = smp_config.ioapics[i].gsi_base;
+        uint32_t count = ((ioapic_read(base, IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+
+        if (gsi >= first && gsi < first + count) {
+            *pin = gsi - first;
+            return base;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 屏蔽所有IOAPIC引脚
+ */
+static void ioapic_mask_all(void)
+{
+    for (uint32_t i = 0; i < smp_config.nr_ioapics; i++) {
+        volatile uint32_t *base = (volatile uint32_t *)smp_config.ioapics[i].address;
+        uint32_t count = ((ioapic_read(base, IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+
+        for (uint32_t pin = 0; pin < count; pin++) {
+            ioapic_write(base, IOAPIC_REG_REDTBL + pin * 2, IOAPIC_RTE_MASKED);
+        }
+    }
+}
+
+/**
+ * 从PIC切换到IOAPIC（需要LAPIC已启用，在smp_init中调用）
+ * 没有IOAPIC时返回false，继续使用PIC
+ */
+bool ioapic_init(void)
+{
+    if (!lapic_available() || smp_config.nr_ioapics == 0) {
+        kernel_printk(KERN_INFO "中断: 未找到IOAPIC，使用8259A\n");
+        return false;
+    }
+
+    uint32_t flags = local_irq_save();
+
+    // PIC上已经打开的IRQ迁移后保持打开
+    uint16_t pic_mask = pic_get_mask();
+
+    ioapic_mask_all();
+
+    for (uint8_t irq = 0; irq < IRQ_COUNT; irq++) {
+        struct ioapic_route *route = &ioapic_routes[irq];
+
+        route->gsi = ioapic_irq_to_gsi(irq);
+        route->base = ioapic_for_gsi(route->gsi, &route->pin);
+        route->low = ioapic_irq_flags(irq) | (IRQ_BASE + irq);
+        route->cpu = 0;
+        route->masked = true;
+
+        // IRQ2是PIC级联线，在IOAPIC下没有意义
+        if (route->base && irq != 2 && !(pic_mask & (1u << irq))) {
+            route->masked = false;
+            ioapic_write_route(route);
+        }
+    }
+
+    // 屏蔽PIC，PIC模式的系统还要通过IMCR把中断线接到APIC
+    pic_disable();
+    if (smp_config.imcr_present) {
+        outb(IMCR_ADDRESS, IMCR_SELECT);
+        outb(IMCR_DATA, IMCR_APIC_MODE);
+    }
+
+    interrupt_set_controller(&ioapic_controller);
+
+    local_irq_restore(flags);
+
+    kernel_printk(KERN_INFO "中断: 使用IOAPIC（%d个），EOI经LAPIC\n", smp_config.nr_ioapics);
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef IOAPIC_H
+#define IOAPIC_H
+
+#include <kernel.h>
+#include <arch/interrupt.h>
+
+/*
+ * Vest-OS IOAPIC驱动
+ * 把ISA IRQ经重定向表投递到指定CPU的LAPIC，中断结束只写LAPIC EOI
+ */
+
+// IOAPIC寄存器窗口
+#define IOAPIC_REGSEL           0x00
+#define IOAPIC_WINDOW           0x10
+
+// IOAPIC寄存器
+#define IOAPIC_REG_ID           0x00
+#define IOAPIC_REG_VERSION      0x01
+#define IOAPIC_REG_REDTBL       0x10
+
+// 重定向表项（低32位）
+#define IOAPIC_RTE_MASKED       (1u << 16)
+#define IOAPIC_RTE_LEVEL        (1u << 15)
+#define IOAPIC_RTE_ACTIVE_LOW   (1u << 13)
+
+// MPS INTI标志（MADT中断重定向和MP表共用）
+#define INTI_POLARITY_MASK      0x3
+#define INTI_POLARITY_LOW       0x3
+#define INTI_TRIGGER_MASK       0xC
+#define INTI_TRIGGER_LEVEL      0xC
+
+extern const interrupt_controller_t ioapic_controller;
+
+// IOAPIC接口
+bool ioapic_init(void);
+uint32_t ioapic_irq_to_gsi(uint8_t irq);
+uint32_t ioapic_irq_cpu(uint8_t irq);
+
+#endif // IOAPIC_H
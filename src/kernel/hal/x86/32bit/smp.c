@@ -0,0 +1,620 @@
+/*
+ * Vest-OS 多处理器启动
+ * ACPI MADT / MP表解析、INIT-SIPI-SIPI唤醒AP和处理器间中断
+ */
+
+#include <kernel.h>
+#include <hal/cpu.h>
+#include <hal/apic.h>
+#include <hal/smp.h>
+#include <hal/ioapic.h>
+#include <arch/interrupt.h>
+#include <kernel/rcu.h>
+#include <sched.h>
+#include <timer.h>
+#include <klog.h>
+
+// ACPI根系统描述指针
+struct acpi_rsdp {
+    char signature[8];
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;
+    uint32_t rsdt_address;
+} __attribute__((packed));
+
+// ACPI表头
+struct acpi_sdt_header {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed));
+
+// MADT
+struct acpi_madt {
+    struct acpi_sdt_header header;
+    uint32_t lapic_address;
+    uint32_t flags;
+} __attribute__((packed));
+
+// MADT条目
+#define MADT_LAPIC          0
+#define MADT_IOAPIC         1
+#define MADT_OVERRIDE       2
+#define MADT_LAPIC_ENABLED  0x1
+
+struct madt_entry {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed));
+
+struct madt_lapic {
+    struct madt_entry header;
+    uint8_t processor_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} __attribute__((packed));
+
+struct madt_ioapic {
+    struct madt_entry header;
+    uint8_t id;
+    uint8_t reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+} __attribute__((packed));
+
+struct madt_override {
+    struct madt_entry header;
+    uint8_t bus;
+    uint8_t source;
+    uint32_t gsi;
+    uint16_t flags;
+} __attribute__((packed));
+
+// MP浮动指针结构
+struct mp_floating {
+    char signature[4];
+    uint32_t config;
+    uint8_t length;
+    uint8_t spec_rev;
+    uint8_t checksum;
+    uint8_t features[5];
+} __attribute__((packed));
+
+// MP配置表头
+struct mp_config_table {
+    char signature[4];
+    uint16_t length;
+    uint8_t spec_rev;
+    uint8_t checksum;
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_size;
+    uint16_t entry_count;
+    uint32_t lapic_address;
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+} __attribute__((packed));
+
+// MP配置表条目
+#define MP_PROCESSOR        0
+#define MP_BUS              1
+#define MP_IOAPIC           2
+#define MP_IOINTR           3
+#define MP_LINTR            4
+#define MP_CPU_ENABLED      0x1
+#define MP_IOAPIC_ENABLED   0x1
+#define MP_FEATURE2_IMCRP   0x80
+
+struct mp_processor {
+    uint8_t type;
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} __attribute__((packed));
+
+struct mp_bus {
+    uint8_t type;
+    uint8_t bus_id;
+    char bus_type[6];
+} __attribute__((packed));
+
+struct mp_ioapic {
+    uint8_t type;
+    uint8_t id;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t address;
+} __attribute__((packed));
+
+struct mp_iointr {
+    uint8_t type;
+    uint8_t irq_type;
+    uint16_t flags;
+    uint8_t src_bus;
+    uint8_t src_irq;
+    uint8_t dst_ioapic;
+    uint8_t dst_pin;
+} __attribute__((packed));
+
+// 传给跳板的启动参数（布局与smp_boot.asm一致）
+struct ap_boot_params {
+    uint32_t cr3;
+    uint32_t stack;
+    uint32_t entry;
+    uint32_t cpu;
+} __attribute__((packed));
+
+// 跳板代码（smp_boot.asm）
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_end[];
+extern uint8_t smp_trampoline_params[];
+
+// CR0分页位
+#define CR0_PG              0x80000000
+
+// 等待AP上线的时间（微秒）
+#define AP_BOOT_TIMEOUT_US  100000
+
+struct smp_config smp_config;
+
+// APIC ID -> 逻辑CPU号（未初始化时全部映射到CPU0）
+static uint8_t apic_to_cpu[256];
+
+// 已上线的CPU数量（包括BSP）
+static volatile uint32_t smp_online_count = 1;
+
+// AP启动栈
+static uint8_t ap_stacks[NR_CPUS][SMP_AP_STACK_SIZE] __attribute__((aligned(16)));
+
+/**
+ * 校验和（所有字节相加为0）
+ */
+static bool smp_checksum_ok(const void *data, uint32_t length)
+{
+    const uint8_t *p = data;
+    uint8_t sum = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        sum += p[i];
+    }
+    return sum == 0;
+}
+
+/**
+ * 在物理内存区间内按16字节边界查找签名
+ */
+static const void *smp_scan(uint32_t start, uint32_t length, const char *signature,
+                            uint32_t sig_len, uint32_t struct_len)
+{
+    for (uint32_t addr = start; addr + struct_len <= start + length; addr += 16) {
+        if (memcmp((const void *)addr, signature, sig_len) == 0 &&
+            smp_checksum_ok((const void *)addr, struct_len)) {
+            return (const void *)addr;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 依次在EBDA、基本内存末尾和BIOS ROM中查找结构
+ */
+static const void *smp_find_bios_struct(const char *signature, uint32_t sig_len,
+                                        uint32_t struct_len)
+{
+    uint32_t ebda = (uint32_t)(*(volatile uint16_t *)0x40E) << 4;
+    const void *found = NULL;
+
+    if (ebda) {
+        found = smp_scan(ebda, 1024, signature, sig_len, struct_len);
+    }
+    if (!found) {
+        found = smp_scan(0x9FC00, 1024, signature, sig_len, struct_len);
+    }
+    if (!found) {
+        found = smp_scan(0xE0000, 0x20000, signature, sig_len, struct_len);
+    }
+    return found;
+}
+
+/**
+ * 登记一个CPU
+ */
+static void smp_add_cpu(uint8_t apic_id)
+{
+    for (uint32_t i = 0; i < smp_config.nr_cpus; i++) {
+        if (smp_config.apic_ids[i] == apic_id) {
+            return;
+        }
+    }
+
+    if (smp_config.nr_cpus >= NR_CPUS) {
+        kernel_printk(KERN_WARNING "SMP: 忽略APIC %d（超过NR_CPUS=%d）\n", apic_id, NR_CPUS);
+        return;
+    }
+
+    smp_config.apic_ids[smp_config.nr_cpus++] = apic_id;
+}
+
+/**
+ * 登记一个IOAPIC
+ */
+static void smp_add_ioapic(uint8_t id, uint32_t address, uint32_t gsi_base)
+{
+    if (smp_config.nr_ioapics >= SMP_MAX_IOAPICS) {
+        return;
+    }
+
+    struct smp_ioapic *ioapic = &smp_config.ioapics[smp_config.nr_ioapics++];
+    ioapic->id = id;
+    ioapic->address = address;
+    ioapic->gsi_base = gsi_base;
+}
+
+/**
+ * 登记一个ISA中断重定向
+ */
+static void smp_add_override(uint8_t source, uint32_t gsi, uint16_t flags)
+{
+    if (smp_config.nr_overrides >= SMP_MAX_IRQ_OVERRIDES) {
+        return;
+    }
+
+    struct smp_irq_override *ovr = &smp_config.overrides[smp_config.nr_overrides++];
+    ovr->source = source;
+    ovr->gsi = gsi;
+    ovr->flags = flags;
+}
+
+/**
+ * 解析ACPI MADT
+ */
+static bool smp_parse_acpi(void)
+{
+    const struct acpi_rsdp *rsdp = smp_find_bios_struct("RSD PTR ", 8, sizeof(struct acpi_rsdp));
+    if (!rsdp) {
+        return false;
+    }
+
+    const struct acpi_sdt_header *rsdt = (const void *)rsdp->rsdt_address;
+    if (memcmp(rsdt->signature, "RSDT", 4) != 0 || !smp_checksum_ok(rsdt, rsdt->length)) {
+        return false;
+    }
+
+    // 在RSDT中查找MADT（签名"APIC"）
+    const struct acpi_madt *madt = NULL;
+    uint32_t nr_tables = (rsdt->length - sizeof(*rsdt)) / 4;
+    const uint32_t *tables = (const uint32_t *)(rsdt + 1);
+
+    for (uint32_t i = 0; i < nr_tables; i++) {
+        const struct acpi_sdt_header *sdt = (const void *)tables[i];
+        if (memcmp(sdt->signature, "APIC", 4) == 0 && smp_checksum_ok(sdt, sdt->length)) {
+            madt = (const struct acpi_madt *)sdt;
+            break;
+        }
+    }
+    if (!madt) {
+        return false;
+    }
+
+    smp_config.lapic_base = madt->lapic_address;
+
+    const uint8_t *p = (const uint8_t *)(madt + 1);
+    const uint8_t *end = (const uint8_t *)madt + madt->header.length;
+
+    while (p + sizeof(struct madt_entry) <= end) {
+        const struct madt_entry *entry = (const void *)p;
+        if (entry->length < sizeof(*entry)) {
+            break;
+        }
+
+        switch (entry->type) {
+        case MADT_LAPIC: {
+            const struct madt_lapic *lapic = (const void *)entry;
+            if (lapic->flags & MADT_LAPIC_ENABLED) {
+                smp_add_cpu(lapic->apic_id);
+            }
+            break;
+        }
+        case MADT_IOAPIC: {
+            const struct madt_ioapic *ioapic = (const void *)entry;
+            smp_add_ioapic(ioapic->id, ioapic->address, ioapic->gsi_base);
+            break;
+        }
+        case MADT_OVERRIDE: {
+            const struct madt_override *ovr = (const void *)entry;
+            if (ovr->bus == 0) {
+                smp_add_override(ovr->source, ovr->gsi, ovr->flags);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        p += entry->length;
+    }
+
+    smp_config.source = "ACPI";
+    return smp_config.nr_cpus > 0;
+}
+
+/**
+ * 解析Intel MP配置表（没有ACPI时的后备）
+ */
+static bool smp_parse_mp(void)
+{
+    const struct mp_floating *mpf = smp_find_bios_struct("_MP_", 4, sizeof(struct mp_floating));
+    if (!mpf || !mpf->config) {
+        return false;  // 没有配置表（默认配置）按单CPU处理
+    }
+
+    const struct mp_config_table *conf = (const void *)mpf->config;
+    if (memcmp(conf->signature, "PCMP", 4) != 0 || !smp_checksum_ok(conf, conf->length)) {
+        return false;
+    }
+
+    smp_config.lapic_base = conf->lapic_address;
+    smp_config.imcr_present = (mpf->features[1] & MP_FEATURE2_IMCRP) != 0;
+
+    const uint8_t *p = (const uint8_t *)(conf + 1);
+    int isa_bus = -1;
+
+    for (uint32_t i = 0; i < conf->entry_count; i++) {
+        switch (*p) {
+        case MP_PROCESSOR: {
+            const struct mp_processor *cpu = (const void *)p;
+            if (cpu->flags & MP_CPU_ENABLED) {
+                smp_add_cpu(cpu->apic_id);
+            }
+            p += sizeof(*cpu);
+            break;
+        }
+        case MP_BUS: {
+            const struct mp_bus *bus = (const void *)p;
+            if (memcmp(bus->bus_type, "ISA", 3) == 0) {
+                isa_bus = bus->bus_id;
+            }
+            p += sizeof(*bus);
+            break;
+        }
+        case MP_IOAPIC: {
+            const struct mp_ioapic *ioapic = (const void *)p;
+            if (ioapic->flags & MP_IOAPIC_ENABLED) {
+                // MP表没有GSI基址，按登记顺序每个IOAPIC 24个引脚
+                smp_add_ioapic(ioapic->id, ioapic->address, smp_config.nr_ioapics * 24);
+            }
+            p += sizeof(*ioapic);
+            break;
+        }
+        case MP_IOINTR: {
+            const struct mp_iointr *intr = (const void *)p;
+            // 只记录与ISA IRQ号不一致的中断（类型0为向量中断）
+            if (intr->irq_type == 0 && intr->src_bus == isa_bus &&
+                intr->src_irq != intr->dst_pin) {
+                smp_add_override(intr->src_irq, intr->dst_pin, intr->flags);
+            }
+            p += sizeof(*intr);
+            break;
+        }
+        case MP_LINTR:
+            p += 8;
+            break;
+        default:
+            // 未知条目无法确定长度，停止解析
+            i = conf->entry_count;
+            break;
+        }
+    }
+
+    smp_config.source = "MP";
+    return smp_config.nr_cpus > 0;
+}
+
+/**
+ * 让BSP成为逻辑CPU0，建立APIC ID到逻辑CPU号的映射
+ */
+static void smp_setup_cpu_map(void)
+{
+    uint8_t bsp = (uint8_t)lapic_id();
+
+    for (uint32_t i = 1; i < smp_config.nr_cpus; i++) {
+        if (smp_config.apic_ids[i] == bsp) {
+            smp_config.apic_ids[i] = smp_config.apic_ids[0];
+            smp_config.apic_ids[0] = bsp;
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < smp_config.nr_cpus; i++) {
+        apic_to_cpu[smp_config.apic_ids[i]] = (uint8_t)i;
+    }
+}
+
+/**
+ * AP的C入口（由跳板在AP自己的栈上调用）
+ */
+static void smp_ap_entry(uint32_t cpu)
+{
+    // 自己的GDT/TSS，共享IDT
+    cpu_init_ap(cpu);
+
+    lapic_enable();
+    lapic_timer_start(HZ);
+
+    sched_cpu_online(cpu);
+
+    barrier();
+    __sync_fetch_and_add(&smp_online_count, 1);
+
+    kernel_printk(KERN_INFO "SMP: CPU%d (APIC %d) 已上线\n", cpu, smp_config.apic_ids[cpu]);
+
+    // 启动上下文成为本CPU的空闲线程
+    sched_idle_loop();
+}
+
+/**
+ * 唤醒一个AP并等待它上线
+ */
+static bool smp_boot_ap(uint32_t cpu)
+{
+    struct ap_boot_params *params = (struct ap_boot_params *)
+        (SMP_TRAMPOLINE_ADDR + (smp_trampoline_params - smp_trampoline_start));
+    uint32_t apic_id = smp_config.apic_ids[cpu];
+    uint32_t online = smp_online_count;
+
+    params->cr3 = (read_cr0() & CR0_PG) ? read_cr3() : 0;
+    params->stack = (uint32_t)&ap_stacks[cpu][SMP_AP_STACK_SIZE];
+    params->entry = (uint32_t)smp_ap_entry;
+    params->cpu = cpu;
+    memory_barrier();
+
+    // INIT，等待10ms，然后最多两次STARTUP
+    lapic_send_init(apic_id);
+    timer_udelay(10000);
+
+    for (int i = 0; i < 2 && smp_online_count == online; i++) {
+        lapic_send_startup(apic_id, SMP_TRAMPOLINE_ADDR >> 12);
+        timer_udelay(200);
+    }
+
+    for (uint32_t waited = 0; waited < AP_BOOT_TIMEOUT_US && smp_online_count == online;
+         waited += 100) {
+        timer_udelay(100);
+    }
+
+    return smp_online_count != online;
+}
+
+/**
+ * 枚举CPU并唤醒所有AP（在scheduler_init之后调用）
+ */
+void smp_init(void)
+{
+    memset(&smp_config, 0, sizeof(smp_config));
+
+    if (!get_cpu_features()->has_apic || (!smp_parse_acpi() && !smp_parse_mp())) {
+        smp_config.source = NULL;
+        smp_config.nr_cpus = 1;
+        kernel_printk(KERN_INFO "SMP: 未找到多处理器配置，单CPU运行\n");
+        return;
+    }
+
+    lapic_init(smp_config.lapic_base);
+    smp_setup_cpu_map();
+
+    // LAPIC中断（伪中断不登记处理函数，也不需要EOI）
+    interrupt_register(LAPIC_TIMER_VECTOR, smp_lapic_timer, NULL, "LAPIC timer");
+    interrupt_register(IPI_RESCHEDULE_VECTOR, smp_ipi_reschedule, NULL, "resched IPI");
+    interrupt_register(IPI_STOP_VECTOR, smp_ipi_stop, NULL, "stop IPI");
+
+    // 外部中断改由IOAPIC投递（没有IOAPIC时继续使用PIC）
+    ioapic_init();
+
+    // AP没有PIT中断，用LAPIC定时器驱动时间片；BSP也改用LAPIC定时器，
+    // 各CPU空闲时才能各自停掉节拍
+    lapic_timer_calibrate();
+    timer_use_lapic();
+
+    // 复制跳板到低端内存
+    memcpy((void *)SMP_TRAMPOLINE_ADDR, smp_trampoline_start,
+           (uint32_t)(smp_trampoline_end - smp_trampoline_start));
+
+    for (uint32_t cpu = 1; cpu < smp_config.nr_cpus; cpu++) {
+        if (!smp_boot_ap(cpu)) {
+            kernel_printk(KERN_WARNING "SMP: CPU%d (APIC %d) 启动超时\n",
+                          cpu, smp_config.apic_ids[cpu]);
+        }
+    }
+
+    kernel_printk(KERN_INFO "SMP: %s报告%d个CPU，%d个已上线，%d个IOAPIC\n",
+                  smp_config.source, smp_config.nr_cpus, smp_online_count,
+                  smp_config.nr_ioapics);
+}
+
+/**
+ * APIC ID对应的逻辑CPU号
+ */
+uint32_t smp_cpu_from_apic(uint32_t apic_id)
+{
+    return apic_to_cpu[apic_id & 0xFF];
+}
+
+/**
+ * 已上线的CPU数量
+ */
+uint32_t smp_num_online(void)
+{
+    return smp_online_count;
+}
+
+/**
+ * 通知目标CPU重新调度（目标是当前CPU时无需IPI）
+ */
+void smp_send_reschedule(uint32_t cpu)
+{
+    if (!lapic_available() || cpu >= smp_config.nr_cpus || cpu == sched_this_cpu()) {
+        return;
+    }
+
+    lapic_send_ipi(smp_config.apic_ids[cpu], IPI_RESCHEDULE_VECTOR);
+}
+
+/**
+ * 停止其他所有CPU（内核崩溃时使用）
+ */
+void smp_send_stop(void)
+{
+    if (lapic_available() && smp_online_count > 1) {
+        lapic_broadcast_ipi(IPI_STOP_VECTOR);
+    }
+}
+
+/**
+ * LAPIC定时器中断（抢占在中断返回前进行）
+ */
+void smp_lapic_timer(interrupt_frame_t *frame, void *data)
+{
+    (void)data;
+
+    lapic_eoi();
+    if (frame->cs & 3) {
+        rcu_user_tick();
+    }
+    timer_tick();
+}
+
+/**
+ * 重新调度IPI：need_resched已由发送方设置，中断返回前切换
+ */
+void smp_ipi_reschedule(interrupt_frame_t *frame, void *data)
+{
+    (void)frame;
+    (void)data;
+
+    lapic_eoi();
+}
+
+/**
+ * 停止IPI：关中断停机
+ */
+void smp_ipi_stop(interrupt_frame_t *frame, void *data)
+{
+    (void)frame;
+    (void)data;
+
+    for (;;) {
+        asm volatile ("cli; hlt");
+    }
+}
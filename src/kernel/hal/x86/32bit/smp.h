@@ -0,0 +1,64 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <kernel.h>
+#include <arch/cpu.h>
+#include <arch/interrupt.h>
+
+/*
+ * Vest-OS 多处理器启动
+ * 从ACPI MADT（或MP表）枚举CPU和IOAPIC，用INIT-SIPI-SIPI唤醒AP，
+ * 每个AP使用自己的GDT/TSS/栈，上线后进入调度器空闲循环。
+ */
+
+// AP启动跳板的物理地址（4KB对齐，低于1MB）
+#define SMP_TRAMPOLINE_ADDR     0x8000
+
+// 每个AP启动栈大小（之后作为该CPU空闲线程的栈）
+#define SMP_AP_STACK_SIZE       8192
+
+#define SMP_MAX_IOAPICS         4
+#define SMP_MAX_IRQ_OVERRIDES   16
+
+// IOAPIC
+struct smp_ioapic {
+    uint8_t id;
+    uint32_t address;
+    uint32_t gsi_base;
+};
+
+// ISA中断重定向
+struct smp_irq_override {
+    uint8_t source;     // ISA IRQ
+    uint32_t gsi;       // 全局系统中断号
+    uint16_t flags;     // 极性/触发方式（MPS INTI标志）
+};
+
+// 固件描述的多处理器配置
+struct smp_config {
+    const char *source;                 // "ACPI"、"MP"或NULL
+    uint32_t lapic_base;
+    uint32_t nr_cpus;
+    uint8_t apic_ids[NR_CPUS];          // 逻辑CPU号 -> APIC ID，0是BSP
+    uint32_t nr_ioapics;
+    struct smp_ioapic ioapics[SMP_MAX_IOAPICS];
+    uint32_t nr_overrides;
+    struct smp_irq_override overrides[SMP_MAX_IRQ_OVERRIDES];
+    bool imcr_present;                  // PIC模式：需要通过IMCR切换到APIC
+};
+
+extern struct smp_config smp_config;
+
+// SMP接口
+void smp_init(void);
+uint32_t smp_cpu_from_apic(uint32_t apic_id);
+uint32_t smp_num_online(void);
+void smp_send_reschedule(uint32_t cpu);
+void smp_send_stop(void);
+
+// LAPIC中断处理
+void smp_lapic_timer(interrupt_frame_t *frame, void *data);
+void smp_ipi_reschedule(interrupt_frame_t *frame, void *data);
+void smp_ipi_stop(interrupt_frame_t *frame, void *data);
+
+#endif // SMP_H
@@ -0,0 +1,83 @@
+; Vest-OS 32位SMP启动代码
+; AP实模式启动跳板
+
+; 跳板被复制到的物理地址（与SMP_TRAMPOLINE_ADDR一致）
+TRAMPOLINE_BASE equ 0x8000
+
+; 跳板内标号的运行地址
+%define TADDR(label) (TRAMPOLINE_BASE + (label) - smp_trampoline_start)
+
+section .text
+
+; ---------------------------------------------------------------------
+; AP启动跳板：STARTUP IPI后AP在实模式下从TRAMPOLINE_BASE开始执行。
+; 进入保护模式，按需开启分页，切到BSP准备的栈后调用smp_ap_entry(cpu)。
+; ---------------------------------------------------------------------
+[BITS 16]
+global smp_trampoline_start
+smp_trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+
+    ; 临时GDT只含平坦代码段和数据段
+    lgdt [TADDR(tramp_gdt_ptr)]
+
+    mov eax, cr0
+    or eax, 1               ; PE
+    mov cr0, eax
+
+    jmp dword 0x08:TADDR(tramp_protected)
+
+[BITS 32]
+tramp_protected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; BSP已开启分页时使用同一个页目录
+    mov eax, [TADDR(smp_trampoline_params)]
+    test eax, eax
+    jz .no_paging
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80000000      ; PG
+    mov cr0, eax
+.no_paging:
+
+    mov esp, [TADDR(smp_trampoline_params) + 4]
+    push dword [TADDR(smp_trampoline_params) + 12]
+    mov eax, [TADDR(smp_trampoline_params) + 8]
+    call eax
+
+.hang:
+    cli
+    hlt
+    jmp .hang
+
+align 8
+tramp_gdt:
+    dq 0
+    dq 0x00CF9A000000FFFF   ; 内核代码段
+    dq 0x00CF92000000FFFF   ; 内核数据段
+tramp_gdt_end:
+
+tramp_gdt_ptr:
+    dw tramp_gdt_end - tramp_gdt - 1
+    dd TADDR(tramp_gdt)
+
+; 启动参数（struct ap_boot_params）：cr3, stack, entry, cpu
+align 4
+global smp_trampoline_params
+smp_trampoline_params:
+    dd 0
+    dd 0
+    dd 0
+    dd 0
+
+global smp_trampoline_end
+smp_trampoline_end:
@@ -0,0 +1,104 @@
+; Vest-OS 32位系统调用入口
+; int 0x80和SYSENTER建立相同的interrupt_frame_t，由syscall.c统一分发
+
+[BITS 32]
+
+%define KERNEL_DS  0x10
+%define USER_CS    0x18
+%define USER_DS    0x20
+%define PERCPU_SEL 0x30
+
+%define EFLAGS_IF  0x200
+
+extern syscall_entry
+extern sysenter_dispatch
+extern interrupt_exit
+
+section .text
+
+; int 0x80：CPU已压入用户的ss/esp/eflags/cs/eip
+global syscall_int80_entry
+syscall_int80_entry:
+    push dword 0        ; 错误码
+    push dword 0x80     ; 向量号
+    pushad
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, KERNEL_DS
+    mov ds, ax
+    mov es, ax
+    mov gs, ax
+    mov ax, PERCPU_SEL
+    mov fs, ax
+
+    ; 系统调用开中断执行
+    sti
+
+    push esp
+    call syscall_entry
+    add esp, 4
+
+    cli
+    call interrupt_exit
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popad
+    add esp, 8
+    iret
+
+; SYSENTER：CPU只切换了cs/ss/esp/eip并关闭中断，esp指向本CPU临时栈上的esp0。
+; 用户态约定见syscall.h：ebp指向用户栈上的返回地址
+global sysenter_entry
+sysenter_entry:
+    mov esp, [esp]      ; 当前线程的内核栈
+
+    ; 补出与int 0x80相同的返回现场，eip和用户栈由sysenter_dispatch填写
+    push dword USER_DS | 3
+    push ebp
+    pushfd
+    or dword [esp], EFLAGS_IF
+    push dword USER_CS | 3
+    push dword 0
+    push dword 0
+    push dword 0x80
+    pushad
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, KERNEL_DS
+    mov ds, ax
+    mov es, ax
+    mov gs, ax
+    mov ax, PERCPU_SEL
+    mov fs, ax
+
+    sti
+
+    push esp
+    call sysenter_dispatch
+    add esp, 4
+
+    cli
+    call interrupt_exit
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popad
+    add esp, 8
+
+    ; 栈上剩下eip、cs、eflags、用户esp、ss
+    mov edx, [esp]
+    mov ecx, [esp + 12]
+    ; sti的延迟生效保证sysexit之前不会进入中断
+    sti
+    sysexit
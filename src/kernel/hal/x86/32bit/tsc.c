@@ -0,0 +1,78 @@
+/*
+ * Vest-OS 时间戳计数器
+ * 用PIT通道2校准TSC频率，判断能否作为高精度时钟源
+ */
+
+#include <kernel.h>
+#include <hal/cpu.h>
+#include <hal/tsc.h>
+#include <timer.h>
+#include <klog.h>
+#include <arch/interrupt.h>
+
+// 校准得到的频率（kHz），0表示未校准
+static uint32_t tsc_khz;
+
+// 不变TSC且已校准
+static bool tsc_stable;
+
+/**
+ * 测量一个PIT校准窗口内的TSC周期数（关中断）
+ */
+static uint64_t tsc_measure_window(void)
+{
+    uint64_t start = rdtsc();
+    timer_udelay(TSC_CALIBRATE_US);
+    return rdtsc() - start;
+}
+
+/**
+ * 校准TSC频率（BSP，timer_init中调用）
+ * 返回TSC是否可以作为时钟源
+ */
+bool tsc_init(void)
+{
+    const struct cpu_features *features = get_cpu_features();
+
+    if (!features->has_tsc) {
+        kernel_printk(KERN_INFO "TSC: 不支持\n");
+        return false;
+    }
+
+    uint32_t flags = interrupt_save_and_disable();
+
+    uint64_t best = ~0ull;
+    for (int i = 0; i < TSC_CALIBRATE_LOOPS; i++) {
+        uint64_t cycles = tsc_measure_window();
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+
+    interrupt_restore(flags);
+
+    // 窗口为10ms，周期数除以10即为kHz（32位内：TSC低于约430GHz）
+    tsc_khz = (uint32_t)best / (TSC_CALIBRATE_US / 1000);
+    tsc_stable = features->has_invariant_tsc && tsc_khz != 0;
+
+    kernel_printk(KERN_INFO "TSC: %d kHz%s\n", tsc_khz,
+                  tsc_stable ? "，不变TSC" : "，频率可能变化，不作为时钟源");
+
+    return tsc_stable;
+}
+
+/**
+ * TSC能否作为时钟源
+ */
+bool tsc_reliable(void)
+{
+    return tsc_stable;
+}
+
+/**
+ * 校准得到的TSC频率（kHz）
+ */
+uint32_t tsc_get_khz(void)
+{
+    return tsc_khz;
+}
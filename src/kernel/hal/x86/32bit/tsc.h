@@ -0,0 +1,22 @@
+#ifndef TSC_H
+#define TSC_H
+
+#include <kernel.h>
+#include <stdint.h>
+
+/*
+ * Vest-OS 时间戳计数器
+ * 开机时用PIT通道2校准TSC频率；只有不变TSC（频率不随调频和睡眠变化）
+ * 才作为时钟源，否则时间维护退回到时钟节拍
+ */
+
+// 校准窗口（微秒）和次数，取最短的一次排除SMI等干扰
+#define TSC_CALIBRATE_US        10000
+#define TSC_CALIBRATE_LOOPS     3
+
+// TSC接口
+bool tsc_init(void);
+bool tsc_reliable(void);
+uint32_t tsc_get_khz(void);
+
+#endif // TSC_H
@@ -0,0 +1,72 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include <kernel.h>
+
+/*
+ * ELF32文件格式（只包含加载静态可执行文件用到的部分）
+ */
+
+#define EI_NIDENT       16
+#define EI_CLASS        4
+#define EI_DATA         5
+#define EI_VERSION      6
+
+#define ELFMAG0         0x7F
+#define ELFMAG1         'E'
+#define ELFMAG2         'L'
+#define ELFMAG3         'F'
+#define ELFCLASS32      1
+#define ELFDATA2LSB     1
+#define EV_CURRENT      1
+
+#define ET_EXEC         2
+#define EM_386          3
+
+// 程序头类型
+#define PT_NULL         0
+#define PT_LOAD         1
+#define PT_INTERP       3
+
+// 段权限
+#define PF_X            0x1
+#define PF_W            0x2
+#define PF_R            0x4
+
+// 辅助向量
+#define AT_NULL         0
+#define AT_PHDR         3
+#define AT_PHENT        4
+#define AT_PHNUM        5
+#define AT_PAGESZ       6
+#define AT_ENTRY        9
+
+typedef struct {
+    uint8_t  e_ident[EI_NIDENT];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint32_t e_entry;
+    uint32_t e_phoff;
+    uint32_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} Elf32_Ehdr;
+
+typedef struct {
+    uint32_t p_type;
+    uint32_t p_offset;
+    uint32_t p_vaddr;
+    uint32_t p_paddr;
+    uint32_t p_filesz;
+    uint32_t p_memsz;
+    uint32_t p_flags;
+    uint32_t p_align;
+} Elf32_Phdr;
+
+#endif // ELF_H
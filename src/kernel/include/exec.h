@@ -0,0 +1,34 @@
+#ifndef EXEC_H
+#define EXEC_H
+
+#include <kernel.h>
+#include <mm.h>
+
+/*
+ * Vest-OS ELF加载
+ *
+ * SYS_EXEC把调用者的用户地址空间换成一个静态链接的ELF32可执行文件：
+ * 每个PT_LOAD段成为一个以文件为后备的VMA（文件内容之后的.bss填0），
+ * 栈是匿名VMA。加载时不读入也不复制任何页，程序只为实际访问到的页
+ * 产生页故障（见<mm.h>）。
+ * 只读段直接映射页缓存，运行同一程序的所有地址空间共享同一份代码页。
+ *
+ * 新栈按i386 System V约定布置：argc、argv[]、NULL、envp[]、NULL、
+ * 辅助向量（AT_PHDR、AT_PHENT、AT_PHNUM、AT_PAGESZ、AT_ENTRY），
+ * 入口处通用寄存器为0。
+ *
+ * 文件头、程序头、路径和参数都在拆除旧映射之前检查和复制，之后只有
+ * 内存耗尽会失败；成功时不返回到旧程序。
+ * 旧程序建立的提交/完成环（含轮询线程）在拆除映射之前释放。
+ */
+
+#define EXEC_ARG_MAX        (32 * 1024)         // argv和envp字符串总长
+#define EXEC_PHNUM_MAX      16
+#define EXEC_STACK_SIZE     (8 * 1024 * 1024)   // 栈VMA大小，按需分配
+#define EXEC_STACK_TOP      MM_USER_TOP
+
+// SYS_EXEC：ebx=路径，ecx=argv，edx=envp（argv、envp可为NULL）
+int32_t sys_exec(uint32_t path_addr, uint32_t argv_addr, uint32_t envp_addr,
+                 uint32_t arg4, uint32_t arg5);
+
+#endif // EXEC_H
@@ -0,0 +1,24 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <kernel.h>
+#include <sys/futex.h>
+
+/*
+ * Vest-OS futex
+ *
+ * 等待者按uaddr的物理地址散列到一组桶中，每个桶是一把自旋锁加一条
+ * 等待者链表；FUTEX_WAIT在桶锁下比较*uaddr并入队，唤醒者同样持桶锁
+ * 摘链后唤醒，因此用户态先改值再FUTEX_WAKE不会错过唤醒。
+ * FUTEX_REQUEUE同时持有两个桶的锁（按地址顺序）把等待者移到另一个key上。
+ *
+ * 等待者的链表节点在它自己的内核栈上：被唤醒或超时后它总要再取一次
+ * 所在桶的锁确认已摘链，唤醒者释放桶锁之后就不再引用它。
+ * 操作和返回值见<sys/futex.h>。
+ */
+
+// SYS_FUTEX：ebx=uaddr, ecx=操作, edx=val, esi=超时毫秒/移动数, edi=uaddr2
+int32_t sys_futex(uint32_t uaddr, uint32_t op, uint32_t val,
+                  uint32_t val2, uint32_t uaddr2);
+
+#endif // FUTEX_H
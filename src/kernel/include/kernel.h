@@ -31,6 +31,12 @@
 #define PAGE_SIZE 4096
 #define PAGE_SHIFT 12
 
+// 页表项标志
+#define PAGE_PRESENT    0x001
+#define PAGE_WRITE      0x002
+#define PAGE_USER       0x004
+#define PAGE_NOFREE     0x200   // 软件可用位：共享的内核页，取消映射时不释放
+
 // 内存布局
 #if ARCH_BITS == 32
     #define KERNEL_BASE_ADDR    0xC0000000
@@ -59,6 +65,14 @@
 #define SYS_MMAP         8
 #define SYS_MUNMAP       9
 #define SYS_IOCTL        10
+#define SYS_SYSLOG       11
+#define SYS_GETTID       12
+#define SYS_STAT         13
+#define SYS_URING_SETUP  14
+#define SYS_URING_ENTER  15
+#define SYS_FUTEX        16
+#define SYS_KSTAT        17
+#define NR_SYSCALLS      18
 
 // 错误码
 #define ERROR_NONE       0
@@ -68,11 +82,16 @@
 #define ERROR_BUSY       -4
 #define ERROR_PERM       -5
 #define ERROR_IO         -6
+#define ERROR_CANCELED   -7
+#define ERROR_AGAIN      -8
+#define ERROR_TIMEOUT    -9
 
 // 前向声明
 struct process;
 struct thread;
 struct tty_device;
+struct page_directory;
+struct mm_struct;
 
 // 内核启动函数
 void kernel_main(void);
@@ -82,7 +101,7 @@ void kernel_init(void);
 void hal_init(void);
 void memory_init(void);
 void scheduler_init(void);
-void interrupt_init(void);
+int interrupt_init(void);
 void tty_init(void);
 
 // 调试输出
@@ -92,8 +111,20 @@ void kernel_panic(const char *message);
 // 内存管理
 void *kmalloc(size_t size);
 void kfree(void *ptr);
+void *kmalloc_aligned(size_t size, size_t alignment);
 void *kmap_page(ptr_t physical);
 void kunmap_page(void *virtual);
+int map_page(struct page_directory *page_dir, uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags);
+int unmap_page(struct page_directory *page_dir, uint32_t virtual_addr);
+uint32_t get_physical_address(struct page_directory *page_dir, uint32_t virtual_addr);
+uint32_t get_page_entry(struct page_directory *page_dir, uint32_t virtual_addr);
+uint32_t alloc_page_frame(void);
+void free_page_frame(uint32_t physical_addr);
+struct page_directory *create_page_directory(void);
+void destroy_page_directory(struct page_directory *page_dir);
+void invalidate_page_directory(struct page_directory *page_dir);
+struct page_directory *current_page_directory(void);
+void switch_page_directory(struct page_directory *page_dir);
 
 // 进程管理
 struct process *create_process(void);
@@ -112,9 +143,9 @@ int tty_write(struct tty_device *tty, const char *data, size_t len);
 int tty_read(struct tty_device *tty, char *data, size_t len);
 struct tty_device *get_tty_device(int tty_id);
 
-// 系统调用处理
-void syscall_handler(uint32_t syscall_number, uint32_t arg1, uint32_t arg2,
-                     uint32_t arg3, uint32_t arg4, uint32_t arg5);
+// 系统调用处理（int 0x80和SYSENTER共用）
+int32_t syscall_handler(uint32_t syscall_number, uint32_t arg1, uint32_t arg2,
+                        uint32_t arg3, uint32_t arg4, uint32_t arg5);
 
 // 工具函数
 void memcpy(void *dest, const void *src, size_t n);
@@ -0,0 +1,69 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include <kernel.h>
+#include <stdarg.h>
+
+/*
+ * Vest-OS 内核日志环形缓冲区
+ *
+ * kernel_printk只在环中记录时间戳、级别、格式串指针和原始参数，
+ * 格式化和控制台输出推迟到klog_flush()中完成（空闲循环或显式调用）。
+ */
+
+// 日志级别前缀，用法: kernel_printk(KERN_ERR "...")
+#define KERN_EMERG      "<0>"
+#define KERN_ALERT      "<1>"
+#define KERN_CRIT       "<2>"
+#define KERN_ERR        "<3>"
+#define KERN_WARNING    "<4>"
+#define KERN_NOTICE     "<5>"
+#define KERN_INFO       "<6>"
+#define KERN_DEBUG      "<7>"
+
+#define printk kernel_printk
+
+// 未带级别前缀的消息使用的默认级别
+#define KLOG_DEFAULT_LEVEL  4
+
+// 环形缓冲区配置（记录数必须是2的幂）
+#define KLOG_RING_SIZE      512
+#define KLOG_RING_MASK      (KLOG_RING_SIZE - 1)
+#define KLOG_MAX_ARGS       8       // 每条记录保存的32位参数字数
+#define KLOG_TEXT_SIZE      48      // %s参数内联拷贝区大小
+#define KLOG_LINE_MAX       256     // 单条记录格式化后的最大长度
+
+// klogctl/syslog操作码（与Linux保持一致）
+#define KLOG_ACTION_READ_ALL     3
+#define KLOG_ACTION_READ_CLEAR   4
+#define KLOG_ACTION_CLEAR        5
+#define KLOG_ACTION_SIZE_BUFFER  10
+
+// 日志记录
+struct klog_record {
+    volatile uint32_t seq;          // 已提交的序号+1，0表示正在写入
+    uint8_t level;                  // 日志级别
+    uint8_t nargs;                  // 已保存的参数字数
+    uint16_t cpu;                   // 产生记录的CPU
+    uint64_t timestamp;             // 单调时钟时间戳（纳秒）
+    const char *fmt;                // 格式串（必须位于只读数据段）
+    uint32_t args[KLOG_MAX_ARGS];   // 原始参数
+    char text[KLOG_TEXT_SIZE];      // %s参数的拷贝
+};
+
+// 控制台输出回调
+typedef void (*klog_console_t)(const char *data, size_t len);
+
+// 日志接口
+void klog_vprintk(const char *format, va_list args);
+void klog_flush(void);
+void klog_set_console(klog_console_t console);
+void klog_set_console_level(int level);
+int klog_read_all(char *buf, size_t size);
+void klog_clear(void);
+uint32_t klog_dropped(void);
+
+// SYS_SYSLOG系统调用
+int sys_syslog(int type, char *buf, int len);
+
+#endif // KLOG_H
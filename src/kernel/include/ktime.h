@@ -0,0 +1,88 @@
+#ifndef KTIME_H
+#define KTIME_H
+
+#include <kernel.h>
+#include <sys/vdso.h>
+
+/*
+ * Vest-OS 时间维护
+ *
+ * 时钟源优先使用不变TSC（开机用PIT校准频率），读取时间只需一次rdtsc
+ * 和一次乘法移位；TSC不存在或频率会变化时退回到时钟节拍（PIT/LAPIC
+ * 驱动的jiffies），精度为一个节拍。
+ * 时间维护CPU每个节拍把已经过的周期数累加到基准时间，读者用顺序锁
+ * 读取基准，乘法不会溢出。
+ * 单调时钟从启动开始计时；实时时钟在单调时钟上加开机时从CMOS RTC
+ * 读出的偏移。
+ * 同样的参数每次更新后复制到vvar页，用户态不进入内核即可读取时间。
+ */
+
+#define NSEC_PER_USEC       1000u
+#define NSEC_PER_MSEC       1000000u
+#define NSEC_PER_SEC        1000000000u
+
+// 时钟类型
+#define CLOCK_REALTIME      0
+#define CLOCK_MONOTONIC     1
+
+// 秒和纳秒表示的时间
+struct ktimespec {
+    uint32_t tv_sec;
+    uint32_t tv_nsec;
+};
+
+// 时钟源：周期数经(cycles * mult) >> shift换算为纳秒
+struct clocksource {
+    const char *name;
+    uint64_t (*read)(void);
+    uint32_t mult;
+    uint32_t shift;
+    uint32_t vclock_mode;           // 用户态读取周期数的方式（VCLOCK_*）
+};
+
+// 时间维护状态（时间维护CPU写，读者用顺序锁读取）
+struct timekeeper {
+    const struct clocksource *clock;
+    uint64_t cycle_last;            // 上次累加时的周期数
+    uint64_t base_ns;               // cycle_last对应的单调时间
+    uint64_t base_frac;             // 换算时移出的不足1纳秒部分（<< shift）
+    uint64_t real_offset;           // 实时时钟减单调时钟
+};
+
+/**
+ * 64位被除数除以32位除数（没有libgcc的64位除法）
+ */
+static inline uint64_t div_u64_rem(uint64_t dividend, uint32_t divisor, uint32_t *remainder)
+{
+#if ARCH_BITS == 32
+    uint32_t high = (uint32_t)(dividend >> 32);
+    uint32_t low = (uint32_t)dividend;
+    uint32_t quot_high = high / divisor;
+    uint32_t quot_low;
+    uint32_t rem;
+
+    high %= divisor;
+    asm ("divl %4" : "=a"(quot_low), "=d"(rem) : "a"(low), "d"(high), "rm"(divisor));
+
+    if (remainder) {
+        *remainder = rem;
+    }
+    return ((uint64_t)quot_high << 32) | quot_low;
+#else
+    if (remainder) {
+        *remainder = (uint32_t)(dividend % divisor);
+    }
+    return dividend / divisor;
+#endif
+}
+
+// 时间维护接口
+void timekeeping_init(void);
+void timekeeping_tick(void);
+uint64_t ktime_get_ns(void);
+uint64_t ktime_get_real_ns(void);
+int ktime_get_ts(uint32_t clock, struct ktimespec *ts);
+void ktime_set_real_ns(uint64_t ns);
+const struct clocksource *clocksource_current(void);
+
+#endif // KTIME_H
@@ -0,0 +1,80 @@
+#ifndef MM_H
+#define MM_H
+
+#include <kernel.h>
+#include <kernel/spinlock.h>
+#include <sys/uring.h>
+
+/*
+ * Vest-OS 用户地址空间
+ *
+ * mm_struct记录一个页目录中哪些用户地址范围是合法的（vm_area），
+ * 页在第一次访问时由页故障处理程序映射：
+ *
+ *   整页都是文件内容  映射页缓存中的页（PAGE_NOFREE），所有映射同一
+ *                     文件的地址空间共享；可写的私有映射先只读映射，
+ *                     第一次写时复制到新页
+ *   文件末尾所在的页  复制到新页，文件内容之后填0（ELF段的.data/.bss交界）
+ *   匿名页            分配清零的新页（.bss、栈）
+ *
+ * 查找VMA和装入页表项都在mm->lock下进行，两个线程同时访问同一页时
+ * 后到者发现已映射，丢弃自己准备的页。
+ */
+
+// VMA可用的范围：第0页留空捕获空指针，URING_MAP_BASE以上是环和vvar
+#define MM_USER_BASE    PAGE_SIZE
+#define MM_USER_TOP     URING_MAP_BASE
+
+// VMA权限
+#define VM_READ         0x1
+#define VM_WRITE        0x2
+#define VM_EXEC         0x4
+
+// 页故障错误码
+#define PF_PROT         0x1     // 页存在，权限不符
+#define PF_WRITE        0x2
+#define PF_USER         0x4
+
+struct vm_file;
+
+struct vm_area {
+    uint32_t start;                     // 页对齐，[start, end)
+    uint32_t end;
+    uint32_t flags;                     // VM_*
+    struct vm_file *file;               // NULL为匿名映射
+    uint32_t file_offset;               // start处对应的文件偏移（页对齐）
+    uint32_t file_end;                  // 文件内容在此虚拟地址结束，之后填0
+    struct vm_area *next;               // 按地址排序
+};
+
+struct mm_struct {
+    struct page_directory *page_dir;
+    struct vm_area *vmas;
+    spinlock_t lock;                    // 保护vmas和用户页表项的装入
+};
+
+// page_dir为NULL时创建新的页目录
+struct mm_struct *mm_create(struct page_directory *page_dir);
+
+// 取消所有VMA及其中已映射的页，页目录保留
+void mm_clear(struct mm_struct *mm);
+
+// 添加VMA（不映射任何页），与已有VMA重叠或越出用户空间时返回ERROR_INVALID
+int mm_map(struct mm_struct *mm, uint32_t start, uint32_t end, uint32_t flags,
+           struct vm_file *file, uint32_t file_offset, uint32_t file_end);
+
+// 当前线程用户地址空间的页故障，已处理返回0
+int handle_mm_fault(uint32_t fault_addr, uint32_t error_code);
+
+// 当前线程能否读（write时写）用户范围[addr, addr + size)，必要时先装入其中的页
+bool mm_access_ok(uint32_t addr, uint32_t size, int write);
+
+// 与用户空间之间复制：先用mm_access_ok检查，不可访问时返回ERROR_INVALID
+// 而不是在内核中产生页故障
+int copy_from_user(void *dst, uint32_t src, uint32_t size);
+int copy_to_user(uint32_t dst, const void *src, uint32_t size);
+
+// 复制以'\0'结尾的字符串，返回长度；size字节内没有结尾时返回ERROR_NOMEM
+int strncpy_from_user(char *dst, uint32_t src, uint32_t size);
+
+#endif // MM_H
@@ -0,0 +1,51 @@
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <kernel.h>
+#include <kernel/spinlock.h>
+
+/*
+ * Vest-OS 页缓存
+ *
+ * 每个可映射的文件对应一个vm_file，按页号缓存物理页帧。页在第一次
+ * 被访问时通过read_page读入，之后一直留在缓存中：映射到用户空间时
+ * 带PAGE_NOFREE，所有映射同一文件同一页的地址空间共享同一个物理页，
+ * 取消映射或删除页目录都不释放它。
+ *
+ * 还没有文件系统，文件按路径注册到一个全局表中；启动模块等已在内存
+ * 中的镜像用vm_file_register_memory注册，文件系统接入后提供自己的
+ * read_page即可。注册后的文件不再删除。
+ */
+
+#define VM_FILE_NAME_MAX    64
+
+struct vm_file;
+
+// 读入第index页到buf（一整页），文件尾之后的部分填0
+typedef int (*vm_read_page_fn)(struct vm_file *file, uint32_t index, void *buf);
+
+struct vm_file {
+    char name[VM_FILE_NAME_MAX];
+    uint32_t size;                      // 文件大小（字节）
+    vm_read_page_fn read_page;
+    void *private;                      // read_page使用的数据
+    spinlock_t lock;                    // 保护pages
+    uint32_t nr_pages;
+    uint32_t *pages;                    // 每页的物理帧，0表示尚未读入
+    uint32_t nr_cached;                 // 已读入的页数
+    struct vm_file *next;
+};
+
+// 注册文件，同名已存在时返回NULL
+struct vm_file *vm_file_register(const char *name, uint32_t size,
+                                 vm_read_page_fn read_page, void *private);
+struct vm_file *vm_file_register_memory(const char *name, const void *data, uint32_t size);
+struct vm_file *vm_file_lookup(const char *name);
+
+// 第index页的物理帧（必要时读入），超出文件或读取失败返回0
+uint32_t vm_file_get_page(struct vm_file *file, uint32_t index);
+
+// 经页缓存读取，返回读到的字节数或错误码
+int32_t vm_file_read(struct vm_file *file, uint32_t offset, void *buf, uint32_t len);
+
+#endif // PAGECACHE_H
@@ -0,0 +1,137 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <kernel.h>
+#include <arch/cpu.h>
+#include <kernel/spinlock.h>
+#include <timer.h>
+
+/*
+ * Vest-OS 调度器
+ *
+ * 每个CPU一个运行队列，时钟中断递减时间片并在中断返回时抢占。
+ * 队列按优先级分为多个FIFO，用位图和bsf在常数时间内找到最高优先级。
+ * 长时间睡眠（例如等待终端输入）的线程获得优先级奖励，唤醒后先于
+ * CPU密集型任务运行。本地队列为空时从最忙的队列窃取线程，窃取和唤醒
+ * 都遵守CPU亲和性掩码。
+ */
+
+// CPU掩码（每位对应一个CPU）
+typedef uint32_t cpumask_t;
+
+#define CPUMASK_ALL         ((cpumask_t)((1u << NR_CPUS) - 1))
+#define CPUMASK_CPU(cpu)    ((cpumask_t)(1u << (cpu)))
+
+// 优先级（数值越小越优先），每级一个FIFO队列，位图记录非空队列
+#define SCHED_PRIO_LEVELS       32
+#define SCHED_PRIO_DEFAULT      16
+#define SCHED_MAX_BONUS         5       // 睡眠奖励/CPU密集惩罚的最大级数
+#define SCHED_MAX_SLEEP_AVG     HZ      // sleep_avg上限（时钟节拍）
+
+// 调度参数
+#define SCHED_TIMESLICE_TICKS   5       // 时间片长度（时钟节拍）
+#define SCHED_BALANCE_TICKS     20      // 空闲CPU周期性窃取间隔
+#define KTHREAD_STACK_SIZE      8192    // 内核线程栈大小
+#define THREAD_NAME_LEN         16
+
+// FPU/SSE状态保存区（FXSAVE要求16字节对齐，线程结构由kmalloc分配，使用时再对齐）
+#define FPU_STATE_SIZE          512
+#define FPU_STATE_ALIGN         16
+
+// 线程状态
+enum thread_state {
+    THREAD_NEW = 0,         // 已创建，尚未启动
+    THREAD_RUNNABLE,        // 在运行队列中等待
+    THREAD_RUNNING,         // 正在某个CPU上运行
+    THREAD_BLOCKED,         // 睡眠，等待sched_wake
+    THREAD_DEAD             // 已退出，切换走后释放
+};
+
+// 线程控制块
+struct thread {
+    uint32_t esp;                   // 切换时保存的栈指针（必须是第一个成员）
+    uint32_t tid;                   // 线程ID
+    volatile uint32_t state;        // 线程状态
+    volatile uint32_t on_cpu;       // 上下文尚未保存完毕，其他CPU不能运行它
+    volatile uint32_t wake_pending; // 运行中被唤醒，下一次sched_block不睡眠
+    uint32_t requeue;               // 被换下时仍可运行，切换完成后由sched_finish_switch入队
+    uint32_t cpu;                   // 所在（或最近运行的）CPU
+    cpumask_t affinity;             // 允许运行的CPU
+    uint32_t timeslice;             // 剩余时间片
+    uint32_t static_prio;           // 基础优先级
+    uint32_t prio;                  // 加上交互奖励后的动态优先级
+    uint32_t sleep_avg;             // 睡眠得分：睡眠时增加，运行时递减
+    uint64_t sleep_start;           // 开始睡眠时的jiffies
+    struct process *process;        // 所属进程，内核线程为NULL
+    struct page_directory *page_dir;    // 运行时使用的地址空间，NULL表示沿用上一个线程的
+    struct mm_struct *mm;           // 用户地址空间的VMA，内核线程为NULL
+    void *stack;                    // 内核栈
+    void (*entry)(void *arg);       // 线程入口
+    void *arg;                      // 入口参数
+    struct thread *next;            // 运行队列链表
+    struct thread *next_all;        // 所有线程的链表（KSTAT_SCHED遍历）
+    uint64_t exec_start;            // 本次开始运行的sched_clock
+    uint64_t ready_since;           // 进入运行队列的sched_clock
+    uint64_t runtime_ns;            // 累计运行时间
+    uint64_t wait_ns;               // 累计在运行队列中等待的时间
+    uint32_t nr_switches;           // 被调度运行的次数
+    char name[THREAD_NAME_LEN];     // 线程名
+    uint32_t fpu_used;              // 用过FPU，fpu_area中有保存的状态
+    uint8_t fpu_area[FPU_STATE_SIZE + FPU_STATE_ALIGN - 1];    // FPU/SSE状态（惰性保存）
+};
+
+// 每CPU运行队列
+struct runqueue {
+    spinlock_t lock;                // 保护队列、位图和nr_running
+    uint32_t bitmap;                // 第p位表示优先级p的队列非空
+    struct thread *head[SCHED_PRIO_LEVELS];     // 每个优先级的FIFO
+    struct thread *tail[SCHED_PRIO_LEVELS];
+    volatile uint32_t nr_running;   // 队列中的线程数（不含curr）
+    struct thread *curr;            // 当前线程
+    struct thread *idle;            // 空闲线程（CPU的启动上下文）
+    volatile uint32_t need_resched; // 中断返回时需要调度
+    uint32_t balance_ticks;         // 距下次窃取检查的节拍数
+    uint32_t online;                // CPU是否参与调度
+    uint64_t switches;              // 上下文切换次数
+    uint64_t steals;                // 从其他队列窃取的线程数
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+// 调度器接口
+void scheduler_init(void);
+void sched_cpu_online(uint32_t cpu);
+void sched_idle_loop(void) __attribute__((noreturn));
+void scheduler_tick(void);
+void sched_preempt(void);
+void interrupt_exit(void);
+void sched_yield(void);
+void sched_block(void);
+void sched_wake(struct thread *thread);
+struct thread *current_thread(void);
+uint32_t sched_this_cpu(void);
+
+// 线程的调度统计，SYS_KSTAT的KSTAT_SCHED表逐线程输出
+struct sched_stat {
+    uint64_t runtime_ns;            // 累计运行时间
+    uint64_t wait_ns;               // 累计就绪等待时间
+    uint32_t nr_switches;           // 被调度运行的次数
+    uint32_t prio;                  // 当前动态优先级
+};
+
+void sched_get_stat(struct thread *thread, struct sched_stat *stat);
+int sched_stat_show(char *buf, size_t size);
+int thread_set_priority(struct thread *thread, uint32_t prio);
+
+// 线程接口
+struct thread *kthread_create(const char *name, void (*entry)(void *arg), void *arg);
+int thread_start(struct thread *thread, void (*entry)(void *arg), void *arg);
+int thread_set_affinity(struct thread *thread, cpumask_t mask);
+void thread_exit(void) __attribute__((noreturn));
+
+// 软中断线程
+void ksoftirqd_init(void);
+void ksoftirqd_start(uint32_t cpu);
+
+// 上下文切换微基准
+void sched_bench_pingpong(uint32_t iterations);
+
+#endif // SCHED_H
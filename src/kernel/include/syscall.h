@@ -0,0 +1,51 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <kernel.h>
+#include <arch/interrupt.h>
+
+/*
+ * Vest-OS 系统调用入口
+ *
+ * 两个入口的调用约定相同：eax为调用号，ebx、ecx、edx、esi、edi依次为
+ * 参数，返回值在eax中，其余寄存器保持不变。
+ *
+ * 调用号越界或未实现时返回ERROR_INVALID。分发经过syscall_table，
+ * 每个调用在返回的CPU上累计次数和耗时。
+ *
+ * int 0x80：任何x86 CPU都可用，代价是一次完整的中断门进出。
+ *
+ * SYSENTER（CPUID报告SEP时）：CPU不保存返回地址和用户栈，SYSEXIT又要
+ * 用ecx、edx带回用户栈和返回地址，因此用户态按如下方式进入：
+ *
+ *     push ecx
+ *     push edx
+ *     push ebp
+ *     push 返回地址
+ *     mov  ebp, esp
+ *     sysenter
+ *
+ * 内核从[ebp]取返回地址，返回时esp = ebp + 4，用户态再依次弹出ebp、
+ * edx、ecx。标志寄存器不保证保持不变。
+ * ebp未对齐或不可读时无处返回，内核结束调用线程。
+ */
+
+/**
+ * 用户指针范围检查
+ */
+static inline bool access_ok(uint32_t addr, uint32_t size)
+{
+    return addr <= USER_SPACE_END && size <= USER_SPACE_END - addr + 1;
+}
+
+// 汇编入口调用的分发函数
+void syscall_entry(interrupt_frame_t *frame);
+void sysenter_dispatch(interrupt_frame_t *frame);
+
+// 所有CPU上的调用次数和耗时（TSC周期）之和
+void syscall_get_stat(uint32_t nr, uint64_t *count, uint64_t *cycles);
+
+// 生成syscalls表（SYS_KSTAT的KSTAT_SYSCALLS）
+int syscall_stat_show(char *buf, size_t size);
+
+#endif // SYSCALL_H
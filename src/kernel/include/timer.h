@@ -0,0 +1,45 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <kernel.h>
+#include <arch/interrupt.h>
+#include <kernel/timer_wheel.h>
+
+/*
+ * Vest-OS 系统时钟
+ * 周期性时钟节拍驱动jiffies和调度器时间片；有LAPIC时各CPU在空闲期间
+ * 停掉节拍，按下一个到期事件单次定时（动态时钟）
+ */
+
+// PIT输入频率（时钟频率HZ见kernel/timer_wheel.h）
+#define PIT_FREQUENCY   1193182
+
+// 停掉节拍后最长的睡眠时间（节拍）
+#define NOHZ_MAX_SLEEP_TICKS    (HZ * 2)
+
+// 启动以来的时钟节拍数
+extern volatile uint64_t jiffies;
+
+// 每CPU时钟统计
+struct tick_stat {
+    uint32_t timer_irqs;            // 时钟中断次数
+    uint32_t idle_wakeups;          // 从空闲停机中被唤醒的次数
+    uint32_t tick_stops;            // 空闲时停掉节拍的次数
+    uint32_t skipped_ticks;         // 停掉节拍期间跳过的节拍数
+};
+
+// 时钟接口
+void timer_init(void);
+void timer_tick(void);
+void timer_interrupt(interrupt_frame_t *frame, void *data);
+void timer_use_lapic(void);
+uint64_t sched_clock(void);
+void timer_udelay(uint32_t us);
+
+// 动态时钟
+void tick_nohz_idle_enter(void);
+void tick_nohz_idle_exit(void);
+void tick_get_stat(uint32_t cpu, struct tick_stat *stat);
+int tick_stat_show(char *buf, size_t size);
+
+#endif // TIMER_H
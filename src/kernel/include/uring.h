@@ -0,0 +1,30 @@
+#ifndef URING_H
+#define URING_H
+
+#include <kernel.h>
+#include <sys/uring.h>
+
+/*
+ * Vest-OS 提交/完成环
+ *
+ * 环的内存从内核堆分配，按页映射到建立者地址空间的固定槽中
+ * （URING_MAP_BASE + id * URING_MAP_SLOT，PAGE_NOFREE）；内核通过自己的
+ * 映射读写环，SQE中的缓冲区仍是用户指针，因此执行请求时必须处在
+ * 建立者的地址空间：非轮询模式由SYS_URING_ENTER在调用者上下文执行，
+ * 轮询线程把thread->page_dir设为建立者的页目录。
+ *
+ * 每个请求转换成对应的系统调用，经syscall_handler分发，参数检查和
+ * 统计与直接调用相同。
+ * 布局和用户态接口见<sys/uring.h>。
+ */
+
+// SYS_URING_SETUP / SYS_URING_ENTER
+int32_t sys_uring_setup(uint32_t params_addr, uint32_t arg2, uint32_t arg3,
+                        uint32_t arg4, uint32_t arg5);
+int32_t sys_uring_enter(uint32_t id, uint32_t to_submit, uint32_t min_complete,
+                        uint32_t flags, uint32_t arg5);
+
+// exec切换地址空间之前释放调用者的环，轮询线程不再访问旧程序的内存
+void uring_exec_release(void);
+
+#endif // URING_H
@@ -0,0 +1,25 @@
+#ifndef VDSO_H
+#define VDSO_H
+
+#include <kernel.h>
+#include <ktime.h>
+#include <sys/vdso.h>
+
+/*
+ * Vest-OS vvar页
+ *
+ * 内核中的一个整页，create_page_directory把它只读映射到每个进程的
+ * VVAR_ADDR（所有进程共享同一物理页，删除页目录时不释放）。
+ * 布局和用户态读取方法见<sys/vdso.h>。
+ */
+
+// vvar页的内核地址
+void *vdso_vvar_page(void);
+
+// 时间维护参数改变后更新（持有时间维护的写锁）
+void vdso_update_time(const struct timekeeper *tk);
+
+// 前台TTY切换后更新
+void vdso_update_tty(int tty_id);
+
+#endif // VDSO_H
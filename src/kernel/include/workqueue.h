@@ -0,0 +1,113 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <kernel.h>
+#include <kernel/spinlock.h>
+#include <kernel/timer_wheel.h>
+#include <kernel/wait.h>
+
+/*
+ * Vest-OS 工作队列
+ *
+ * 把可以睡眠的慢操作（刷新输出缓冲、清零页面、回写日志、重启服务等）
+ * 从系统调用和中断路径移到内核线程中执行。每个工作队列在每个CPU上
+ * 有一个工作线程池，工作在提交它的CPU上执行；前面的工作睡眠时池中
+ * 按需增加线程，但每CPU并发数不超过max_active。
+ * 中断上下文可以提交工作，处理函数在线程上下文中开中断运行。
+ *
+ * 同一个工作项不会并发执行：处理函数开始前清除pending，执行期间可以
+ * 再次提交；取到这样的工作时若它仍在另一个线程中执行（按工作地址查
+ * 池的busy_hash），交给那个线程在当前实例结束后执行。
+ */
+
+// 每CPU工作线程数上限
+#define WQ_MAX_ACTIVE           4
+
+// 正在执行的工作 -> 工作线程，按工作地址散列
+#define WQ_BUSY_HASH_SIZE       8
+
+struct work_struct;
+struct workqueue;
+typedef void (*work_func_t)(struct work_struct *work);
+
+// 工作项（通常嵌入在使用者的结构中）
+struct work_struct {
+    struct work_struct *next;
+    volatile uint32_t pending;      // 已在队列中或正在等待延迟到期
+    uint64_t seq;                   // 最近一次入队的序号（池的nr_queued）
+    work_func_t func;
+};
+
+// 延迟工作项：定时器到期后提交到原CPU的队列
+struct delayed_work {
+    struct work_struct work;
+    struct workqueue *wq;
+    uint32_t cpu;                   // 提交时所在的CPU
+    timer_list_t timer;
+};
+
+// 工作线程
+struct worker {
+    struct thread *thread;
+    struct worker_pool *pool;
+    struct worker *next_idle;
+    bool idle;                      // 在池的空闲链表中
+    struct work_struct *current_work;   // 正在执行的工作
+    uint64_t current_seq;               // 正在执行的工作入队时的序号
+    struct worker *hash_next;           // busy_hash链
+    struct work_struct *scheduled;      // 当前工作执行中又被提交，结束后接着执行
+};
+
+// 每CPU工作线程池
+struct worker_pool {
+    spinlock_t lock;                // 保护队列和线程计数
+    uint32_t cpu;
+    uint32_t max_active;
+    struct work_struct *head;       // 待处理工作（FIFO）
+    struct work_struct *tail;
+    struct worker *idle;            // 空闲线程
+    struct worker *busy_hash[WQ_BUSY_HASH_SIZE];    // 正在执行工作的线程
+    uint32_t nr_workers;            // 线程数
+    uint32_t nr_running;            // 正在执行工作的线程数
+    uint64_t nr_queued;             // 累计提交数，也是最近入队工作的序号
+    uint64_t nr_done;               // 累计完成数
+    wait_queue_head_t flush_wait;   // flush_workqueue等待序号之前的工作全部完成
+};
+
+// 工作队列
+struct workqueue {
+    const char *name;
+    struct worker_pool pools[NR_CPUS];
+};
+
+#define INIT_WORK(w, f) do {        \
+    (w)->next = NULL;               \
+    (w)->pending = 0;               \
+    (w)->func = (f);                \
+} while (0)
+
+#define INIT_DELAYED_WORK(d, f) do {                        \
+    INIT_WORK(&(d)->work, (f));                             \
+    (d)->wq = NULL;                                         \
+    timer_setup(&(d)->timer, delayed_work_timer_fn, (d));   \
+} while (0)
+
+// 由工作项得到延迟工作项
+#define to_delayed_work(w) \
+    ((struct delayed_work *)((char *)(w) - __builtin_offsetof(struct delayed_work, work)))
+
+// 系统默认工作队列
+extern struct workqueue *system_wq;
+
+// 工作队列接口
+void workqueue_init(void);
+struct workqueue *alloc_workqueue(const char *name, uint32_t max_active);
+bool queue_work(struct workqueue *wq, struct work_struct *work);
+bool queue_work_on(uint32_t cpu, struct workqueue *wq, struct work_struct *work);
+bool queue_delayed_work(struct workqueue *wq, struct delayed_work *dwork, uint32_t delay);
+bool schedule_work(struct work_struct *work);
+bool schedule_delayed_work(struct delayed_work *dwork, uint32_t delay);
+void flush_workqueue(struct workqueue *wq);
+void delayed_work_timer_fn(timer_list_t *timer);
+
+#endif // WORKQUEUE_H
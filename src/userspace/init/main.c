@@ -12,6 +12,20 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <signal.h>
+#include <spawn.h>
+
+extern char **environ;
+
+// shell的环境变量
+static char *shell_envp[] = {
+    "PATH=/bin:/sbin:/usr/bin:/usr/sbin:/usr/local/bin",
+    "HOME=/root",
+    "TERM=linux",
+    "USER=root",
+    "LOGNAME=root",
+    "SHELL=/bin/sh",
+    NULL
+};
 
 // 默认系统服务
 static const char* default_services[] = {
@@ -93,23 +107,21 @@ static int start_system_services(void)
     printf("启动系统服务...\n");
 
     for (int i = 0; default_services[i] != NULL; i++) {
-        pid_t pid = fork();
+        char *const argv[] = { (char *)default_services[i], NULL };
+        pid_t pid;
 
-        if (pid == 0) {
-            // 子进程
-            printf("启动服务: %s\n", default_services[i]);
-            execl(default_services[i], default_services[i], NULL);
+        // posix_spawn不复制init的地址空间，子进程直接exec
+        printf("启动服务: %s\n", default_services[i]);
+        int ret = posix_spawn(&pid, default_services[i], NULL, NULL, argv, environ);
 
-            // 如果exec失败
-            printf("错误: 无法启动服务 %s: %s\n",
-                   default_services[i], strerror(errno));
-            exit(1);
-        } else if (pid > 0) {
-            // 父进程
+        if (ret == 0) {
             printf("服务 %s 已启动 (PID: %d)\n",
                    default_services[i], pid);
+        } else if (ret == ENOENT || ret == EACCES) {
+            printf("错误: 无法启动服务 %s: %s\n",
+                   default_services[i], strerror(ret));
         } else {
-            printf("错误: fork失败: %s\n", strerror(errno));
+            printf("错误: 创建进程失败: %s\n", strerror(ret));
             return -1;
         }
     }
@@ -129,13 +141,11 @@ static int run_startup_scripts(void)
         if (access(startup_scripts[i], X_OK) == 0) {
             printf("执行脚本: %s\n", startup_scripts[i]);
 
-            pid_t pid = fork();
-            if (pid == 0) {
-                execl(startup_scripts[i], startup_scripts[i], NULL);
-                printf("错误: 无法执行脚本 %s: %s\n",
-                       startup_scripts[i], strerror(errno));
-                exit(1);
-            } else if (pid > 0) {
+            char *const argv[] = { (char *)startup_scripts[i], NULL };
+            pid_t pid;
+            int ret = posix_spawn(&pid, startup_scripts[i], NULL, NULL, argv, environ);
+
+            if (ret == 0) {
                 int status;
                 waitpid(pid, &status, 0);
 
@@ -143,8 +153,11 @@ static int run_startup_scripts(void)
                     printf("警告: 脚本 %s 执行失败，退出码: %d\n",
                            startup_scripts[i], WEXITSTATUS(status));
                 }
+            } else if (ret == ENOENT || ret == EACCES || ret == ENOEXEC) {
+                printf("错误: 无法执行脚本 %s: %s\n",
+                       startup_scripts[i], strerror(ret));
             } else {
-                printf("错误: fork失败: %s\n", strerror(errno));
+                printf("错误: 创建进程失败: %s\n", strerror(ret));
                 return -1;
             }
         } else {
@@ -212,35 +225,35 @@ static int start_shell(void)
 
     printf("启动shell: %s\n", shell);
 
-    pid_t pid = fork();
-    if (pid == 0) {
-        // 设置环境变量
-        setenv("PATH", "/bin:/sbin:/usr/bin:/usr/sbin:/usr/local/bin", 1);
-        setenv("HOME", "/root", 1);
-        setenv("TERM", "linux", 1);
-        setenv("USER", "root", 1);
-        setenv("LOGNAME", "root", 1);
+    /*
+     * posix_spawn没有可移植的切换目录的文件操作：在init中切到/root，
+     * 创建子进程后再切回
+     */
+    int cwd = open(".", O_RDONLY | O_DIRECTORY);
+    if (chdir("/root") != 0) {
+        printf("警告: 无法切换到/root: %s\n", strerror(errno));
+    }
 
-        // 切换到root目录
-        chdir("/root");
+    char *const argv[] = { (char *)shell, NULL };
+    pid_t pid;
+    int ret = posix_spawn(&pid, shell, NULL, NULL, argv, shell_envp);
 
-        // 启动shell
-        execl(shell, shell, NULL);
+    if (cwd >= 0) {
+        fchdir(cwd);
+        close(cwd);
+    }
 
-        // 如果exec失败
-        printf("错误: 无法启动shell: %s\n", strerror(errno));
-        exit(1);
-    } else if (pid > 0) {
-        // 等待shell退出
-        int status;
-        waitpid(pid, &status, 0);
-
-        printf("Shell已退出，状态: %d\n", WEXITSTATUS(status));
-        return WEXITSTATUS(status);
-    } else {
-        printf("错误: fork失败: %s\n", strerror(errno));
+    if (ret != 0) {
+        printf("错误: 无法启动shell: %s\n", strerror(ret));
         return -1;
     }
+
+    // 等待shell退出
+    int status;
+    waitpid(pid, &status, 0);
+
+    printf("Shell已退出，状态: %d\n", WEXITSTATUS(status));
+    return WEXITSTATUS(status);
 }
 
 /**
@@ -15,8 +15,10 @@
 #include <grp.h>
 #include <time.h>
 #include <errno.h>
+#include <sys/uring.h>
 
 #define LS_VERSION "1.0.0"
+#define URING_ENTRIES 64       /* stat requests per ring submission */
 
 /* Structure to hold file information */
 typedef struct {
@@ -50,6 +52,7 @@ static void print_usage(const char *program);
 static void print_version(void);
 static void parse_arguments(int argc, char *argv[], char **dirs, int *dir_count);
 static int collect_files(const char *path, file_info_t **files, int *count);
+static void stat_files_uring(file_info_t *files, int count, int *stat_ok);
 static void sort_files(file_info_t *files, int count);
 static int compare_name(const void *a, const void *b);
 static int compare_size(const void *a, const void *b);
@@ -213,7 +216,27 @@ static int collect_files(const char *path, file_info_t **files, int *count) {
 
         snprintf(info->path, sizeof(info->path), "%s/%s", path, entry->d_name);
 
-        if (stat(info->path, &info->statbuf) != 0) {
+        file_count++;
+    }
+
+    closedir(dir);
+
+    /*
+     * Stat every entry in one pass through the submission ring; entries
+     * the ring could not stat fall back to stat/lstat.
+     */
+    int *stat_ok = calloc(file_count > 0 ? file_count : 1, sizeof(int));
+    if (stat_ok == NULL) {
+        free(file_list);
+        return -1;
+    }
+    stat_files_uring(file_list, file_count, stat_ok);
+
+    int kept = 0;
+    for (int i = 0; i < file_count; i++) {
+        file_info_t *info = &file_list[i];
+
+        if (!stat_ok[i] && stat(info->path, &info->statbuf) != 0) {
             /* If stat fails, use lstat for broken symlinks */
             if (lstat(info->path, &info->statbuf) != 0) {
                 continue; /* Skip files we can't stat */
@@ -224,16 +247,54 @@ static int collect_files(const char *path, file_info_t **files, int *count) {
         info->is_link = S_ISLNK(info->statbuf.st_mode);
         info->is_exec = is_executable(&info->statbuf);
 
-        file_count++;
+        if (kept != i) {
+            file_list[kept] = *info;
+        }
+        kept++;
     }
-
-    closedir(dir);
+    free(stat_ok);
 
     *files = file_list;
-    *count = file_count;
+    *count = kept;
     return 0;
 }
 
+/*
+ * Queue a stat for each entry and submit up to URING_ENTRIES at a time,
+ * so a directory of N files costs N/URING_ENTRIES kernel entries rather
+ * than N. stat_ok[i] is set for each entry the ring stat'ed successfully.
+ * Must run after the list stops growing: the SQEs hold pointers into it.
+ */
+static void stat_files_uring(file_info_t *files, int count, int *stat_ok) {
+    uring_t ring;
+
+    if (count == 0 || uring_queue_init(URING_ENTRIES, 0, &ring) < 0) {
+        return;
+    }
+
+    for (int base = 0; base < count; base += URING_ENTRIES) {
+        int batch = count - base < URING_ENTRIES ? count - base : URING_ENTRIES;
+
+        for (int i = 0; i < batch; i++) {
+            uring_sqe_t *sqe = uring_get_sqe(&ring);
+            uring_prep_stat(sqe, files[base + i].path, &files[base + i].statbuf);
+            sqe->user_data = (uint64_t)(base + i);
+        }
+
+        if (uring_submit_and_wait(&ring, batch) < 0) {
+            break;
+        }
+
+        uring_cqe_t *cqe;
+        while ((cqe = uring_peek_cqe(&ring)) != NULL) {
+            stat_ok[cqe->user_data] = cqe->res >= 0;
+            uring_cqe_seen(&ring);
+        }
+    }
+
+    uring_queue_exit(&ring);
+}
+
 static void sort_files(file_info_t *files, int count) {
     if (size_sort) {
         qsort(files, count, sizeof(file_info_t), compare_size);
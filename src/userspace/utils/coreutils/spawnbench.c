@@ -0,0 +1,152 @@
+/*
+ * spawnbench.c - Process creation benchmark for Vest-OS
+ *
+ * Launches a command (default /bin/true) repeatedly and reports how
+ * many commands per second each creation path sustains: fork + exec,
+ * which duplicates the parent's address space only to throw it away,
+ * and posix_spawn, which shares the parent's memory until exec. The
+ * gap grows with the size of the parent, so an optional ballast
+ * allocation stands in for a large shell.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define SPAWNBENCH_VERSION "1.0.0"
+#define DEFAULT_ITERATIONS 1000
+#define DEFAULT_COMMAND "/bin/true"
+
+extern char **environ;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int wait_child(pid_t pid) {
+    int status;
+    if (waitpid(pid, &status, 0) < 0) {
+        return -1;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static int run_fork_exec(char *argv[]) {
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        execv(argv[0], argv);
+        _exit(127);
+    } else if (pid < 0) {
+        return -1;
+    }
+    return wait_child(pid);
+}
+
+static int run_posix_spawn(char *argv[]) {
+    pid_t pid;
+
+    if (posix_spawn(&pid, argv[0], NULL, NULL, argv, environ) != 0) {
+        return -1;
+    }
+    return wait_child(pid);
+}
+
+/* Commands per second, or a negative value if a launch failed */
+static double bench(const char *name, int (*run)(char *argv[]), char *argv[],
+                    unsigned long iterations) {
+    double start = now_seconds();
+
+    for (unsigned long i = 0; i < iterations; i++) {
+        if (run(argv) != 0) {
+            fprintf(stderr, "spawnbench: %s: launching %s failed\n", name, argv[0]);
+            return -1;
+        }
+    }
+
+    double elapsed = now_seconds() - start;
+    double rate = elapsed > 0 ? iterations / elapsed : 0;
+
+    printf("%-12s %10.0f commands/sec  (%.1f us/command)\n",
+           name, rate, elapsed * 1e6 / iterations);
+    return rate;
+}
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [-n ITERATIONS] [-m MEGABYTES] [COMMAND [ARG]...]\n", program);
+    printf("Time process creation through fork+exec and posix_spawn.\n\n");
+    printf("  -n ITERATIONS   launches per path (default %d)\n", DEFAULT_ITERATIONS);
+    printf("  -m MEGABYTES    touch this much memory first to enlarge the parent\n");
+    printf("  COMMAND         absolute path of the program to launch (default %s)\n",
+           DEFAULT_COMMAND);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long iterations = DEFAULT_ITERATIONS;
+    unsigned long ballast_mb = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:h")) != -1) {
+        char *end;
+        switch (opt) {
+        case 'n':
+            iterations = strtoul(optarg, &end, 10);
+            if (*end != '\0' || iterations == 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'm':
+            ballast_mb = strtoul(optarg, &end, 10);
+            if (*end != '\0') {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    char *default_argv[] = { DEFAULT_COMMAND, NULL };
+    char **cmd_argv = optind < argc ? &argv[optind] : default_argv;
+
+    if (ballast_mb > 0) {
+        size_t size = ballast_mb << 20;
+        char *ballast = malloc(size);
+        if (ballast == NULL) {
+            fprintf(stderr, "spawnbench: cannot allocate %lu MB\n", ballast_mb);
+            return 1;
+        }
+        /* Touch every page so fork has something to copy */
+        memset(ballast, 1, size);
+    }
+
+    printf("spawnbench %s: %lu launches of %s per path", SPAWNBENCH_VERSION,
+           iterations, cmd_argv[0]);
+    if (ballast_mb > 0) {
+        printf(", %lu MB parent", ballast_mb);
+    }
+    printf("\n");
+
+    double forked = bench("fork+exec", run_fork_exec, cmd_argv, iterations);
+    double spawned = bench("posix_spawn", run_posix_spawn, cmd_argv, iterations);
+
+    if (forked < 0 || spawned < 0) {
+        return 1;
+    }
+
+    if (forked > 0) {
+        printf("speedup:     %.2fx\n", spawned / forked);
+    }
+
+    return 0;
+}
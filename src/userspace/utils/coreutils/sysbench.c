@@ -0,0 +1,154 @@
+/*
+ * sysbench.c - Null system call microbenchmark for Vest-OS
+ *
+ * Times SYS_GETTID, which does no work in the kernel, through both
+ * system call entry paths: the int 0x80 interrupt gate and the
+ * SYSENTER/SYSEXIT fast path. The difference is the cost of the
+ * interrupt gate itself.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define SYSBENCH_VERSION "1.0.0"
+#define DEFAULT_ITERATIONS 1000000
+#define WARMUP_ITERATIONS 1000
+
+/* Must match src/kernel/include/kernel.h */
+#define SYS_GETTID 12
+
+static inline uint64_t read_tsc(void) {
+    uint32_t low, high;
+    __asm__ volatile ("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+/* CPUID.1:EDX bit 11; the kernel applies the same Pentium Pro quirk */
+static int cpu_has_sep(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ volatile ("cpuid"
+                      : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+                      : "a"(1));
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+
+    if (family == 6 && model < 3 && stepping < 3) {
+        return 0;
+    }
+    return (edx & (1u << 11)) != 0;
+}
+
+static inline int32_t syscall0_int80(uint32_t nr) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+                      : "=a"(ret)
+                      : "a"(nr)
+                      : "memory");
+    return ret;
+}
+
+/*
+ * SYSENTER does not save a return address or user stack, so push
+ * ecx, edx, ebp and the resume address and point ebp at them. The
+ * kernel resumes at the pushed address with esp just above it.
+ */
+static inline int32_t syscall0_sysenter(uint32_t nr) {
+    int32_t ret;
+    __asm__ volatile ("push %%ecx\n\t"
+                      "push %%edx\n\t"
+                      "push %%ebp\n\t"
+                      "push $1f\n\t"
+                      "mov %%esp, %%ebp\n\t"
+                      "sysenter\n"
+                      "1:\n\t"
+                      "pop %%ebp\n\t"
+                      "pop %%edx\n\t"
+                      "pop %%ecx"
+                      : "=a"(ret)
+                      : "a"(nr)
+                      : "memory", "cc");
+    return ret;
+}
+
+/* Cycles per call, averaged over iterations */
+static uint64_t bench_int80(unsigned long iterations) {
+    for (unsigned long i = 0; i < WARMUP_ITERATIONS; i++) {
+        syscall0_int80(SYS_GETTID);
+    }
+
+    uint64_t start = read_tsc();
+    for (unsigned long i = 0; i < iterations; i++) {
+        syscall0_int80(SYS_GETTID);
+    }
+    return (read_tsc() - start) / iterations;
+}
+
+static uint64_t bench_sysenter(unsigned long iterations) {
+    for (unsigned long i = 0; i < WARMUP_ITERATIONS; i++) {
+        syscall0_sysenter(SYS_GETTID);
+    }
+
+    uint64_t start = read_tsc();
+    for (unsigned long i = 0; i < iterations; i++) {
+        syscall0_sysenter(SYS_GETTID);
+    }
+    return (read_tsc() - start) / iterations;
+}
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [ITERATIONS]\n", program);
+    printf("Time a null system call through int 0x80 and SYSENTER.\n");
+    printf("Default: %d iterations.\n", DEFAULT_ITERATIONS);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long iterations = DEFAULT_ITERATIONS;
+
+    if (argc > 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (argc == 2) {
+        char *end;
+        iterations = strtoul(argv[1], &end, 10);
+        if (*end != '\0' || iterations == 0) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    printf("sysbench %s: %lu null system calls per path\n", SYSBENCH_VERSION, iterations);
+
+    /* Both paths must agree before the numbers mean anything */
+    int32_t tid = syscall0_int80(SYS_GETTID);
+    if (tid < 0) {
+        fprintf(stderr, "sysbench: SYS_GETTID failed (%d)\n", tid);
+        return 1;
+    }
+
+    uint64_t int80 = bench_int80(iterations);
+    printf("int 0x80: %llu cycles/call\n", (unsigned long long)int80);
+
+    if (!cpu_has_sep()) {
+        printf("sysenter: not supported by this CPU\n");
+        return 0;
+    }
+
+    if (syscall0_sysenter(SYS_GETTID) != tid) {
+        fprintf(stderr, "sysbench: sysenter returned a different thread ID\n");
+        return 1;
+    }
+
+    uint64_t sysenter = bench_sysenter(iterations);
+    printf("sysenter: %llu cycles/call\n", (unsigned long long)sysenter);
+
+    if (sysenter > 0) {
+        printf("speedup:  %llu.%02llux\n",
+               (unsigned long long)(int80 / sysenter),
+               (unsigned long long)(int80 * 100 / sysenter % 100));
+    }
+
+    return 0;
+}
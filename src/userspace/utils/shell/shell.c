@@ -11,8 +11,11 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <signal.h>
+#include <spawn.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/klog.h>
+#include <sys/kstat.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 
@@ -20,6 +23,13 @@
 #define MAX_CMD_LEN 1024
 #define MAX_ARGS 64
 
+extern char **environ;
+
+// klogctl操作码
+#define SYSLOG_ACTION_READ_ALL    3
+#define SYSLOG_ACTION_READ_CLEAR  4
+#define SYSLOG_ACTION_SIZE_BUFFER 10
+
 // 内置命令结构
 struct builtin_command {
     const char *name;
@@ -40,6 +50,11 @@ static int builtin_rm(int argc, char *argv[]);
 static int builtin_clear(int argc, char *argv[]);
 static int builtin_ps(int argc, char *argv[]);
 static int builtin_kill(int argc, char *argv[]);
+static int builtin_dmesg(int argc, char *argv[]);
+static int builtin_lockstat(int argc, char *argv[]);
+static int builtin_interrupts(int argc, char *argv[]);
+static int builtin_tickstat(int argc, char *argv[]);
+static int builtin_syscalls(int argc, char *argv[]);
 static int builtin_reboot(int argc, char *argv[]);
 static int builtin_shutdown(int argc, char *argv[]);
 
@@ -57,6 +72,11 @@ static struct builtin_command builtin_commands[] = {
     {"clear", builtin_clear, "清屏"},
     {"ps", builtin_ps, "显示进程列表"},
     {"kill", builtin_kill, "发送信号到进程"},
+    {"dmesg", builtin_dmesg, "显示内核日志 (-c 读取后清除)"},
+    {"lockstat", builtin_lockstat, "显示锁竞争统计 (-c 清零)"},
+    {"interrupts", builtin_interrupts, "显示各中断向量的计数和耗时"},
+    {"tickstat", builtin_tickstat, "显示每CPU每秒唤醒次数和停掉的时钟节拍"},
+    {"syscalls", builtin_syscalls, "显示各系统调用的次数和耗时"},
     {"reboot", builtin_reboot, "重启系统"},
     {"shutdown", builtin_shutdown, "关闭系统"},
     {NULL, NULL, NULL}
@@ -122,36 +142,106 @@ static struct builtin_command* find_builtin(const char *name)
     return NULL;
 }
 
+/**
+ * 把argv中的重定向（< file、> file、>> file、2> file，操作符与文件名
+ * 可以连写）转换成spawn的文件操作，并从argv中删去
+ * @return 剩余参数个数，-1语法错误
+ */
+static int parse_redirections(int argc, char *argv[], posix_spawn_file_actions_t *actions)
+{
+    int out = 0;
+
+    for (int i = 0; i < argc; i++) {
+        char *arg = argv[i];
+        int fd, flags;
+
+        if (strncmp(arg, "2>", 2) == 0) {
+            fd = STDERR_FILENO;
+            flags = O_WRONLY | O_CREAT | O_TRUNC;
+            arg += 2;
+        } else if (strncmp(arg, ">>", 2) == 0) {
+            fd = STDOUT_FILENO;
+            flags = O_WRONLY | O_CREAT | O_APPEND;
+            arg += 2;
+        } else if (arg[0] == '>') {
+            fd = STDOUT_FILENO;
+            flags = O_WRONLY | O_CREAT | O_TRUNC;
+            arg += 1;
+        } else if (arg[0] == '<') {
+            fd = STDIN_FILENO;
+            flags = O_RDONLY;
+            arg += 1;
+        } else {
+            argv[out++] = arg;
+            continue;
+        }
+
+        // 操作符后单独的文件名
+        if (*arg == '\0') {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "sh: 重定向缺少文件名\n");
+                return -1;
+            }
+            arg = argv[++i];
+        }
+
+        posix_spawn_file_actions_addopen(actions, fd, arg, flags, 0644);
+    }
+
+    argv[out] = NULL;
+    return out;
+}
+
 /**
  * 执行外部命令
+ *
+ * 用posix_spawn创建子进程：不复制shell的地址空间，子进程在exec之前
+ * 与shell共享内存，重定向作为文件操作在exec之前于子进程中执行
  */
 static int execute_external_command(int argc, char *argv[])
 {
-    pid_t pid = fork();
-
-    if (pid == 0) {
-        // 子进程
-        execvp(argv[0], argv);
-
-        // 如果exec失败
-        fprintf(stderr, "sh: %s: %s\n", argv[0], strerror(errno));
-        exit(127);
-    } else if (pid > 0) {
-        // 父进程
-        int status;
-        waitpid(pid, &status, 0);
-
-        if (WIFEXITED(status)) {
-            return WEXITSTATUS(status);
-        } else if (WIFSIGNALED(status)) {
-            fprintf(stderr, "sh: 程序被信号 %d 终止\n", WTERMSIG(status));
-            return 128 + WTERMSIG(status);
-        }
-        return 1;
-    } else {
-        fprintf(stderr, "sh: fork失败: %s\n", strerror(errno));
-        return 1;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t sigdefault;
+    pid_t pid;
+    int ret;
+
+    posix_spawn_file_actions_init(&actions);
+
+    argc = parse_redirections(argc, argv, &actions);
+    if (argc <= 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return argc < 0 ? 2 : 0;
+    }
+
+    // shell忽略的信号在子进程中恢复默认处理
+    posix_spawnattr_init(&attr);
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGINT);
+    sigaddset(&sigdefault, SIGQUIT);
+    posix_spawnattr_setsigdefault(&attr, &sigdefault);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    ret = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (ret != 0) {
+        fprintf(stderr, "sh: %s: %s\n", argv[0], strerror(ret));
+        return 127;
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        fprintf(stderr, "sh: 程序被信号 %d 终止\n", WTERMSIG(status));
+        return 128 + WTERMSIG(status);
     }
+    return 1;
 }
 
 /**
@@ -333,14 +423,64 @@ static int builtin_clear(int argc, char *argv[])
     return 0;
 }
 
+// 统计表输出缓冲区大小（与内核单次输出的上限一致）
+#define KSTAT_BUF_SIZE (16 * 1024)
+
+/**
+ * 在KSTAT_SCHED表中查找线程的运行时间和就绪等待时间（纳秒），找到返回1
+ */
+static int sched_stat_lookup(const char *table, int tid,
+                             unsigned long long *run_ns, unsigned long long *wait_ns)
+{
+    const char *line = strchr(table, '\n');     // 跳过表头
+
+    while (line && *++line) {
+        int id;
+        char name[32];
+        unsigned long long run, wait;
+
+        if (sscanf(line, "%d %31s %llu %llu", &id, name, &run, &wait) == 4 && id == tid) {
+            *run_ns = run;
+            *wait_ns = wait;
+            return 1;
+        }
+        line = strchr(line, '\n');
+    }
+
+    return 0;
+}
+
 static int builtin_ps(int argc, char *argv[])
 {
-    printf("PID   PPID  STAT COMMAND\n");
+    // 调度统计来自SYS_KSTAT的KSTAT_SCHED表，每个线程一行
+    char *sched = malloc(KSTAT_BUF_SIZE);
+    if (!sched) {
+        fprintf(stderr, "ps: 内存不足\n");
+        return 1;
+    }
+    if (kstat(KSTAT_SCHED, KSTAT_READ, sched, KSTAT_BUF_SIZE) < 0) {
+        sched[0] = '\0';
+    }
+
+    printf("PID   PPID  STAT   RUNTIME     WAIT COMMAND\n");
 
     DIR *dir = opendir("/proc");
     if (!dir) {
-        fprintf(stderr, "ps: 无法访问/proc目录\n");
-        return 1;
+        // 没有procfs：只列出调度统计表中的线程
+        const char *line = strchr(sched, '\n');
+        while (line && *++line) {
+            int tid;
+            char name[32];
+            unsigned long long run_ns, wait_ns;
+
+            if (sscanf(line, "%d %31s %llu %llu", &tid, name, &run_ns, &wait_ns) == 4) {
+                printf("%-5d %-5s %-4c %7llums %6llums %s\n", tid, "-", '-',
+                       run_ns / 1000000, wait_ns / 1000000, name);
+            }
+            line = strchr(line, '\n');
+        }
+        free(sched);
+        return 0;
     }
 
     struct dirent *entry;
@@ -359,13 +499,20 @@ static int builtin_ps(int argc, char *argv[])
                 char comm[256];
 
                 fscanf(stat_file, "%d %s %c %d", &pid, comm, &state, &ppid);
-                printf("%-5d %-5d %-4c %s\n", pid, ppid, state, comm);
                 fclose(stat_file);
+
+                // 调度统计：运行时间和就绪等待时间（纳秒）
+                unsigned long long run_ns = 0, wait_ns = 0;
+                sched_stat_lookup(sched, pid, &run_ns, &wait_ns);
+
+                printf("%-5d %-5d %-4c %7llums %6llums %s\n", pid, ppid, state,
+                       run_ns / 1000000, wait_ns / 1000000, comm);
             }
         }
     }
 
     closedir(dir);
+    free(sched);
     return 0;
 }
 
@@ -394,6 +541,104 @@ static int builtin_kill(int argc, char *argv[])
     return 0;
 }
 
+static int builtin_dmesg(int argc, char *argv[])
+{
+    int action = SYSLOG_ACTION_READ_ALL;
+
+    if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+        action = SYSLOG_ACTION_READ_CLEAR;
+    }
+
+    int size = klogctl(SYSLOG_ACTION_SIZE_BUFFER, NULL, 0);
+    if (size <= 0) {
+        size = 16384;
+    }
+
+    char *buffer = malloc(size);
+    if (!buffer) {
+        fprintf(stderr, "dmesg: 内存不足\n");
+        return 1;
+    }
+
+    int len = klogctl(action, buffer, size);
+    if (len < 0) {
+        fprintf(stderr, "dmesg: %s\n", strerror(errno));
+        free(buffer);
+        return 1;
+    }
+
+    fwrite(buffer, 1, len, stdout);
+    if (len > 0 && buffer[len - 1] != '\n') {
+        printf("\n");
+    }
+
+    free(buffer);
+    return 0;
+}
+
+/**
+ * 经SYS_KSTAT输出一张内核统计表
+ */
+static int show_kstat(const char *cmd, uint32_t table)
+{
+    char *buffer = malloc(KSTAT_BUF_SIZE);
+    if (!buffer) {
+        fprintf(stderr, "%s: 内存不足\n", cmd);
+        return 1;
+    }
+
+    int32_t len = kstat(table, KSTAT_READ, buffer, KSTAT_BUF_SIZE);
+    if (len < 0) {
+        fprintf(stderr, "%s: 无法读取统计%s\n", cmd,
+                len == KSTAT_ENOENT ? "（内核未启用）" : "");
+        free(buffer);
+        return 1;
+    }
+
+    fwrite(buffer, 1, len, stdout);
+    free(buffer);
+    return 0;
+}
+
+static int builtin_lockstat(int argc, char *argv[])
+{
+    // 内核需以CONFIG_LOCK_STAT（make LOCK_STAT=1）构建才有这张表
+    if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+        if (kstat(KSTAT_LOCK, KSTAT_CLEAR, NULL, 0) < 0) {
+            fprintf(stderr, "lockstat: 无法清零统计\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    return show_kstat("lockstat", KSTAT_LOCK);
+}
+
+static int builtin_interrupts(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    return show_kstat("interrupts", KSTAT_INTERRUPTS);
+}
+
+static int builtin_tickstat(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    // 每秒唤醒次数按距上次读取的时间计算
+    return show_kstat("tickstat", KSTAT_TICK);
+}
+
+static int builtin_syscalls(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    return show_kstat("syscalls", KSTAT_SYSCALLS);
+}
+
 static int builtin_reboot(int argc, char *argv[])
 {
     printf("正在重启系统...\n");